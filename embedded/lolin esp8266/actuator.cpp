@@ -0,0 +1,539 @@
+#include "actuator.h"
+
+#ifndef ARDUINO
+#include <stdio.h>
+#define PROGMEM
+#endif
+
+//Timer / pin backend: timer1 and direct GPIO registers on target, ActuatorMockTimer on the host.
+//Everything the interrupt reaches is IRAM_ATTR: flash (checkpoint EEPROM writes) may be busy.
+#ifdef ARDUINO
+
+static ServoActuator* activeActuator = nullptr;
+
+static void IRAM_ATTR actuatorTimerIsr() {
+    activeActuator->onTimer();
+}
+
+#define ACTUATOR_NOW()       micros()
+#define ACTUATOR_LOCK()      noInterrupts()
+#define ACTUATOR_UNLOCK()    interrupts()
+
+//TIM_DIV16: 80 MHz / 16 = 5 ticks per us
+static inline void IRAM_ATTR actuatorTimerArm(uint32_t delay_us) {
+    timer1_write(delay_us * 5);
+}
+
+static inline void IRAM_ATTR actuatorPinWrite(uint8_t pin, bool high) {
+    if (high) {
+        GPOS = (1u << pin);
+    } else {
+        GPOC = (1u << pin);
+    }
+}
+
+#else
+
+#define ACTUATOR_NOW()       ActuatorMockTimer::now()
+#define ACTUATOR_LOCK()
+#define ACTUATOR_UNLOCK()
+
+static inline void actuatorTimerArm(uint32_t delay_us) {
+    ActuatorMockTimer::arm(delay_us);
+}
+
+static inline void actuatorPinWrite(uint8_t pin, bool high) {
+    (void)pin;
+    ActuatorMockTimer::writePin(high);
+}
+
+#endif
+
+//Fixed-width rows so the whole table stays in flash; print on target with FPSTR()
+static const char ACTUATOR_COMMAND_NAMES[][5] PROGMEM = { "ARM", "FIRE", "SAFE" };
+static const char ACTUATOR_STATE_NAMES[][6] PROGMEM = { "SAFE", "ARMED", "FIRED" };
+static const char ACTUATOR_OUTCOME_NAMES[][14] PROGMEM = { "done", "not permitted", "not armed", "cancelled", "timeout" };
+
+//Wrap-safe: a at or after b on the micros() clock
+static inline bool IRAM_ATTR reached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+//Keep the earliest deadline (relative to now)
+static inline void IRAM_ATTR earliest(uint32_t now, uint32_t candidate, uint32_t& best) {
+    if ((int32_t)(candidate - now) < (int32_t)(best - now)) {
+        best = candidate;
+    }
+}
+
+
+ServoActuator::ServoActuator()
+    : pin(0),
+      begun(false),
+      armAllowed(false),
+      fireAllowed(false),
+      queueCount(0),
+      state(ActuatorState::SAFE),
+      armed_us(0),
+      driving(false),
+      pulseHigh(false),
+      pulseWidth_us(ACTUATOR_PULSE_LOCKED_US),
+      targetWidth_us(ACTUATOR_PULSE_LOCKED_US),
+      widthChanged(false),
+      pulseStart_us(0),
+      pulseEnd_us(0),
+      nextFrame_us(0),
+      eventsWritten(0),
+      eventsRead(0),
+      edgeEvent(-1),
+      executed(0),
+      refused(0),
+      maxLate_us(0) {
+}
+
+bool ServoActuator::begin(uint8_t servoPin) {
+    if (servoPin > 15) {
+        return false;
+    }
+    pin = servoPin;
+#ifdef ARDUINO
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    activeActuator = this;
+    timer1_isr_init();
+    timer1_attachInterrupt(actuatorTimerIsr);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+    Serial.print(F("[ACT] Release servo on GPIO"));
+    Serial.print(pin);
+    Serial.println(F(", timer1"));
+#else
+    ActuatorMockTimer::attach(this);
+    actuatorPinWrite(pin, false);
+#endif
+    begun = true;
+    return true;
+}
+
+void ServoActuator::setInterlocks(bool arm, bool fire) {
+    armAllowed = arm;
+    fireAllowed = fire;
+}
+
+bool ServoActuator::schedule(ActuatorCommand command, uint32_t due_us, uint32_t decision_us) {
+    Pending p = { command, due_us, decision_us };
+    ACTUATOR_LOCK();
+    bool ok = queueCount < ACTUATOR_QUEUE_SIZE;
+    if (ok) {
+        insert(p);
+        if (begun) {
+            armTimer(ACTUATOR_NOW());
+        }
+    }
+    ACTUATOR_UNLOCK();
+    return ok;
+}
+
+bool ServoActuator::scheduleRelease(uint32_t decision_us) {
+    ACTUATOR_LOCK();
+    bool armPending = false;
+    uint32_t armDue_us = 0;
+    for (uint8_t i = 0; i < queueCount; i++) {
+        if (queue[i].command == ActuatorCommand::ARM) {
+            armPending = true;
+            armDue_us = queue[i].due_us;
+            break;
+        }
+    }
+    bool armed = state == ActuatorState::ARMED;
+    uint8_t needed = armed || armPending ? 2 : 3;
+    if (queueCount + needed > ACTUATOR_QUEUE_SIZE) {
+        ACTUATOR_UNLOCK();
+        return false;
+    }
+
+    //FIRE as soon as the ARM has settled, never before the decision
+    uint32_t fire_us;
+    if (armed) {
+        fire_us = armed_us + ACTUATOR_ARM_SETTLE_US;
+    } else if (armPending) {
+        fire_us = armDue_us + ACTUATOR_ARM_SETTLE_US;
+    } else {
+        Pending arm = { ActuatorCommand::ARM, decision_us, decision_us };
+        insert(arm);
+        fire_us = decision_us + ACTUATOR_ARM_SETTLE_US;
+    }
+    if (!reached(fire_us, decision_us)) {
+        fire_us = decision_us;
+    }
+    Pending fire = { ActuatorCommand::FIRE, fire_us, decision_us };
+    Pending safe = { ActuatorCommand::SAFE, fire_us + ACTUATOR_RELEASE_HOLD_US, decision_us };
+    insert(fire);
+    insert(safe);
+    if (begun) {
+        armTimer(ACTUATOR_NOW());
+    }
+    ACTUATOR_UNLOCK();
+    return true;
+}
+
+void ServoActuator::abort(uint32_t decision_us) {
+    ACTUATOR_LOCK();
+    uint32_t now = ACTUATOR_NOW();
+    for (uint8_t i = 0; i < queueCount; i++) {
+        logEvent(queue[i], ActuatorOutcome::CANCELLED, now);
+    }
+    queueCount = 0;
+    Pending safe = { ActuatorCommand::SAFE, now, decision_us };
+    execute(safe, now, false);
+    if (begun) {
+        armTimer(now);
+    }
+    ACTUATOR_UNLOCK();
+}
+
+ActuatorState ServoActuator::getState() const {
+    return state;
+}
+
+uint8_t ServoActuator::getPending() const {
+    return queueCount;
+}
+
+bool ServoActuator::isArmPending() const {
+    for (uint8_t i = 0; i < queueCount; i++) {
+        if (queue[i].command == ActuatorCommand::ARM) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ServoActuator::popEvent(ActuatorEvent& event) {
+    ACTUATOR_LOCK();
+    //Reader lapped by the interrupt: skip to the oldest entry still in the log
+    if ((uint8_t)(eventsWritten - eventsRead) > ACTUATOR_EVENT_LOG) {
+        eventsRead = (uint8_t)(eventsWritten - ACTUATOR_EVENT_LOG);
+    }
+    uint8_t index = eventsRead % ACTUATOR_EVENT_LOG;
+    bool ready = eventsRead != eventsWritten && (int8_t)index != edgeEvent;
+    if (ready) {
+        event = events[index];
+        eventsRead++;
+    }
+    ACTUATOR_UNLOCK();
+    return ready;
+}
+
+void ServoActuator::printEvent(const ActuatorEvent& e) {
+    const char* command = ACTUATOR_COMMAND_NAMES[(uint8_t)e.command];
+    const char* outcome = ACTUATOR_OUTCOME_NAMES[(uint8_t)e.outcome];
+    bool actuated = e.outcome == ActuatorOutcome::DONE || e.outcome == ActuatorOutcome::TIMEOUT;
+#ifdef ARDUINO
+    Serial.print(F("[ACT] "));
+    Serial.print(FPSTR(command));
+    Serial.print(' ');
+    Serial.print(FPSTR(outcome));
+    if (actuated) {
+        Serial.print(F(": decision->edge "));
+        Serial.print(e.edge_us - e.decision_us);
+        Serial.print(F(" us (timer late "));
+        Serial.print(e.applied_us - e.due_us);
+        Serial.print(F(" us, irq->edge "));
+        Serial.print(e.edge_us - e.applied_us);
+        Serial.print(F(" us)"));
+    }
+    Serial.println();
+#else
+    printf("[ACT] %s %s", command, outcome);
+    if (actuated) {
+        printf(": decision->edge %u us (timer late %u us, irq->edge %u us)",
+               (unsigned)(e.edge_us - e.decision_us), (unsigned)(e.applied_us - e.due_us),
+               (unsigned)(e.edge_us - e.applied_us));
+    }
+    printf("\n");
+#endif
+}
+
+void ServoActuator::printStatus() const {
+#ifdef ARDUINO
+    Serial.print(F("  Servo:   "));
+    Serial.print(FPSTR(ACTUATOR_STATE_NAMES[(uint8_t)state]));
+    Serial.print(F(", "));
+    Serial.print(queueCount);
+    Serial.print(F(" pending, "));
+    Serial.print(executed);
+    Serial.print(F(" executed, "));
+    Serial.print(refused);
+    Serial.print(F(" refused, timer late max "));
+    Serial.print(maxLate_us);
+    Serial.println(F(" us"));
+#else
+    printf("  Servo:   %s, %u pending, %u executed, %u refused, timer late max %u us\n",
+           ACTUATOR_STATE_NAMES[(uint8_t)state], (unsigned)queueCount, (unsigned)executed,
+           (unsigned)refused, (unsigned)maxLate_us);
+#endif
+}
+
+/**
+ Runs at every programmed deadline (pulse end, frame start, command due, arm
+ timeout). Extra calls are harmless, everything is checked against the clock.
+ */
+void IRAM_ATTR ServoActuator::onTimer() {
+    uint32_t now = ACTUATOR_NOW();
+
+    //End the pulse in progress, never early
+    if (pulseHigh && reached(now, pulseStart_us + pulseWidth_us)) {
+        actuatorPinWrite(pin, false);
+        pulseHigh = false;
+        pulseEnd_us = now;
+        if (!driving && edgeEvent >= 0) {
+            events[edgeEvent].edge_us = now;     //SAFE: that was the last pulse
+            edgeEvent = -1;
+        }
+    }
+
+    while (queueCount > 0 && reached(now, queue[0].due_us)) {
+        Pending command = queue[0];
+        queueCount--;
+        for (uint8_t i = 0; i < queueCount; i++) {
+            queue[i] = queue[i + 1];
+        }
+        if (now - command.due_us > maxLate_us) {
+            maxLate_us = now - command.due_us;
+        }
+        execute(command, now, false);
+    }
+
+    if (state == ActuatorState::ARMED && reached(now, armed_us + ACTUATOR_ARM_TIMEOUT_US)) {
+        Pending safe = { ActuatorCommand::SAFE, now, now };
+        execute(safe, now, true);
+    }
+
+    //New width: restart the frame once the minimum gap has passed
+    //(elapsed time unsigned: pulseEnd_us may be from long ago, before an ARM)
+    if (driving && !pulseHigh &&
+        (reached(now, nextFrame_us) || (widthChanged && now - pulseEnd_us >= ACTUATOR_MIN_GAP_US))) {
+        startPulse(now);
+    }
+
+    armTimer(now);
+}
+
+void IRAM_ATTR ServoActuator::insert(const Pending& command) {
+    //Sorted by due time, FIFO among equal times
+    uint8_t i = queueCount;
+    while (i > 0 && !reached(command.due_us, queue[i - 1].due_us)) {
+        queue[i] = queue[i - 1];
+        i--;
+    }
+    queue[i] = command;
+    queueCount++;
+}
+
+//A command that changes the output takes over edgeEvent: one it replaces before
+//its first pulse never reached the servo and keeps edge_us = 0
+void IRAM_ATTR ServoActuator::execute(const Pending& command, uint32_t now, bool timeout) {
+    switch (command.command) {
+        case ActuatorCommand::ARM:
+            if (!armAllowed) {
+                logEvent(command, ActuatorOutcome::NOT_PERMITTED, now);
+                return;
+            }
+            if (state != ActuatorState::SAFE) {
+                logEvent(command, state == ActuatorState::ARMED ? ActuatorOutcome::DONE : ActuatorOutcome::NOT_PERMITTED, now);
+                return;
+            }
+            state = ActuatorState::ARMED;
+            armed_us = now;
+            driving = true;
+            targetWidth_us = ACTUATOR_PULSE_LOCKED_US;
+            widthChanged = true;
+            edgeEvent = (int8_t)logEvent(command, ActuatorOutcome::DONE, now);
+            break;
+
+        case ActuatorCommand::FIRE:
+            if (!fireAllowed) {
+                logEvent(command, ActuatorOutcome::NOT_PERMITTED, now);
+                return;
+            }
+            if (state != ActuatorState::ARMED) {
+                logEvent(command, ActuatorOutcome::NOT_ARMED, now);
+                return;
+            }
+            if (!reached(now, armed_us + ACTUATOR_ARM_SETTLE_US)) {
+                //Servo still moving to LOCKED (or the ARM interrupt ran late): wait for it
+                Pending deferred = command;
+                deferred.due_us = armed_us + ACTUATOR_ARM_SETTLE_US;
+                insert(deferred);
+                return;
+            }
+            state = ActuatorState::FIRED;
+            targetWidth_us = ACTUATOR_PULSE_RELEASED_US;
+            widthChanged = true;
+            edgeEvent = (int8_t)logEvent(command, ActuatorOutcome::DONE, now);
+            break;
+
+        case ActuatorCommand::SAFE: {
+            state = ActuatorState::SAFE;
+            driving = false;
+            widthChanged = false;
+            uint8_t index = logEvent(command, timeout ? ActuatorOutcome::TIMEOUT : ActuatorOutcome::DONE, now);
+            if (pulseHigh) {
+                edgeEvent = (int8_t)index;       //output goes quiet when this pulse ends
+            } else {
+                edgeEvent = -1;
+                events[index].edge_us = now;
+            }
+            break;
+        }
+    }
+}
+
+uint8_t IRAM_ATTR ServoActuator::logEvent(const Pending& command, ActuatorOutcome outcome, uint32_t now) {
+    uint8_t index = eventsWritten % ACTUATOR_EVENT_LOG;
+    ActuatorEvent& e = events[index];
+    e.command = command.command;
+    e.outcome = outcome;
+    e.decision_us = command.decision_us;
+    e.due_us = command.due_us;
+    e.applied_us = now;
+    e.edge_us = 0;
+    eventsWritten++;
+
+    if (outcome == ActuatorOutcome::NOT_PERMITTED || outcome == ActuatorOutcome::NOT_ARMED) {
+        refused++;
+    } else if (outcome != ActuatorOutcome::CANCELLED) {
+        executed++;
+    }
+    return index;
+}
+
+void IRAM_ATTR ServoActuator::startPulse(uint32_t now) {
+    actuatorPinWrite(pin, true);
+    pulseHigh = true;
+    pulseStart_us = now;
+    pulseWidth_us = targetWidth_us;
+    nextFrame_us = now + ACTUATOR_FRAME_US;
+    if (widthChanged) {
+        widthChanged = false;
+        if (edgeEvent >= 0) {
+            events[edgeEvent].edge_us = now;
+            edgeEvent = -1;
+        }
+    }
+}
+
+//Program the next shot at the earliest pending deadline (none: timer stays idle)
+void IRAM_ATTR ServoActuator::armTimer(uint32_t now) {
+    uint32_t next = now + ACTUATOR_TIMER_MAX_US;
+    bool needed = false;
+    if (pulseHigh) {
+        earliest(now, pulseStart_us + pulseWidth_us, next);
+        needed = true;
+    } else if (driving) {
+        earliest(now, nextFrame_us, next);
+        if (widthChanged) {
+            uint32_t gap = now - pulseEnd_us;
+            earliest(now, gap >= ACTUATOR_MIN_GAP_US ? now : now + ACTUATOR_MIN_GAP_US - gap, next);
+        }
+        needed = true;
+    }
+    if (queueCount > 0) {
+        earliest(now, queue[0].due_us, next);
+        needed = true;
+    }
+    if (state == ActuatorState::ARMED) {
+        earliest(now, armed_us + ACTUATOR_ARM_TIMEOUT_US, next);
+        needed = true;
+    }
+    if (!needed) {
+        return;
+    }
+
+    int32_t delay = (int32_t)(next - now);
+    if (delay < ACTUATOR_TIMER_MIN_US) {
+        delay = ACTUATOR_TIMER_MIN_US;
+    }
+    actuatorTimerArm((uint32_t)delay);
+}
+
+
+#ifndef ARDUINO
+
+static ServoActuator* mockActuator = nullptr;
+static uint32_t mockNow_us = 0;
+static bool mockArmed = false;
+static uint32_t mockDue_us = 0;
+static uint32_t mockLatency_us = 0;
+static uint32_t mockEdgeTime[ActuatorMockTimer::MAX_EDGES];
+static bool mockEdgeLevel[ActuatorMockTimer::MAX_EDGES];
+static uint32_t mockEdges = 0;            //total recorded, ring of MAX_EDGES
+static bool mockLevel = false;
+
+void ActuatorMockTimer::reset(uint32_t start_us) {
+    mockNow_us = start_us;
+    mockArmed = false;
+    mockLatency_us = 0;
+    mockLevel = false;
+    clearEdges();
+}
+
+uint32_t ActuatorMockTimer::now() {
+    return mockNow_us;
+}
+
+void ActuatorMockTimer::advanceTo(uint32_t t_us) {
+    //Single-shot timer: each interrupt programs the next one
+    while (mockArmed && (int32_t)(mockDue_us + mockLatency_us - t_us) <= 0) {
+        mockNow_us = mockDue_us + mockLatency_us;
+        mockArmed = false;
+        if (mockActuator != nullptr) {
+            mockActuator->onTimer();
+        }
+    }
+    mockNow_us = t_us;
+}
+
+void ActuatorMockTimer::setInterruptLatency(uint32_t latency_us) {
+    mockLatency_us = latency_us;
+}
+
+void ActuatorMockTimer::attach(ServoActuator* actuator) {
+    mockActuator = actuator;
+}
+
+void ActuatorMockTimer::arm(uint32_t delay_us) {
+    mockDue_us = mockNow_us + delay_us;
+    mockArmed = true;
+}
+
+void ActuatorMockTimer::writePin(bool high) {
+    if (high == mockLevel) {
+        return;
+    }
+    mockLevel = high;
+    uint16_t index = (uint16_t)(mockEdges % MAX_EDGES);
+    mockEdgeTime[index] = mockNow_us;
+    mockEdgeLevel[index] = high;
+    mockEdges++;
+}
+
+uint16_t ActuatorMockTimer::getEdgeCount() {
+    return (uint16_t)(mockEdges < MAX_EDGES ? mockEdges : MAX_EDGES);
+}
+
+uint32_t ActuatorMockTimer::getEdgeTime(uint16_t index) {
+    uint32_t first = mockEdges < MAX_EDGES ? 0 : mockEdges - MAX_EDGES;
+    return mockEdgeTime[(first + index) % MAX_EDGES];
+}
+
+bool ActuatorMockTimer::getEdgeLevel(uint16_t index) {
+    uint32_t first = mockEdges < MAX_EDGES ? 0 : mockEdges - MAX_EDGES;
+    return mockEdgeLevel[(first + index) % MAX_EDGES];
+}
+
+void ActuatorMockTimer::clearEdges() {
+    mockEdges = 0;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+//Servo frame and positions of the parachute release pin
+#define ACTUATOR_FRAME_US           20000    //50 Hz servo frame
+#define ACTUATOR_MIN_GAP_US         3000     //shortest low time when a frame is restarted early
+#define ACTUATOR_PULSE_LOCKED_US    1000     //release pin engaged (ARM holds it here)
+#define ACTUATOR_PULSE_RELEASED_US  2000     //release pin pulled (FIRE)
+
+//Release sequence
+#define ACTUATOR_ARM_SETTLE_US      100000   //servo powered and holding LOCKED before FIRE is accepted
+#define ACTUATOR_RELEASE_HOLD_US    1500000  //drive RELEASED this long, then SAFE (servo unpowered)
+#define ACTUATOR_ARM_TIMEOUT_US     5000000  //ARMED without FIRE: back to SAFE on its own
+
+#define ACTUATOR_QUEUE_SIZE         8        //pending timed commands
+#define ACTUATOR_EVENT_LOG          8        //executed commands kept for the main loop
+#define ACTUATOR_TIMER_MAX_US       1000000  //longest single timer shot (timer1 at DIV16 tops out at 1.67 s)
+#define ACTUATOR_TIMER_MIN_US       10       //shorter shots are rounded up (interrupt entry cost)
+
+
+enum class ActuatorCommand : uint8_t {
+    ARM,        //start the servo frame at LOCKED
+    FIRE,       //move to RELEASED
+    SAFE        //stop the frame after the current pulse (servo holds mechanically)
+};
+
+enum class ActuatorState : uint8_t {
+    SAFE,
+    ARMED,
+    FIRED
+};
+
+enum class ActuatorOutcome : uint8_t {
+    DONE,
+    NOT_PERMITTED,      //interlock: the FSM state does not allow this command
+    NOT_ARMED,          //FIRE while not ARMED
+    CANCELLED,          //dropped by abort()
+    TIMEOUT             //automatic SAFE after ACTUATOR_ARM_TIMEOUT_US armed
+};
+
+//One executed (or refused) command, all times micros()
+struct ActuatorEvent {
+    ActuatorCommand command;
+    ActuatorOutcome outcome;
+    uint32_t decision_us;       //when the FSM decided (shared by a whole sequence)
+    uint32_t due_us;            //when it was scheduled for
+    uint32_t applied_us;        //timer interrupt that executed it
+    uint32_t edge_us;           //output actually changed: first pulse with the new width,
+                                //for SAFE the end of the last pulse
+};
+
+
+/**
+ Parachute release servo driven from hardware timer1
+ Responsibilities:
+ - Generate the servo pulses from the timer interrupt, so pulse width and
+   actuation time do not inherit the main loop jitter (a Serial print or a
+   flash write in loop() stretches nothing here)
+ - Execute timed commands (ARM / FIRE / SAFE at a micros() deadline) in the
+   same interrupt, and restart the servo frame early (after
+   ACTUATOR_MIN_GAP_US) instead of waiting up to 20 ms for the next one
+ - Interlocks checked when a command executes, not when it is queued: ARM
+   and FIRE only while the FSM allows them (setInterlocks), FIRE only when
+   ARMED and held until the ARM has settled, SAFE always. A pulse is never cut short (a short pulse is a
+   valid position for the servo)
+ - Timestamp decision -> interrupt -> output edge for every command
+
+ Owns timer1: no analogWrite(), tone() or Servo library in the same build.
+ Only one instance can be begun. On the host, timer and pin are simulated
+ by ActuatorMockTimer.
+
+ Main loop contract:
+   Serial.begin(115200, SERIAL_8N1, SERIAL_TX_ONLY);   //servo is on the RX pin
+   actuator.begin(PARACHUTE_SERVO_PIN); fsm.attachActuator(&actuator);
+   every loop: ActuatorEvent e; while (actuator.popEvent(e)) ServoActuator::printEvent(e);
+ */
+class ServoActuator {
+public:
+    ServoActuator();
+
+    //pin: GPIO 0-15 (direct register writes from the interrupt)
+    bool begin(uint8_t pin);
+
+    //From the FSM state: which of ARM / FIRE may execute
+    void setInterlocks(bool armAllowed, bool fireAllowed);
+
+    //Queue command at due_us, false if the queue is full
+    bool schedule(ActuatorCommand command, uint32_t due_us, uint32_t decision_us);
+
+    /**
+     ARM now (unless already armed or an ARM is pending), FIRE once the ARM has
+     settled, SAFE after ACTUATOR_RELEASE_HOLD_US. Arming early (predicted
+     landing) lets FIRE follow the decision without the settle time.
+     */
+    bool scheduleRelease(uint32_t decision_us);
+
+    //Drop every pending command and SAFE now (SAFE_MODE)
+    void abort(uint32_t decision_us);
+
+    ActuatorState getState() const;
+    uint8_t getPending() const;
+    bool isArmPending() const;
+
+    //Next executed command for logging (main loop), false if none is complete yet
+    bool popEvent(ActuatorEvent& event);
+    static void printEvent(const ActuatorEvent& event);
+    void printStatus() const;
+
+    //Timer interrupt body
+    void onTimer();
+
+private:
+    struct Pending {
+        ActuatorCommand command;
+        uint32_t due_us;
+        uint32_t decision_us;
+    };
+
+    uint8_t pin;
+    bool begun;
+
+    //Shared with the interrupt
+    volatile bool armAllowed;
+    volatile bool fireAllowed;
+    Pending queue[ACTUATOR_QUEUE_SIZE];       //sorted by due_us
+    volatile uint8_t queueCount;
+
+    volatile ActuatorState state;
+    uint32_t armed_us;
+    bool driving;                             //servo frame running
+    bool pulseHigh;
+    uint16_t pulseWidth_us;                   //width of the pulse in progress
+    uint16_t targetWidth_us;                  //width for the next pulse
+    bool widthChanged;                        //next pulse starts as soon as the gap allows
+    uint32_t pulseStart_us;
+    uint32_t pulseEnd_us;
+    uint32_t nextFrame_us;
+
+    ActuatorEvent events[ACTUATOR_EVENT_LOG];
+    volatile uint8_t eventsWritten;
+    uint8_t eventsRead;
+    int8_t edgeEvent;                         //event waiting for its output edge, -1 = none
+
+    uint32_t executed;
+    uint32_t refused;
+    uint32_t maxLate_us;                      //interrupt after due_us (timer latency)
+
+    void insert(const Pending& command);
+    void execute(const Pending& command, uint32_t now, bool timeout);
+    uint8_t logEvent(const Pending& command, ActuatorOutcome outcome, uint32_t now);
+    void startPulse(uint32_t now);
+    void armTimer(uint32_t now);
+};
+
+
+#ifndef ARDUINO
+/**
+ Host stand-in for timer1 and the servo pin
+ A simulated micros() clock: advanceTo() runs the interrupt at every
+ programmed shot, injected latency included, and records the pin edges so a
+ host program can check pulse widths and actuation times.
+ */
+class ActuatorMockTimer {
+public:
+    static const uint16_t MAX_EDGES = 1024;
+
+    static void reset(uint32_t start_us);
+    static uint32_t now();
+    static void advanceTo(uint32_t t_us);
+    static void setInterruptLatency(uint32_t latency_us);
+
+    //Hooks used by ServoActuator
+    static void attach(ServoActuator* actuator);
+    static void arm(uint32_t delay_us);
+    static void writePin(bool high);
+
+    //Recorded output (both edges), oldest first, last MAX_EDGES kept
+    static uint16_t getEdgeCount();
+    static uint32_t getEdgeTime(uint16_t index);
+    static bool getEdgeLevel(uint16_t index);
+    static void clearEdges();
+};
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#include "alloc_tracking.h"
+
+#if defined(ALLOC_TRACKING) && !defined(ARDUINO)
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+//glibc's allocator, under the names it keeps for exactly this kind of wrapper
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+}
+
+static AllocStats allocStats;
+
+const AllocStats& allocGetStats() {
+    return allocStats;
+}
+
+extern "C" void* malloc(size_t size) {
+    allocStats.allocations++;
+    allocStats.bytes += size;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocStats.allocations++;
+    allocStats.bytes += (uint64_t)count * size;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    if (size == 0 && p) {
+        allocStats.frees++;
+    } else {
+        allocStats.allocations++;
+        allocStats.bytes += size;
+    }
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p) {
+    if (p) {
+        allocStats.frees++;
+    }
+    __libc_free(p);
+}
+
+//Counted in malloc / free
+static void* trackedAlloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+static void trackedFree(void* p) {
+    free(p);
+}
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { trackedFree(p); }
+
+AllocFreeScope::AllocFreeScope(const char* name)
+    : name(name), allocationsAtStart(allocStats.allocations) {
+}
+
+AllocFreeScope::~AllocFreeScope() {
+    uint32_t count = allocStats.allocations - allocationsAtStart;
+    if (count != 0) {
+        fprintf(stderr, "[ALLOC] %s allocated %u times in steady state\n", name, (unsigned)count);
+        abort();
+    }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef ALLOC_TRACKING_H
+#define ALLOC_TRACKING_H
+
+#include "config.h"
+
+/**
+ Heap allocation tracking for host builds (ALLOC_TRACKING in config.h)
+ Replaces malloc / calloc / realloc / free with counting versions (glibc:
+ they forward to the __libc_* entry points), and operator new / delete on
+ top of them, so Arduino String (realloc) and C code are caught as well as
+ new. The ESP8266 core defines its own allocator, so this never goes on the
+ target: the flag is ignored when ARDUINO is defined.
+
+ ALLOC_FREE_SCOPE(name) marks a steady-state path (readAll, poll, FSM::update,
+ telemetry) that must not touch the heap. In a host run any allocation inside
+ the scope prints the name and aborts, so a regression fails the run instead
+ of fragmenting the ESP8266 heap over a long IDLE.
+ */
+
+#if defined(ALLOC_TRACKING) && !defined(ARDUINO)
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct AllocStats {
+    uint32_t allocations;         //malloc / calloc / realloc (to a non-zero size) and new
+    uint32_t frees;               //free / delete with a non-null pointer, realloc to 0
+    uint64_t bytes;               //total requested
+};
+
+const AllocStats& allocGetStats();
+
+//Aborts if the allocation count changed between construction and destruction
+class AllocFreeScope {
+public:
+    explicit AllocFreeScope(const char* name);
+    ~AllocFreeScope();
+
+private:
+    const char* name;
+    uint32_t allocationsAtStart;
+};
+
+#define ALLOC_FREE_SCOPE(name) AllocFreeScope allocFreeScope(name)
+
+#else
+
+#define ALLOC_FREE_SCOPE(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//Radio link (see radio.h)
+//Select ONE backend for the flight build: RADIO_BACKEND_NRF24 or RADIO_BACKEND_LORA
+#define RADIO_BACKEND_NRF24
+
+//nRF24L01+ wiring on the LOLIN (SPI on D5/D6/D7)
+#define NRF24_CE_PIN        2      //D4
+#define NRF24_CSN_PIN       15     //D8
+#define NRF24_CHANNEL       76
+#define NRF24_PIPE_ADDRESS  0xF0F0F0F0E1LL  //must match ground_station/receivers/nrf24_receiver.py
+
+//LoRa SX1278 wiring and RF settings
+#define LORA_SS_PIN         15     //D8
+#define LORA_RST_PIN        16     //D0
+#define LORA_DIO0_PIN       0      //D3
+#define LORA_FREQUENCY_HZ   433E6  //must match ground_station/receivers/lora_receiver.py
+
+//Parachute release servo, driven from timer1 (see actuator.h)
+//GPIO3 (RX): not a boot strap and free with both radio backends. Serial
+//must be started TX-only: Serial.begin(115200, SERIAL_8N1, SERIAL_TX_ONLY)
+#define PARACHUTE_SERVO_PIN 3      //RX
+
+//GPIO0/2/15 select the boot mode: a servo line or its pull-down there can stop the board booting
+#if PARACHUTE_SERVO_PIN == 0 || PARACHUTE_SERVO_PIN == 2 || PARACHUTE_SERVO_PIN == 15
+#error "PARACHUTE_SERVO_PIN is a boot strap pin"
+#endif
+
+#if defined(RADIO_BACKEND_LORA) && PARACHUTE_SERVO_PIN == LORA_DIO0_PIN
+#error "PARACHUTE_SERVO_PIN collides with LORA_DIO0_PIN"
+#endif
+
+//I2C: the DS3231 is fixed at 0x68, so the MPU6050 has AD0 strapped high
+#define MPU6050_ADDRESS     0x69
+
+//GPS: uncomment to run the NEO-6M in UBX binary mode at 5 Hz instead of 1 Hz NMEA
+//#define GPS_USE_UBX
+#define GPS_UBX_BAUD        38400
+#define GPS_UBX_MEAS_RATE_MS 200
+
+//Sensor pipeline and FSM on scaled integers instead of soft-float (see fixed_point.h)
+//Changes the telemetry layout, rebuild the ground decoder from the same tree
+//#define FIXED_POINT_PIPELINE
+
+//Cycle counts of readAll / FSM::update, printed by SensorManager::printStatus (see cycle_profile.h)
+//#define CYCLE_PROFILE
+
+//Host builds only: abort if a steady-state path allocates (see alloc_tracking.h)
+//#define ALLOC_TRACKING
+
+//Bench builds only: uncomment to run the fault injection benchmark (see fault_injection.h)
+//#define FAULT_INJECTION
+#define FAULT_INJECTION_SEED 12345
+
+#endif
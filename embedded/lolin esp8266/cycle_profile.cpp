@@ -0,0 +1,64 @@
+#include "cycle_profile.h"
+
+#ifdef CYCLE_PROFILE
+
+CycleProfiler cycleProfiler;
+
+//Fixed-width rows so the whole table stays in flash; print with FPSTR()
+static const char SLOT_NAMES[PROFILE_SLOT_COUNT][12] PROGMEM = { "readAll", "FSM::update" };
+
+CycleProfiler::CycleProfiler() {
+    reset();
+}
+
+void CycleProfiler::add(ProfileSlot slot, uint32_t cycles) {
+    CycleStats& s = stats[slot];
+    s.calls++;
+    s.total += cycles;
+    if (cycles < s.min) {
+        s.min = cycles;
+    }
+    if (cycles > s.max) {
+        s.max = cycles;
+    }
+}
+
+void CycleProfiler::reset() {
+    for (uint8_t i = 0; i < PROFILE_SLOT_COUNT; i++) {
+        stats[i].calls = 0;
+        stats[i].min = UINT32_MAX;
+        stats[i].max = 0;
+        stats[i].total = 0;
+    }
+}
+
+const CycleStats& CycleProfiler::getStats(ProfileSlot slot) const {
+    return stats[slot];
+}
+
+void CycleProfiler::print() const {
+#ifdef FIXED_POINT_PIPELINE
+    Serial.println(F("[PROFILE] fixed-point build, cycles per call (min / avg / max)"));
+#else
+    Serial.println(F("[PROFILE] float build, cycles per call (min / avg / max)"));
+#endif
+    for (uint8_t i = 0; i < PROFILE_SLOT_COUNT; i++) {
+        const CycleStats& s = stats[i];
+        if (s.calls == 0) {
+            continue;
+        }
+        Serial.print(F("[PROFILE] "));
+        Serial.print(FPSTR(SLOT_NAMES[i]));
+        Serial.print(F(": "));
+        Serial.print(s.min);
+        Serial.print(F(" / "));
+        Serial.print((uint32_t)(s.total / s.calls));
+        Serial.print(F(" / "));
+        Serial.print(s.max);
+        Serial.print(F(" ("));
+        Serial.print(s.calls);
+        Serial.println(F(" calls)"));
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CYCLE_PROFILE_H
+#define CYCLE_PROFILE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "config.h"
+
+//Profiled code paths
+enum ProfileSlot : uint8_t {
+    PROFILE_READ_ALL,
+    PROFILE_FSM_UPDATE,
+    PROFILE_SLOT_COUNT
+};
+
+#ifdef CYCLE_PROFILE
+
+//CPU cycles per call of one slot (ESP.getCycleCount, 80/160 MHz, wraps after ~53 s)
+struct CycleStats {
+    uint32_t calls;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+};
+
+/**
+ Cycle counters for a few hot paths, used to compare the float and the
+ FIXED_POINT_PIPELINE builds on the target. Interrupts that land inside a
+ scope are counted too, min is the cleanest figure.
+ */
+class CycleProfiler {
+public:
+    CycleProfiler();
+    void add(ProfileSlot slot, uint32_t cycles);
+    void reset();
+    const CycleStats& getStats(ProfileSlot slot) const;
+    void print() const;
+
+private:
+    CycleStats stats[PROFILE_SLOT_COUNT];
+};
+
+extern CycleProfiler cycleProfiler;
+
+//Times the enclosing block
+class CycleScope {
+public:
+    explicit CycleScope(ProfileSlot slot) : slot(slot), start(ESP.getCycleCount()) {}
+    ~CycleScope() { cycleProfiler.add(slot, ESP.getCycleCount() - start); }
+
+private:
+    ProfileSlot slot;
+    uint32_t start;
+};
+
+#define PROFILE_SCOPE(slot) CycleScope profileScope(slot)
+
+#else
+
+#define PROFILE_SCOPE(slot) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,311 @@
+#include "fault_injection.h"
+
+//Fixed-width rows in FaultClass order, the last one for anything out of range
+static const char FAULT_CLASS_NAMES[][15] PROGMEM = {
+    "I2C_NAK", "STUCK_VALUE", "GPS_GARBAGE", "GPS_DROPOUT", "RTC_POWER_LOSS", "UNKNOWN"
+};
+
+const char* getFaultClassName(FaultClass fault) {
+    uint8_t i = (uint8_t)fault;
+    return FAULT_CLASS_NAMES[i < (uint8_t)FaultClass::COUNT ? i : (uint8_t)FaultClass::COUNT];
+}
+
+#ifdef FAULT_INJECTION
+
+FaultInjector faultInjector;
+
+//0x76 BMP280, 0x69 MPU6050 (MPU6050_ADDRESS)
+const FaultStep FAULT_BENCHMARK_SCRIPT[] = {
+    //fault                        addr   start_ms  duration_ms
+    { FaultClass::I2C_NAK,         0x76,    5000,      200 },    //short NAK burst
+    { FaultClass::I2C_NAK,         0x76,   15000,     3000 },    //barometer gone for a while
+    { FaultClass::I2C_NAK,         0x69,   25000,     2000 },
+    { FaultClass::STUCK_VALUE,     0x76,   35000,     5000 },
+    { FaultClass::STUCK_VALUE,     0x69,   50000,     5000 },
+    { FaultClass::GPS_GARBAGE,     0x00,   65000,     5000 },
+    { FaultClass::GPS_DROPOUT,     0x00,   80000,     5000 },
+    { FaultClass::GPS_DROPOUT,     0x00,   95000,      800 },    //shorter than one NMEA period
+    { FaultClass::RTC_POWER_LOSS,  0x00,  105000,      100 },
+};
+const uint8_t FAULT_BENCHMARK_STEPS = sizeof(FAULT_BENCHMARK_SCRIPT) / sizeof(FAULT_BENCHMARK_SCRIPT[0]);
+
+
+FaultInjector::FaultInjector()
+    : script(nullptr),
+      stepCount(0),
+      startTime_ms(0),
+      now_ms(0),
+      started(false),
+      reported(false),
+      rtcOscillatorStopped(false),
+      rng(1),
+      frozenAddress(0),
+      frozenReg(0),
+      frozenLength(0) {
+    memset(results, 0, sizeof(results));
+    for (uint8_t i = 0; i < (uint8_t)FaultClass::COUNT; i++) {
+        healthy[i] = true;
+    }
+}
+
+void FaultInjector::begin(const FaultStep* newScript, uint8_t steps, uint32_t seed) {
+    script = newScript;
+    stepCount = steps > FAULT_MAX_STEPS ? FAULT_MAX_STEPS : steps;
+    memset(results, 0, sizeof(results));
+    started = false;
+    reported = false;
+    rtcOscillatorStopped = false;
+    frozenLength = 0;
+    rng = seed ? seed : 1;   //xorshift must not start at 0
+
+    Serial.print(F("[FAULT] Injection enabled: "));
+    Serial.print(stepCount);
+    Serial.print(F(" steps, seed "));
+    Serial.println(seed);
+}
+
+void FaultInjector::update(unsigned long now) {
+    if (script == nullptr) {
+        return;
+    }
+    if (!started) {
+        started = true;
+        startTime_ms = now;
+    }
+    now_ms = now;
+    uint32_t t = now - startTime_ms;
+
+    for (uint8_t i = 0; i < stepCount; i++) {
+        const FaultStep& step = script[i];
+        FaultStepResult& r = results[i];
+
+        if (!r.active && !r.ended && t >= step.start_ms) {
+            r.active = true;
+            if (step.fault == FaultClass::RTC_POWER_LOSS) {
+                rtcOscillatorStopped = true;
+            } else if (step.fault == FaultClass::STUCK_VALUE) {
+                frozenLength = 0;   //freeze the next burst the device returns
+            }
+            Serial.print(F("[FAULT] + "));
+            Serial.print(FPSTR(getFaultClassName(step.fault)));
+            Serial.print(F(" 0x"));
+            Serial.println(step.address, HEX);
+        }
+
+        if (r.active && t >= step.start_ms + step.duration_ms) {
+            r.active = false;
+            r.ended = true;
+            //Already reported healthy again before the fault was removed (short burst absorbed)
+            if (r.detected && healthy[(uint8_t)step.fault]) {
+                r.recovered = true;
+                r.recover_ms = 0;
+            }
+            Serial.print(F("[FAULT] - "));
+            Serial.println(FPSTR(getFaultClassName(step.fault)));
+        }
+    }
+
+    if (!reported && isFinished()) {
+        reported = true;
+        printReport();
+    }
+}
+
+bool FaultInjector::isFinished() const {
+    if (!started || stepCount == 0) {
+        return false;
+    }
+    unsigned long lastEnd = 0;
+    for (uint8_t i = 0; i < stepCount; i++) {
+        if (!results[i].ended) {
+            return false;
+        }
+        if (endTime(i) > lastEnd) {
+            lastEnd = endTime(i);
+        }
+    }
+    return now_ms - lastEnd >= FAULT_SETTLE_MS;
+}
+
+bool FaultInjector::nak(uint8_t address) {
+    return isActive(FaultClass::I2C_NAK, address);
+}
+
+void FaultInjector::filterRead(uint8_t address, uint8_t reg, uint8_t* data, uint8_t len) {
+    if (!isActive(FaultClass::STUCK_VALUE, address)) {
+        return;
+    }
+    if (frozenLength == 0 || frozenAddress != address) {
+        frozenAddress = address;
+        frozenReg = reg;
+        frozenLength = len > FAULT_MAX_FROZEN ? FAULT_MAX_FROZEN : len;
+        memcpy(frozen, data, frozenLength);
+        return;
+    }
+    //Replay the snapshot for every read inside the frozen register range
+    if (reg >= frozenReg && (uint16_t)reg + len <= (uint16_t)frozenReg + frozenLength) {
+        memcpy(data, frozen + (reg - frozenReg), len);
+    }
+}
+
+int FaultInjector::gpsByte(int c) {
+    if (isActive(FaultClass::GPS_DROPOUT, 0)) {
+        return -1;
+    }
+    //1 byte in 8 replaced: almost every NMEA sentence / UBX frame fails its checksum
+    if (isActive(FaultClass::GPS_GARBAGE, 0) && (nextRandom() & 0x07) == 0) {
+        return (int)(nextRandom() & 0xFF);
+    }
+    return c;
+}
+
+bool FaultInjector::rtcPowerLost() const {
+    return rtcOscillatorStopped;
+}
+
+void FaultInjector::rtcTimeRestored() {
+    //Restoring the time while power is still being lost does not clear the flag
+    if (!isActive(FaultClass::RTC_POWER_LOSS, 0)) {
+        rtcOscillatorStopped = false;
+    }
+}
+
+void FaultInjector::reportDetected(FaultClass fault) {
+    unsigned long now = millis();
+    healthy[(uint8_t)fault] = false;
+    for (uint8_t i = 0; i < stepCount; i++) {
+        FaultStepResult& r = results[i];
+        //The stop flag stays latched after a short power loss, detectable until the time is restored
+        bool latched = fault == FaultClass::RTC_POWER_LOSS && rtcOscillatorStopped;
+        if (script[i].fault == fault && (r.active || latched) && !r.detected) {
+            r.detected = true;
+            r.detect_ms = now - (startTime_ms + script[i].start_ms);
+        }
+    }
+}
+
+void FaultInjector::reportRecovered(FaultClass fault) {
+    unsigned long now = millis();
+    healthy[(uint8_t)fault] = true;
+    for (uint8_t i = 0; i < stepCount; i++) {
+        FaultStepResult& r = results[i];
+        if (script[i].fault == fault && r.ended && r.detected && !r.recovered) {
+            r.recovered = true;
+            r.recover_ms = now - endTime(i);
+        }
+    }
+}
+
+void FaultInjector::noteTransition(uint8_t stateId) {
+    for (uint8_t i = 0; i < stepCount; i++) {
+        FaultStepResult& r = results[i];
+        if (r.active || (r.ended && r.detected && !r.recovered)) {
+            r.transitions++;
+            Serial.print(F("[FAULT] FSM -> state "));
+            Serial.print(stateId);
+            Serial.print(F(" during "));
+            Serial.println(FPSTR(getFaultClassName(script[i].fault)));
+        }
+    }
+}
+
+uint8_t FaultInjector::getStepCount() const {
+    return stepCount;
+}
+
+const FaultStepResult& FaultInjector::getResult(uint8_t step) const {
+    return results[step < stepCount ? step : 0];
+}
+
+void FaultInjector::printReport() const {
+    Serial.println(F("[FAULT] ===== Fault injection report ====="));
+    Serial.println(F("[FAULT] step  class  addr  detect_ms  recover_ms  fsm_transitions"));
+    for (uint8_t i = 0; i < stepCount; i++) {
+        const FaultStepResult& r = results[i];
+        Serial.print(F("[FAULT] "));
+        Serial.print(i);
+        Serial.print(F("  "));
+        Serial.print(FPSTR(getFaultClassName(script[i].fault)));
+        Serial.print(F("  0x"));
+        Serial.print(script[i].address, HEX);
+        Serial.print(F("  "));
+        if (r.detected) {
+            Serial.print(r.detect_ms);
+        } else {
+            Serial.print(F("MISSED"));
+        }
+        Serial.print(F("  "));
+        if (r.recovered) {
+            Serial.print(r.recover_ms);
+        } else {
+            Serial.print(r.detected ? F("NO_RECOVERY") : F("-"));
+        }
+        Serial.print(F("  "));
+        Serial.println(r.transitions);
+    }
+
+    Serial.println(F("[FAULT] class  steps  detected  avg/max detect_ms  avg/max recover_ms"));
+    for (uint8_t c = 0; c < (uint8_t)FaultClass::COUNT; c++) {
+        uint8_t steps = 0, detected = 0, recovered = 0;
+        uint32_t detectSum = 0, detectMax = 0, recoverSum = 0, recoverMax = 0;
+        for (uint8_t i = 0; i < stepCount; i++) {
+            if ((uint8_t)script[i].fault != c) {
+                continue;
+            }
+            const FaultStepResult& r = results[i];
+            steps++;
+            if (r.detected) {
+                detected++;
+                detectSum += r.detect_ms;
+                detectMax = r.detect_ms > detectMax ? r.detect_ms : detectMax;
+            }
+            if (r.recovered) {
+                recovered++;
+                recoverSum += r.recover_ms;
+                recoverMax = r.recover_ms > recoverMax ? r.recover_ms : recoverMax;
+            }
+        }
+        if (steps == 0) {
+            continue;
+        }
+        Serial.print(F("[FAULT] "));
+        Serial.print(FPSTR(getFaultClassName((FaultClass)c)));
+        Serial.print(F("  "));
+        Serial.print(steps);
+        Serial.print(F("  "));
+        Serial.print(detected);
+        Serial.print(F("  "));
+        Serial.print(detected ? detectSum / detected : 0);
+        Serial.print(F("/"));
+        Serial.print(detectMax);
+        Serial.print(F("  "));
+        Serial.print(recovered ? recoverSum / recovered : 0);
+        Serial.print(F("/"));
+        Serial.println(recoverMax);
+    }
+}
+
+bool FaultInjector::isActive(FaultClass fault, uint8_t address) const {
+    bool byAddress = (fault == FaultClass::I2C_NAK || fault == FaultClass::STUCK_VALUE);
+    for (uint8_t i = 0; i < stepCount; i++) {
+        if (results[i].active && script[i].fault == fault &&
+            (!byAddress || script[i].address == address)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//xorshift32: same seed, same corruption pattern on every run
+uint32_t FaultInjector::nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+unsigned long FaultInjector::endTime(uint8_t step) const {
+    return startTime_ms + script[step].start_ms + script[step].duration_ms;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef FAULT_INJECTION_H
+#define FAULT_INJECTION_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "config.h"
+
+//Fault classes, also used by SensorManager health tracking to say what it detected
+enum class FaultClass : uint8_t {
+    I2C_NAK,          //device stops acknowledging (loose connector, brown-out)
+    STUCK_VALUE,      //device acknowledges but its data registers freeze
+    GPS_GARBAGE,      //corrupted bytes on the GPS UART (noise, wrong baud)
+    GPS_DROPOUT,      //no bytes at all from the GPS
+    RTC_POWER_LOSS,   //DS3231 oscillator stop flag set, time must be restored
+    COUNT
+};
+
+//In flash on the target, print with FPSTR()
+const char* getFaultClassName(FaultClass fault);
+
+
+#ifdef FAULT_INJECTION
+
+#define FAULT_MAX_STEPS      16
+#define FAULT_MAX_FROZEN     32      //bytes kept for a stuck register burst
+#define FAULT_SETTLE_MS      10000   //wait after the last step before the report
+
+//One scripted fault, times relative to the start of the script
+struct FaultStep {
+    FaultClass fault;
+    uint8_t address;          //I2C address for I2C_NAK / STUCK_VALUE, ignored otherwise
+    uint32_t start_ms;
+    uint32_t duration_ms;
+};
+
+//Result of one executed step
+struct FaultStepResult {
+    bool active;
+    bool ended;
+    bool detected;
+    bool recovered;
+    uint32_t detect_ms;       //activation -> SensorManager reported the fault
+    uint32_t recover_ms;      //fault removed -> SensorManager reported healthy again
+    uint8_t transitions;      //FSM transitions while active or not yet recovered
+};
+
+
+/**
+ Scripted fault injection at the HAL seams (I2C bus, GPS UART, DS3231 flag)
+ Compiled only with FAULT_INJECTION defined in config.h, never in a flight build.
+ Responsibilities:
+ - Run a fault script against millis() with a fixed seed (repeatable runs)
+ - Corrupt/suppress traffic through the hooks below while a step is active
+ - Timestamp detection and recovery reported by SensorManager
+ - Count FSM transitions that happen during a fault
+ - Print a per-class time-to-detect / time-to-recover table at the end
+ */
+class FaultInjector {
+public:
+    FaultInjector();
+
+    void begin(const FaultStep* script, uint8_t steps, uint32_t seed);
+
+    //Activate / end steps, call every loop(), first call starts the script
+    void update(unsigned long now_ms);
+    bool isFinished() const;
+
+    //HAL hooks
+    bool nak(uint8_t address);
+    void filterRead(uint8_t address, uint8_t reg, uint8_t* data, uint8_t len);
+    int gpsByte(int c);                   //-1 = byte dropped
+    bool rtcPowerLost() const;
+    void rtcTimeRestored();               //RTC adjusted, clears the latched stop flag
+
+    //Health reports from SensorManager
+    void reportDetected(FaultClass fault);
+    void reportRecovered(FaultClass fault);
+    void noteTransition(uint8_t stateId);
+
+    uint8_t getStepCount() const;
+    const FaultStepResult& getResult(uint8_t step) const;
+    void printReport() const;
+
+private:
+    const FaultStep* script;
+    uint8_t stepCount;
+    FaultStepResult results[FAULT_MAX_STEPS];
+    unsigned long startTime_ms;
+    unsigned long now_ms;
+    bool started;
+    bool reported;
+    bool healthy[(uint8_t)FaultClass::COUNT];
+    bool rtcOscillatorStopped;
+    uint32_t rng;
+
+    //STUCK_VALUE snapshot (one stuck device at a time)
+    uint8_t frozenAddress;
+    uint8_t frozenReg;
+    uint8_t frozenLength;
+    uint8_t frozen[FAULT_MAX_FROZEN];
+
+    bool isActive(FaultClass fault, uint8_t address) const;
+    uint32_t nextRandom();
+    unsigned long endTime(uint8_t step) const;
+};
+
+//Default benchmark: every fault class, short and long, spaced so each one recovers
+extern const FaultStep FAULT_BENCHMARK_SCRIPT[];
+extern const uint8_t FAULT_BENCHMARK_STEPS;
+
+extern FaultInjector faultInjector;
+
+#define FAULT_I2C_NAK(address)                   faultInjector.nak(address)
+#define FAULT_I2C_FILTER(address, reg, data, len) faultInjector.filterRead(address, reg, data, len)
+#define FAULT_GPS_BYTE(c)                        faultInjector.gpsByte(c)
+#define FAULT_RTC_POWER_LOST()                   faultInjector.rtcPowerLost()
+#define FAULT_RTC_RESTORED()                     faultInjector.rtcTimeRestored()
+#define FAULT_DETECTED(fault)                    faultInjector.reportDetected(fault)
+#define FAULT_RECOVERED(fault)                   faultInjector.reportRecovered(fault)
+#define FAULT_NOTE_TRANSITION(stateId)           faultInjector.noteTransition(stateId)
+
+#else
+
+//Flight build: hooks compile to nothing
+#define FAULT_I2C_NAK(address)                   false
+#define FAULT_I2C_FILTER(address, reg, data, len) ((void)0)
+#define FAULT_GPS_BYTE(c)                        (c)
+#define FAULT_RTC_POWER_LOST()                   false
+#define FAULT_RTC_RESTORED()                     ((void)0)
+#define FAULT_DETECTED(fault)                    ((void)0)
+#define FAULT_RECOVERED(fault)                   ((void)0)
+#define FAULT_NOTE_TRANSITION(stateId)           ((void)0)
+
+#endif
+
+#endif
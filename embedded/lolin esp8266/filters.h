@@ -0,0 +1,369 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+#include <math.h>
+
+//Fixed-size robust filters for per-field sensor cleanup.
+//Header-only templates: size is a compile-time constant, no heap, no virtual
+//calls, nothing Arduino-specific (also builds on the host).
+//
+//  MedianFilter<T, N>   median of the last N samples (sorting network)
+//  HampelFilter<T, N>   replaces samples further than k * MAD from the window median
+//  MovingStats<T, N>    O(1) sliding mean / variance / min / max
+
+
+//Branchless compare-exchange: after the call a <= b
+template <typename T>
+inline void sortPair(T& a, T& b) {
+    T lo = (b < a) ? b : a;
+    T hi = (b < a) ? a : b;
+    a = lo;
+    b = hi;
+}
+
+/**
+ Sorting network for N values: fixed sequence of compare-exchanges, no
+ data-dependent branches or loop exits. Generic N uses odd-even transposition
+ (N rounds), small sizes use the known optimal networks.
+ */
+template <typename T, uint8_t N>
+struct SortingNetwork {
+    static void sort(T* v) {
+        for (uint8_t round = 0; round < N; round++) {
+            for (uint8_t i = round & 1; i + 1 < N; i += 2) {
+                sortPair(v[i], v[i + 1]);
+            }
+        }
+    }
+};
+
+template <typename T>
+struct SortingNetwork<T, 1> {
+    static void sort(T*) {}
+};
+
+template <typename T>
+struct SortingNetwork<T, 3> {
+    static void sort(T* v) {
+        sortPair(v[0], v[1]);
+        sortPair(v[1], v[2]);
+        sortPair(v[0], v[1]);
+    }
+};
+
+//9 compare-exchanges (optimal)
+template <typename T>
+struct SortingNetwork<T, 5> {
+    static void sort(T* v) {
+        sortPair(v[0], v[1]); sortPair(v[3], v[4]);
+        sortPair(v[2], v[4]);
+        sortPair(v[2], v[3]); sortPair(v[1], v[4]);
+        sortPair(v[0], v[3]);
+        sortPair(v[0], v[2]); sortPair(v[1], v[3]);
+        sortPair(v[1], v[2]);
+    }
+};
+
+//16 compare-exchanges (optimal)
+template <typename T>
+struct SortingNetwork<T, 7> {
+    static void sort(T* v) {
+        sortPair(v[0], v[6]); sortPair(v[2], v[3]); sortPair(v[4], v[5]);
+        sortPair(v[0], v[2]); sortPair(v[1], v[4]); sortPair(v[3], v[6]);
+        sortPair(v[0], v[1]); sortPair(v[2], v[5]); sortPair(v[3], v[4]);
+        sortPair(v[1], v[2]); sortPair(v[4], v[6]);
+        sortPair(v[2], v[3]); sortPair(v[4], v[5]);
+        sortPair(v[1], v[2]); sortPair(v[3], v[4]); sortPair(v[5], v[6]);
+    }
+};
+
+//|v| without the fabs round trip through double (integer windows stay integer)
+template <typename T>
+inline T absValue(T v) {
+    return v < 0 ? -v : v;
+}
+
+//Gaussian sigma from the median absolute deviation: 1.4826 * MAD
+template <typename T>
+inline T sigmaFromMad(T mad) {
+    return (T)1.4826 * mad;
+}
+
+//Scaled integers (FIXED_POINT_PIPELINE): 759 / 512 = 1.4824
+inline int32_t sigmaFromMad(int32_t mad) {
+    return (int32_t)(((int64_t)mad * 759) >> 9);
+}
+
+inline int16_t sigmaFromMad(int16_t mad) {
+    return (int16_t)(((int32_t)mad * 759) >> 9);
+}
+
+//Median of N values (v is reordered), N odd gives the true median
+template <typename T, uint8_t N>
+inline T medianOf(T* v) {
+    SortingNetwork<T, N>::sort(v);
+    return v[N / 2];
+}
+
+
+//Ring buffer shared by the windowed filters
+template <typename T, uint8_t N>
+class SampleWindow {
+public:
+    SampleWindow() : head(0), count(0) {}
+
+    void reset() {
+        head = 0;
+        count = 0;
+    }
+
+    void push(T value) {
+        values[head] = value;
+        head = (uint8_t)((head + 1) % N);
+        if (count < N) {
+            count++;
+        }
+    }
+
+    bool isFull() const { return count == N; }
+    uint8_t size() const { return count; }
+
+    //Copy into out[N]; a window that is not full yet is padded with the newest sample
+    void copyTo(T* out) const {
+        T newest = values[(head + N - 1) % N];
+        for (uint8_t i = 0; i < N; i++) {
+            out[i] = (i < count) ? values[i] : newest;
+        }
+    }
+
+private:
+    T values[N];
+    uint8_t head;
+    uint8_t count;
+};
+
+
+/**
+ Running median of the last N samples (N odd)
+ Removes single spikes completely (up to N/2 in a row), delays steps by N/2 samples
+ */
+template <typename T, uint8_t N>
+class MedianFilter {
+    static_assert(N % 2 == 1, "median window must be odd");
+public:
+    T update(T value) {
+        window.push(value);
+        T sorted[N];
+        window.copyTo(sorted);
+        return medianOf<T, N>(sorted);
+    }
+
+    void reset() { window.reset(); }
+
+private:
+    SampleWindow<T, N> window;
+};
+
+
+/**
+ Hampel identifier over the last N samples (N odd)
+ A sample further than k * sigma from the window median is replaced by the
+ median, sigma = 1.4826 * MAD (median absolute deviation). Unlike a median
+ filter it adds no delay for normal samples. Integer T stays integer
+ (no float in the update).
+ minSigma keeps a perfectly quiet window from flagging the first bit of noise.
+ */
+template <typename T, uint8_t N>
+class HampelFilter {
+    static_assert(N % 2 == 1, "Hampel window must be odd");
+public:
+    explicit HampelFilter(T k = 3, T minSigma = 0) : k(k), minSigma(minSigma), outliers(0), lastOutlier(false) {}
+
+    T update(T value) {
+        window.push(value);
+        if (!window.isFull()) {
+            lastOutlier = false;
+            return value;
+        }
+
+        T v[N];
+        window.copyTo(v);
+        T median = medianOf<T, N>(v);
+        for (uint8_t i = 0; i < N; i++) {
+            v[i] = absValue<T>(v[i] - median);
+        }
+        T sigma = sigmaFromMad(medianOf<T, N>(v));
+        if (sigma < minSigma) {
+            sigma = minSigma;
+        }
+
+        lastOutlier = absValue<T>(value - median) > k * sigma;
+        if (lastOutlier) {
+            outliers++;
+            return median;
+        }
+        return value;
+    }
+
+    void reset() {
+        window.reset();
+        lastOutlier = false;
+    }
+
+    bool wasOutlier() const { return lastOutlier; }
+    uint32_t getOutlierCount() const { return outliers; }
+
+private:
+    SampleWindow<T, N> window;
+    T k;
+    T minSigma;
+    uint32_t outliers;
+    bool lastOutlier;
+};
+
+
+//Deque of window slots for MovingStats min/max (at most N entries)
+template <uint8_t N>
+class SlotDeque {
+public:
+    SlotDeque() : head(0), len(0) {}
+
+    void clear() { head = 0; len = 0; }
+    bool empty() const { return len == 0; }
+    uint8_t front() const { return slots[head]; }
+    uint8_t back() const { return slots[(head + len - 1) % N]; }
+    void popFront() { head = (uint8_t)((head + 1) % N); len--; }
+    void popBack() { len--; }
+    void pushBack(uint8_t slot) { slots[(head + len) % N] = slot; len++; }
+
+private:
+    uint8_t slots[N];
+    uint8_t head;
+    uint8_t len;
+};
+
+
+//Running sums of MovingStats: float stays float, integers widen so that
+//N * value^2 cannot overflow (int32 windows: |value| < 2^27 at N = 255)
+template <typename T> struct MovingStatsAccum {
+    typedef T Sum;
+    typedef T SumSq;
+};
+template <> struct MovingStatsAccum<int8_t> {
+    typedef int32_t Sum;
+    typedef int32_t SumSq;
+};
+template <> struct MovingStatsAccum<uint8_t> {
+    typedef int32_t Sum;
+    typedef int32_t SumSq;
+};
+template <> struct MovingStatsAccum<int16_t> {
+    typedef int32_t Sum;
+    typedef int64_t SumSq;
+};
+template <> struct MovingStatsAccum<uint16_t> {
+    typedef int32_t Sum;
+    typedef int64_t SumSq;
+};
+template <> struct MovingStatsAccum<int32_t> {
+    typedef int64_t Sum;
+    typedef int64_t SumSq;
+};
+
+/**
+ Sliding window statistics over the last N samples, O(1) per update
+ - mean / variance from running sums (MovingStatsAccum), re-summed every
+   N updates so float rounding cannot accumulate
+ - min / max from monotonic deques of window slots (amortised O(1)):
+   the min deque holds increasing values, the max deque decreasing ones,
+   the front is the answer and leaves when its slot is overwritten
+ */
+template <typename T, uint8_t N>
+class MovingStats {
+public:
+    typedef typename MovingStatsAccum<T>::Sum Sum;
+    typedef typename MovingStatsAccum<T>::SumSq SumSq;
+
+    MovingStats() { reset(); }
+
+    void reset() {
+        head = 0;
+        count = 0;
+        sinceResum = 0;
+        sum = 0;
+        sumSq = 0;
+        minSlots.clear();
+        maxSlots.clear();
+    }
+
+    void update(T value) {
+        uint8_t slot = head;
+        if (count == N) {
+            T old = values[slot];
+            sum -= old;
+            sumSq -= (SumSq)old * old;
+            if (!minSlots.empty() && minSlots.front() == slot) minSlots.popFront();
+            if (!maxSlots.empty() && maxSlots.front() == slot) maxSlots.popFront();
+        } else {
+            count++;
+        }
+        values[slot] = value;
+        sum += value;
+        sumSq += (SumSq)value * value;
+
+        while (!minSlots.empty() && !(values[minSlots.back()] < value)) minSlots.popBack();
+        while (!maxSlots.empty() && !(value < values[maxSlots.back()])) maxSlots.popBack();
+        minSlots.pushBack(slot);
+        maxSlots.pushBack(slot);
+
+        head = (uint8_t)((head + 1) % N);
+        if (++sinceResum == N) {
+            sinceResum = 0;
+            resum();
+        }
+    }
+
+    uint8_t size() const { return count; }
+    bool isFull() const { return count == N; }
+
+    T mean() const { return count ? (T)(sum / count) : 0; }
+
+    //Population variance of the window, in the wide type (square of T's unit)
+    SumSq variance() const {
+        if (count == 0) {
+            return 0;
+        }
+        //Integer mean m with remainder r: sum^2 / count = m (sum + r) + r^2 / count exactly,
+        //so the truncated mean does not leak into the variance (r is ~0 for float)
+        Sum m = sum / count;
+        Sum r = sum - m * count;
+        SumSq var = (sumSq - (SumSq)m * (sum + r) - (SumSq)r * r / count) / count;
+        return var > 0 ? var : 0;
+    }
+
+    T stddev() const { return (T)sqrt((double)variance()); }
+    T min() const { return count ? values[minSlots.front()] : 0; }
+    T max() const { return count ? values[maxSlots.front()] : 0; }
+
+private:
+    T values[N];
+    uint8_t head;              //slot of the next sample
+    uint8_t count;
+    uint8_t sinceResum;
+    Sum sum;
+    SumSq sumSq;
+    SlotDeque<N> minSlots;
+    SlotDeque<N> maxSlots;
+
+    void resum() {
+        sum = 0;
+        sumSq = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            sum += values[i];
+            sumSq += (SumSq)values[i] * values[i];
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "fixed_point.h"
+
+#ifndef ARDUINO
+#define PROGMEM
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#endif
+
+#define ALTITUDE_TABLE_MAX_CPA   11000000L   //1100 hPa
+#define ALTITUDE_TABLE_STEP_CPA  50000L      //5 hPa
+
+//44330 * (1 - (p / 1013.25)^0.1903) in cm, p = 1100, 1095, ... 300 hPa
+static const int32_t ALTITUDE_TABLE_CM[161] PROGMEM = {
+      -69844,   -65942,   -62025,   -58094,   -54148,   -50187,   -46212,   -42221,
+      -38215,   -34194,   -30157,   -26105,   -22037,   -17953,   -13853,    -9737,
+       -5605,    -1456,     2709,     6891,    11090,    15306,    19540,    23790,
+       28058,    32344,    36647,    40969,    45309,    49667,    54043,    58438,
+       62853,    67286,    71738,    76210,    80701,    85213,    89744,    94295,
+       98867,   103460,   108073,   112707,   117363,   122040,   126739,   131459,
+      136202,   140967,   145755,   150566,   155400,   160257,   165137,   170042,
+      174971,   179924,   184902,   189904,   194932,   199986,   205065,   210170,
+      215302,   220461,   225646,   230859,   236099,   241368,   246665,   251990,
+      257345,   262728,   268142,   273586,   279060,   284565,   290101,   295669,
+      301269,   306902,   312567,   318266,   323998,   329765,   335567,   341403,
+      347276,   353184,   359129,   365111,   371131,   377189,   383286,   389422,
+      395598,   401814,   408072,   414371,   420713,   427097,   433525,   439997,
+      446514,   453077,   459686,   466343,   473047,   479800,   486602,   493455,
+      500358,   507314,   514322,   521384,   528501,   535674,   542903,   550189,
+      557535,   564940,   572406,   579933,   587524,   595180,   602900,   610688,
+      618543,   626468,   634464,   642533,   650674,   658892,   667186,   675558,
+      684011,   692545,   701163,   709867,   718658,   727539,   736511,   745576,
+      754738,   763997,   773358,   782821,   792389,   802066,   811854,   821756,
+      831775,   841913,   852175,   862564,   873083,   883736,   894526,   905459,
+      916537
+};
+
+#define ALTITUDE_TABLE_SIZE (sizeof(ALTITUDE_TABLE_CM) / sizeof(ALTITUDE_TABLE_CM[0]))
+
+int32_t fixedPressureToAltitude(int32_t pressure_cPa) {
+    int32_t offset = ALTITUDE_TABLE_MAX_CPA - pressure_cPa;
+    if (offset <= 0) {
+        return (int32_t)pgm_read_dword(&ALTITUDE_TABLE_CM[0]);
+    }
+    uint32_t index = (uint32_t)offset / ALTITUDE_TABLE_STEP_CPA;
+    if (index >= ALTITUDE_TABLE_SIZE - 1) {
+        return (int32_t)pgm_read_dword(&ALTITUDE_TABLE_CM[ALTITUDE_TABLE_SIZE - 1]);
+    }
+    int32_t lo = (int32_t)pgm_read_dword(&ALTITUDE_TABLE_CM[index]);
+    int32_t hi = (int32_t)pgm_read_dword(&ALTITUDE_TABLE_CM[index + 1]);
+    int32_t frac = offset - (int32_t)index * ALTITUDE_TABLE_STEP_CPA;
+    //largest step is 11078 cm (300 hPa end), times frac < 50000 fits int32
+    return lo + (hi - lo) * frac / ALTITUDE_TABLE_STEP_CPA;
+}
+
+/**
+ Octant reduction to z = min/max in [0, 1] (Q15), then
+ atan(z) ~ pi/4 z + z (1 - z) (0.2447 + 0.0663 z)  [rad], max error 0.0015 rad
+ */
+int16_t fixedAtan2(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) {
+        return 0;
+    }
+    uint32_t ax = x < 0 ? (uint32_t)-x : (uint32_t)x;
+    uint32_t ay = y < 0 ? (uint32_t)-y : (uint32_t)y;
+    bool steep = ay > ax;
+    uint32_t num = steep ? ax : ay;
+    uint32_t den = steep ? ay : ax;
+    while (den >= (1UL << 16)) {   //num << 15 must fit 32 bits
+        num >>= 1;
+        den >>= 1;
+    }
+    int32_t z = (int32_t)((num << 15) / den);
+
+    //Coefficients in 0.01 deg: pi/4 = 4500, 0.2447 rad = 1402, 0.0663 rad = 380
+    int32_t w = (z * (32768 - z)) >> 15;
+    int32_t angle = ((4500 * z) >> 15) + ((w * (1402 + ((380 * z) >> 15))) >> 15);
+
+    if (steep) {
+        angle = 9000 - angle;
+    }
+    if (x < 0) {
+        angle = 18000 - angle;
+    }
+    return (int16_t)(y < 0 ? -angle : angle);
+}
+
+//e^(-i/8) in Q15, i = 0..64
+static const uint16_t EXP_NEG_TABLE[65] PROGMEM = {
+    32768, 28918, 25520, 22521, 19875, 17539, 15479, 13660,
+    12055, 10638,  9388,  8285,  7312,  6452,  5694,  5025,
+     4435,  3914,  3454,  3048,  2690,  2374,  2095,  1849,
+     1631,  1440,  1271,  1121,   990,   873,   771,   680,
+      600,   530,   467,   412,   364,   321,   283,   250,
+      221,   195,   172,   152,   134,   118,   104,    92,
+       81,    72,    63,    56,    49,    43,    38,    34,
+       30,    26,    23,    21,    18,    16,    14,    12,
+       11
+};
+
+uint16_t fixedExpNeg(uint32_t x_q12) {
+    uint32_t index = x_q12 >> 9;
+    if (index >= 64) {
+        return 0;
+    }
+    int32_t lo = pgm_read_word(&EXP_NEG_TABLE[index]);
+    int32_t hi = pgm_read_word(&EXP_NEG_TABLE[index + 1]);
+    return (uint16_t)(lo + (((hi - lo) * (int32_t)(x_q12 & 511)) >> 9));
+}
+
+uint16_t fixedSqrt(uint32_t v) {
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)result;
+}
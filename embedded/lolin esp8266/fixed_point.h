@@ -0,0 +1,69 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+#include "config.h"
+
+/**
+ Scaled integer units for the FIXED_POINT_PIPELINE build (config.h)
+ The ESP8266 has no FPU, every float/double operation is a libgcc call.
+ With the flag set, drivers -> filters -> SensorData -> FSM (thresholds and
+ the trajectory predictor) run on these units; floats only remain at the
+ edges (ground calibration, checkpoints, serial logs). Out of scope, still
+ float but not per loop; SensorData gets their results as scaled ints:
+ - the vibration spectrum after the Q15 FFT, once per 256-sample block
+ - the landing drift fit (LandingPredictor), once per GPS fix at 1-5 Hz
+
+   altitude       cm          int32
+   pressure       centipascal int32   (1 cPa ~ 0.08 mm of altitude)
+   temperature    0.01 C      int16
+   angle          0.01 deg    int16
+   acceleration   mg          int16
+   lat / lon      1e-7 deg    int32   (native unit of UBX and TinyGPS raw fields)
+   speed          cm/s
+   voltage        mV
+   frequency      0.01 Hz     uint16
+   rotation rate  0.01 deg/s  uint16
+ */
+
+#ifdef FIXED_POINT_PIPELINE
+typedef int32_t altitude_t;                              //cm
+#define ALTITUDE_FROM_M(m)   ((altitude_t)((m) * 100))
+#define ALTITUDE_TO_M(a)     ((a) * 0.01f)
+#else
+typedef float altitude_t;                                //m
+#define ALTITUDE_FROM_M(m)   ((altitude_t)(m))
+#define ALTITUDE_TO_M(a)     (a)
+#endif
+
+//Vertical speed, same unit choice as altitude_t
+#ifdef FIXED_POINT_PIPELINE
+typedef int32_t vspeed_t;                                //cm/s
+#define VSPEED_FROM_MPS(v)   ((vspeed_t)((v) * 100))
+#define VSPEED_TO_MPS(s)     ((s) * 0.01f)
+#else
+typedef float vspeed_t;                                  //m/s
+#define VSPEED_FROM_MPS(v)   ((vspeed_t)(v))
+#define VSPEED_TO_MPS(s)     (s)
+#endif
+
+//Standard atmosphere altitude (same formula as GroundBaseline::pressureToAltitude),
+//table in flash every 5 hPa from 1100 to 300 hPa, linear in between
+//(< 5 cm error below 3000 m, AGL differences much less)
+int32_t fixedPressureToAltitude(int32_t pressure_cPa);
+
+//atan2 in 0.01 deg (-18000..18000), error < 0.12 deg
+int16_t fixedAtan2(int32_t y, int32_t x);
+
+//e^-x in Q15 for x in Q12 (1/4096), flash table every 1/8 up to x = 8 and 0 beyond,
+//error < 0.2% of full scale
+uint16_t fixedExpNeg(uint32_t x_q12);
+
+//floor(sqrt(v))
+uint16_t fixedSqrt(uint32_t v);
+
+#endif
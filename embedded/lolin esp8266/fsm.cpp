@@ -3,6 +3,9 @@
  */
 
 #include "fsm.h"
+#include "fault_injection.h"
+#include "cycle_profile.h"
+#include "alloc_tracking.h"
 
 
 FSM::FSM() 
@@ -10,7 +13,21 @@ FSM::FSM()
       previousState(MissionState::BOOT), //cubesat knows its in first state
       stateEntryTime(0),
       lastTelemetryTime(0),              
-      imageCaptured(false) {             //cubesat knows it hasn't taken the image yet with esp32cam
+      maxAltitudeReached(0),
+      imageCaptured(false),              //cubesat knows it hasn't taken the image yet with esp32cam
+      platformStable(true),
+      shedMask(0),
+      deployTarget(-1),
+      imageTarget(-1),
+      landingTarget(-1),
+      checkpoints(nullptr),
+      groundPressure_hPa(1013.25),
+      groundAltitude_MSL(0.0),
+      groundReady(false),
+      lastCheckpointTime(0),
+      lastPersistentTime(0),
+      actuator(nullptr),
+      transitionTime_us(0) {
 }
 
 
@@ -18,84 +35,108 @@ bool FSM::begin() {
     stateEntryTime = millis();
     lastTelemetryTime = 0;
     imageCaptured = false;
+
+    restartPredictor();
     
-    Serial.println("[FSM] Initialized in BOOT state");
+    Serial.println(F("[FSM] Initialized in BOOT state"));
     return true;
 }
 
 
-void FSM::update(float altitude_m, unsigned long time_since_boot_ms, bool gps_valid) {
+void FSM::update(altitude_t altitude, unsigned long time_since_boot_ms, bool gps_valid) {
+    PROFILE_SCOPE(PROFILE_FSM_UPDATE);
+    ALLOC_FREE_SCOPE("FSM::update");
+
+    if (altitude > maxAltitudeReached) {
+        maxAltitudeReached = altitude;
+    }
 
-    //Calculate altitude change rate
-    float altitudeChange = altitude_m - previousAltitude;
-    previousAltitude = altitude_m;
+    //Fit altitude/speed and refresh time-to-altitude for deploy, image and landing
+    predictor.update(altitude, time_since_boot_ms);
 
-    if (altitude_m > maxAltitudeReached) {
-        maxAltitudeReached = altitude_m;
+    //RTC memory write is a few us, keeps the stored time-in-state fresh;
+    //the EEPROM copy now and then, so its RTC stamp stays within the max age
+    if (checkpoints != nullptr && isResumable() &&
+        millis() - lastCheckpointTime >= CHECKPOINT_INTERVAL_MS) {
+        saveCheckpoint(millis() - lastPersistentTime >= CHECKPOINT_EEPROM_REFRESH_MS);
     }
     
 
     switch (currentState) {
         
         case MissionState::BOOT:
-            //transition to IDLE after initialization complete
-            //check sensors
-            if (time_since_boot_ms > 5000) {  //5 seconds for sensor stabilization
+            //transition to IDLE as soon as the ground baseline has converged
+            //(setGroundReference), AGL altitudes are meaningless before that
+            if (groundReady) {
                 transitionTo(MissionState::IDLE);  //turn into IDLE mission state (waiting)
+            } else if (time_since_boot_ms > BOOT_TIMEOUT) {
+                Serial.println(F("[FSM] WARNING: no ground baseline, barometer unusable"));
+                enterSafeMode();
             }
             break;                 //handbrake
             
         case MissionState::IDLE:
             //detect release by sudden altitude change or acceleration spike
-            //altitude_m relative to ground (AGL)
+            //altitude relative to ground (AGL)
             //Main loop calculate: altitude_AGL = current_altitude - ground_altitude
             //where ground_altitude is measured during BOOT (inicialization) using BMP280's sensor pressure averaging
             
-            if (altitude_m > LIFTOFF_DETECT_ALT) {  //detected drone is lifting off
+            if (altitude > LIFTOFF_DETECT_ALT) {  //detected drone is lifting off
                 transitionTo(MissionState::ASCENT);
             }
             
             //Safety timeout, prevent infinite IDLE bucle
             if (getTimeInState() > IDLE_TIMEOUT) {
-                Serial.println("[FSM] WARNING: IDLE timeout exceeded");
+                Serial.println(F("[FSM] WARNING: IDLE timeout exceeded"));
                 enterSafeMode();
             }
             break;
         
-        case MissionState::ASCENDING:
-            //stay in ASCENT until we detect DESCENT    
-            if (altitudeChange < DESCENT_THRESHOLD) {
-                Serial.print("[FSM] Descent detected! Rate: ");
-                Serial.print(altitudeChange, 2);
-                Serial.println("m/s");
+        case MissionState::ASCENT: {
+            //stay in ASCENT until we detect DESCENT
+            //fitted speed (vspeed_t); the raw per-sample change is mostly noise, so no
+            //descent is declared before the fit is ready (only happens after a warm restart)
+            vspeed_t verticalSpeed = predictor.isReady() ? predictor.getVerticalSpeed() : 0;
+            if (verticalSpeed < DESCENT_THRESHOLD) {
+                Serial.print(F("[FSM] Descent detected! Rate: "));
+                Serial.print(VSPEED_TO_MPS(verticalSpeed), 2);
+                Serial.println(F("m/s"));
                 transitionTo(MissionState::DESCENT_FREE);
             }
             break;
+        }
         case MissionState::DESCENT_FREE:
             //Transition when parachute deploys (altitude drops below threshold)
-            if (altitude_m < PARACHUTE_DEPLOY_ALT) {
+            if (altitude < PARACHUTE_DEPLOY_ALT) {
                 transitionTo(MissionState::DESCENT_STABLE);
             }
             
             //if cubesat is in free fall too long, assume parachute failed
             if (getTimeInState() > 10000) {  // 10 seconds max free fall
-                Serial.println("[FSM] WARNING: Free fall timeout - parachute may have failed");
+                Serial.println(F("[FSM] WARNING: Free fall timeout - parachute may have failed"));
                 //continue to DESCENT_STABLE anyway (data collection priority)
                 transitionTo(MissionState::DESCENT_STABLE);
             }
             break;
             
         case MissionState::DESCENT_STABLE:
+            //Power the release servo ahead, so FIRE does not wait for it to settle
+            if (actuator != nullptr && actuator->getState() == ActuatorState::SAFE && !actuator->isArmPending() &&
+                predictor.isArmed(landingTarget, LANDING_LEAD_MS + ACTUATOR_ARM_SETTLE_US / 1000)) {
+                unsigned long now_us = micros();
+                actuator->schedule(ActuatorCommand::ARM, now_us, now_us);
+            }
+
             //This is the CRITICAL PHASE for data collection
-            //Transition to LANDING when close to ground
-            if (altitude_m < LANDING_DETECT_ALT) {
+            //Transition to LANDING when close to ground (measured, the prediction only pre-arms the servo)
+            if (altitude < LANDING_DETECT_ALT) {
                 transitionTo(MissionState::LANDING);
             }
             break;
             
         case MissionState::LANDING:
             //Transition to FINAL_REPORT when on ground
-            if (altitude_m < GROUND_LEVEL_ALT) {
+            if (altitude < GROUND_LEVEL_ALT) {
                 transitionTo(MissionState::FINAL_REPORT);
             }
             
@@ -128,6 +169,7 @@ const char* FSM::getStateName() const {
     switch (currentState) {
         case MissionState::BOOT:           return "BOOT";
         case MissionState::IDLE:           return "IDLE";
+        case MissionState::ASCENT:         return "ASCENT";
         case MissionState::DESCENT_FREE:   return "DESCENT_FREE";
         case MissionState::DESCENT_STABLE: return "DESCENT_STABLE";
         case MissionState::LANDING:        return "LANDING";
@@ -145,7 +187,8 @@ uint8_t FSM::getStateID() const {
 //Check if image should be captured
 bool FSM::shouldCaptureImage() const {
     //Only capture ONE image during stable descent at specific altitude
-    if (currentState == MissionState::DESCENT_STABLE && !imageCaptured) {
+    if (currentState == MissionState::DESCENT_STABLE && !imageCaptured &&
+        !(shedMask & (1u << SHED_IMAGE_CAPTURE))) {
         //This will be checked in main loop with altitude condition
         return true;
     }
@@ -160,8 +203,12 @@ bool FSM::shouldTransmitTelemetry(unsigned long current_time_ms) {
         return false;
     }
     
-    //Check if interval has passed
-    if (current_time_ms - lastTelemetryTime >= TELEMETRY_INTERVAL) {
+    //Check if interval has passed (stretched while shedding load)
+    unsigned long interval = TELEMETRY_INTERVAL;
+    if (shedMask & (1u << SHED_TELEMETRY_RATE)) {
+        interval *= LOAD_TELEMETRY_STRETCH;
+    }
+    if (current_time_ms - lastTelemetryTime >= interval) {
         lastTelemetryTime = current_time_ms;
         return true;
     }
@@ -171,7 +218,7 @@ bool FSM::shouldTransmitTelemetry(unsigned long current_time_ms) {
 
 //Force SAFE_MODE (error handling)
 void FSM::enterSafeMode() {
-    Serial.println("[FSM] ENTERING SAFE MODE");
+    Serial.println(F("[FSM] ENTERING SAFE MODE"));
     transitionTo(MissionState::SAFE_MODE);
 }
 
@@ -185,7 +232,169 @@ unsigned long FSM::getTimeInState() const {
  
 void FSM::confirmImageCaptured() {
     imageCaptured = true;
-    Serial.println("[FSM] Image capture confirmed. Flag set to prevent bucle.");
+    if (checkpoints != nullptr) {
+        saveCheckpoint(true);    //never take the picture twice after a reset
+    }
+    Serial.println(F("[FSM] Image capture confirmed. Flag set to prevent bucle."));
+}
+
+
+//Actual - predicted (1 s ahead) crossing time for every target, for post-flight tuning
+void FSM::printPredictionErrors() const {
+    const int8_t targets[] = { deployTarget, imageTarget, landingTarget };
+    for (uint8_t i = 0; i < 3; i++) {
+        if (targets[i] < 0) {
+            continue;
+        }
+        const AltitudePrediction& p = predictor.getPrediction(targets[i]);
+        Serial.print(F("[FSM] Prediction @"));
+        Serial.print(ALTITUDE_TO_M(p.target), 0);
+        Serial.print(F(" m: "));
+        if (p.errorAvailable) {
+            Serial.print(p.lastError_ms);
+            Serial.println(F(" ms"));
+        } else {
+            Serial.println(F("not scored"));
+        }
+    }
+}
+
+bool FSM::isImageCaptureArmed() const {
+    if (currentState != MissionState::DESCENT_STABLE || imageCaptured ||
+        (shedMask & (1u << SHED_IMAGE_CAPTURE))) {
+        return false;
+    }
+    bool windowOpen = predictor.isArmed(imageTarget, CAMERA_LEAD_MS) ||
+                      predictor.getPrediction(imageTarget).crossed;
+    if (!windowOpen) {
+        return false;
+    }
+    //Wait for a calm moment, but do not miss the picture waiting for it
+    return platformStable ||
+           predictor.getAltitude() < IMAGE_CAPTURE_ALT - CAPTURE_WINDOW;
+}
+
+void FSM::setPlatformStable(bool stable) {
+    platformStable = stable;
+}
+
+void FSM::setShedMask(uint16_t mask) {
+    shedMask = mask;
+}
+
+const TrajectoryPredictor& FSM::getPredictor() const {
+    return predictor;
+}
+
+void FSM::setGroundReference(float pressure_hPa, float altitude_MSL) {
+    groundPressure_hPa = pressure_hPa;
+    groundAltitude_MSL = altitude_MSL;
+    groundReady = true;
+}
+
+void FSM::attachCheckpoint(CheckpointStore* store) {
+    checkpoints = store;
+}
+
+void FSM::attachActuator(ServoActuator* servo) {
+    actuator = servo;
+    applyInterlocks();
+    //Attached after a warm restart into LANDING: resume() had no servo to release
+    if (currentState == MissionState::LANDING && actuator != nullptr) {
+        actuator->scheduleRelease(micros());
+    }
+}
+
+//ARM from the predicted landing on, FIRE only once LANDING is declared
+void FSM::applyInterlocks() {
+    if (actuator != nullptr) {
+        actuator->setInterlocks(currentState == MissionState::DESCENT_STABLE ||
+                                currentState == MissionState::LANDING,
+                                currentState == MissionState::LANDING);
+    }
+}
+
+bool FSM::resume(const MissionCheckpoint& checkpoint) {
+    if (checkpoint.state < static_cast<uint8_t>(MissionState::IDLE) ||
+        checkpoint.state > static_cast<uint8_t>(MissionState::LANDING)) {
+        return false;
+    }
+    unsigned long start = micros();
+
+    lastTelemetryTime = 0;
+    restartPredictor();
+
+    currentState = static_cast<MissionState>(checkpoint.state);
+    previousState = MissionState::BOOT;
+    //millis() restarted at 0, wraps like any other millis() difference
+    stateEntryTime = millis() - checkpoint.timeInState_ms;
+    maxAltitudeReached = ALTITUDE_FROM_M(checkpoint.maxAltitudeReached);
+    imageCaptured = checkpoint.imageCaptured != 0;
+    groundPressure_hPa = checkpoint.groundPressure_hPa;
+    groundAltitude_MSL = checkpoint.groundAltitude_MSL;
+    groundReady = true;
+    configurePredictor();
+    applyInterlocks();
+    //Reset in LANDING: the release may not have happened, pulling it twice is harmless
+    if (currentState == MissionState::LANDING && actuator != nullptr) {
+        actuator->scheduleRelease(micros());
+    }
+
+    Serial.print(F("[FSM] Warm restart into "));
+    Serial.print(getStateName());
+    Serial.print(F(" ("));
+    Serial.print(checkpoint.timeInState_ms);
+    Serial.print(F(" ms in state) in "));
+    Serial.print(micros() - start);
+    Serial.println(F(" us"));
+    return true;
+}
+
+void FSM::snapshot(MissionCheckpoint& checkpoint) const {
+    checkpoint.state = getStateID();
+    checkpoint.imageCaptured = imageCaptured ? 1 : 0;
+    checkpoint.timeInState_ms = getTimeInState();
+    checkpoint.maxAltitudeReached = ALTITUDE_TO_M(maxAltitudeReached);   //meters in either build
+    checkpoint.groundPressure_hPa = groundPressure_hPa;
+    checkpoint.groundAltitude_MSL = groundAltitude_MSL;
+}
+
+void FSM::saveCheckpoint(bool persistent) {
+    MissionCheckpoint checkpoint;
+    snapshot(checkpoint);
+    checkpoints->save(checkpoint, persistent);
+    lastCheckpointTime = millis();
+    if (persistent) {
+        lastPersistentTime = lastCheckpointTime;
+    }
+}
+
+bool FSM::isResumable() const {
+    return currentState >= MissionState::IDLE && currentState <= MissionState::LANDING;
+}
+
+//Empty fit with the deploy, image and landing targets
+void FSM::restartPredictor() {
+    predictor.begin();
+    deployTarget = predictor.addTarget(PARACHUTE_DEPLOY_ALT);
+    imageTarget = predictor.addTarget(IMAGE_CAPTURE_ALT);
+    landingTarget = predictor.addTarget(LANDING_DETECT_ALT);
+}
+
+//Drag model for the phase we are in
+void FSM::configurePredictor() {
+    switch (currentState) {
+        case MissionState::DESCENT_FREE:
+            predictor.setTerminalVelocity(FREEFALL_TERMINAL_VELOCITY);
+            break;
+        case MissionState::DESCENT_STABLE:
+        case MissionState::LANDING:
+            predictor.setTerminalVelocity(PARACHUTE_TERMINAL_VELOCITY);
+            break;
+        default:
+            predictor.setTerminalVelocity(0);  //no drag model while carried
+            break;
+    }
 }
 
 
@@ -194,6 +403,7 @@ void FSM::transitionTo(MissionState newState) {
     if (newState == currentState) {
         return;  //No transition needed
     }
+    transitionTime_us = micros();
     
     //Exit current state
     onStateExit();
@@ -202,54 +412,81 @@ void FSM::transitionTo(MissionState newState) {
     previousState = currentState;
     currentState = newState;
     stateEntryTime = millis();
+    FAULT_NOTE_TRANSITION(getStateID());
     
     //Log transition
-    Serial.print("[FSM] Transition: ");
+    Serial.print(F("[FSM] Transition: "));
     Serial.print(getStateName());
-    Serial.print(" (");
+    Serial.print(F(" ("));
     Serial.print(getTimeInState());
-    Serial.println(" ms)");
+    Serial.println(F(" ms)"));
     
     //Enter new state
     onStateEntry();
+
+    if (checkpoints != nullptr) {
+        if (isResumable()) {
+            saveCheckpoint(true);
+        } else if (currentState == MissionState::FINAL_REPORT) {
+            checkpoints->clear();    //mission over, next power-on is a cold boot
+        }
+    }
 }
 
 
 //Actions when entering a state
 void FSM::onStateEntry() {
-    Serial.print("[FSM] Entered state: ");
+    Serial.print(F("[FSM] Entered state: "));
     Serial.println(getStateName());
+    applyInterlocks();
     
     switch (currentState) {
         case MissionState::BOOT:
-            Serial.println("[FSM] System booting...");
+            Serial.println(F("[FSM] System booting..."));
             break;
             
         case MissionState::IDLE:
-            Serial.println("[FSM] Ready for deployment");
+            Serial.println(F("[FSM] Ready for deployment"));
+            //BOOT samples were AGL against the default ground pressure, the
+            //jump to the converged baseline would read as a fast descent
+            restartPredictor();
+            break;
+
+        case MissionState::ASCENT:
+            Serial.println(F("[FSM] Liftoff - climbing with drone"));
+            configurePredictor();
             break;
             
         case MissionState::DESCENT_FREE:
-            Serial.println("[FSM] Free fall detected - awaiting parachute");
+            Serial.println(F("[FSM] Free fall detected - awaiting parachute"));
+            configurePredictor();
             break;
             
         case MissionState::DESCENT_STABLE:
-            Serial.println("[FSM] Stable descent - PRIMARY DATA COLLECTION PHASE");
+            Serial.println(F("[FSM] Stable descent - PRIMARY DATA COLLECTION PHASE"));
+            configurePredictor();
             //Reset image flag for this mission
             imageCaptured = false;
             break;
             
         case MissionState::LANDING:
-            Serial.println("[FSM] Landing sequence initiated");
-            //TODO: Trigger parachute release servo here
+            Serial.println(F("[FSM] Landing sequence initiated"));
+            //Release the parachute so it does not drag the payload after touchdown
+            if (actuator != nullptr && !actuator->scheduleRelease(transitionTime_us)) {
+                Serial.println(F("[FSM] WARNING: Release servo queue full"));
+            }
             break;
             
         case MissionState::FINAL_REPORT:
-            Serial.println("[FSM] Mission complete - transmitting final report");
+            Serial.println(F("[FSM] Mission complete - transmitting final report"));
+            printPredictionErrors();
             break;
             
         case MissionState::SAFE_MODE:
-            Serial.println("[FSM] SAFE MODE ACTIVE - Minimal operations only");
+            Serial.println(F("[FSM] SAFE MODE ACTIVE - Minimal operations only"));
+            if (actuator != nullptr) {
+                actuator->abort(transitionTime_us);
+            }
             break;
     }
 }
@@ -257,17 +494,17 @@ void FSM::onStateEntry() {
 //Actions when exiting a state
 void FSM::onStateExit() {
     //Log time spent in state
-    Serial.print("[FSM] Exiting ");
+    Serial.print(F("[FSM] Exiting "));
     Serial.print(getStateName());
-    Serial.print(" after ");
+    Serial.print(F(" after "));
     Serial.print(getTimeInState());
-    Serial.println(" ms");
+    Serial.println(F(" ms"));
     
     //State-specific cleanup
     switch (currentState) {
         case MissionState::DESCENT_STABLE:
             if (!imageCaptured) {
-                Serial.println("[FSM] WARNING: Exited DESCENT_STABLE without capturing image");
+                Serial.println(F("[FSM] WARNING: Exited DESCENT_STABLE without capturing image"));
             }
             break;
             
@@ -5,7 +5,16 @@
 #ifndef FSM_H
 #define FSM_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "predictor.h"
+#include "mission_checkpoint.h"
+#include "fixed_point.h"
+#include "load_shedding.h"
+#include "actuator.h"
 
 
  //Each state has specific behaviors and data collection priorities
@@ -38,11 +47,12 @@ public:
     bool begin();
 
     /**
-     * altitude_m Current altitude in meters (from BMP280 or GPS)
+     * altitude Current altitude AGL (from BMP280 or GPS), altitude_t: meters,
+     *          or cm with FIXED_POINT_PIPELINE (SensorData altitude_AGL / altitude_AGL_cm)
      * time_since_boot_ms time since system boot
      * gps_valid Whether GPS has valid fix
      */
-    void update(float altitude_m, unsigned long time_since_boot_ms, bool gps_valid);
+    void update(altitude_t altitude, unsigned long time_since_boot_ms, bool gps_valid);
 
     
     //get mission state (const)
@@ -88,30 +98,123 @@ public:
      
     void confirmImageCaptured();
 
+    /**
+     True when the trajectory predictor expects IMAGE_CAPTURE_ALT within the
+     camera trigger latency, main loop fires the ESP32-CAM on this instead of
+     waiting for the altitude to actually cross (sensor lag = missed altitude)
+     */
+    bool isImageCaptureArmed() const;
+
+    /**
+     Camera gate from SensorManager::getVibration().isStableForCapture()
+     Once armed, the trigger waits for a calm block (little swing, no strong
+     vibration) but never longer than CAPTURE_WINDOW below IMAGE_CAPTURE_ALT
+     Default true: without the analyser the camera fires as soon as it is armed
+     */
+    void setPlatformStable(bool stable);
+
+    //Vertical speed and time-to-altitude estimates (for telemetry / logs)
+    const TrajectoryPredictor& getPredictor() const;
+
+    /**
+     Load shedding (LoadShedder::getShedMask): SHED_TELEMETRY_RATE stretches
+     the telemetry interval by LOAD_TELEMETRY_STRETCH, SHED_IMAGE_CAPTURE keeps
+     the camera disarmed (critical battery). Transitions are never shed.
+     */
+    void setShedMask(uint16_t mask);
+
+    /**
+     Ground calibration from SensorManager, stored in every checkpoint
+     Call whenever SensorManager::isCalibrated(), BOOT ends on the first call
+     */
+    void setGroundReference(float pressure_hPa, float altitude_MSL);
+
+    /**
+     Checkpoint on every transition into IDLE..LANDING (RTC memory + EEPROM)
+     and every CHECKPOINT_INTERVAL_MS in those states (RTC memory, EEPROM
+     every CHECKPOINT_EEPROM_REFRESH_MS)
+     */
+    void attachCheckpoint(CheckpointStore* store);
+
+    /**
+     Parachute release servo: released on LANDING entry (decision timestamp
+     taken at the transition), armed ahead when the landing is predicted within
+     LANDING_LEAD_MS + ACTUATOR_ARM_SETTLE_US. Interlocks follow the state:
+     ARM in DESCENT_STABLE and LANDING, FIRE only in LANDING, SAFE_MODE aborts.
+     Attach before or after resume(): a warm restart into LANDING schedules
+     the release in whichever of the two runs last.
+     */
+    void attachActuator(ServoActuator* servo);
+
+    /**
+     Warm restart: continue the mission from a checkpoint instead of BOOT
+     IDLE..LANDING are resumed: IDLE is checkpointed once the ground baseline
+     has converged, so a reset during the pad wait keeps that baseline (frozen)
+     even if the drone is already lifting. No entry actions are repeated.
+     return false if the checkpoint is not resumable (caller does a cold boot)
+     */
+    bool resume(const MissionCheckpoint& checkpoint);
+    void snapshot(MissionCheckpoint& checkpoint) const;
+
 private:
     MissionState currentState;           //current state
     MissionState previousState;          //previous state
     unsigned long stateEntryTime;        //millis() when current state was entered
     unsigned long lastTelemetryTime;     //millis() of last telemetry transmission
 
-    //Altitude tracking for ASCENT → DESCENT_FREE transition
-    float previousAltitude;              //last altitude reading (for detecting descent)
-    float maxAltitudeReached;            //peak altitude during ASCENT state
+    altitude_t maxAltitudeReached;       //peak altitude during ASCENT state
     
     
     //these altitudes must be RELATIVE to ground (Above Ground Level)
     //main loop must implement AGL calibration during BOOT/IDLE
-    const float LIFTOFF_DETECT_ALT = 10.0      //meters AGL (detect drone liftoff)
-    const float PARACHUTE_DEPLOY_ALT = 80.0;   //meters AGL (not MSL! because margin of error)
-    const float LANDING_DETECT_ALT = 10.0;     //meters AGL
-    const float GROUND_LEVEL_ALT = 2.0;        //meters AGL (consider landed)
+    //altitude_t so the per-sample comparisons stay integer in the fixed-point build
+    const altitude_t LIFTOFF_DETECT_ALT = ALTITUDE_FROM_M(10.0);     //meters AGL (detect drone liftoff)
+    const altitude_t PARACHUTE_DEPLOY_ALT = ALTITUDE_FROM_M(80.0);   //meters AGL (not MSL! because margin of error)
+    const altitude_t LANDING_DETECT_ALT = ALTITUDE_FROM_M(10.0);     //meters AGL
+    const altitude_t GROUND_LEVEL_ALT = ALTITUDE_FROM_M(2.0);        //meters AGL (consider landed)
     const unsigned long TELEMETRY_INTERVAL = 1000;  //ms (1 Hz)
     const unsigned long IDLE_TIMEOUT = 300000; //5 min max in IDLE
-    const float DESCENT_THRESHOLD = -0.5;      //m/s (negative = descending) "we are definitely falling"
+    const unsigned long BOOT_TIMEOUT = 30000;  //ground baseline normally converges in a few seconds
+    const vspeed_t DESCENT_THRESHOLD = VSPEED_FROM_MPS(-0.5);      //m/s (negative = descending) "we are definitely falling"
     
     //Image capture control
     bool imageCaptured;                  //boolean
-    const float IMAGE_CAPTURE_ALT = 40.0; //meters AGL (probably stable descent phase)
+    const altitude_t IMAGE_CAPTURE_ALT = ALTITUDE_FROM_M(40.0); //meters AGL (probably stable descent phase)
+    const altitude_t CAPTURE_WINDOW = ALTITUDE_FROM_M(10.0);    //shoot anyway once this far below IMAGE_CAPTURE_ALT
+    bool platformStable;
+
+    uint16_t shedMask;
+
+    //Ahead-of-time arming of the camera and the release servo when the predicted
+    //crossing is closer than their latency. Transitions follow the measured altitude;
+    //the deploy crossing is only predicted and scored (nothing to pre-arm)
+    TrajectoryPredictor predictor;
+    int8_t deployTarget;
+    int8_t imageTarget;
+    int8_t landingTarget;
+    const vspeed_t FREEFALL_TERMINAL_VELOCITY = VSPEED_FROM_MPS(-25.0);   //m/s, payload without parachute
+    const vspeed_t PARACHUTE_TERMINAL_VELOCITY = VSPEED_FROM_MPS(-5.0);   //m/s, under canopy
+    const unsigned long CAMERA_LEAD_MS = 400;         //ESP32-CAM trigger to exposure
+    const unsigned long LANDING_LEAD_MS = 200;        //margin on top of the servo settle time when pre-arming
+    void printPredictionErrors() const;
+    void configurePredictor();
+    void restartPredictor();
+
+    //Warm restart checkpoint
+    CheckpointStore* checkpoints;
+    float groundPressure_hPa;
+    float groundAltitude_MSL;
+    bool groundReady;
+    unsigned long lastCheckpointTime;
+    unsigned long lastPersistentTime;    //last EEPROM copy
+    const unsigned long CHECKPOINT_INTERVAL_MS = 250;
+    void saveCheckpoint(bool persistent);
+    bool isResumable() const;            //IDLE..LANDING, the states a checkpoint is kept for
+
+    //Parachute release
+    ServoActuator* actuator;
+    unsigned long transitionTime_us;     //micros() when the last transition was decided
+    void applyInterlocks();
     
     /**
      Transition to new state
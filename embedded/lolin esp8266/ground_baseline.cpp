@@ -0,0 +1,167 @@
+#include "ground_baseline.h"
+
+GroundBaseline::GroundBaseline()
+    : frozen(false) {
+    reset();
+}
+
+void GroundBaseline::reset() {
+    head = 0;
+    count = 0;
+    estimate = 1013.25;
+    altitude = 0.0;
+    spread = 0.0;
+    recentEstimates.reset();
+    moving = 0;
+    anchor = 0.0;
+    anchor_ms = 0;
+    ready = false;
+    restarted = false;
+    firstSample_ms = 0;
+    timeToReady_ms = 0;
+}
+
+bool GroundBaseline::addSample(float pressure_hPa, unsigned long now_ms) {
+    if (frozen) {
+        return false;
+    }
+
+    //Once ready, a reading far from the estimate is the payload being carried, not weather
+    if (ready && fabs(pressure_hPa - estimate) > GROUND_MOTION_HPA) {
+        if (++moving >= GROUND_MOTION_RESET) {
+            Serial.println(F("[GROUND] Payload moved, restarting baseline"));
+            restart();
+        }
+        return false;
+    }
+    moving = 0;
+
+    if (count == 0) {
+        firstSample_ms = now_ms;
+    }
+    window[head] = pressure_hPa;
+    head = (head + 1) % GROUND_WINDOW;
+    if (count < GROUND_WINDOW) {
+        count++;
+    }
+    recompute();
+
+    //Settled: the estimate stayed within GROUND_SETTLE_HPA over the last GROUND_SETTLE_SAMPLES
+    recentEstimates.update(estimate);
+    bool settled = recentEstimates.isFull() &&
+                   recentEstimates.max() - recentEstimates.min() <= GROUND_SETTLE_HPA;
+
+    //Every step below the motion gate, but the estimate follows: carried up slowly
+    if (ready && fabs(estimate - anchor) > GROUND_DRIFT_HPA) {
+        Serial.println(F("[GROUND] Baseline drifting, restarting baseline"));
+        restart();
+        return false;
+    }
+    if (ready && now_ms - anchor_ms >= GROUND_DRIFT_WINDOW_MS) {
+        anchor = estimate;
+        anchor_ms = now_ms;
+    }
+
+    //A restart while still being carried would settle on a point of the way up
+    bool held = !restarted || now_ms - firstSample_ms >= GROUND_DRIFT_WINDOW_MS;
+
+    if (!ready && count >= GROUND_MIN_SAMPLES && settled && held && spread <= GROUND_STABLE_SPREAD_HPA) {
+        ready = true;
+        timeToReady_ms = now_ms - firstSample_ms;
+        anchor = estimate;
+        anchor_ms = now_ms;
+
+        Serial.print(F("[GROUND] Baseline ready after "));
+        Serial.print(timeToReady_ms);
+        Serial.print(F(" ms: "));
+        Serial.print(estimate, 2);
+        Serial.print(F(" hPa, "));
+        Serial.print(altitude, 2);
+        Serial.print(F(" m MSL (spread "));
+        Serial.print(spread, 3);
+        Serial.println(F(" hPa)"));
+    }
+    return true;
+}
+
+void GroundBaseline::restart() {
+    reset();
+    restarted = true;
+}
+
+void GroundBaseline::freeze() {
+    if (!frozen && ready) {
+        Serial.print(F("[GROUND] Baseline frozen at "));
+        Serial.print(estimate, 2);
+        Serial.println(F(" hPa"));
+    }
+    frozen = true;
+}
+
+void GroundBaseline::thaw() {
+    frozen = false;
+}
+
+bool GroundBaseline::isFrozen() const {
+    return frozen;
+}
+
+void GroundBaseline::restore(float pressure_hPa, float altitude_MSL) {
+    reset();
+    estimate = pressure_hPa;
+    altitude = altitude_MSL;
+    ready = true;
+    frozen = true;
+}
+
+bool GroundBaseline::isReady() const {
+    return ready;
+}
+
+float GroundBaseline::getPressure() const {
+    return estimate;
+}
+
+float GroundBaseline::getAltitude() const {
+    return altitude;
+}
+
+float GroundBaseline::getSpread() const {
+    return spread;
+}
+
+uint8_t GroundBaseline::getCount() const {
+    return count;
+}
+
+unsigned long GroundBaseline::getTimeToReady() const {
+    return timeToReady_ms;
+}
+
+float GroundBaseline::pressureToAltitude(float pressure_hPa) {
+    return 44330.0 * (1.0 - pow(pressure_hPa / 1013.25, 0.1903));
+}
+
+//Interquartile trimmed mean + IQR, insertion sort of at most 32 values (~1 per barometer sample)
+void GroundBaseline::recompute() {
+    float sorted[GROUND_WINDOW];
+    for (uint8_t i = 0; i < count; i++) {
+        float value = window[i];
+        int8_t j = (int8_t)i - 1;
+        while (j >= 0 && sorted[j] > value) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = value;
+    }
+
+    uint8_t lo = count / 4;
+    uint8_t hi = count - lo;
+    float sum = 0.0;
+    for (uint8_t i = lo; i < hi; i++) {
+        sum += sorted[i];
+    }
+    estimate = sum / (hi - lo);
+    spread = sorted[hi - 1] - sorted[lo];
+    altitude = pressureToAltitude(estimate);
+}
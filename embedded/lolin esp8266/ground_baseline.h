@@ -0,0 +1,83 @@
+#ifndef GROUND_BASELINE_H
+#define GROUND_BASELINE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "filters.h"
+
+#define GROUND_WINDOW             32      //samples kept (~3 s in BOOT, ~17 s in IDLE)
+#define GROUND_MIN_SAMPLES        16
+#define GROUND_STABLE_SPREAD_HPA  0.12    //interquartile range, ~1 m
+#define GROUND_SETTLE_HPA         0.05    //estimate range over the last GROUND_SETTLE_SAMPLES, ~0.4 m
+#define GROUND_SETTLE_SAMPLES     8
+#define GROUND_MOTION_HPA         0.25    //~2 m from the estimate = payload is moving
+#define GROUND_MOTION_RESET       20      //moving samples in a row before starting over
+#define GROUND_DRIFT_HPA          0.10    //estimate change within GROUND_DRIFT_WINDOW_MS = slow lift, ~0.8 m
+#define GROUND_DRIFT_WINDOW_MS    60000   //weather moves < 0.05 hPa a minute
+
+/**
+ Incremental ground pressure estimator, no blocking calibration loop at boot
+ Responsibilities:
+ - Keep a sliding window of barometer samples during BOOT/IDLE
+ - Robust estimate: interquartile (25%) trimmed mean, spikes and the odd
+   person walking past do not move it
+ - Convergence: enough samples, small spread and a settled estimate,
+   so BOOT can end as soon as the baseline is usable
+ - Track slow weather drift while waiting in IDLE, ignore samples that look
+   like the payload being moved, start over if it was moved for good or
+   the estimate creeps faster than weather can (a slow lift in small steps);
+   after such a restart the new baseline must hold for GROUND_DRIFT_WINDOW_MS,
+   SensorManager keeps the last reference meanwhile
+ - Freeze on liftoff (SensorManager::applyProfile)
+ */
+class GroundBaseline {
+public:
+    GroundBaseline();
+
+    void reset();
+
+    //Add one new barometer sample, return false if frozen or rejected as motion
+    bool addSample(float pressure_hPa, unsigned long now_ms);
+
+    void freeze();
+    void thaw();
+    bool isFrozen() const;
+
+    //Warm restart: take a known baseline, ready and frozen
+    void restore(float pressure_hPa, float altitude_MSL);
+
+    bool isReady() const;
+    float getPressure() const;            //hPa
+    float getAltitude() const;            //m MSL, same formula as SensorManager
+    float getSpread() const;              //interquartile range (hPa)
+    uint8_t getCount() const;
+    unsigned long getTimeToReady() const; //first sample -> ready (ms), 0 until ready
+
+    //International barometric formula, 1013.25 hPa reference (as Adafruit_BMP280::readAltitude)
+    static float pressureToAltitude(float pressure_hPa);
+
+private:
+    float window[GROUND_WINDOW];
+    uint8_t head;
+    uint8_t count;
+    float estimate;
+    float altitude;
+    float spread;
+    MovingStats<float, GROUND_SETTLE_SAMPLES + 1> recentEstimates;   //current + past, for the settle check
+    uint8_t moving;
+    float anchor;                         //estimate at the start of the drift window
+    unsigned long anchor_ms;
+    bool ready;
+    bool restarted;                       //reset by motion or drift, not the first baseline
+    bool frozen;
+    unsigned long firstSample_ms;
+    unsigned long timeToReady_ms;
+
+    void restart();
+    void recompute();
+};
+
+#endif
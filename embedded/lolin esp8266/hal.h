@@ -0,0 +1,41 @@
+#ifndef HAL_H
+#define HAL_H
+
+/**
+ Compile-time hardware policies for the sensor drivers
+ BMP280_DriverT, MPU6050_DriverT, RTC_DriverT and GPS_DriverT take one
+ policy type and reach the hardware only through its members, all resolved
+ at compile time (static inline functions and typedefs, no virtual calls).
+ The code size against the pre-template drivers has no committed
+ measurement: compare a flight build with one from before the templates
+ (memory_report.py --compare, per object and for the .elf).
+
+ A policy provides:
+   Clock       static millis(), micros(), delay(ms), yield()
+   Bus         asynchronous register reads (I2CBus interface: submitRead,
+               poll, readRegisters, writeRegister, probe)
+   GpsSerial   SoftwareSerial interface: (rx, tx) constructor, begin(baud),
+               available(), read(), write(buffer, length)
+   BMP280      Adafruit_BMP280 interface used by begin()/setSampling()
+   MPU6050     Adafruit_MPU6050 interface
+   MPU6050Bandwidth  its DLPF setting (MPU6050_BAND_*_HZ values)
+   RTC         RTClib RTC_DS3231 interface
+   NMEA        TinyGPSPlus interface
+ plus the vocabulary types of those libraries (DateTime, sensors_event_t,
+ mpu6050_*_t, RawDegrees) and Serial for the boot log.
+
+ Esp8266Hal (hal_esp8266.h) maps them to the Arduino core and libraries,
+ LinuxSimHal (hal_linux.h) to simulated devices on a host, with the flight
+ I2CBus running over the Arduino core stand-ins of hal_linux_core.h. TargetHal is the
+ one for the current build and the X_Driver typedefs use it.
+ */
+
+#ifdef ARDUINO
+#include "hal_esp8266.h"
+typedef Esp8266Hal TargetHal;
+#else
+#include "hal_linux.h"
+typedef LinuxSimHal TargetHal;
+#endif
+
+#endif
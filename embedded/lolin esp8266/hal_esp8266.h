@@ -0,0 +1,34 @@
+#ifndef HAL_ESP8266_H
+#define HAL_ESP8266_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_BMP280.h>
+#include <Adafruit_MPU6050.h>
+#include <Adafruit_Sensor.h>
+#include <RTClib.h>
+#include <TinyGPSPlus.h>
+#include <SoftwareSerial.h> //ESP8266
+#include "i2c_bus.h"
+
+//Arduino core time base, every call inlines to the core function
+struct Esp8266Clock {
+    static inline unsigned long millis() { return ::millis(); }
+    static inline unsigned long micros() { return ::micros(); }
+    static inline void delay(unsigned long ms) { ::delay(ms); }
+    static inline void yield() { ::yield(); }
+};
+
+//Flight hardware: LOLIN D1 mini, shared I2C bus manager, GPS on SoftwareSerial
+struct Esp8266Hal {
+    typedef Esp8266Clock Clock;
+    typedef I2CBus Bus;
+    typedef SoftwareSerial GpsSerial;
+    typedef Adafruit_BMP280 BMP280;
+    typedef Adafruit_MPU6050 MPU6050;
+    typedef mpu6050_bandwidth_t MPU6050Bandwidth;
+    typedef RTC_DS3231 RTC;
+    typedef TinyGPSPlus NMEA;
+};
+
+#endif
@@ -0,0 +1,825 @@
+#ifndef ARDUINO
+
+#include "hal_linux.h"
+
+#include <chrono>
+#include <math.h>
+
+//Boot log
+
+SimPrint Serial;
+
+static bool printEnabled = true;
+
+void SimPrint::setEnabled(bool enabled) {
+    printEnabled = enabled;
+}
+
+size_t SimPrint::print(const char* s) {
+    return printEnabled ? (size_t)printf("%s", s) : 0;
+}
+
+size_t SimPrint::print(char c) {
+    return printEnabled ? (size_t)printf("%c", c) : 0;
+}
+
+size_t SimPrint::print(int value, int base) {
+    return print((long)value, base);
+}
+
+size_t SimPrint::print(unsigned int value, int base) {
+    return print((unsigned long)value, base);
+}
+
+size_t SimPrint::print(long value, int base) {
+    if (base == HEX) {
+        return print((unsigned long)value, base);
+    }
+    return printEnabled ? (size_t)printf("%ld", value) : 0;
+}
+
+size_t SimPrint::print(unsigned long value, int base) {
+    return printEnabled ? (size_t)printf(base == HEX ? "%lX" : "%lu", value) : 0;
+}
+
+size_t SimPrint::print(double value, int digits) {
+    return printEnabled ? (size_t)printf("%.*f", digits, value) : 0;
+}
+
+size_t SimPrint::println() {
+    return printEnabled ? (size_t)printf("\n") : 0;
+}
+
+
+//Clock
+
+uint64_t SimClock::now_us = 0;
+
+
+//I2C devices and the physical bus
+
+SimI2CDevice::SimI2CDevice() : present(true) {
+    memset(registers, 0, sizeof(registers));
+}
+
+bool SimI2CDevice::read(uint8_t reg, uint8_t* data, uint8_t len) const {
+    if (!present) {
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        data[i] = registers[(uint8_t)(reg + i)];
+    }
+    return true;
+}
+
+bool SimI2CDevice::write(uint8_t reg, uint8_t value) {
+    if (!present) {
+        return false;
+    }
+    registers[reg] = value;
+    return true;
+}
+
+uint8_t SimI2CDevice::getRegister(uint8_t reg) const {
+    return registers[reg];
+}
+
+void SimI2CDevice::setRegister(uint8_t reg, uint8_t value) {
+    registers[reg] = value;
+}
+
+void SimI2CDevice::setPresent(bool isPresent) {
+    present = isPresent;
+}
+
+bool SimI2CDevice::isPresent() const {
+    return present;
+}
+
+static uint8_t wireAddresses[SIM_I2C_MAX_DEVICES];
+static SimI2CDevice* wireDevices[SIM_I2C_MAX_DEVICES];
+static uint8_t wireDeviceCount = 0;
+static uint32_t wireTransfers = 0;
+
+static SimI2CDevice* wireFind(uint8_t address) {
+    for (uint8_t i = 0; i < wireDeviceCount; i++) {
+        if (wireAddresses[i] == address) {
+            return wireDevices[i];
+        }
+    }
+    return nullptr;
+}
+
+bool SimWire::attach(uint8_t address, SimI2CDevice* device) {
+    if (wireFind(address) != nullptr || wireDeviceCount >= SIM_I2C_MAX_DEVICES) {
+        return false;   //address already taken: two devices would answer
+    }
+    wireAddresses[wireDeviceCount] = address;
+    wireDevices[wireDeviceCount] = device;
+    wireDeviceCount++;
+    return true;
+}
+
+void SimWire::detachAll() {
+    wireDeviceCount = 0;
+    wireTransfers = 0;
+}
+
+bool SimWire::probe(uint8_t address) {
+    SimI2CDevice* device = wireFind(address);
+    wireTransfers++;
+    return device != nullptr && device->isPresent();
+}
+
+bool SimWire::read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t len) {
+    SimI2CDevice* device = wireFind(address);
+    wireTransfers++;
+    return device != nullptr && device->read(reg, data, len);
+}
+
+bool SimWire::write(uint8_t address, uint8_t reg, uint8_t value) {
+    SimI2CDevice* device = wireFind(address);
+    wireTransfers++;
+    return device != nullptr && device->write(reg, value);
+}
+
+uint32_t SimWire::getTransfers() {
+    return wireTransfers;
+}
+
+
+//TwoWire
+
+SimTwoWire Wire;
+
+SimTwoWire::SimTwoWire()
+    : clockHz(100000),
+      remainder_ns(0),
+      txAddress(0),
+      txLength(0),
+      rxLength(0),
+      rxIndex(0),
+      pointerAddress(0),
+      pointer(0) {
+}
+
+void SimTwoWire::begin() {
+    txLength = 0;
+    rxLength = 0;
+    rxIndex = 0;
+}
+
+void SimTwoWire::setClock(uint32_t hz) {
+    clockHz = hz > 0 ? hz : 100000;
+}
+
+void SimTwoWire::beginTransmission(uint8_t address) {
+    txAddress = address;
+    txLength = 0;
+}
+
+size_t SimTwoWire::write(uint8_t value) {
+    if (txLength >= SIM_WIRE_BUFFER) {
+        return 0;
+    }
+    txBuffer[txLength++] = value;
+    return 1;
+}
+
+uint8_t SimTwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    busTime(1 + txLength);
+    if (!SimWire::probe(txAddress)) {
+        return 2;           //address NAK
+    }
+    if (txLength > 0) {
+        pointerAddress = txAddress;
+        pointer = txBuffer[0];
+    }
+    for (uint8_t i = 1; i < txLength; i++) {
+        if (!SimWire::write(txAddress, pointer++, txBuffer[i])) {
+            return 3;       //data NAK
+        }
+    }
+    return 0;
+}
+
+uint8_t SimTwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+    (void)sendStop;
+    rxIndex = 0;
+    rxLength = 0;
+    if (quantity > SIM_WIRE_BUFFER) {
+        quantity = SIM_WIRE_BUFFER;
+    }
+    uint8_t reg = pointerAddress == address ? pointer : 0;
+    if (!SimWire::read(address, reg, rxBuffer, quantity)) {
+        busTime(1);
+        return 0;
+    }
+    busTime(1 + quantity);
+    pointerAddress = address;
+    pointer = (uint8_t)(reg + quantity);
+    rxLength = quantity;
+    return quantity;
+}
+
+int SimTwoWire::available() {
+    return rxLength - rxIndex;
+}
+
+int SimTwoWire::read() {
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+void SimTwoWire::busTime(uint16_t bytes) {
+    //9 clocks per byte (8 data + ACK), ~2 for start and stop
+    uint64_t ns = (uint64_t)(9 * bytes + 2) * 1000000000ULL / clockHz + remainder_ns;
+    SimClock::now_us += ns / 1000;
+    remainder_ns = (uint32_t)(ns % 1000);
+}
+
+
+//EEPROM
+
+SimEEPROM EEPROM;
+
+static uint8_t eepromFlash[SIM_EEPROM_SIZE];
+static bool eepromErased = false;
+static uint32_t eepromCommits = 0;
+
+SimEEPROM::SimEEPROM() : size(0) {
+    memset(cache, 0xFF, sizeof(cache));
+}
+
+void SimEEPROM::begin(size_t newSize) {
+    if (!eepromErased) {
+        erase();
+    }
+    size = newSize < SIM_EEPROM_SIZE ? newSize : SIM_EEPROM_SIZE;
+    memcpy(cache, eepromFlash, size);
+}
+
+uint8_t SimEEPROM::read(int address) const {
+    return address >= 0 && (size_t)address < size ? cache[address] : 0;
+}
+
+void SimEEPROM::write(int address, uint8_t value) {
+    if (address >= 0 && (size_t)address < size) {
+        cache[address] = value;
+    }
+}
+
+bool SimEEPROM::commit() {
+    if (size == 0) {
+        return false;       //begin() not called
+    }
+    memcpy(eepromFlash, cache, size);
+    eepromCommits++;
+    return true;
+}
+
+void SimEEPROM::erase() {
+    memset(eepromFlash, 0xFF, sizeof(eepromFlash));
+    eepromErased = true;
+    eepromCommits = 0;
+}
+
+uint32_t SimEEPROM::getCommits() {
+    return eepromCommits;
+}
+
+
+//ESP: RTC user memory, cycle counter
+
+SimEsp ESP;
+
+static uint32_t rtcUserMemory[SIM_RTC_USER_BLOCKS];
+
+bool SimEsp::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset >= SIM_RTC_USER_BLOCKS || offset * 4 + size > SIM_RTC_USER_BLOCKS * 4) {
+        return false;
+    }
+    memcpy(data, &rtcUserMemory[offset], size);
+    return true;
+}
+
+bool SimEsp::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset >= SIM_RTC_USER_BLOCKS || offset * 4 + size > SIM_RTC_USER_BLOCKS * 4) {
+        return false;
+    }
+    memcpy(&rtcUserMemory[offset], data, size);
+    return true;
+}
+
+uint32_t SimEsp::getCycleCount() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SimEsp::powerCycle() {
+    memset(rtcUserMemory, 0, sizeof(rtcUserMemory));
+}
+
+
+//ADC
+
+uint16_t SimAdc::value = 0;
+
+
+//Datasheet 3.12 example: 25.08 C, 100653.27 Pa
+static const uint8_t BMP280_EXAMPLE_TRIM[24] = {
+    0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC,                     //T1 27504, T2 26435, T3 -1000
+    0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B, 0x27, 0x0B,         //P1 36477, P2 -10685, P3 3024, P4 2855
+    0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6,         //P5 140, P6 -7, P7 15500, P8 -14600
+    0x70, 0x17                                              //P9 6000
+};
+
+//Datasheet 8.1 double precision compensation, trim as read from 0x88..0x9F
+static bool bmp280Compensate(const uint8_t trim[24], int32_t adc_P, int32_t adc_T,
+                             double& temperature_C, double& pressure_Pa) {
+    uint16_t dig_T1 = (uint16_t)(trim[0] | (trim[1] << 8));
+    int16_t dig_T2 = (int16_t)(trim[2] | (trim[3] << 8));
+    int16_t dig_T3 = (int16_t)(trim[4] | (trim[5] << 8));
+    uint16_t dig_P1 = (uint16_t)(trim[6] | (trim[7] << 8));
+    int16_t dig_P2 = (int16_t)(trim[8] | (trim[9] << 8));
+    int16_t dig_P3 = (int16_t)(trim[10] | (trim[11] << 8));
+    int16_t dig_P4 = (int16_t)(trim[12] | (trim[13] << 8));
+    int16_t dig_P5 = (int16_t)(trim[14] | (trim[15] << 8));
+    int16_t dig_P6 = (int16_t)(trim[16] | (trim[17] << 8));
+    int16_t dig_P7 = (int16_t)(trim[18] | (trim[19] << 8));
+    int16_t dig_P8 = (int16_t)(trim[20] | (trim[21] << 8));
+    int16_t dig_P9 = (int16_t)(trim[22] | (trim[23] << 8));
+
+    double t1 = (adc_T / 16384.0 - dig_T1 / 1024.0) * dig_T2;
+    double t2 = (adc_T / 131072.0 - dig_T1 / 8192.0) * (adc_T / 131072.0 - dig_T1 / 8192.0) * dig_T3;
+    double t_fine = t1 + t2;
+    temperature_C = t_fine / 5120.0;
+
+    double p1 = t_fine / 2.0 - 64000.0;
+    double p2 = p1 * p1 * dig_P6 / 32768.0;
+    p2 = p2 + p1 * dig_P5 * 2.0;
+    p2 = p2 / 4.0 + dig_P4 * 65536.0;
+    p1 = (dig_P3 * p1 * p1 / 524288.0 + dig_P2 * p1) / 524288.0;
+    p1 = (1.0 + p1 / 32768.0) * dig_P1;
+    if (p1 == 0.0) {
+        return false;
+    }
+    double p = 1048576.0 - adc_P;
+    p = (p - p2 / 4096.0) * 6250.0 / p1;
+    p1 = dig_P9 * p * p / 2147483648.0;
+    p2 = p * dig_P8 / 32768.0;
+    pressure_Pa = p + (p1 + p2 + dig_P7) / 16.0;
+    return true;
+}
+
+SimBMP280Device::SimBMP280Device()
+    : filtered_Pa(0.0),
+      nextConversion_us(0),
+      conversions(0) {
+    memcpy(&registers[0x88], BMP280_EXAMPLE_TRIM, sizeof(BMP280_EXAMPLE_TRIM));
+    registers[0xD0] = 0x58;     //chip id
+    setRaw(415148, 519888);
+}
+
+void SimBMP280Device::setRaw(int32_t adc_P, int32_t adc_T) {
+    registers[0xF7] = (uint8_t)(adc_P >> 12);
+    registers[0xF8] = (uint8_t)(adc_P >> 4);
+    registers[0xF9] = (uint8_t)((adc_P & 0x0F) << 4);
+    registers[0xFA] = (uint8_t)(adc_T >> 12);
+    registers[0xFB] = (uint8_t)(adc_T >> 4);
+    registers[0xFC] = (uint8_t)((adc_T & 0x0F) << 4);
+}
+
+SimMPU6050Device::SimMPU6050Device() {
+    registers[0x75] = 0x68;     //WHO_AM_I
+    const int16_t level[3] = { 0, 0, 4096 };    //1 g on Z at +-8 g
+    const int16_t still[3] = { 0, 0, 0 };
+    setRaw(level, 0, still);
+}
+
+void SimBMP280Device::setPressure(double pressure_Pa, double temperature_C) {
+    //Temperature rises and pressure falls with the ADC value: bisect T first (P depends on it)
+    double t, p;
+    int32_t lo = 0;
+    int32_t hi = 0xFFFFF;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        bmp280Compensate(&registers[0x88], 0, mid, t, p);
+        if (t < temperature_C) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    int32_t adc_T = lo;
+    lo = 0;
+    hi = 0xFFFFF;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        bmp280Compensate(&registers[0x88], mid, adc_T, t, p);
+        if (p > pressure_Pa) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    setRaw(lo, adc_T);
+}
+
+//osrs field -> oversampling (5..7 are x16 as well)
+static uint8_t bmp280Oversampling(uint8_t osrs) {
+    return osrs == 0 ? 0 : (osrs >= 5 ? 16 : (uint8_t)(1 << (osrs - 1)));
+}
+
+uint32_t SimBMP280Device::getPeriodUs() const {
+    static const uint32_t STANDBY_US[8] = { 500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000 };
+    uint8_t osT = bmp280Oversampling(registers[0xF4] >> 5);
+    uint8_t osP = bmp280Oversampling((registers[0xF4] >> 2) & 0x07);
+    //Max measurement time: 1.25 ms + 2.3 ms per T and P sample + 0.575 ms if P is on
+    uint32_t measure_us = 1250 + 2300 * osT + (osP ? 2300 * osP + 575 : 0);
+    return measure_us + STANDBY_US[registers[0xF5] >> 5];
+}
+
+uint32_t SimBMP280Device::getConversions() const {
+    return conversions;
+}
+
+void SimBMP280Device::update(double pressure_Pa, double temperature_C, uint64_t now_us) {
+    if ((registers[0xF4] & 0x03) != 0x03) {
+        //SLEEP / FORCED are not modelled: output follows the input
+        filtered_Pa = pressure_Pa;
+        setPressure(pressure_Pa, temperature_C);
+        return;
+    }
+    if (now_us < nextConversion_us) {
+        return;
+    }
+    uint32_t period_us = getPeriodUs();
+    nextConversion_us = now_us + period_us;
+
+    //IIR (datasheet 3.3.3): x = (x * (c - 1) + new) / c, c = 1 / 2 / 4 / 8 / 16, starts from the first sample
+    uint8_t filter = (registers[0xF5] >> 2) & 0x07;
+    uint8_t c = filter == 0 ? 1 : (filter >= 4 ? 16 : (uint8_t)(1 << filter));
+    filtered_Pa = conversions == 0 ? pressure_Pa : filtered_Pa + (pressure_Pa - filtered_Pa) / c;
+    conversions++;
+    setPressure(filtered_Pa, temperature_C);
+}
+
+void SimMPU6050Device::setRaw(const int16_t accel[3], int16_t temperature, const int16_t gyro[3]) {
+    for (uint8_t i = 0; i < 3; i++) {
+        registers[0x3B + 2 * i] = (uint8_t)((uint16_t)accel[i] >> 8);
+        registers[0x3C + 2 * i] = (uint8_t)accel[i];
+        registers[0x43 + 2 * i] = (uint8_t)((uint16_t)gyro[i] >> 8);
+        registers[0x44 + 2 * i] = (uint8_t)gyro[i];
+    }
+    registers[0x41] = (uint8_t)((uint16_t)temperature >> 8);
+    registers[0x42] = (uint8_t)temperature;
+}
+
+static uint8_t binToBcd(uint8_t value) {
+    return value + 6 * (value / 10);
+}
+
+static uint8_t bcdToBin(uint8_t value) {
+    return value - 6 * (value >> 4);
+}
+
+SimDS3231Device::SimDS3231Device() {
+    setTime(2000, 1, 1, 0, 0, 0);
+    setPowerLost(true);         //fresh chip: oscillator stop flag set
+    setTemperature(25.0);
+}
+
+void SimDS3231Device::setTime(uint16_t year, uint8_t month, uint8_t day,
+                              uint8_t hour, uint8_t minute, uint8_t second) {
+    registers[0x00] = binToBcd(second);
+    registers[0x01] = binToBcd(minute);
+    registers[0x02] = binToBcd(hour);
+    registers[0x03] = 1;
+    registers[0x04] = binToBcd(day);
+    registers[0x05] = binToBcd(month);
+    registers[0x06] = binToBcd((uint8_t)(year - 2000));
+}
+
+void SimDS3231Device::setPowerLost(bool lost) {
+    registers[0x0F] = lost ? (registers[0x0F] | 0x80) : (registers[0x0F] & 0x7F);
+}
+
+void SimDS3231Device::setTemperature(float celsius) {
+    int16_t quarters = (int16_t)lroundf(celsius * 4);
+    registers[0x11] = (uint8_t)(quarters >> 2);
+    registers[0x12] = (uint8_t)((quarters & 0x03) << 6);
+}
+
+
+//BMP280 library stand-in
+
+SimBMP280::SimBMP280() : address(0x77), chipId(0) {
+}
+
+bool SimBMP280::begin(uint8_t i2cAddress, uint8_t expectedId) {
+    address = i2cAddress;
+    if (!SimWire::read(address, 0xD0, &chipId, 1) || chipId != expectedId ||
+        !SimWire::read(address, 0x88, trim, sizeof(trim))) {
+        return false;
+    }
+    setSampling();
+    return true;
+}
+
+void SimBMP280::setSampling(sensor_mode mode, sensor_sampling tempSampling,
+                            sensor_sampling pressSampling, sensor_filter filter,
+                            standby_duration standby) {
+    SimWire::write(address, 0xF5, (uint8_t)((standby << 5) | (filter << 2)));
+    SimWire::write(address, 0xF4, (uint8_t)((tempSampling << 5) | (pressSampling << 2) | mode));
+}
+
+bool SimBMP280::compensate(double& temperature_C, double& pressure_Pa) {
+    uint8_t data[6];
+    if (!SimWire::read(address, 0xF7, data, sizeof(data))) {
+        return false;
+    }
+    int32_t adc_P = ((int32_t)data[0] << 12) | ((int32_t)data[1] << 4) | (data[2] >> 4);
+    int32_t adc_T = ((int32_t)data[3] << 12) | ((int32_t)data[4] << 4) | (data[5] >> 4);
+    return bmp280Compensate(trim, adc_P, adc_T, temperature_C, pressure_Pa);
+}
+
+float SimBMP280::readTemperature() {
+    double temperature, pressure;
+    return compensate(temperature, pressure) ? (float)temperature : NAN;
+}
+
+float SimBMP280::readPressure() {
+    double temperature, pressure;
+    return compensate(temperature, pressure) ? (float)pressure : NAN;
+}
+
+float SimBMP280::readAltitude(float seaLevelhPa) {
+    float pressure_hPa = readPressure() / 100.0f;
+    return 44330.0f * (1.0f - powf(pressure_hPa / seaLevelhPa, 0.1903f));
+}
+
+uint8_t SimBMP280::sensorID() {
+    return chipId;
+}
+
+
+//MPU6050 library stand-in
+
+SimMPU6050::SimMPU6050() : address(0x68) {
+}
+
+bool SimMPU6050::begin(uint8_t i2cAddress) {
+    address = i2cAddress;
+    uint8_t whoAmI;
+    if (!SimWire::read(address, 0x75, &whoAmI, 1) || whoAmI != 0x68) {
+        return false;
+    }
+    return SimWire::write(address, 0x6B, 0x01);    //wake up, PLL with gyro X
+}
+
+void SimMPU6050::setAccelerometerRange(mpu6050_accel_range_t range) {
+    SimWire::write(address, 0x1C, (uint8_t)(range << 3));
+}
+
+mpu6050_accel_range_t SimMPU6050::getAccelerometerRange() {
+    uint8_t value = 0;
+    SimWire::read(address, 0x1C, &value, 1);
+    return (mpu6050_accel_range_t)((value >> 3) & 0x03);
+}
+
+void SimMPU6050::setGyroRange(mpu6050_gyro_range_t range) {
+    SimWire::write(address, 0x1B, (uint8_t)(range << 3));
+}
+
+mpu6050_gyro_range_t SimMPU6050::getGyroRange() {
+    uint8_t value = 0;
+    SimWire::read(address, 0x1B, &value, 1);
+    return (mpu6050_gyro_range_t)((value >> 3) & 0x03);
+}
+
+void SimMPU6050::setFilterBandwidth(mpu6050_bandwidth_t bandwidth) {
+    SimWire::write(address, 0x1A, (uint8_t)bandwidth);
+}
+
+void SimMPU6050::setSampleRateDivisor(uint8_t divisor) {
+    SimWire::write(address, 0x19, divisor);
+}
+
+bool SimMPU6050::getEvent(sensors_event_t* accel, sensors_event_t* gyro, sensors_event_t* temp) {
+    uint8_t data[14];
+    if (!SimWire::read(address, 0x3B, data, sizeof(data))) {
+        return false;
+    }
+    int16_t raw[7];
+    for (uint8_t i = 0; i < 7; i++) {
+        raw[i] = (int16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+    }
+
+    float accelScale = 9.80665f / (16384 >> getAccelerometerRange());       //m/s^2 per LSB
+    float gyroScale = (float)(PI / 180.0) / (131.0f / (1 << getGyroRange())); //rad/s per LSB
+    accel->acceleration.x = raw[0] * accelScale;
+    accel->acceleration.y = raw[1] * accelScale;
+    accel->acceleration.z = raw[2] * accelScale;
+    temp->temperature = raw[3] / 340.0f + 36.53f;
+    gyro->gyro.x = raw[4] * gyroScale;
+    gyro->gyro.y = raw[5] * gyroScale;
+    gyro->gyro.z = raw[6] * gyroScale;
+    return true;
+}
+
+
+//RTClib stand-ins
+
+//Days since 1970-01-01 from a civil date (H. Hinnant's algorithm, years >= 1970)
+static uint32_t daysFromCivil(uint16_t year, uint8_t month, uint8_t day) {
+    uint32_t y = year - (month <= 2 ? 1 : 0);
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+DateTime::DateTime(uint32_t unixTime) {
+    uint32_t days = unixTime / 86400UL;
+    uint32_t secondsOfDay = unixTime % 86400UL;
+    ss = secondsOfDay % 60;
+    mm = (secondsOfDay / 60) % 60;
+    hh = secondsOfDay / 3600;
+
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    yOff = (uint8_t)(yoe + era * 400 + (m <= 2 ? 1 : 0) - 2000);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day,
+                   uint8_t hour, uint8_t minute, uint8_t second)
+    : yOff((uint8_t)(year >= 2000 ? year - 2000 : year)),
+      m(month), d(day), hh(hour), mm(minute), ss(second) {
+}
+
+static uint8_t twoDigits(const char* p) {
+    return (uint8_t)((p[0] >= '0' && p[0] <= '9' ? (p[0] - '0') * 10 : 0) + (p[1] - '0'));
+}
+
+//date "Feb  6 2026", time "15:00:00"
+DateTime::DateTime(const char* date, const char* time) {
+    static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    m = 1;
+    for (uint8_t i = 0; i < 12; i++) {
+        if (strncmp(date, &MONTHS[3 * i], 3) == 0) {
+            m = i + 1;
+        }
+    }
+    d = twoDigits(date + 4);
+    yOff = twoDigits(date + 9);
+    hh = twoDigits(time);
+    mm = twoDigits(time + 3);
+    ss = twoDigits(time + 6);
+}
+
+uint32_t DateTime::unixtime() const {
+    return daysFromCivil(year(), m, d) * 86400UL + hh * 3600UL + mm * 60UL + ss;
+}
+
+#define SIM_DS3231_ADDRESS 0x68
+
+bool SimDS3231::begin() {
+    return SimWire::probe(SIM_DS3231_ADDRESS);
+}
+
+bool SimDS3231::lostPower() {
+    uint8_t status = 0;
+    SimWire::read(SIM_DS3231_ADDRESS, 0x0F, &status, 1);
+    return (status & 0x80) != 0;
+}
+
+void SimDS3231::adjust(const DateTime& dt) {
+    SimWire::write(SIM_DS3231_ADDRESS, 0x00, binToBcd(dt.second()));
+    SimWire::write(SIM_DS3231_ADDRESS, 0x01, binToBcd(dt.minute()));
+    SimWire::write(SIM_DS3231_ADDRESS, 0x02, binToBcd(dt.hour()));
+    SimWire::write(SIM_DS3231_ADDRESS, 0x04, binToBcd(dt.day()));
+    SimWire::write(SIM_DS3231_ADDRESS, 0x05, binToBcd(dt.month()));
+    SimWire::write(SIM_DS3231_ADDRESS, 0x06, binToBcd((uint8_t)(dt.year() - 2000)));
+
+    uint8_t status = 0;
+    SimWire::read(SIM_DS3231_ADDRESS, 0x0F, &status, 1);
+    SimWire::write(SIM_DS3231_ADDRESS, 0x0F, status & 0x7F);
+}
+
+DateTime SimDS3231::now() {
+    uint8_t data[7];
+    if (!SimWire::read(SIM_DS3231_ADDRESS, 0x00, data, sizeof(data))) {
+        return DateTime();
+    }
+    return DateTime(2000 + bcdToBin(data[6]), bcdToBin(data[5] & 0x7F), bcdToBin(data[4]),
+                    bcdToBin(data[2] & 0x3F), bcdToBin(data[1]), bcdToBin(data[0] & 0x7F));
+}
+
+float SimDS3231::getTemperature() {
+    uint8_t data[2];
+    if (!SimWire::read(SIM_DS3231_ADDRESS, 0x11, data, sizeof(data))) {
+        return 0.0;
+    }
+    return (int8_t)data[0] + (data[1] >> 6) * 0.25f;
+}
+
+
+//Serial lines
+
+struct SimUartLine {
+    uint8_t rx[SIM_UART_BUFFER];
+    uint16_t head;
+    uint16_t count;
+    uint32_t baud;
+    uint32_t written;
+    uint32_t overflows;
+};
+
+static SimUartLine uartLines[SIM_UART_PINS];
+
+static SimUartLine* uartLine(uint8_t rxPin) {
+    return rxPin < SIM_UART_PINS ? &uartLines[rxPin] : nullptr;
+}
+
+SimUart::SimUart(uint8_t rx, uint8_t tx) : rxPin(rx) {
+    (void)tx;
+}
+
+void SimUart::begin(uint32_t baud) {
+    SimUartLine* line = uartLine(rxPin);
+    if (line != nullptr) {
+        line->baud = baud;
+    }
+}
+
+int SimUart::available() {
+    SimUartLine* line = uartLine(rxPin);
+    return line != nullptr ? line->count : 0;
+}
+
+int SimUart::read() {
+    SimUartLine* line = uartLine(rxPin);
+    if (line == nullptr || line->count == 0) {
+        return -1;
+    }
+    uint8_t c = line->rx[line->head];
+    line->head = (line->head + 1) % SIM_UART_BUFFER;
+    line->count--;
+    return c;
+}
+
+size_t SimUart::write(const uint8_t* buffer, size_t size) {
+    (void)buffer;
+    SimUartLine* line = uartLine(rxPin);
+    if (line != nullptr) {
+        line->written += size;
+    }
+    return size;
+}
+
+uint16_t SimUart::inject(uint8_t rxPin, const uint8_t* data, uint16_t len) {
+    SimUartLine* line = uartLine(rxPin);
+    if (line == nullptr) {
+        return 0;
+    }
+    uint16_t accepted = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        if (line->count >= SIM_UART_BUFFER) {
+            line->overflows++;
+            continue;
+        }
+        line->rx[(line->head + line->count) % SIM_UART_BUFFER] = data[i];
+        line->count++;
+        accepted++;
+    }
+    return accepted;
+}
+
+uint32_t SimUart::getWritten(uint8_t rxPin) {
+    SimUartLine* line = uartLine(rxPin);
+    return line != nullptr ? line->written : 0;
+}
+
+uint32_t SimUart::getBaud(uint8_t rxPin) {
+    SimUartLine* line = uartLine(rxPin);
+    return line != nullptr ? line->baud : 0;
+}
+
+uint32_t SimUart::getOverflows(uint8_t rxPin) {
+    SimUartLine* line = uartLine(rxPin);
+    return line != nullptr ? line->overflows : 0;
+}
+
+void SimUart::reset() {
+    memset(uartLines, 0, sizeof(uartLines));
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef HAL_LINUX_H
+#define HAL_LINUX_H
+
+#include "hal_linux_core.h"
+#include "i2c_bus.h"
+
+#define SIM_UART_PINS          17       //GPIO 0-16
+#define SIM_UART_BUFFER        1024     //bytes waiting in the simulated RX line
+
+
+/**
+ BMP280 register model, datasheet example trim (3.12) and raw sample preloaded
+ setRaw() / setPressure() change the output registers at once. update() is
+ the sensor in NORMAL mode: it takes the pressure at the sensor and converts
+ it every measurement time (max, table 13) + standby set in 0xF4 / 0xF5,
+ through the IIR filter set in 0xF5, so the drivers see the output rate and
+ lag of the sampling profile.
+ */
+class SimBMP280Device : public SimI2CDevice {
+public:
+    SimBMP280Device();
+    void setRaw(int32_t adc_P, int32_t adc_T);    //20-bit ADC values
+    void setPressure(double pressure_Pa, double temperature_C);   //nearest ADC values for the trim
+    void update(double pressure_Pa, double temperature_C, uint64_t now_us);
+
+    uint32_t getPeriodUs() const;                 //measurement + standby of the current settings
+    uint32_t getConversions() const;
+
+private:
+    double filtered_Pa;
+    uint64_t nextConversion_us;
+    uint32_t conversions;
+};
+
+//MPU6050 register model: WHO_AM_I, sample registers 0x3B..0x48 (big-endian)
+class SimMPU6050Device : public SimI2CDevice {
+public:
+    SimMPU6050Device();
+    void setRaw(const int16_t accel[3], int16_t temperature, const int16_t gyro[3]);
+};
+
+//DS3231 register model: BCD time, oscillator stop flag (set at power-up), temperature
+class SimDS3231Device : public SimI2CDevice {
+public:
+    SimDS3231Device();
+    void setTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+    void setPowerLost(bool lost);
+    void setTemperature(float celsius);           //0.25 C steps
+};
+
+
+//Adafruit_BMP280 subset on SimWire (double precision compensation, datasheet 8.1)
+class SimBMP280 {
+public:
+    enum sensor_sampling {
+        SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16
+    };
+    enum sensor_mode {
+        MODE_SLEEP = 0, MODE_FORCED = 1, MODE_NORMAL = 3
+    };
+    enum sensor_filter {
+        FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16
+    };
+    enum standby_duration {
+        STANDBY_MS_1, STANDBY_MS_63, STANDBY_MS_125, STANDBY_MS_250,
+        STANDBY_MS_500, STANDBY_MS_1000, STANDBY_MS_2000, STANDBY_MS_4000
+    };
+
+    SimBMP280();
+
+    bool begin(uint8_t address = 0x77, uint8_t chipId = 0x58);
+    void setSampling(sensor_mode mode = MODE_NORMAL,
+                     sensor_sampling tempSampling = SAMPLING_X16,
+                     sensor_sampling pressSampling = SAMPLING_X16,
+                     sensor_filter filter = FILTER_OFF,
+                     standby_duration standby = STANDBY_MS_1);
+    float readTemperature();
+    float readPressure();
+    float readAltitude(float seaLevelhPa = 1013.25);
+    uint8_t sensorID();
+
+private:
+    uint8_t address;
+    uint8_t chipId;
+    uint8_t trim[24];
+
+    bool compensate(double& temperature_C, double& pressure_Pa);
+};
+
+
+//Adafruit_MPU6050 / Adafruit_Sensor vocabulary
+typedef enum {
+    MPU6050_RANGE_2_G, MPU6050_RANGE_4_G, MPU6050_RANGE_8_G, MPU6050_RANGE_16_G
+} mpu6050_accel_range_t;
+
+typedef enum {
+    MPU6050_RANGE_250_DEG, MPU6050_RANGE_500_DEG, MPU6050_RANGE_1000_DEG, MPU6050_RANGE_2000_DEG
+} mpu6050_gyro_range_t;
+
+typedef enum {
+    MPU6050_BAND_260_HZ, MPU6050_BAND_184_HZ, MPU6050_BAND_94_HZ, MPU6050_BAND_44_HZ,
+    MPU6050_BAND_21_HZ, MPU6050_BAND_10_HZ, MPU6050_BAND_5_HZ
+} mpu6050_bandwidth_t;
+
+struct sensors_vec_t {
+    float x;
+    float y;
+    float z;
+};
+
+struct sensors_event_t {
+    sensors_vec_t acceleration;   //m/s^2
+    sensors_vec_t gyro;           //rad/s
+    float temperature;            //C
+};
+
+//Adafruit_MPU6050 subset on SimWire, ranges and filter kept in the register model
+class SimMPU6050 {
+public:
+    SimMPU6050();
+
+    bool begin(uint8_t address = 0x68);
+    void setAccelerometerRange(mpu6050_accel_range_t range);
+    mpu6050_accel_range_t getAccelerometerRange();
+    void setGyroRange(mpu6050_gyro_range_t range);
+    mpu6050_gyro_range_t getGyroRange();
+    void setFilterBandwidth(mpu6050_bandwidth_t bandwidth);
+    void setSampleRateDivisor(uint8_t divisor);
+    bool getEvent(sensors_event_t* accel, sensors_event_t* gyro, sensors_event_t* temp);
+
+private:
+    uint8_t address;
+};
+
+
+//RTClib DateTime subset, years 2000-2099
+class DateTime {
+public:
+    DateTime(uint32_t unixTime = 946684800UL);
+    DateTime(uint16_t year, uint8_t month, uint8_t day,
+             uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0);
+    DateTime(const char* date, const char* time);     //__DATE__, __TIME__
+
+    uint16_t year() const { return 2000 + yOff; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint32_t unixtime() const;
+
+private:
+    uint8_t yOff, m, d, hh, mm, ss;
+};
+
+//RTC_DS3231 subset on SimWire
+class SimDS3231 {
+public:
+    bool begin();
+    bool lostPower();
+    void adjust(const DateTime& dt);
+    DateTime now();
+    float getTemperature();
+};
+
+
+/**
+ SoftwareSerial subset over a simulated line per RX pin
+ The simulation feeds the receiver side with inject() and checks what the
+ driver sent with getWritten(). begin() keeps the RX bytes (a baud change
+ does not flush the line), bytes beyond SIM_UART_BUFFER are dropped.
+ */
+class SimUart {
+public:
+    SimUart(uint8_t rxPin, uint8_t txPin);
+
+    void begin(uint32_t baud);
+    int available();
+    int read();
+    size_t write(const uint8_t* buffer, size_t size);
+
+    static uint16_t inject(uint8_t rxPin, const uint8_t* data, uint16_t len);
+    static uint32_t getWritten(uint8_t rxPin);
+    static uint32_t getBaud(uint8_t rxPin);
+    static uint32_t getOverflows(uint8_t rxPin);
+    static void reset();
+
+private:
+    uint8_t rxPin;
+};
+
+
+//TinyGPSPlus vocabulary
+struct RawDegrees {
+    uint16_t deg;
+    uint32_t billionths;
+    bool negative;
+
+    RawDegrees() : deg(0), billionths(0), negative(false) {}
+};
+
+/**
+ TinyGPSPlus subset: bytes are counted, sentences are not decoded, so NMEA
+ mode never reports a fix on the host. Simulations drive the GPS in UBX mode
+ (UBX_Parser is the flight parser).
+ */
+class SimNmea {
+public:
+    struct Location {
+        bool isValid() const { return false; }
+        uint32_t age() const { return 0xFFFFFFFF; }
+        double lat() const { return 0.0; }
+        double lng() const { return 0.0; }
+        RawDegrees rawLat() const { return RawDegrees(); }
+        RawDegrees rawLng() const { return RawDegrees(); }
+    };
+    struct Decimal {
+        bool isValid() const { return false; }
+        int32_t value() const { return 0; }
+        double meters() const { return 0.0; }
+        double mps() const { return 0.0; }
+        double hdop() const { return 0.0; }
+    };
+    struct Integer {
+        bool isValid() const { return false; }
+        uint32_t value() const { return 0; }
+    };
+    struct Time {
+        bool isValid() const { return false; }
+        uint8_t hour() const { return 0; }
+        uint8_t minute() const { return 0; }
+        uint8_t second() const { return 0; }
+    };
+    struct Date {
+        bool isValid() const { return false; }
+        uint8_t day() const { return 0; }
+        uint8_t month() const { return 0; }
+        uint16_t year() const { return 0; }
+    };
+
+    Location location;
+    Decimal altitude;
+    Decimal speed;
+    Decimal hdop;
+    Integer satellites;
+    Time time;
+    Date date;
+
+    SimNmea() : chars(0) {}
+    bool encode(char c) { (void)c; chars++; return false; }
+    uint32_t charsProcessed() const { return chars; }
+    uint32_t sentencesWithFix() const { return 0; }
+    uint32_t failedChecksum() const { return 0; }
+
+private:
+    uint32_t chars;
+};
+
+
+//Host build: every device simulated, the flight I2CBus on the simulated Wire, time under control of the simulation
+struct LinuxSimHal {
+    typedef SimClock Clock;
+    typedef I2CBus Bus;
+    typedef SimUart GpsSerial;
+    typedef SimBMP280 BMP280;
+    typedef SimMPU6050 MPU6050;
+    typedef mpu6050_bandwidth_t MPU6050Bandwidth;
+    typedef SimDS3231 RTC;
+    typedef SimNmea NMEA;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef HAL_LINUX_CORE_H
+#define HAL_LINUX_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ Arduino core stand-ins for host builds (included instead of <Arduino.h>
+ when ARDUINO is not defined): Serial, millis()/micros()/delay()/yield(),
+ Wire, EEPROM, ESP, analogRead(). Everything runs on simulated time and the
+ simulated I2C bus, so the flight modules (I2CBus, SensorManager, FSM,
+ CheckpointStore) compile and run unmodified on a host.
+ Implemented in hal_linux.cpp; the library stand-ins and the LinuxSimHal
+ policy are in hal_linux.h.
+ */
+
+#define SIM_I2C_MAX_DEVICES    8
+#define SIM_WIRE_BUFFER        128      //Wire TX / RX buffer (BUFFER_LENGTH on the ESP8266 core)
+#define SIM_CLOCK_YIELD_US     100      //yield() advances the clock (busy-wait loops terminate)
+#define SIM_EEPROM_SIZE        4096     //one flash sector
+#define SIM_RTC_USER_BLOCKS    128      //RTC user memory, 4-byte blocks
+
+//Arduino vocabulary used by the drivers
+#define F(s)    (s)
+#define FPSTR(p) (p)
+#define PROGMEM
+#define DEC     10
+#define HEX     16
+#ifndef PI
+#define PI      3.1415926535897932384626433832795
+#endif
+#define A0      17
+
+/**
+ Boot log on stdout, stands in for Serial
+ setEnabled(false) mutes it (benchmarks, long simulations).
+ */
+class SimPrint {
+public:
+    static void setEnabled(bool enabled);
+
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+    size_t println();
+
+    template <typename T>
+    size_t println(T value) {
+        size_t n = print(value);
+        return n + println();
+    }
+
+    template <typename T>
+    size_t println(T value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+};
+
+extern SimPrint Serial;
+
+
+/**
+ Simulated time, stands in for the Arduino core clock
+ Nothing advances it on its own: the simulation calls advance() / set(),
+ delay(), yield() and Wire transfers move it forward like the time they
+ would have taken. unsigned long is 64-bit on a Linux host, so
+ millis()/micros() do not wrap at 32 bits as they do on the target.
+ */
+struct SimClock {
+    static uint64_t now_us;
+
+    static inline unsigned long millis() { return (unsigned long)(now_us / 1000); }
+    static inline unsigned long micros() { return (unsigned long)now_us; }
+    static inline void delay(unsigned long ms) { now_us += (uint64_t)ms * 1000; }
+    static inline void yield() { now_us += SIM_CLOCK_YIELD_US; }
+
+    static inline void set(uint64_t t_us) { now_us = t_us; }
+    static inline void advance(uint32_t us) { now_us += us; }
+};
+
+inline unsigned long millis() { return SimClock::millis(); }
+inline unsigned long micros() { return SimClock::micros(); }
+inline void delay(unsigned long ms) { SimClock::delay(ms); }
+inline void yield() { SimClock::yield(); }
+
+
+/**
+ One device on the simulated I2C bus: a 256-register bank with auto-increment
+ Device models preload and update their registers, driver writes land in the
+ same bank. setPresent(false) makes every transfer NAK (unplugged device).
+ */
+class SimI2CDevice {
+public:
+    SimI2CDevice();
+
+    bool read(uint8_t reg, uint8_t* data, uint8_t len) const;
+    bool write(uint8_t reg, uint8_t value);
+
+    uint8_t getRegister(uint8_t reg) const;
+    void setRegister(uint8_t reg, uint8_t value);
+    void setPresent(bool present);
+    bool isPresent() const;
+
+protected:
+    uint8_t registers[256];
+    bool present;
+};
+
+//The physical bus: devices by address, shared by Wire and the library stand-ins
+class SimWire {
+public:
+    static bool attach(uint8_t address, SimI2CDevice* device);
+    static void detachAll();
+
+    static bool probe(uint8_t address);
+    static bool read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t len);
+    static bool write(uint8_t address, uint8_t reg, uint8_t value);
+    static uint32_t getTransfers();
+};
+
+/**
+ TwoWire subset over SimWire, what I2CBus uses
+ The first byte of a transmission sets the register pointer, the following
+ ones are register writes; requestFrom() reads from the pointer of the last
+ transmission to that address. endTransmission() returns 2 (address NAK)
+ for a missing or unplugged device. Each transfer advances SimClock by its
+ bit time at the setClock() rate (9 bits per byte plus start / stop).
+ */
+class SimTwoWire {
+public:
+    SimTwoWire();
+
+    void begin();
+    void setClock(uint32_t clockHz);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = 1);
+    int available();
+    int read();
+
+private:
+    uint32_t clockHz;
+    uint32_t remainder_ns;
+    uint8_t txAddress;
+    uint8_t txBuffer[SIM_WIRE_BUFFER];
+    uint8_t txLength;
+    uint8_t rxBuffer[SIM_WIRE_BUFFER];
+    uint8_t rxLength;
+    uint8_t rxIndex;
+    uint8_t pointerAddress;
+    uint8_t pointer;
+
+    void busTime(uint16_t bytes);
+};
+
+extern SimTwoWire Wire;
+
+
+/**
+ ESP8266 EEPROM library stand-in: a RAM cache of one flash sector
+ begin() loads the cache from the simulated flash, put() only changes the
+ cache, commit() writes it back. The flash survives simulated resets and
+ power loss; erase() returns it to the erased state (0xFF).
+ */
+class SimEEPROM {
+public:
+    SimEEPROM();
+
+    void begin(size_t size);
+    uint8_t read(int address) const;
+    void write(int address, uint8_t value);
+    bool commit();
+
+    template <typename T>
+    T& get(int address, T& value) const {
+        if (address >= 0 && address + sizeof(T) <= size) {
+            memcpy(&value, &cache[address], sizeof(T));
+        }
+        return value;
+    }
+
+    template <typename T>
+    const T& put(int address, const T& value) {
+        if (address >= 0 && address + sizeof(T) <= size) {
+            memcpy(&cache[address], &value, sizeof(T));
+        }
+        return value;
+    }
+
+    static void erase();
+    static uint32_t getCommits();
+
+private:
+    size_t size;
+    uint8_t cache[SIM_EEPROM_SIZE];
+};
+
+extern SimEEPROM EEPROM;
+
+
+/**
+ ESP class subset: RTC user memory and the cycle counter
+ RTC memory survives a simulated reset (setup() run again) but not
+ powerCycle(), after which it reads back as zeros.
+ getCycleCount() counts host nanoseconds, not target cycles: a CYCLE_PROFILE
+ host build reports host timings, target cycles only come from the board.
+ */
+class SimEsp {
+public:
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+    uint32_t getCycleCount();
+
+    static void powerCycle();
+};
+
+extern SimEsp ESP;
+
+
+//ADC stand-in: analogRead() returns the last set() value (10 bits)
+struct SimAdc {
+    static uint16_t value;
+
+    static inline void set(uint16_t raw) { value = raw; }
+};
+
+inline int analogRead(uint8_t pin) { (void)pin; return SimAdc::value; }
+
+#endif
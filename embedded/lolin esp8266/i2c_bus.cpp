@@ -0,0 +1,259 @@
+#include "i2c_bus.h"
+#include "fault_injection.h"
+
+I2CBus::I2CBus()
+    : head(0),
+      count(0),
+      state(IDLE),
+      burstAddress(0),
+      burstReg(0),
+      burstLength(0),
+      burstRequests(0),
+      burstOk(false),
+      burstNak(false),
+      burstStart_us(0),
+      deviceCount(0) {
+    memset(stats, 0, sizeof(stats));
+}
+
+bool I2CBus::begin(uint32_t clockHz) {
+    Wire.begin();
+    Wire.setClock(clockHz);
+
+    Serial.print(F("[I2C] Bus at "));
+    Serial.print(clockHz / 1000);
+    Serial.println(F(" kHz"));
+    return true;
+}
+
+bool I2CBus::submitRead(uint8_t address, uint8_t reg, uint8_t length,
+                        I2CCallback callback, void* context) {
+    if (count >= I2C_QUEUE_SIZE || length == 0 || length > I2C_MAX_BURST) {
+        return false;
+    }
+
+    I2CTransaction& t = queue[(head + count) % I2C_QUEUE_SIZE];
+    t.address = address;
+    t.reg = reg;
+    t.length = length;
+    t.callback = callback;
+    t.context = context;
+    t.submitTime_us = micros();
+    count++;
+    return true;
+}
+
+void I2CBus::poll() {
+    switch (state) {
+        case IDLE:
+            if (count > 0) {
+                startBurst();
+                state = SEND_REGISTER;
+            }
+            break;
+
+        case SEND_REGISTER:
+            burstStart_us = micros();
+            if (FAULT_I2C_NAK(burstAddress)) {
+                burstNak = true;
+                state = DELIVER;
+                break;
+            }
+            Wire.beginTransmission(burstAddress);
+            Wire.write(burstReg);
+            //Repeated start: keep the bus between pointer write and read
+            if (Wire.endTransmission(false) != 0) {
+                burstNak = true;
+                state = DELIVER;
+            } else {
+                state = READ_DATA;
+            }
+            break;
+
+        case READ_DATA: {
+            uint8_t received = Wire.requestFrom(burstAddress, burstLength, (uint8_t)true);
+            uint8_t n = 0;
+            while (Wire.available() && n < burstLength) {
+                buffer[n++] = (uint8_t)Wire.read();
+            }
+            burstOk = (received == burstLength && n == burstLength);
+            state = DELIVER;
+            break;
+        }
+
+        case DELIVER:
+            finishBurst();
+            state = IDLE;
+            break;
+    }
+}
+
+bool I2CBus::isIdle() const {
+    return state == IDLE && count == 0;
+}
+
+uint8_t I2CBus::getPending() const {
+    return count;
+}
+
+bool I2CBus::probe(uint8_t address) {
+    if (FAULT_I2C_NAK(address)) {
+        return false;
+    }
+    Wire.beginTransmission(address);
+    return Wire.endTransmission() == 0;
+}
+
+bool I2CBus::writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+    if (FAULT_I2C_NAK(address)) {
+        return false;
+    }
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(value);
+    bool ok = Wire.endTransmission() == 0;
+    if (!ok) {
+        I2CDeviceStats* s = statsFor(address);
+        if (s) {
+            s->naks++;
+        }
+    }
+    return ok;
+}
+
+bool I2CBus::readRegisters(uint8_t address, uint8_t reg, uint8_t* out, uint8_t length) {
+    if (FAULT_I2C_NAK(address)) {
+        return false;
+    }
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) {
+        I2CDeviceStats* s = statsFor(address);
+        if (s) {
+            s->naks++;
+        }
+        return false;
+    }
+    if (Wire.requestFrom(address, length, (uint8_t)true) != length) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)Wire.read();
+    }
+    return true;
+}
+
+const I2CDeviceStats* I2CBus::getStats(uint8_t address) const {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (stats[i].address == address) {
+            return &stats[i];
+        }
+    }
+    return nullptr;
+}
+
+void I2CBus::printStats() const {
+    Serial.println(F("[I2C] addr  bursts  reqs  nak  short  avg_us  max_us  max_lat_us"));
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        const I2CDeviceStats& s = stats[i];
+        Serial.print(F("[I2C] 0x"));
+        Serial.print(s.address, HEX);
+        Serial.print(F("  "));
+        Serial.print(s.transactions);
+        Serial.print(F("  "));
+        Serial.print(s.requests);
+        Serial.print(F("  "));
+        Serial.print(s.naks);
+        Serial.print(F("  "));
+        Serial.print(s.shortReads);
+        Serial.print(F("  "));
+        Serial.print(s.transactions ? s.busTime_us / s.transactions : 0);
+        Serial.print(F("  "));
+        Serial.print(s.maxBusTime_us);
+        Serial.print(F("  "));
+        Serial.println(s.maxLatency_us);
+    }
+}
+
+//Take the head descriptor and merge the following ones if they read an
+//adjacent or overlapping register range of the same device
+void I2CBus::startBurst() {
+    const I2CTransaction& first = queue[head];
+    burstAddress = first.address;
+    burstReg = first.reg;
+    burstLength = first.length;
+    burstRequests = 1;
+    burstOk = false;
+    burstNak = false;
+
+    while (burstRequests < count) {
+        const I2CTransaction& next = queue[(head + burstRequests) % I2C_QUEUE_SIZE];
+        if (next.address != burstAddress || next.reg < burstReg ||
+            next.reg > burstReg + burstLength) {
+            break;
+        }
+        uint16_t end = (uint16_t)next.reg + next.length;
+        uint16_t burstEnd = (uint16_t)burstReg + burstLength;
+        if (end > burstEnd) {
+            if (end - burstReg > I2C_MAX_BURST) {
+                break;
+            }
+            burstLength = (uint8_t)(end - burstReg);
+        }
+        burstRequests++;
+    }
+}
+
+void I2CBus::finishBurst() {
+    unsigned long now = micros();
+    uint32_t busTime = now - burstStart_us;
+
+    I2CDeviceStats* s = statsFor(burstAddress);
+    if (s) {
+        s->transactions++;
+        s->requests += burstRequests;
+        s->busTime_us += busTime;
+        if (busTime > s->maxBusTime_us) {
+            s->maxBusTime_us = busTime;
+        }
+        if (burstNak) {
+            s->naks++;
+        } else if (!burstOk) {
+            s->shortReads++;
+        } else {
+            s->bytes += burstLength;
+        }
+    }
+
+    if (burstOk) {
+        FAULT_I2C_FILTER(burstAddress, burstReg, buffer, burstLength);
+    }
+
+    for (uint8_t i = 0; i < burstRequests; i++) {
+        I2CTransaction& t = queue[head];
+        head = (head + 1) % I2C_QUEUE_SIZE;
+        count--;
+
+        uint32_t latency = now - t.submitTime_us;
+        if (s && latency > s->maxLatency_us) {
+            s->maxLatency_us = latency;
+        }
+        if (t.callback) {
+            t.callback(t.context, buffer + (t.reg - burstReg), t.length, burstOk);
+        }
+    }
+}
+
+I2CDeviceStats* I2CBus::statsFor(uint8_t address) {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (stats[i].address == address) {
+            return &stats[i];
+        }
+    }
+    if (deviceCount >= I2C_MAX_DEVICES) {
+        return nullptr;
+    }
+    I2CDeviceStats& s = stats[deviceCount++];
+    s.address = address;
+    return &s;
+}
@@ -0,0 +1,115 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#else
+#include "hal_linux_core.h"
+#endif
+
+#define I2C_BUS_CLOCK_HZ     400000
+#define I2C_QUEUE_SIZE       8        //pending read descriptors
+#define I2C_MAX_BURST        32       //bytes per coalesced read
+#define I2C_MAX_DEVICES      4        //devices with statistics
+
+/**
+ Completion callback for a queued read
+ ok is false if the device NAKed or returned fewer bytes than requested,
+ data is only valid during the call
+ */
+typedef void (*I2CCallback)(void* context, const uint8_t* data, uint8_t len, bool ok);
+
+//Register read descriptor
+struct I2CTransaction {
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+    I2CCallback callback;
+    void* context;
+    unsigned long submitTime_us;
+};
+
+//Per-device timing and error counters, keyed by address (one device per address)
+struct I2CDeviceStats {
+    uint8_t address;
+    uint32_t transactions;     //completed bursts
+    uint32_t requests;         //descriptors served (>= transactions when coalesced)
+    uint32_t naks;
+    uint32_t shortReads;
+    uint32_t bytes;
+    uint32_t busTime_us;       //sum of time the bus was busy for this device
+    uint32_t maxBusTime_us;
+    uint32_t maxLatency_us;    //submit -> callback, includes queueing
+};
+
+
+/**
+ Owns the shared I2C bus (BMP280 0x76, MPU6050 0x69, DS3231 0x68)
+ Responsibilities:
+ - Run the bus at 400 kHz
+ - Queue register reads as non-blocking descriptors
+ - Coalesce adjacent reads of the same device into one burst
+ - Advance one bus phase per poll() so no loop iteration pays for a whole
+   queue of transfers
+ - Keep per-device timing / NAK statistics
+ */
+class I2CBus {
+public:
+    I2CBus();
+
+    bool begin(uint32_t clockHz = I2C_BUS_CLOCK_HZ);
+
+    /**
+     Queue a read of length bytes starting at reg, callback runs from poll()
+     return false if queue is full or length too large
+     */
+    bool submitRead(uint8_t address, uint8_t reg, uint8_t length,
+                    I2CCallback callback, void* context);
+
+    //Advance the state machine by one phase, call every loop()
+    void poll();
+
+    //No transfer in progress and nothing queued
+    bool isIdle() const;
+    uint8_t getPending() const;
+
+    //Blocking helpers for begin()/configuration only, never in the flight loop
+    bool probe(uint8_t address);              //address ACK only (recovery checks)
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length);
+
+    const I2CDeviceStats* getStats(uint8_t address) const;
+    void printStats() const;
+
+private:
+    enum State : uint8_t {
+        IDLE,
+        SEND_REGISTER,  //address + register pointer, repeated start
+        READ_DATA,      //requestFrom + drain RX buffer
+        DELIVER         //callbacks + statistics
+    };
+
+    I2CTransaction queue[I2C_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+
+    State state;
+    uint8_t burstAddress;
+    uint8_t burstReg;
+    uint8_t burstLength;
+    uint8_t burstRequests;    //queue entries covered by this burst
+    bool burstOk;
+    bool burstNak;
+    unsigned long burstStart_us;
+    uint8_t buffer[I2C_MAX_BURST];
+
+    I2CDeviceStats stats[I2C_MAX_DEVICES];
+    uint8_t deviceCount;
+
+    void startBurst();
+    void finishBurst();
+    I2CDeviceStats* statsFor(uint8_t address);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "landing_predictor.h"
+
+#include <math.h>
+#include <string.h>
+
+#define LANDING_DEG_TO_RAD  0.017453292519943295
+
+LandingPredictor::LandingPredictor() {
+    reset();
+}
+
+void LandingPredictor::reset() {
+    originSet = false;
+    originLat_e7 = 0;
+    originLon_e7 = 0;
+    eastPerE7 = (float)LANDING_M_PER_E7;
+    sumW = 0.0;
+    sumT = 0.0;
+    sumTT = 0.0;
+    memset(sumX, 0, sizeof(sumX));
+    memset(sumTX, 0, sizeof(sumTX));
+    firstFix_ms = 0;
+    lastFix_ms = 0;
+    fixes = 0;
+    memset(&estimate, 0, sizeof(estimate));
+}
+
+void LandingPredictor::setOrigin(int32_t lat_e7, int32_t lon_e7) {
+    //New frame: the old sums are in the old frame
+    reset();
+    originSet = true;
+    originLat_e7 = lat_e7;
+    originLon_e7 = lon_e7;
+    eastPerE7 = (float)(LANDING_M_PER_E7 * cos(lat_e7 * 1e-7 * LANDING_DEG_TO_RAD));
+}
+
+bool LandingPredictor::hasOrigin() const {
+    return originSet;
+}
+
+void LandingPredictor::toLocal(int32_t lat_e7, int32_t lon_e7, float& east_m, float& north_m) const {
+    east_m = (float)(lon_e7 - originLon_e7) * eastPerE7;
+    north_m = (float)(lat_e7 - originLat_e7) * (float)LANDING_M_PER_E7;
+}
+
+void LandingPredictor::toGlobal(float east_m, float north_m, int32_t& lat_e7, int32_t& lon_e7) const {
+    lat_e7 = originLat_e7 + (int32_t)lroundf(north_m / (float)LANDING_M_PER_E7);
+    lon_e7 = originLon_e7;
+    if (eastPerE7 > 1e-6f) {
+        lon_e7 += (int32_t)lroundf(east_m / eastPerE7);
+    }
+}
+
+void LandingPredictor::addFix(int32_t lat_e7, int32_t lon_e7, float altitude_m, unsigned long time_ms) {
+    if (!originSet) {
+        setOrigin(lat_e7, lon_e7);
+    }
+
+    if (fixes > 0) {
+        float dt = (time_ms - lastFix_ms) / 1000.0f;
+        if (dt <= 0.0f) {
+            return;                       //same fix twice
+        }
+        //Move t = 0 to the new fix (old samples at t - dt), then age them
+        sumTT = sumTT - 2.0f * dt * sumT + dt * dt * sumW;
+        sumT -= dt * sumW;
+        for (uint8_t i = 0; i < 3; i++) {
+            sumTX[i] -= dt * sumX[i];
+        }
+        float w = expf(-dt / (float)LANDING_WINDOW_S);
+        sumW *= w;
+        sumT *= w;
+        sumTT *= w;
+        for (uint8_t i = 0; i < 3; i++) {
+            sumX[i] *= w;
+            sumTX[i] *= w;
+        }
+    }
+
+    float x[3];
+    toLocal(lat_e7, lon_e7, x[0], x[1]);
+    x[2] = altitude_m;
+    sumW += 1.0f;
+    for (uint8_t i = 0; i < 3; i++) {
+        sumX[i] += x[i];              //t = 0: no contribution to sumT / sumTT / sumTX
+    }
+    if (fixes == 0) {
+        firstFix_ms = time_ms;
+    }
+    lastFix_ms = time_ms;
+    if (fixes < 0xFFFF) {
+        fixes++;
+    }
+    estimate.time_ms = time_ms;
+    predict();
+}
+
+//Weighted least squares x = a + b t per axis, evaluated at t = 0 (the newest fix)
+void LandingPredictor::predict() {
+    float det = sumW * sumTT - sumT * sumT;
+    if (fixes < LANDING_MIN_FIXES || det <= 1e-6f ||
+        lastFix_ms - firstFix_ms < (unsigned long)(LANDING_MIN_SPAN_S * 1000)) {
+        estimate.valid = false;
+        return;
+    }
+    float at[3];
+    float slope[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        slope[i] = (sumW * sumTX[i] - sumT * sumX[i]) / det;
+        at[i] = (sumX[i] - slope[i] * sumT) / sumW;
+    }
+
+    estimate.east_m = at[0];
+    estimate.north_m = at[1];
+    estimate.altitude_m = at[2];
+    estimate.windEast_mps = slope[0];
+    estimate.windNorth_mps = slope[1];
+    estimate.descent_mps = -slope[2];
+    estimate.windEast_cmps = (int16_t)(slope[0] * 100.0f);
+    estimate.windNorth_cmps = (int16_t)(slope[1] * 100.0f);
+
+    if (estimate.descent_mps < LANDING_MIN_DESCENT_MPS) {
+        estimate.valid = false;
+        return;
+    }
+    float remaining = estimate.altitude_m > 0.0f ? estimate.altitude_m : 0.0f;
+    float t = remaining / estimate.descent_mps;
+    if (t > LANDING_MAX_HORIZON_S) {
+        t = LANDING_MAX_HORIZON_S;
+    }
+    estimate.timeToLanding_s = t;
+    estimate.timeToLanding_ds = (uint16_t)(t * 10.0f);
+    estimate.landingEast_m = at[0] + slope[0] * t;
+    estimate.landingNorth_m = at[1] + slope[1] * t;
+    toGlobal(estimate.landingEast_m, estimate.landingNorth_m,
+             estimate.landingLat_e7, estimate.landingLon_e7);
+    estimate.valid = true;
+}
+
+const LandingEstimate& LandingPredictor::getEstimate() const {
+    return estimate;
+}
+
+uint16_t LandingPredictor::getFixCount() const {
+    return fixes;
+}
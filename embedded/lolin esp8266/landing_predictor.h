@@ -0,0 +1,99 @@
+#ifndef LANDING_PREDICTOR_H
+#define LANDING_PREDICTOR_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+
+#define LANDING_WINDOW_S          8.0      //time constant of the drift fit
+#define LANDING_MIN_FIXES         5
+#define LANDING_MIN_SPAN_S        3.0      //track length before the first estimate (GPS noise)
+#define LANDING_MIN_DESCENT_MPS   0.5      //slower than this gives no touchdown estimate
+#define LANDING_MAX_HORIZON_S     300.0
+
+//Meters per 1e-7 degree of latitude (WGS84 mean radius, flat-earth frame)
+#define LANDING_M_PER_E7          0.011131949
+
+
+//Drift and touchdown estimate after the last fix (local frame: x east, y north, z up AGL)
+struct LandingEstimate {
+    bool valid;                   //descending and enough fixes for the fit
+    unsigned long time_ms;        //fix time the estimate refers to
+    float east_m;                 //fitted position relative to the origin
+    float north_m;
+    float altitude_m;             //fitted altitude AGL
+    float windEast_mps;           //horizontal drift velocity, ~ wind under the canopy
+    float windNorth_mps;
+    float descent_mps;            //positive down
+    float timeToLanding_s;
+    float landingEast_m;
+    float landingNorth_m;
+    int32_t landingLat_e7;
+    int32_t landingLon_e7;
+    //Same results scaled once per fix for SensorData
+    int16_t windEast_cmps;
+    int16_t windNorth_cmps;
+    uint16_t timeToLanding_ds;
+};
+
+
+/**
+ Wind drift and landing point from the GPS track
+ Responsibilities:
+ - Local east/north frame around the release point (setOrigin): flat earth,
+   one cos() per origin, every fix is two int32 differences and two multiplies.
+   Under 0.1% scale error within a few km of the origin.
+ - Exponentially weighted linear fit of east, north and altitude over time
+   (window LANDING_WINDOW_S). The three axes share the time sums, and one
+   update is a handful of float operations at the GPS rate (1-5 Hz), not per readAll.
+ - Touchdown: remaining altitude / descent rate, then the drift extrapolated to
+   that time. This assumes a steady descent under the canopy. In free fall
+   the estimate runs short until the fit window has settled on the canopy rate.
+ */
+class LandingPredictor {
+public:
+    LandingPredictor();
+
+    //Forget the origin and the track
+    void reset();
+
+    void setOrigin(int32_t lat_e7, int32_t lon_e7);
+    bool hasOrigin() const;
+
+    /**
+     One new GPS position (call once per fix, not per readAll)
+     altitude_m: barometric AGL at the same time (better than GPS height)
+     */
+    void addFix(int32_t lat_e7, int32_t lon_e7, float altitude_m, unsigned long time_ms);
+
+    const LandingEstimate& getEstimate() const;
+    uint16_t getFixCount() const;
+
+    //Flat-earth conversion around the origin
+    void toLocal(int32_t lat_e7, int32_t lon_e7, float& east_m, float& north_m) const;
+    void toGlobal(float east_m, float north_m, int32_t& lat_e7, int32_t& lon_e7) const;
+
+private:
+    bool originSet;
+    int32_t originLat_e7;
+    int32_t originLon_e7;
+    float eastPerE7;              //m per 1e-7 deg of longitude at the origin latitude
+
+    //Weighted sums, time in seconds relative to the newest fix (t = 0)
+    float sumW;
+    float sumT;
+    float sumTT;
+    float sumX[3];
+    float sumTX[3];
+    unsigned long firstFix_ms;
+    unsigned long lastFix_ms;
+    uint16_t fixes;
+
+    LandingEstimate estimate;
+
+    void predict();
+};
+
+#endif
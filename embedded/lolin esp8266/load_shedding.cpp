@@ -0,0 +1,208 @@
+#include "load_shedding.h"
+
+#ifndef ARDUINO
+#include <stdio.h>
+#define PROGMEM
+#endif
+
+//Level that sheds everything up to and including the sensor rates
+#define LOAD_BATTERY_REDUCED_LEVEL  (SHED_SENSOR_RATE + 1)
+
+//Fixed-width rows so the whole table stays in flash; print with FPSTR()
+static const char SHED_TASK_NAMES[SHED_TASK_COUNT][15] PROGMEM = {
+    "log", "vibration", "attitude", "landing", "sensor rate", "telemetry rate", "camera"
+};
+
+LoadShedder::LoadShedder() {
+    begin();
+}
+
+void LoadShedder::begin(uint32_t loopBudget_us) {
+    budget_us = loopBudget_us > 0 ? loopBudget_us : LOAD_LOOP_BUDGET_US;
+    loopAverage_us = 0;
+    loopMax_us = 0;
+    overruns = 0;
+    intervalOverruns = 0;
+    lastEval_ms = 0;
+    calmSince_ms = 0;
+    calm = false;
+    lastRestore_ms = 0;
+    restoreHold_ms = LOAD_RESTORE_HOLD_MS;
+    battery_mV_x16 = 0;
+    batteryFloor = 0;
+    overloadLevel = 0;
+    level = 0;
+    changed = false;
+}
+
+void LoadShedder::update(uint32_t loopTime_us, uint16_t battery_mV, unsigned long now_ms, bool safeMode) {
+    //Loop time: fast average, the overrun count catches spikes the average hides
+    loopAverage_us = (uint32_t)((int32_t)loopAverage_us + (((int32_t)loopTime_us - (int32_t)loopAverage_us) >> 3));
+    if (loopTime_us > loopMax_us) {
+        loopMax_us = loopTime_us;
+    }
+    if (loopTime_us > budget_us) {
+        overruns++;
+        if (intervalOverruns < 0xFF) {
+            intervalOverruns++;
+        }
+    }
+
+    //0 mV: no measurement (ADC not wired), no battery floor
+    if (battery_mV > 0) {
+        if (battery_mV_x16 == 0) {
+            battery_mV_x16 = (uint32_t)battery_mV << 4;
+        } else {
+            battery_mV_x16 = battery_mV_x16 - (battery_mV_x16 >> 4) + battery_mV;
+        }
+        batteryFloor = batteryFloorFor(getBatteryFiltered_mV());
+    }
+
+    if (now_ms - lastEval_ms >= LOAD_EVAL_INTERVAL_MS) {
+        evaluate(now_ms);
+    }
+
+    uint8_t next = overloadLevel;
+    const char* reason = "loop";
+    if (batteryFloor > next) {
+        next = batteryFloor;
+        reason = "battery";
+    }
+    if (safeMode) {
+        next = LOAD_LEVEL_MAX;
+        reason = "safe mode";
+    }
+    if (next != level) {
+        setLevel(next, reason);
+    }
+}
+
+//Once per LOAD_EVAL_INTERVAL_MS: one step up on overload, one step down after a calm hold
+void LoadShedder::evaluate(unsigned long now_ms) {
+    lastEval_ms = now_ms;
+    bool overloaded = loopAverage_us > budget_us || intervalOverruns >= LOAD_OVERRUN_LIMIT;
+    bool margin = (uint64_t)loopAverage_us * 100 < (uint64_t)budget_us * LOAD_RESTORE_PERCENT;
+
+    if (overloaded) {
+        calm = false;
+        if (overloadLevel < LOAD_OVERLOAD_LEVEL_MAX) {
+            overloadLevel++;
+            //Back to overload right after a restore: wait longer before the next one
+            if (lastRestore_ms != 0 && now_ms - lastRestore_ms < restoreHold_ms &&
+                restoreHold_ms < LOAD_RESTORE_HOLD_MAX_MS) {
+                restoreHold_ms *= 2;
+            }
+        }
+    } else if (margin && overloadLevel > 0) {
+        if (!calm) {
+            calm = true;
+            calmSince_ms = now_ms;
+        } else if (now_ms - calmSince_ms >= restoreHold_ms) {
+            overloadLevel--;
+            calmSince_ms = now_ms;
+            lastRestore_ms = now_ms;
+        }
+    } else {
+        calm = false;
+    }
+
+    intervalOverruns = 0;
+    loopMax_us = 0;
+}
+
+uint8_t LoadShedder::batteryFloorFor(uint16_t mV) const {
+    uint16_t critical = LOAD_BATTERY_CRITICAL_MV;
+    if (batteryFloor >= LOAD_LEVEL_MAX) {
+        critical += LOAD_BATTERY_HYSTERESIS_MV;
+    }
+    if (mV < critical) {
+        return LOAD_LEVEL_MAX;
+    }
+    uint16_t reduced = LOAD_BATTERY_REDUCED_MV;
+    if (batteryFloor >= LOAD_BATTERY_REDUCED_LEVEL) {
+        reduced += LOAD_BATTERY_HYSTERESIS_MV;
+    }
+    return mV < reduced ? LOAD_BATTERY_REDUCED_LEVEL : 0;
+}
+
+void LoadShedder::setLevel(uint8_t next, const char* reason) {
+    uint8_t previous = level;
+    level = next;
+    changed = true;
+#ifdef ARDUINO
+    Serial.print(F("[LOAD] Level "));
+    Serial.print(previous);
+    Serial.print(F(" -> "));
+    Serial.print(next);
+    Serial.print(F(" ("));
+    Serial.print(reason);
+    Serial.print(F(", loop avg "));
+    Serial.print(loopAverage_us);
+    Serial.print(F(" us, battery "));
+    Serial.print(getBatteryFiltered_mV());
+    Serial.println(F(" mV)"));
+#else
+    (void)previous;
+    (void)reason;
+#endif
+}
+
+uint8_t LoadShedder::getLevel() const {
+    return level;
+}
+
+uint16_t LoadShedder::getShedMask() const {
+    return (uint16_t)((1u << level) - 1u);
+}
+
+bool LoadShedder::isEnabled(ShedTask task) const {
+    return task >= level;
+}
+
+bool LoadShedder::hasChanged() {
+    bool c = changed;
+    changed = false;
+    return c;
+}
+
+uint32_t LoadShedder::getLoopAverage_us() const {
+    return loopAverage_us;
+}
+
+uint32_t LoadShedder::getLoopMax_us() const {
+    return loopMax_us;
+}
+
+uint16_t LoadShedder::getBatteryFiltered_mV() const {
+    return (uint16_t)(battery_mV_x16 >> 4);
+}
+
+uint32_t LoadShedder::getOverruns() const {
+    return overruns;
+}
+
+void LoadShedder::printStatus() const {
+#ifdef ARDUINO
+    Serial.print(F("  Load:    level "));
+    Serial.print(level);
+    Serial.print(F(", loop avg "));
+    Serial.print(loopAverage_us);
+    Serial.print(F(" / "));
+    Serial.print(budget_us);
+    Serial.print(F(" us, "));
+    Serial.print(overruns);
+    Serial.print(F(" overruns"));
+    for (uint8_t i = 0; i < level; i++) {
+        Serial.print(i == 0 ? F(", shed: ") : F(", "));
+        Serial.print(FPSTR(SHED_TASK_NAMES[i]));
+    }
+    Serial.println();
+#else
+    printf("  Load:    level %u, loop avg %u / %u us, %u overruns", level,
+           (unsigned)loopAverage_us, (unsigned)budget_us, (unsigned)overruns);
+    for (uint8_t i = 0; i < level; i++) {
+        printf(i == 0 ? ", shed: %s" : ", %s", SHED_TASK_NAMES[i]);
+    }
+    printf("\n");
+#endif
+}
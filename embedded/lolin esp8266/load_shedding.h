@@ -0,0 +1,108 @@
+#ifndef LOAD_SHEDDING_H
+#define LOAD_SHEDDING_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+
+//Sheddable work, in the order it is given up (first entry goes first).
+//Never shed: barometer, FSM::update, checkpoints and telemetry at the slow rate.
+enum ShedTask : uint8_t {
+    SHED_VERBOSE_LOG,       //printStatus and other periodic Serial output
+    SHED_VIBRATION,         //IMU spectrum in DESCENT_STABLE (FFT every block)
+    SHED_ATTITUDE,          //pitch / roll from the accelerometer
+    SHED_LANDING,           //drift fit and touchdown prediction
+    SHED_SENSOR_RATE,       //lower IMU rate, same baro (see getReducedSamplingProfile)
+    SHED_TELEMETRY_RATE,    //telemetry every TELEMETRY_INTERVAL * LOAD_TELEMETRY_STRETCH
+    SHED_IMAGE_CAPTURE,     //ESP32-CAM trigger: battery only, a GPIO pulse costs no CPU
+    SHED_TASK_COUNT
+};
+
+#define LOAD_LEVEL_MAX             SHED_TASK_COUNT     //level n = first n tasks shed
+#define LOAD_OVERLOAD_LEVEL_MAX    SHED_IMAGE_CAPTURE  //loop overrun never takes the camera
+
+#define LOAD_LOOP_BUDGET_US        20000    //default loop deadline (50 Hz control loop)
+#define LOAD_EVAL_INTERVAL_MS      250      //one level up at most this often
+#define LOAD_OVERRUN_LIMIT         1        //overruns per interval that count as overload (periodic spikes too)
+#define LOAD_RESTORE_PERCENT       60       //average loop time below this % of the budget...
+#define LOAD_RESTORE_HOLD_MS       3000     //...for this long gives one level back
+#define LOAD_RESTORE_HOLD_MAX_MS   30000    //hold doubles when a restore overloads again
+#define LOAD_TELEMETRY_STRETCH     4
+
+//Battery floors (mV, filtered): below the threshold the level is at least the floor,
+//it is released LOAD_BATTERY_HYSTERESIS_MV above the threshold
+#define LOAD_BATTERY_REDUCED_MV    3500     //up to the sensor rates
+#define LOAD_BATTERY_CRITICAL_MV   3300     //everything (same as LOW_BATTERY_MV)
+#define LOAD_BATTERY_HYSTERESIS_MV 100
+
+
+/**
+ Load shedding controller
+ Responsibilities:
+ - Loop time: a moving average and an overrun count against the loop budget.
+   Overload raises the level one step per LOAD_EVAL_INTERVAL_MS, so the cheapest
+   cut comes first. A sustained margin (average below LOAD_RESTORE_PERCENT of
+   the budget for LOAD_RESTORE_HOLD_MS) gives one step back at a time: a task
+   that was shed for being expensive does not bounce straight back on, and if
+   a restore overloads again the hold doubles (up to LOAD_RESTORE_HOLD_MAX_MS).
+ - Battery: filtered voltage (radio bursts sag the cell) sets a floor under the
+   level, released only LOAD_BATTERY_HYSTERESIS_MV above the threshold.
+ - SAFE_MODE sheds everything.
+ The controller only decides; SensorManager::setShedMask and FSM::setShedMask
+ apply the decision, the main loop gates its own logging with isEnabled().
+
+ Main loop contract:
+   unsigned long start = micros();
+   ... poll, readAll, FSM::update, telemetry ...
+   shedder.update(micros() - start, battery_mV, millis(), fsm.getState() == MissionState::SAFE_MODE);
+   if (shedder.hasChanged()) { sensors.setShedMask(shedder.getShedMask()); fsm.setShedMask(...); }
+ */
+class LoadShedder {
+public:
+    LoadShedder();
+
+    void begin(uint32_t loopBudget_us = LOAD_LOOP_BUDGET_US);
+
+    //One finished loop iteration
+    void update(uint32_t loopTime_us, uint16_t battery_mV, unsigned long now_ms, bool safeMode);
+
+    uint8_t getLevel() const;
+    uint16_t getShedMask() const;           //bit per ShedTask, set = shed
+    bool isEnabled(ShedTask task) const;
+
+    //True once after every level change (consumed by the call)
+    bool hasChanged();
+
+    uint32_t getLoopAverage_us() const;
+    uint32_t getLoopMax_us() const;         //since the last evaluation
+    uint16_t getBatteryFiltered_mV() const;
+    uint32_t getOverruns() const;           //total
+    void printStatus() const;
+
+private:
+    uint32_t budget_us;
+    uint32_t loopAverage_us;                //EWMA, 1/8 weight
+    uint32_t loopMax_us;
+    uint32_t overruns;
+    uint8_t intervalOverruns;
+    unsigned long lastEval_ms;
+    unsigned long calmSince_ms;
+    bool calm;
+    unsigned long lastRestore_ms;
+    unsigned long restoreHold_ms;
+
+    uint32_t battery_mV_x16;                //EWMA, 1/16 weight, 0 = no sample yet
+    uint8_t batteryFloor;
+
+    uint8_t overloadLevel;
+    uint8_t level;
+    bool changed;
+
+    void evaluate(unsigned long now_ms);
+    uint8_t batteryFloorFor(uint16_t mV) const;
+    void setLevel(uint8_t next, const char* reason);
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "mission_checkpoint.h"
+#ifdef ARDUINO
+#include <EEPROM.h>
+#endif
+#include "telemetry_packet.h"
+
+CheckpointStore::CheckpointStore()
+    : sequence(0),
+      saves(0),
+      bootRtcTime(0),
+      boot_ms(0) {
+}
+
+void CheckpointStore::begin(uint32_t rtcNow) {
+    bootRtcTime = rtcNow;
+    boot_ms = millis();
+    EEPROM.begin(CHECKPOINT_EEPROM_SIZE);
+}
+
+//DS3231 time carried on by millis(), no bus read per save
+uint32_t CheckpointStore::rtcNow() const {
+    if (bootRtcTime == 0) {
+        return 0;
+    }
+    return bootRtcTime + (millis() - boot_ms) / 1000;
+}
+
+//Saved within CHECKPOINT_EEPROM_MAX_AGE_S on a clock that kept running
+bool CheckpointStore::isRecent(const MissionCheckpoint& checkpoint) const {
+    uint32_t now = rtcNow();
+    return now != 0 && checkpoint.rtcTime != 0 &&
+           (int32_t)(now - checkpoint.rtcTime) >= 0 && now - checkpoint.rtcTime <= CHECKPOINT_EEPROM_MAX_AGE_S;
+}
+
+bool CheckpointStore::load(MissionCheckpoint& checkpoint) {
+    MissionCheckpoint fromRtc;
+    MissionCheckpoint fromEeprom;
+    bool rtcOk = ESP.rtcUserMemoryRead(CHECKPOINT_RTC_BLOCK, (uint32_t*)&fromRtc, sizeof(fromRtc)) &&
+                 isValid(fromRtc);
+    EEPROM.get(CHECKPOINT_EEPROM_ADDR, fromEeprom);
+    bool eepromOk = isValid(fromEeprom);
+    if (eepromOk && !isRecent(fromEeprom)) {
+        Serial.println(F("[CHECKPOINT] EEPROM copy from an earlier power-on, ignored"));
+        eepromOk = false;
+    }
+
+    if (!rtcOk && !eepromOk) {
+        return false;
+    }
+    //RTC copy is normally newer (periodic saves), EEPROM only after a power loss
+    if (rtcOk && (!eepromOk || (int32_t)(fromRtc.sequence - fromEeprom.sequence) >= 0)) {
+        checkpoint = fromRtc;
+        Serial.print(F("[CHECKPOINT] Loaded from RTC memory, seq "));
+    } else {
+        checkpoint = fromEeprom;
+        Serial.print(F("[CHECKPOINT] Loaded from EEPROM, seq "));
+    }
+    Serial.println(checkpoint.sequence);
+
+    sequence = checkpoint.sequence;
+    return true;
+}
+
+bool CheckpointStore::save(MissionCheckpoint& checkpoint, bool persistent) {
+    checkpoint.magic = CHECKPOINT_MAGIC;
+    checkpoint.version = CHECKPOINT_VERSION;
+    checkpoint.reserved = 0;
+    checkpoint.padding = 0;
+    checkpoint.sequence = ++sequence;
+    checkpoint.rtcTime = rtcNow();
+    checkpoint.crc = computeCrc(checkpoint);
+
+    bool ok = ESP.rtcUserMemoryWrite(CHECKPOINT_RTC_BLOCK, (uint32_t*)&checkpoint, sizeof(checkpoint));
+    if (persistent) {
+        EEPROM.put(CHECKPOINT_EEPROM_ADDR, checkpoint);
+        ok = EEPROM.commit() && ok;
+    }
+    saves++;
+    return ok;
+}
+
+void CheckpointStore::clear() {
+    MissionCheckpoint empty;
+    memset(&empty, 0, sizeof(empty));
+    ESP.rtcUserMemoryWrite(CHECKPOINT_RTC_BLOCK, (uint32_t*)&empty, sizeof(empty));
+    EEPROM.put(CHECKPOINT_EEPROM_ADDR, empty);
+    EEPROM.commit();
+    Serial.println(F("[CHECKPOINT] Cleared"));
+}
+
+uint32_t CheckpointStore::getSaveCount() const {
+    return saves;
+}
+
+uint16_t CheckpointStore::computeCrc(const MissionCheckpoint& checkpoint) {
+    return telemetryCrc16((const uint8_t*)&checkpoint, offsetof(MissionCheckpoint, crc));
+}
+
+bool CheckpointStore::isValid(const MissionCheckpoint& checkpoint) {
+    return checkpoint.magic == CHECKPOINT_MAGIC &&
+           checkpoint.version == CHECKPOINT_VERSION &&
+           checkpoint.crc == computeCrc(checkpoint);
+}
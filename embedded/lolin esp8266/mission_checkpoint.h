@@ -0,0 +1,100 @@
+#ifndef MISSION_CHECKPOINT_H
+#define MISSION_CHECKPOINT_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+
+#define CHECKPOINT_MAGIC        0x43534154UL   //"CSAT"
+#define CHECKPOINT_VERSION      2
+#define CHECKPOINT_RTC_BLOCK    32     //RTC user memory offset in 4-byte blocks (first 128 bytes belong to OTA)
+#define CHECKPOINT_EEPROM_ADDR  0
+#define CHECKPOINT_EEPROM_SIZE  64     //bytes reserved by EEPROM.begin()
+#define CHECKPOINT_EEPROM_REFRESH_MS 30000   //EEPROM copy rewritten this often in IDLE..LANDING
+#define CHECKPOINT_EEPROM_MAX_AGE_S  60      //older EEPROM copies are from an earlier power-on
+
+//Everything the FSM needs to continue a mission after a reset.
+//Multiple of 4 bytes: RTC user memory is accessed in 32-bit blocks.
+struct MissionCheckpoint {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t state;              //MissionState as in FSM::getStateID()
+    uint8_t imageCaptured;
+    uint8_t reserved;
+    uint32_t sequence;          //incremented on every save, newest copy wins
+    uint32_t timeInState_ms;    //millis() restarts at 0, so the elapsed time is stored
+    float maxAltitudeReached;
+    float groundPressure_hPa;
+    float groundAltitude_MSL;
+    uint32_t rtcTime;           //DS3231 unix time of the save, 0 if the RTC had lost power
+    uint16_t padding;
+    uint16_t crc;               //CRC-16/CCITT over all bytes before it
+};
+
+static_assert(sizeof(MissionCheckpoint) % 4 == 0, "RTC memory is written in 4-byte blocks");
+static_assert(sizeof(MissionCheckpoint) <= CHECKPOINT_EEPROM_SIZE, "EEPROM area too small");
+
+
+/**
+ Mission checkpoint storage for warm restarts (brownout, watchdog, exception)
+ Responsibilities:
+ - RTC user memory copy: survives every reset except power loss, cheap enough
+   to rewrite on every transition and periodically
+ - EEPROM (flash) copy: survives power loss, written on transitions only
+   and every CHECKPOINT_EEPROM_REFRESH_MS (each commit erases a flash sector
+   and blocks for tens of ms). Stamped with the DS3231 time: a copy older
+   than CHECKPOINT_EEPROM_MAX_AGE_S, or any copy when the RTC lost its time,
+   is from a flight that never finished (powered off on recovery) and is
+   ignored, the board boots cold instead of resuming it on the pad
+ - CRC + magic + version check, the newest valid copy is returned
+
+ Boot sequence using it:
+   store.begin(sensors.beginClock());
+   if (store.load(cp) && fsm.resume(cp)) {
+       sensors.beginWarm(cp.groundPressure_hPa, cp.groundAltitude_MSL, fsm.getState());
+   } else {
+       sensors.begin(); fsm.begin();
+   }
+   //every loop: once sensors.isCalibrated(), fsm.setGroundReference(...) (BOOT ends on it)
+   //after a warm boot, fsm.update() only from the first barometer sample on (data.bmp_valid):
+   //SensorData starts empty and altitude 0 reads as landed
+   fsm.attachCheckpoint(&store);
+   actuator.begin(PARACHUTE_SERVO_PIN); fsm.attachActuator(&actuator);   //resumed in LANDING: releases
+ */
+class CheckpointStore {
+public:
+    CheckpointStore();
+
+    //rtcNow: DS3231 unix time at boot (SensorManager::beginClock), 0 if unknown
+    void begin(uint32_t rtcNow);
+
+    //Newest valid copy from RTC memory or EEPROM, false if none
+    bool load(MissionCheckpoint& checkpoint);
+
+    /**
+     Stamp magic/version/sequence/RTC time/crc and write to RTC memory,
+     persistent also mirrors it to EEPROM
+     */
+    bool save(MissionCheckpoint& checkpoint, bool persistent);
+
+    //Invalidate both copies (mission finished)
+    void clear();
+
+    uint32_t getSaveCount() const;
+
+private:
+    uint32_t sequence;
+    uint32_t saves;
+    uint32_t bootRtcTime;       //DS3231 time at begin(), 0 if unknown
+    unsigned long boot_ms;
+
+    uint32_t rtcNow() const;
+    bool isRecent(const MissionCheckpoint& checkpoint) const;
+
+    static uint16_t computeCrc(const MissionCheckpoint& checkpoint);
+    static bool isValid(const MissionCheckpoint& checkpoint);
+};
+
+#endif
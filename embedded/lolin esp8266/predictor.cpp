@@ -0,0 +1,427 @@
+#include "predictor.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PREDICTOR_GRAVITY        9.80665
+#define PREDICTOR_MIN_SAMPLES    5
+#define PREDICTOR_MAX_HORIZON_S  120.0   //do not predict further than this
+#define PREDICTOR_MIN_DESCENT    0.1     //m/s, slower than this is "hovering"
+
+#ifdef FIXED_POINT_PIPELINE
+#define PREDICTOR_GRAVITY_CMPS2     98067     //0.01 cm/s^2
+#define PREDICTOR_MAX_HORIZON_MS    120000L
+#define PREDICTOR_MIN_DESCENT_CMPS  10
+#define PREDICTOR_MAX_INNOVATION_CM 4000      //keeps the squared innovation in int32
+#define PREDICTOR_MAX_SPEED_CMPS    8000      //model clamp, keeps speed * tau in int32
+#define PREDICTOR_MAX_GAIN_SAMPLES  1024      //expanding gains are long gone by then
+#endif
+
+TrajectoryPredictor::TrajectoryPredictor()
+#ifdef FIXED_POINT_PIPELINE
+    : h_q8(0),
+      v_q8(0),
+      fadeG(0),
+      fadeH(0),
+      fadeP11(0),
+      readySamples(0xFFFF),
+      gainG(0),
+      gainH(0),
+      gainP11(0),
+      period_ms(0),
+      residualVar(10000),
+      terminalTc_ms(0),
+#else
+    : h(0.0),
+      v(0.0),
+      lambda(0.95),
+      residualVar(1.0),
+#endif
+      lastTime_ms(0),
+      samples(0),
+      terminalVelocity(0),
+      targetCount(0) {
+#ifndef FIXED_POINT_PIPELINE
+    memset(P, 0, sizeof(P));
+#endif
+    memset(predictions, 0, sizeof(predictions));
+    memset(aheadCrossing_ms, 0, sizeof(aheadCrossing_ms));
+    memset(aheadValid, 0, sizeof(aheadValid));
+}
+
+void TrajectoryPredictor::begin(float forgetting) {
+#ifdef FIXED_POINT_PIPELINE
+    //Float once here, the per-sample path only sees the Q15 / Q30 constants
+    float q = 1.0f - forgetting;
+    fadeG = (uint16_t)((1.0f - forgetting * forgetting) * 32768.0f + 0.5f);
+    fadeH = (uint16_t)(q * q * 32768.0f + 0.5f);
+    fadeP11 = (uint32_t)(q * q * q / forgetting * 1073741824.0f + 0.5f);
+    readySamples = (uint16_t)ceilf(2.0f / q);
+    residualVar = 10000;
+#else
+    lambda = forgetting;
+    residualVar = 1.0;
+#endif
+    samples = 0;
+    targetCount = 0;   //targets are registered again after begin()
+}
+
+int8_t TrajectoryPredictor::addTarget(altitude_t altitude) {
+    if (targetCount >= PREDICTOR_MAX_TARGETS) {
+        return -1;
+    }
+    AltitudePrediction& p = predictions[targetCount];
+    memset(&p, 0, sizeof(p));
+    p.target = altitude;
+    return (int8_t)targetCount++;
+}
+
+void TrajectoryPredictor::setTerminalVelocity(vspeed_t vt) {
+    terminalVelocity = vt;
+#ifdef FIXED_POINT_PIPELINE
+    terminalTc_ms = vt < 0 ? -vt * 100000L / PREDICTOR_GRAVITY_CMPS2 : 0;
+#endif
+    //Predictions of the last sample under the new model: the FSM switches it on
+    //a transition, after update(), and acts on them in the same loop. An ahead
+    //prediction of the old model is not scored.
+    for (uint8_t i = 0; i < targetCount; i++) {
+        aheadValid[i] = false;
+        predict(i, lastTime_ms);
+    }
+}
+
+#ifdef FIXED_POINT_PIPELINE
+
+void TrajectoryPredictor::update(altitude_t altitude, unsigned long time_ms) {
+    if (samples == 0) {
+        h_q8 = altitude * 256;
+        v_q8 = 0;
+        lastTime_ms = time_ms;
+        samples = 1;
+        return;
+    }
+
+    uint32_t dt = time_ms - lastTime_ms;
+    lastTime_ms = time_ms;
+    if (dt == 0) {
+        return;
+    }
+    period_ms = dt;
+
+    //Move the fit to the new sample time
+    h_q8 += (int32_t)((int64_t)v_q8 * dt / 1000);
+
+    //Expanding-memory gains of a least squares line through samples + 1 points,
+    //until they drop to the fading-memory gains lambda settles on
+    uint32_t k = samples < PREDICTOR_MAX_GAIN_SAMPLES ? samples : PREDICTOR_MAX_GAIN_SAMPLES;
+    uint32_t norm = (k + 1) * (k + 2);
+    uint32_t g = 2 * (2 * k + 1) * 32768UL / norm;
+    if (g > fadeG) {
+        gainG = (uint16_t)(g > 32768 ? 32768 : g);
+        gainH = (uint16_t)(6 * 32768UL / norm);
+        gainP11 = (uint32_t)(12 * 1073741824ULL / (norm * k));
+    } else {
+        gainG = fadeG;
+        gainH = fadeH;
+        gainP11 = fadeP11;
+    }
+
+    int32_t innovation = altitude * 256 - h_q8;
+    h_q8 += (int32_t)(((int64_t)gainG * innovation) >> 15);
+    v_q8 += (int32_t)(((int64_t)gainH * innovation * 1000 / dt) >> 15);
+
+    //Noise level for the confidence figures
+    int32_t r = innovation / 256;
+    if (r > PREDICTOR_MAX_INNOVATION_CM) {
+        r = PREDICTOR_MAX_INNOVATION_CM;
+    } else if (r < -PREDICTOR_MAX_INNOVATION_CM) {
+        r = -PREDICTOR_MAX_INNOVATION_CM;
+    }
+    residualVar += (r * r - residualVar) / 10;
+    if (samples < 0xFFFF) {
+        samples++;
+    }
+
+    updateTargets(altitude, time_ms);
+}
+
+altitude_t TrajectoryPredictor::getAltitude() const {
+    return h_q8 / 256;
+}
+
+vspeed_t TrajectoryPredictor::getVerticalSpeed() const {
+    return v_q8 / 256;
+}
+
+bool TrajectoryPredictor::isReady() const {
+    return samples >= PREDICTOR_MIN_SAMPLES && samples >= readySamples;
+}
+
+/**
+ Altitude (cm) tau_ms ahead and the speed (cm/s) at that moment, same model
+ as the float build with tc = |vt| / g and e^(-tau/tc) from fixedExpNeg
+ */
+int32_t TrajectoryPredictor::altitudeAfter(int32_t tau_ms, int32_t& speed) const {
+    int32_t h = h_q8 / 256;
+    int32_t v = v_q8 / 256;
+    if (v > PREDICTOR_MAX_SPEED_CMPS) {
+        v = PREDICTOR_MAX_SPEED_CMPS;
+    } else if (v < -PREDICTOR_MAX_SPEED_CMPS) {
+        v = -PREDICTOR_MAX_SPEED_CMPS;
+    }
+    if (terminalVelocity >= 0 || terminalTc_ms == 0) {
+        speed = v;
+        return h + v * tau_ms / 1000;
+    }
+    int32_t vt = terminalVelocity;
+    int32_t decay = fixedExpNeg((uint32_t)tau_ms * 4096 / (uint32_t)terminalTc_ms);
+    speed = vt + (((v - vt) * decay) >> 15);
+    return h + vt * tau_ms / 1000 + (((v - vt) * terminalTc_ms / 1000) * (32768 - decay) >> 15);
+}
+
+void TrajectoryPredictor::predict(uint8_t index, unsigned long now_ms) {
+    AltitudePrediction& p = predictions[index];
+    p.valid = false;
+    int32_t h = h_q8 / 256;
+    if (!isReady() || p.crossed || h <= p.target) {
+        return;
+    }
+
+    //Newton on h(tau) = target, h'(tau) = v(tau); tau kept within twice the horizon
+    //so every product above stays in int32
+    int32_t descent = terminalVelocity < 0 ? -terminalVelocity : -v_q8 / 256;
+    if (descent < PREDICTOR_MIN_DESCENT_CMPS) {
+        return;  //not heading down
+    }
+    int32_t tau = (h - p.target) * 1000 / descent;
+    int32_t speed = 0;
+    for (uint8_t iter = 0; iter < 8; iter++) {
+        if (tau > 2 * PREDICTOR_MAX_HORIZON_MS) {
+            tau = 2 * PREDICTOR_MAX_HORIZON_MS;
+        }
+        int32_t altitude = altitudeAfter(tau, speed);
+        if (speed > -PREDICTOR_MIN_DESCENT_CMPS) {
+            return;
+        }
+        int32_t step = (altitude - p.target) * 1000 / speed;
+        tau -= step;
+        if (tau < 0) {
+            tau = 0;
+        }
+        if (step == 0) {
+            break;
+        }
+    }
+    if (tau > PREDICTOR_MAX_HORIZON_MS) {
+        return;
+    }
+    altitudeAfter(tau, speed);
+    if (speed > -PREDICTOR_MIN_DESCENT_CMPS) {
+        return;
+    }
+
+    //First-order uncertainty as in the float build. With u = dh(T)/dv0 / dt the
+    //covariance terms are P00 = g, P01 = h / dt, P11 = p11 / dt^2, so
+    //var(T) = residualVar / v(T)^2 * (g + 2 u h + u^2 p11)
+    int32_t dhdv0_ms = tau;
+    if (terminalVelocity < 0 && terminalTc_ms > 0) {
+        uint16_t decay = fixedExpNeg((uint32_t)tau * 4096 / (uint32_t)terminalTc_ms);
+        dhdv0_ms = (terminalTc_ms * (32768 - decay)) >> 15;
+    }
+    uint64_t u_q8 = (uint64_t)dhdv0_ms * 256 / period_ms;
+    if (u_q8 > (1ULL << 22)) {
+        u_q8 = 1ULL << 22;
+    }
+    uint64_t bracket_q15 = gainG + ((2 * u_q8 * gainH) >> 8) + ((((u_q8 * u_q8) >> 16) * gainP11) >> 15);
+    if (bracket_q15 > (1ULL << 36)) {
+        bracket_q15 = 1ULL << 36;
+    }
+    uint64_t var_q15 = (uint64_t)residualVar * bracket_q15 / (uint64_t)((int64_t)speed * speed);   //s^2
+    if (var_q15 > (1ULL << 40)) {
+        var_q15 = 1ULL << 40;
+    }
+    uint64_t var_ms2 = (var_q15 * 15625) >> 9;   //* 1e6 / 32768
+    if (var_ms2 > 0xFFFFFFFFULL) {
+        var_ms2 = 0xFFFFFFFFULL;
+    }
+
+    p.valid = true;
+    p.timeToTarget_ms = (uint32_t)tau;
+    p.sigma_ms = fixedSqrt((uint32_t)var_ms2);
+
+    if (!aheadValid[index] && p.timeToTarget_ms <= PREDICTOR_HORIZON_MS) {
+        aheadCrossing_ms[index] = now_ms + p.timeToTarget_ms;
+        aheadValid[index] = true;
+    }
+}
+
+#else
+
+void TrajectoryPredictor::update(altitude_t altitude_m, unsigned long time_ms) {
+    if (samples == 0) {
+        h = altitude_m;
+        v = 0.0;
+        P[0][0] = 100.0;
+        P[0][1] = 0.0;
+        P[1][0] = 0.0;
+        P[1][1] = 100.0;
+        lastTime_ms = time_ms;
+        samples = 1;
+        return;
+    }
+
+    float dt = (time_ms - lastTime_ms) / 1000.0;
+    lastTime_ms = time_ms;
+    if (dt <= 0.0) {
+        return;
+    }
+
+    //Move the fit to the new sample time: theta' = T theta, P' = T P T^T, T = [1 dt; 0 1]
+    h += v * dt;
+    float p00 = P[0][0] + 2.0 * dt * P[0][1] + dt * dt * P[1][1];
+    float p01 = P[0][1] + dt * P[1][1];
+    float p11 = P[1][1];
+
+    //RLS step with regressor [1, 0] (altitude measured at the anchor time)
+    float innovation = altitude_m - h;
+    float denom = lambda + p00;
+    float k0 = p00 / denom;
+    float k1 = p01 / denom;
+    h += k0 * innovation;
+    v += k1 * innovation;
+
+    P[0][0] = (p00 - k0 * p00) / lambda;
+    P[0][1] = (p01 - k0 * p01) / lambda;
+    P[1][0] = P[0][1];
+    P[1][1] = (p11 - k1 * p01) / lambda;
+
+    //Noise level for the confidence figures
+    residualVar += 0.1 * (innovation * innovation - residualVar);
+    if (samples < 0xFFFF) {
+        samples++;
+    }
+
+    updateTargets(altitude_m, time_ms);
+}
+
+altitude_t TrajectoryPredictor::getAltitude() const {
+    return h;
+}
+
+vspeed_t TrajectoryPredictor::getVerticalSpeed() const {
+    return v;
+}
+
+bool TrajectoryPredictor::isReady() const {
+    //Speed settles after about two forgetting windows (1 / (1 - lambda) samples each),
+    //before that a few noisy samples can swing it by several m/s
+    return samples >= PREDICTOR_MIN_SAMPLES && samples * (1.0 - lambda) >= 2.0;
+}
+
+/**
+ Altitude tau_s seconds ahead and the speed at that moment
+ v(t) = vt + (v0 - vt) e^(-t/tc), tc = |vt| / g   (drag-limited)
+ v(t) = v0                                        (no terminal velocity set)
+ */
+float TrajectoryPredictor::altitudeAfter(float tau_s, float& speed) const {
+    if (terminalVelocity >= 0.0) {
+        speed = v;
+        return h + v * tau_s;
+    }
+    float vt = terminalVelocity;
+    float tc = -vt / PREDICTOR_GRAVITY;
+    float decay = expf(-tau_s / tc);
+    speed = vt + (v - vt) * decay;
+    return h + vt * tau_s + (v - vt) * tc * (1.0 - decay);
+}
+
+void TrajectoryPredictor::predict(uint8_t index, unsigned long now_ms) {
+    AltitudePrediction& p = predictions[index];
+    p.valid = false;
+    if (!isReady() || p.crossed || h <= p.target) {
+        return;
+    }
+
+    //Newton on h(tau) = target, h'(tau) = v(tau)
+    float descent = terminalVelocity < 0.0 ? -terminalVelocity : -v;
+    if (descent < PREDICTOR_MIN_DESCENT) {
+        return;  //not heading down
+    }
+    float tau = (h - p.target) / descent;
+    float speed = 0.0;
+    for (uint8_t iter = 0; iter < 8; iter++) {
+        float altitude = altitudeAfter(tau, speed);
+        if (speed > -PREDICTOR_MIN_DESCENT) {
+            return;
+        }
+        float step = (altitude - p.target) / speed;
+        tau -= step;
+        if (tau < 0.0) {
+            tau = 0.0;
+        }
+        if (fabsf(step) < 0.001) {
+            break;
+        }
+    }
+    altitudeAfter(tau, speed);
+    if (tau > PREDICTOR_MAX_HORIZON_S || speed > -PREDICTOR_MIN_DESCENT) {
+        return;
+    }
+
+    //First-order uncertainty: dT/dh = -1/v(T), dT/dv0 = -(dh(T)/dv0)/v(T)
+    float dhdv0 = tau;
+    if (terminalVelocity < 0.0) {
+        float tc = -terminalVelocity / PREDICTOR_GRAVITY;
+        dhdv0 = tc * (1.0 - expf(-tau / tc));
+    }
+    float dTdh = -1.0 / speed;
+    float dTdv = -dhdv0 / speed;
+    float varT = residualVar * (dTdh * dTdh * P[0][0] + 2.0 * dTdh * dTdv * P[0][1] + dTdv * dTdv * P[1][1]);
+
+    p.valid = true;
+    p.timeToTarget_ms = (uint32_t)(tau * 1000.0);
+    p.sigma_ms = (uint32_t)(sqrtf(varT > 0.0 ? varT : 0.0) * 1000.0);
+
+    //Remember the crossing time predicted about one horizon ahead, for scoring
+    if (!aheadValid[index] && p.timeToTarget_ms <= PREDICTOR_HORIZON_MS) {
+        aheadCrossing_ms[index] = now_ms + p.timeToTarget_ms;
+        aheadValid[index] = true;
+    }
+}
+
+#endif
+
+void TrajectoryPredictor::updateTargets(altitude_t altitude, unsigned long time_ms) {
+    for (uint8_t i = 0; i < targetCount; i++) {
+        AltitudePrediction& p = predictions[i];
+
+        //Downward crossing of the target by the measurement: score the ahead prediction
+        if (!p.crossed && altitude <= p.target) {
+            p.crossed = true;
+            if (aheadValid[i]) {
+                p.lastError_ms = (int32_t)(time_ms - aheadCrossing_ms[i]);
+                p.errorAvailable = true;
+            }
+            aheadValid[i] = false;
+        } else if (p.crossed && altitude > p.target + ALTITUDE_FROM_M(1.0)) {
+            p.crossed = false;  //back above (climbing), re-arm with 1 m hysteresis
+        }
+
+        predict(i, time_ms);
+    }
+}
+
+const AltitudePrediction& TrajectoryPredictor::getPrediction(uint8_t index) const {
+    if (index >= targetCount) {
+        index = 0;
+    }
+    return predictions[index];
+}
+
+bool TrajectoryPredictor::isArmed(uint8_t index, uint32_t lead_ms, uint32_t max_sigma_ms) const {
+    if (index >= targetCount) {
+        return false;
+    }
+    const AltitudePrediction& p = predictions[index];
+    return p.valid && !p.crossed && p.timeToTarget_ms <= lead_ms && p.sigma_ms <= max_sigma_ms;
+}
@@ -0,0 +1,112 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+#include "fixed_point.h"
+
+#define PREDICTOR_MAX_TARGETS     4
+#define PREDICTOR_HORIZON_MS      1000   //crossing predicted this far ahead is scored against reality
+
+//Time-to-altitude estimate for one target
+struct AltitudePrediction {
+    altitude_t target;            //target altitude (AGL)
+    bool valid;                   //descending towards the target and fit is usable
+    uint32_t timeToTarget_ms;     //predicted time until crossing
+    uint32_t sigma_ms;            //1-sigma uncertainty of timeToTarget_ms
+    bool crossed;                 //altitude already went below target
+    int32_t lastError_ms;         //actual - predicted crossing time (1 s ahead prediction)
+    bool errorAvailable;
+};
+
+
+/**
+ Incremental trajectory predictor
+ Responsibilities:
+ - Recursive least squares (with forgetting) fit of altitude and vertical speed
+ - Drag-limited descent model: speed relaxes towards a terminal velocity with
+   time constant |vt| / g, so a free fall does not get extrapolated linearly
+ - Time-to-altitude + confidence for a few configurable target altitudes
+ - Self-scoring: each prediction made ~1 s ahead is compared with the real
+   crossing, that error is what replays of recorded descents look at
+
+ Units follow altitude_t / vspeed_t. With FIXED_POINT_PIPELINE the fit is the
+ integer form of the same estimator: at a steady sample rate RLS with
+ forgetting lambda settles on fixed gains (fading-memory g-h filter,
+ g = 1 - lambda^2, h = (1 - lambda)^2), reached through the expanding-memory
+ gains of a plain least squares line while it has fewer samples. Covariance
+ terms follow from the gains, e^-x comes from a flash table (fixedExpNeg).
+ */
+class TrajectoryPredictor {
+public:
+    TrajectoryPredictor();
+
+    /**
+     forgetting: RLS forgetting factor per sample (0.9-0.99, lower = faster tracking)
+     */
+    void begin(float forgetting = 0.95);
+
+    //Register a target altitude, return its index (or -1 if full)
+    int8_t addTarget(altitude_t altitude);
+
+    //Expected terminal velocity (negative) for the current phase, re-predicts the targets
+    void setTerminalVelocity(vspeed_t vt);
+
+    //Feed one altitude sample (AGL) and update all predictions
+    void update(altitude_t altitude, unsigned long time_ms);
+
+    const AltitudePrediction& getPrediction(uint8_t index) const;
+
+    //True if target index is predicted to be crossed within lead_ms with sigma below max_sigma_ms
+    bool isArmed(uint8_t index, uint32_t lead_ms, uint32_t max_sigma_ms = 500) const;
+
+    altitude_t getAltitude() const;       //filtered altitude
+    vspeed_t getVerticalSpeed() const;    //filtered vertical speed (negative = descending)
+    bool isReady() const;                 //enough samples for a fit
+
+private:
+#ifdef FIXED_POINT_PIPELINE
+    //g-h state at the time of the last sample
+    int32_t h_q8;                         //cm * 256
+    int32_t v_q8;                         //cm/s * 256
+    uint16_t fadeG;                       //Q15 steady-state gains from lambda
+    uint16_t fadeH;
+    uint32_t fadeP11;                     //Q30, (1 - lambda)^3 / lambda
+    uint16_t readySamples;                //two forgetting windows
+    uint16_t gainG;                       //Q15 gains of the last update (= P00, P01 * dt)
+    uint16_t gainH;
+    uint32_t gainP11;                     //Q30, P11 * dt^2
+    uint32_t period_ms;                   //dt of the last update
+    int32_t residualVar;                  //EWMA of squared innovations (cm^2)
+    int32_t terminalTc_ms;                //|vt| / g, 0 without a drag model
+#else
+    //RLS state: theta = [altitude, speed] at the time of the last sample
+    float h;
+    float v;
+    float P[2][2];
+    float lambda;
+    float residualVar;                    //EWMA of squared innovations (m^2)
+#endif
+    unsigned long lastTime_ms;
+    uint16_t samples;
+
+    vspeed_t terminalVelocity;
+
+    AltitudePrediction predictions[PREDICTOR_MAX_TARGETS];
+    uint32_t aheadCrossing_ms[PREDICTOR_MAX_TARGETS];   //absolute time predicted ~1 s ahead
+    bool aheadValid[PREDICTOR_MAX_TARGETS];
+    uint8_t targetCount;
+
+    void updateTargets(altitude_t altitude, unsigned long time_ms);
+    void predict(uint8_t index, unsigned long now_ms);
+#ifdef FIXED_POINT_PIPELINE
+    int32_t altitudeAfter(int32_t tau_ms, int32_t& speed) const;
+#else
+    float altitudeAfter(float tau_s, float& speed) const;
+#endif
+};
+
+#endif
@@ -0,0 +1,465 @@
+#include "radio.h"
+#include "alloc_tracking.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#ifdef RADIO_BACKEND_LORA
+#include <SPI.h>
+#include <LoRa.h>
+#endif
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long millis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)(ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
+#endif
+
+
+RadioLink::RadioLink()
+    : backend(nullptr),
+      active(0),
+      nextFragment(0),
+      fragmentCount(0),
+      txSequence(0),
+      rxAssembly(0),
+      rxLength(0),
+      rxReadyLength(0),
+      rxReceivedMask(0),
+      rxSequence(0),
+      rxFragmentCount(0),
+      rxStartTime(0),
+      rxAssembling(false),
+      rxReady(false),
+      rxHaveLastSequence(false),
+      rxLastSequence(0) {
+    tx[0].length = 0;
+    tx[0].full = false;
+    tx[1].length = 0;
+    tx[1].full = false;
+    resetStats();
+}
+
+bool RadioLink::begin(RadioBackend* radioBackend) {
+    backend = radioBackend;
+    if (backend == nullptr || !backend->begin()) {
+        backend = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool RadioLink::send(const uint8_t* frame, uint16_t len) {
+    ALLOC_FREE_SCOPE("RadioLink::send");
+    if (backend == nullptr || len == 0 || len > RADIO_MAX_FRAME) {
+        stats.framesRejected++;
+        return false;
+    }
+
+    //The frame on air finished at the end of the last poll(): move the waiting
+    //one up before it gets replaced
+    if (!tx[active].full && tx[active ^ 1].full) {
+        swapBuffers();
+    }
+
+    //Always write into the waiting buffer, never touch the one on air
+    TxBuffer& pending = tx[active ^ 1];
+    if (pending.full) {
+        stats.framesOverwritten++;
+    }
+
+    memcpy(pending.data, frame, len);
+    pending.length = len;
+    pending.sequence = txSequence++;
+    pending.full = true;
+    stats.framesQueued++;
+
+    //Radio idle: start this frame right away on the next poll()
+    if (!tx[active].full) {
+        swapBuffers();
+    }
+    return true;
+}
+
+void RadioLink::poll(uint8_t maxFragments) {
+    ALLOC_FREE_SCOPE("RadioLink::poll");
+    if (backend == nullptr) {
+        return;
+    }
+
+    //TX side: a few fragments per loop, stop as soon as the radio is busy
+    for (uint8_t i = 0; i < maxFragments; i++) {
+        if (!tx[active].full) {
+            if (!tx[active ^ 1].full) {
+                break;
+            }
+            swapBuffers();
+        }
+        if (!backend->txReady()) {
+            stats.txBusyPolls++;
+            break;
+        }
+        if (!sendNextFragment()) {
+            break;
+        }
+    }
+
+    //RX side: drain everything the backend has buffered
+    uint8_t payload[RADIO_MAX_PAYLOAD];
+    uint8_t len;
+    while ((len = backend->receive(payload, sizeof(payload))) > 0) {
+        handlePayload(payload, len);
+    }
+
+    //Drop a half-assembled frame whose missing fragments never came
+    if (rxAssembling && millis() - rxStartTime > RADIO_REASSEMBLY_TIMEOUT_MS) {
+        rxAssembling = false;
+        stats.framesIncomplete++;
+    }
+}
+
+bool RadioLink::txBusy() const {
+    return tx[0].full || tx[1].full;
+}
+
+bool RadioLink::available() const {
+    return rxReady;
+}
+
+uint16_t RadioLink::read(uint8_t* buffer, uint16_t maxLen) {
+    if (!rxReady || rxReadyLength > maxLen) {
+        return 0;
+    }
+    memcpy(buffer, rxData[rxAssembly ^ 1], rxReadyLength);
+    rxReady = false;
+    return rxReadyLength;
+}
+
+uint8_t RadioLink::lastRxSequence() const {
+    return rxLastSequence;
+}
+
+const RadioStats& RadioLink::getStats() const {
+    return stats;
+}
+
+void RadioLink::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+//Move the waiting frame on air
+void RadioLink::swapBuffers() {
+    active ^= 1;
+    nextFragment = 0;
+    TxBuffer& current = tx[active];
+    fragmentCount = (current.length + RADIO_FRAG_DATA - 1) / RADIO_FRAG_DATA;
+}
+
+bool RadioLink::sendNextFragment() {
+    TxBuffer& current = tx[active];
+
+    uint16_t offset = (uint16_t)nextFragment * RADIO_FRAG_DATA;
+    uint16_t remaining = current.length - offset;
+    uint8_t dataLen = remaining > RADIO_FRAG_DATA ? RADIO_FRAG_DATA : (uint8_t)remaining;
+
+    uint8_t payload[RADIO_MAX_PAYLOAD];
+    payload[0] = current.sequence;
+    payload[1] = nextFragment;
+    payload[2] = fragmentCount;
+    payload[3] = dataLen;
+    memcpy(payload + RADIO_FRAG_HEADER, current.data + offset, dataLen);
+
+    if (!backend->transmit(payload, RADIO_FRAG_HEADER + dataLen)) {
+        return false;  //retry same fragment next poll
+    }
+
+    stats.fragmentsSent++;
+    nextFragment++;
+    if (nextFragment >= fragmentCount) {
+        current.full = false;
+        stats.framesSent++;
+    }
+    return true;
+}
+
+void RadioLink::handlePayload(const uint8_t* payload, uint8_t len) {
+    stats.fragmentsReceived++;
+
+    if (len < RADIO_FRAG_HEADER) {
+        stats.fragmentsMalformed++;
+        return;
+    }
+
+    uint8_t sequence = payload[0];
+    uint8_t index = payload[1];
+    uint8_t count = payload[2];
+    uint8_t dataLen = payload[3];
+
+    if (count == 0 || count > RADIO_MAX_FRAGMENTS || index >= count ||
+        dataLen > RADIO_FRAG_DATA || dataLen > len - RADIO_FRAG_HEADER ||
+        (index < count - 1 && dataLen != RADIO_FRAG_DATA)) {
+        stats.fragmentsMalformed++;
+        return;
+    }
+
+    //Fragment of a different frame: the one in progress will never complete
+    if (rxAssembling && (sequence != rxSequence || count != rxFragmentCount)) {
+        rxAssembling = false;
+        stats.framesIncomplete++;
+    }
+
+    if (!rxAssembling) {
+        rxAssembling = true;
+        rxSequence = sequence;
+        rxFragmentCount = count;
+        rxReceivedMask = 0;
+        rxStartTime = millis();
+    }
+
+    uint16_t offset = (uint16_t)index * RADIO_FRAG_DATA;
+    memcpy(rxData[rxAssembly] + offset, payload + RADIO_FRAG_HEADER, dataLen);
+    rxReceivedMask |= (uint16_t)(1u << index);
+    if (index == count - 1) {
+        rxLength = offset + dataLen;
+    }
+
+    uint16_t completeMask = (count == 16) ? 0xFFFF : (uint16_t)((1u << count) - 1);
+    if (rxReceivedMask == completeMask) {
+        completeFrame();
+    }
+}
+
+void RadioLink::completeFrame() {
+    rxAssembling = false;
+
+    if (rxHaveLastSequence) {
+        uint8_t gap = (uint8_t)(rxSequence - rxLastSequence - 1);
+        if (gap < 128) {  //larger means a duplicate or reordered frame
+            stats.sequenceGaps += gap;
+        }
+    }
+    rxHaveLastSequence = true;
+    rxLastSequence = rxSequence;
+
+    //Unread frame gets replaced, same policy as TX
+    if (rxReady) {
+        stats.framesUnread++;
+    }
+    rxReadyLength = rxLength;
+    rxAssembly ^= 1;
+    rxReady = true;
+    stats.framesReceived++;
+}
+
+
+#ifdef ARDUINO
+
+#ifdef RADIO_BACKEND_NRF24
+NRF24Backend::NRF24Backend(uint8_t cePin, uint8_t csnPin)
+    : nrf24(cePin, csnPin), cePin(cePin), csnPin(csnPin) {
+}
+
+bool NRF24Backend::begin() {
+    Serial.print(F("[RADIO] nRF24 on CE:"));
+    Serial.print(cePin);
+    Serial.print(F(" CSN:"));
+    Serial.print(csnPin);
+    Serial.print(F("... "));
+
+    if (!nrf24.begin()) {
+        Serial.println(F("FAILED!"));
+        return false;
+    }
+
+    nrf24.setChannel(NRF24_CHANNEL);
+    nrf24.setPayloadSize(RADIO_MAX_PAYLOAD);
+    nrf24.setDataRate(RF24_250KBPS);     //best range
+    nrf24.setAutoAck(false);             //telemetry is fire-and-forget, no retry stalls
+    nrf24.openWritingPipe(NRF24_PIPE_ADDRESS);
+    nrf24.stopListening();
+
+    Serial.println(F("OK"));
+    return true;
+}
+
+bool NRF24Backend::txReady() {
+    //TX FIFO holds 3 payloads, accept while there is room
+    return !nrf24.isFifo(true, false);
+}
+
+bool NRF24Backend::transmit(const uint8_t* payload, uint8_t len) {
+    uint8_t padded[RADIO_MAX_PAYLOAD];
+    memset(padded, 0, sizeof(padded));
+    memcpy(padded, payload, len);
+    nrf24.startFastWrite(padded, RADIO_MAX_PAYLOAD, true);
+    return true;
+}
+
+uint8_t NRF24Backend::receive(uint8_t* payload, uint8_t maxLen) {
+    //Downlink not used on the nRF24, the radio stays in TX mode
+    (void)payload;
+    (void)maxLen;
+    return 0;
+}
+#endif
+
+#ifdef RADIO_BACKEND_LORA
+volatile bool LoRaBackend::transmitting = false;
+volatile bool LoRaBackend::listening = false;
+volatile uint8_t LoRaBackend::rxPayload[RADIO_MAX_PAYLOAD];
+volatile uint8_t LoRaBackend::rxLength = 0;
+
+//DIO0 interrupts: the library has read and cleared the IRQ flags before calling these
+void IRAM_ATTR LoRaBackend::onTxDone() {
+    transmitting = false;
+}
+
+//One-payload mailbox, an unread payload is replaced (the link layer counts the gap)
+void IRAM_ATTR LoRaBackend::onReceive(int size) {
+    uint8_t n = 0;
+    while (n < size && n < RADIO_MAX_PAYLOAD && LoRa.available()) {
+        rxPayload[n++] = (uint8_t)LoRa.read();
+    }
+    rxLength = n;
+}
+
+LoRaBackend::LoRaBackend() {
+}
+
+bool LoRaBackend::begin() {
+    Serial.print(F("[RADIO] LoRa @ "));
+    Serial.print((uint32_t)(LORA_FREQUENCY_HZ / 1E6));
+    Serial.print(F(" MHz... "));
+
+    LoRa.setPins(LORA_SS_PIN, LORA_RST_PIN, LORA_DIO0_PIN);
+    if (!LoRa.begin(LORA_FREQUENCY_HZ)) {
+        Serial.println(F("FAILED!"));
+        return false;
+    }
+
+    LoRa.enableCrc();
+    LoRa.onTxDone(onTxDone);
+    LoRa.onReceive(onReceive);
+    LoRa.receive();
+    listening = true;
+    Serial.println(F("OK"));
+    return true;
+}
+
+bool LoRaBackend::txReady() {
+    //Back to continuous RX once the last packet is out
+    if (!transmitting && !listening) {
+        LoRa.receive();
+        listening = true;
+    }
+    return !transmitting;
+}
+
+bool LoRaBackend::transmit(const uint8_t* payload, uint8_t len) {
+    if (!LoRa.beginPacket()) {  //leaves RX mode
+        return false;
+    }
+    listening = false;
+    LoRa.write(payload, len);
+    transmitting = true;   //before endPacket: TX-done can fire right after it
+    LoRa.endPacket(true);  //async, onTxDone() clears the flag
+    return true;
+}
+
+uint8_t LoRaBackend::receive(uint8_t* payload, uint8_t maxLen) {
+    noInterrupts();
+    uint8_t n = rxLength <= maxLen ? rxLength : 0;
+    for (uint8_t i = 0; i < n; i++) {
+        payload[i] = rxPayload[i];
+    }
+    rxLength = 0;
+    interrupts();
+    return n;
+}
+#endif
+
+#else
+
+FdRadioBackend::FdRadioBackend(int rxFd, int txFd)
+    : rxFd(rxFd), txFd(txFd), rxFill(0) {
+}
+
+bool FdRadioBackend::begin() {
+    if (rxFd < 0 || txFd < 0) {
+        return false;
+    }
+    fcntl(rxFd, F_SETFL, fcntl(rxFd, F_GETFL) | O_NONBLOCK);
+    fcntl(txFd, F_SETFL, fcntl(txFd, F_GETFL) | O_NONBLOCK);
+    rxFill = 0;
+    return true;
+}
+
+bool FdRadioBackend::txReady() {
+    struct pollfd pfd;
+    pfd.fd = txFd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT);
+}
+
+bool FdRadioBackend::transmit(const uint8_t* payload, uint8_t len) {
+    uint8_t record[RADIO_MAX_PAYLOAD + 1];
+    if (len > RADIO_MAX_PAYLOAD) {
+        return false;
+    }
+    record[0] = len;
+    memcpy(record + 1, payload, len);
+
+    //Records are smaller than PIPE_BUF, so a pipe write is all-or-nothing
+    ssize_t written = write(txFd, record, len + 1);
+    return written == (ssize_t)(len + 1);
+}
+
+uint8_t FdRadioBackend::receive(uint8_t* payload, uint8_t maxLen) {
+    //Read the length byte first, then exactly the record, never past it
+    if (rxFill == 0) {
+        if (read(rxFd, rxBuffer, 1) != 1) {
+            return 0;
+        }
+        rxFill = 1;
+        if (rxBuffer[0] > RADIO_MAX_PAYLOAD) {
+            rxFill = 0;  //garbage, resync on next byte
+            return 0;
+        }
+    }
+
+    uint8_t want = rxBuffer[0] + 1;
+    while (rxFill < want) {
+        ssize_t n = read(rxFd, rxBuffer + rxFill, want - rxFill);
+        if (n <= 0) {
+            return 0;  //rest of the record arrives later
+        }
+        rxFill += (uint8_t)n;
+    }
+
+    uint8_t len = rxBuffer[0];
+    rxFill = 0;
+    if (len > maxLen) {
+        return 0;
+    }
+    memcpy(payload, rxBuffer + 1, len);
+    return len;
+}
+
+bool FdRadioBackend::openLoopback(int& rxFd, int& txFd) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    rxFd = fds[0];
+    txFd = fds[1];
+    return true;
+}
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef RADIO_H
+#define RADIO_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+#include "config.h"
+
+//Radio link layer between the mission code and the physical transceiver.
+//Nothing here ever waits for TX-done: send() only copies the frame into a buffer
+//and poll() (called every loop) pushes at most a few fragments into the radio FIFO.
+
+#define RADIO_MAX_PAYLOAD     32    //nRF24 hardware payload (LoRa backend uses the same size)
+#define RADIO_FRAG_HEADER     4     //seq, index, count, length (nRF24 pads the rest)
+#define RADIO_FRAG_DATA       (RADIO_MAX_PAYLOAD - RADIO_FRAG_HEADER)
+#define RADIO_MAX_FRAGMENTS   16
+#define RADIO_MAX_FRAME       (RADIO_FRAG_DATA * RADIO_MAX_FRAGMENTS)  //448 bytes
+#define RADIO_REASSEMBLY_TIMEOUT_MS 500
+
+
+/**
+ Physical transceiver. Implementations MUST be non-blocking:
+ - txReady() says if the radio can accept another payload right now
+ - transmit() starts sending one payload and returns immediately
+ - receive() returns 0 if nothing is waiting
+ */
+class RadioBackend {
+public:
+    virtual ~RadioBackend() {}
+    virtual bool begin() = 0;
+    virtual bool txReady() = 0;
+    virtual bool transmit(const uint8_t* payload, uint8_t len) = 0;
+    virtual uint8_t receive(uint8_t* payload, uint8_t maxLen) = 0;
+};
+
+
+//Counters for telemetry / ground debugging
+struct RadioStats {
+    uint32_t framesQueued;          //accepted by send()
+    uint32_t framesSent;            //all fragments handed to the backend
+    uint32_t framesOverwritten;     //pending frame replaced before it went out
+    uint32_t framesRejected;        //too large or link not started
+    uint32_t fragmentsSent;
+    uint32_t txBusyPolls;           //poll() found the backend busy
+
+    uint32_t framesReceived;        //fully reassembled
+    uint32_t framesUnread;          //replaced by a newer frame before read()
+    uint32_t fragmentsReceived;
+    uint32_t fragmentsMalformed;    //bad header
+    uint32_t framesIncomplete;      //dropped while reassembling (timeout or new seq)
+    uint32_t sequenceGaps;          //frames missing between two received frames
+};
+
+
+/**
+ Responsibilities:
+ - Double-buffered TX: one frame is being fragmented out while the next one waits
+ - Fragmentation of frames larger than the 32-byte payload, reassembly on receive
+ - Per-frame sequence numbers and link statistics
+ */
+class RadioLink {
+public:
+    RadioLink();
+
+    bool begin(RadioBackend* backend);
+
+    /**
+     Queue a frame for transmission (copied, caller buffer can be reused)
+     If a frame is already waiting behind the one on air, it is replaced:
+     for telemetry the newest sample is always the one worth sending
+     return false if frame is too large or link not started
+     */
+    bool send(const uint8_t* frame, uint16_t len);
+
+    /**
+     Service the link, call once per loop()
+     Sends up to maxFragments fragments and drains all received payloads
+     */
+    void poll(uint8_t maxFragments = 3);
+
+    //True while a frame is on air or waiting
+    bool txBusy() const;
+
+    //True if a reassembled frame is ready to be read
+    bool available() const;
+
+    /**
+     Copy the received frame out and release the RX buffer
+     return frame length (0 if nothing available or buffer too small)
+     */
+    uint16_t read(uint8_t* buffer, uint16_t maxLen);
+
+    //Sequence number of the last frame returned by read()
+    uint8_t lastRxSequence() const;
+
+    const RadioStats& getStats() const;
+    void resetStats();
+
+private:
+    struct TxBuffer {
+        uint8_t data[RADIO_MAX_FRAME];
+        uint16_t length;
+        uint8_t sequence;
+        bool full;
+    };
+
+    RadioBackend* backend;
+
+    //Double buffer: tx[active] is on air, tx[active ^ 1] is waiting
+    TxBuffer tx[2];
+    uint8_t active;
+    uint8_t nextFragment;
+    uint8_t fragmentCount;
+    uint8_t txSequence;
+
+    //Reassembly into rxData[rxAssembly], the completed frame waits in the other
+    //buffer so fragments of the next frame never overwrite it before read()
+    uint8_t rxData[2][RADIO_MAX_FRAME];
+    uint8_t rxAssembly;
+    uint16_t rxLength;
+    uint16_t rxReadyLength;
+    uint16_t rxReceivedMask;
+    uint8_t rxSequence;
+    uint8_t rxFragmentCount;
+    unsigned long rxStartTime;
+    bool rxAssembling;
+    bool rxReady;
+    bool rxHaveLastSequence;
+    uint8_t rxLastSequence;
+
+    RadioStats stats;
+
+    bool sendNextFragment();
+    void handlePayload(const uint8_t* payload, uint8_t len);
+    void completeFrame();
+    void swapBuffers();
+};
+
+
+#ifdef ARDUINO
+
+#ifdef RADIO_BACKEND_NRF24
+#include <SPI.h>
+#include <RF24.h>
+
+//nRF24L01+ through the RF24 library, uses startFastWrite (no wait for ACK)
+class NRF24Backend : public RadioBackend {
+public:
+    NRF24Backend(uint8_t cePin, uint8_t csnPin);
+    bool begin() override;
+    bool txReady() override;
+    bool transmit(const uint8_t* payload, uint8_t len) override;
+    uint8_t receive(uint8_t* payload, uint8_t maxLen) override;
+private:
+    RF24 nrf24;
+    uint8_t cePin;
+    uint8_t csnPin;
+};
+#endif
+
+#ifdef RADIO_BACKEND_LORA
+//SX127x through the LoRa library: async endPacket() and continuous receive,
+//both completed from the DIO0 interrupt (onTxDone / onReceive callbacks)
+class LoRaBackend : public RadioBackend {
+public:
+    LoRaBackend();
+    bool begin() override;
+    bool txReady() override;
+    bool transmit(const uint8_t* payload, uint8_t len) override;
+    uint8_t receive(uint8_t* payload, uint8_t maxLen) override;
+private:
+    //Touched by the DIO0 callbacks, which take no context pointer
+    static volatile bool transmitting;
+    static volatile bool listening;
+    static volatile uint8_t rxPayload[RADIO_MAX_PAYLOAD];
+    static volatile uint8_t rxLength;
+    static void onTxDone();
+    static void onReceive(int size);
+};
+#endif
+
+#else
+
+/**
+ Linux backend over file descriptors, for host tests and throughput runs
+ Each payload is written as [len][bytes] so it works over a pipe (loopback)
+ or a pty (talking to the ground-station tools)
+ */
+class FdRadioBackend : public RadioBackend {
+public:
+    FdRadioBackend(int rxFd, int txFd);
+    bool begin() override;
+    bool txReady() override;
+    bool transmit(const uint8_t* payload, uint8_t len) override;
+    uint8_t receive(uint8_t* payload, uint8_t maxLen) override;
+
+    //Create a pipe: a backend on (rxFd, txFd) receives what it sends
+    static bool openLoopback(int& rxFd, int& txFd);
+private:
+    int rxFd;
+    int txFd;
+    uint8_t rxBuffer[RADIO_MAX_PAYLOAD + 1];
+    uint8_t rxFill;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,155 @@
+#include "resampler.h"
+
+#include <string.h>
+
+//a before b on the wrapping micros() clock
+static inline bool timeBefore(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+SampleStream::SampleStream() {
+    reset();
+}
+
+void SampleStream::reset() {
+    memset(time_us, 0, sizeof(time_us));
+    memset(value, 0, sizeof(value));
+    head = 0;
+    count = 0;
+}
+
+bool SampleStream::push(uint32_t t_us, float v) {
+    if (count > 0 && !timeBefore(getNewestTime(), t_us)) {
+        return false;
+    }
+    time_us[head] = t_us;
+    value[head] = v;
+    head = (head + 1) & (RESAMPLE_HISTORY - 1);
+    if (count < RESAMPLE_HISTORY) {
+        count++;
+    }
+    return true;
+}
+
+bool SampleStream::valueAt(uint32_t t_us, ResampleMode mode, uint32_t maxGap_us,
+                           float& v, uint32_t& age_us) const {
+    //Newest to oldest: grid points are close to the present
+    uint8_t after = 0;
+    bool haveAfter = false;
+    for (uint8_t n = 0; n < count; n++) {
+        uint8_t i = (head - 1 - n) & (RESAMPLE_HISTORY - 1);
+        if (timeBefore(t_us, time_us[i])) {
+            after = i;
+            haveAfter = true;
+            continue;
+        }
+        //time_us[i] <= t
+        uint32_t gap = haveAfter ? time_us[after] - time_us[i] : 0;
+        if (mode == ResampleMode::INTERPOLATE && haveAfter && gap <= maxGap_us) {
+            float f = (float)(t_us - time_us[i]) / (float)gap;
+            v = value[i] + f * (value[after] - value[i]);
+            age_us = 0;
+        } else {
+            v = value[i];
+            age_us = t_us - time_us[i];
+        }
+        return true;
+    }
+    return false;
+}
+
+uint8_t SampleStream::getCount() const {
+    return count;
+}
+
+uint32_t SampleStream::getNewestTime() const {
+    return time_us[(head - 1) & (RESAMPLE_HISTORY - 1)];
+}
+
+
+Resampler::Resampler()
+    : streamCount(0),
+      period_us(1000),
+      latency_us(0),
+      started(false),
+      gridTime_us(0),
+      skipped(0) {
+}
+
+void Resampler::begin(uint32_t period, uint32_t latency) {
+    period_us = period > 0 ? period : 1;
+    latency_us = latency;
+    started = false;
+    gridTime_us = 0;
+    skipped = 0;
+    for (uint8_t i = 0; i < streamCount; i++) {
+        streams[i].reset();
+    }
+}
+
+int8_t Resampler::addStream(ResampleMode mode, uint32_t maxGap_us, uint32_t staleAfter_us) {
+    if (streamCount >= RESAMPLE_MAX_STREAMS) {
+        return -1;
+    }
+    config[streamCount].mode = mode;
+    config[streamCount].maxGap_us = maxGap_us;
+    config[streamCount].staleAfter_us = staleAfter_us;
+    streams[streamCount].reset();
+    return (int8_t)streamCount++;
+}
+
+bool Resampler::push(uint8_t stream, uint32_t time_us, float value) {
+    if (stream >= streamCount || !streams[stream].push(time_us, value)) {
+        return false;
+    }
+    if (!started) {
+        started = true;
+        gridTime_us = time_us + period_us;
+    }
+    return true;
+}
+
+bool Resampler::next(uint32_t now_us, ResampledFrame& frame) {
+    if (!started || timeBefore(now_us - latency_us, gridTime_us)) {
+        return false;
+    }
+
+    //Too far behind: drop the oldest grid points instead of bursting through them
+    uint32_t behind = (now_us - latency_us - gridTime_us) / period_us;
+    if (behind > RESAMPLE_MAX_BACKLOG) {
+        uint32_t drop = behind - RESAMPLE_MAX_BACKLOG;
+        gridTime_us += drop * period_us;
+        skipped += drop;
+    }
+
+    frame.time_us = gridTime_us;
+    frame.validMask = 0;
+    frame.staleMask = 0;
+    for (uint8_t i = 0; i < RESAMPLE_MAX_STREAMS; i++) {
+        frame.value[i] = 0.0f;
+        frame.age_us[i] = 0;
+        if (i >= streamCount ||
+            !streams[i].valueAt(gridTime_us, config[i].mode, config[i].maxGap_us,
+                                frame.value[i], frame.age_us[i])) {
+            continue;
+        }
+        frame.validMask |= (uint8_t)(1 << i);
+        if (frame.age_us[i] > config[i].staleAfter_us) {
+            frame.staleMask |= (uint8_t)(1 << i);
+        }
+    }
+    gridTime_us += period_us;
+    return true;
+}
+
+const SampleStream& Resampler::getStream(uint8_t stream) const {
+    return streams[stream < RESAMPLE_MAX_STREAMS ? stream : 0];
+}
+
+uint8_t Resampler::getStreamCount() const {
+    return streamCount;
+}
+
+uint32_t Resampler::getSkipped() const {
+    return skipped;
+}
@@ -0,0 +1,118 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+
+#define RESAMPLE_HISTORY       16      //samples kept per stream (power of two)
+#define RESAMPLE_MAX_STREAMS   8
+#define RESAMPLE_MAX_BACKLOG   8       //grid points emitted late before the grid skips ahead
+
+//How a stream is carried between its samples
+enum class ResampleMode : uint8_t {
+    INTERPOLATE,    //linear between the samples around the grid point (continuous signals)
+    HOLD            //last sample at or before the grid point (counters, flags, GPS fixes)
+};
+
+
+/**
+ History of one sensor stream: the last RESAMPLE_HISTORY (time, value) pairs
+ Times are micros() of the acquisition (the *_time_us fields of SensorData).
+ All comparisons are wrap-safe, so the 71 min micros() rollover is harmless as
+ long as the history spans less than half of it.
+ */
+class SampleStream {
+public:
+    SampleStream();
+    void reset();
+
+    //New sample, dropped (false) if not newer than the last one (telemetry repeats old samples)
+    bool push(uint32_t time_us, float value);
+
+    /**
+     Value at time t_us
+     INTERPOLATE: linear between the samples on either side, if they are no more
+     than maxGap_us apart. Otherwise (t after the newest sample, or across a gap)
+     the last sample before t is held.
+     age_us: t - time of the sample the value came from, 0 when interpolated.
+     false if there is no sample at or before t.
+     */
+    bool valueAt(uint32_t t_us, ResampleMode mode, uint32_t maxGap_us,
+                 float& value, uint32_t& age_us) const;
+
+    uint8_t getCount() const;
+    uint32_t getNewestTime() const;
+
+private:
+    uint32_t time_us[RESAMPLE_HISTORY];
+    float value[RESAMPLE_HISTORY];
+    uint8_t head;                 //next write position
+    uint8_t count;
+};
+
+
+//One grid point: every stream at the same instant
+struct ResampledFrame {
+    uint32_t time_us;             //grid time (micros() clock of the samples)
+    float value[RESAMPLE_MAX_STREAMS];
+    uint32_t age_us[RESAMPLE_MAX_STREAMS];    //staleness: 0 if interpolated, else time since the held sample
+    uint8_t validMask;            //bit i: stream i had a sample at or before the grid point
+    uint8_t staleMask;            //bit i: age_us[i] above the stream's stale limit
+};
+
+
+/**
+ Streaming resampler onto a fixed time grid
+ Responsibilities:
+ - Streams are added once (addStream) with their mode, the longest sample
+   gap that is still interpolated, and the age after which the value is stale.
+ - Grid point T is emitted once the clock reaches T + latency_us, so every
+   stream with a sample period below the latency has the sample after T and
+   is interpolated. A stream that is late or dead is held and reported
+   through age_us / staleMask instead of delaying the output: latency is bounded.
+ - After a stall the missed grid points come out one per next() call, at most
+   RESAMPLE_MAX_BACKLOG of them; older ones are skipped (getSkipped).
+ */
+class Resampler {
+public:
+    Resampler();
+
+    //Grid period and output delay; forgets all samples (streams are kept)
+    void begin(uint32_t period_us, uint32_t latency_us);
+
+    //Index of the new stream, or -1 if RESAMPLE_MAX_STREAMS are in use
+    int8_t addStream(ResampleMode mode, uint32_t maxGap_us, uint32_t staleAfter_us);
+
+    bool push(uint8_t stream, uint32_t time_us, float value);
+
+    /**
+     Next grid point that is due at now_us (call in a loop until false)
+     The first grid point is the first sample time of any stream plus one period.
+     */
+    bool next(uint32_t now_us, ResampledFrame& frame);
+
+    const SampleStream& getStream(uint8_t stream) const;
+    uint8_t getStreamCount() const;
+    uint32_t getSkipped() const;
+
+private:
+    struct StreamConfig {
+        ResampleMode mode;
+        uint32_t maxGap_us;
+        uint32_t staleAfter_us;
+    };
+
+    SampleStream streams[RESAMPLE_MAX_STREAMS];
+    StreamConfig config[RESAMPLE_MAX_STREAMS];
+    uint8_t streamCount;
+    uint32_t period_us;
+    uint32_t latency_us;
+    bool started;                 //gridTime_us is set
+    uint32_t gridTime_us;         //next grid point to emit
+    uint32_t skipped;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "sampling_profiles.h"
+
+typedef TargetHal::BMP280 Baro;
+
+//BMP280 numbers from the datasheet (max measurement time, table 13 and
+//IIR step response, table 6: filter 2/4/8/16 -> 2/5/11/22 samples to 75%)
+//
+//  pad       P x16 T x2  IIR 2   standby 500 ms  ~543 ms period   ~1.1 s lag
+//  climb     P x8  T x1  IIR 4   standby 62.5 ms ~85 ms period    ~0.43 s lag
+//  descent   P x4  T x1  IIR 2   standby 0.5 ms  ~14 ms period    ~28 ms lag
+//
+//The pad profile keeps the old low rate and x16 oversampling but only a
+//2-tap IIR: with 16 taps (~11.9 s) liftoff was declared ~24 m up. The
+//ground baseline estimator does the averaging on the pad (ground_baseline.h).
+//BOOT runs the climb profile so the baseline estimator gets its first
+//window of samples in ~3 s instead of ~17 s.
+//embedded/tools/altitude_lag replays the periods and lags on the host model.
+
+static const SamplingProfile PAD_PROFILE = {
+    "PAD",
+    Baro::SAMPLING_X2, Baro::SAMPLING_X16,
+    Baro::FILTER_X2, Baro::STANDBY_MS_500,
+    MPU6050_BAND_21_HZ, 99,               //10 Hz
+    543, 1086
+};
+
+static const SamplingProfile CLIMB_PROFILE = {
+    "CLIMB",
+    Baro::SAMPLING_X1, Baro::SAMPLING_X8,
+    Baro::FILTER_X4, Baro::STANDBY_MS_63,
+    MPU6050_BAND_44_HZ, 19,               //50 Hz
+    85, 425
+};
+
+static const SamplingProfile DESCENT_PROFILE = {
+    "DESCENT",
+    Baro::SAMPLING_X1, Baro::SAMPLING_X4,
+    Baro::FILTER_X2, Baro::STANDBY_MS_1,
+    MPU6050_BAND_94_HZ, 4,                //200 Hz
+    14, 28
+};
+
+//Load shedding only lowers the IMU rate: the barometer is what the FSM and
+//the predictor decide on, a slower or longer filter would delay every
+//transition by its lag. Same BMP280 settings as the full profile.
+static const SamplingProfile CLIMB_REDUCED_PROFILE = {
+    "CLIMB_REDUCED",
+    Baro::SAMPLING_X1, Baro::SAMPLING_X8,
+    Baro::FILTER_X4, Baro::STANDBY_MS_63,
+    MPU6050_BAND_10_HZ, 49,               //20 Hz
+    85, 425
+};
+
+static const SamplingProfile DESCENT_REDUCED_PROFILE = {
+    "DESCENT_REDUCED",
+    Baro::SAMPLING_X1, Baro::SAMPLING_X4,
+    Baro::FILTER_X2, Baro::STANDBY_MS_1,
+    MPU6050_BAND_44_HZ, 19,               //50 Hz
+    14, 28
+};
+
+//Indexed by MissionState
+static const SamplingProfile* const PROFILE_TABLE[] = {
+    &CLIMB_PROFILE,      //BOOT (fast baseline convergence)
+    &PAD_PROFILE,        //IDLE
+    &CLIMB_PROFILE,      //ASCENT
+    &DESCENT_PROFILE,    //DESCENT_FREE
+    &DESCENT_PROFILE,    //DESCENT_STABLE
+    &DESCENT_PROFILE,    //LANDING
+    &PAD_PROFILE,        //FINAL_REPORT
+    &PAD_PROFILE         //SAFE_MODE
+};
+
+const SamplingProfile& getSamplingProfile(MissionState state) {
+    uint8_t index = static_cast<uint8_t>(state);
+    if (index >= sizeof(PROFILE_TABLE) / sizeof(PROFILE_TABLE[0])) {
+        return PAD_PROFILE;
+    }
+    return *PROFILE_TABLE[index];
+}
+
+const SamplingProfile& getReducedSamplingProfile(MissionState state) {
+    const SamplingProfile& full = getSamplingProfile(state);
+    if (&full == &DESCENT_PROFILE) {
+        return DESCENT_REDUCED_PROFILE;     //200 -> 50 Hz IMU
+    }
+    if (&full == &CLIMB_PROFILE) {
+        return CLIMB_REDUCED_PROFILE;       //50 -> 20 Hz IMU
+    }
+    return full;                            //pad: 10 Hz IMU already
+}
@@ -0,0 +1,33 @@
+#ifndef SAMPLING_PROFILES_H
+#define SAMPLING_PROFILES_H
+
+#include "hal.h"
+#include "fsm.h"
+
+//Sensor sampling settings for one mission phase, in the vocabulary of TargetHal
+struct SamplingProfile {
+    const char* name;
+
+    //BMP280
+    TargetHal::BMP280::sensor_sampling tempSampling;
+    TargetHal::BMP280::sensor_sampling pressSampling;
+    TargetHal::BMP280::sensor_filter filter;
+    TargetHal::BMP280::standby_duration standby;
+
+    //MPU6050
+    TargetHal::MPU6050Bandwidth mpuBandwidth;
+    uint8_t mpuRateDivisor;               //ODR = 1 kHz / (1 + divisor)
+
+    //Expected BMP280 behaviour, for logs and sanity checks
+    uint16_t baroPeriod_ms;               //measurement time + standby
+    uint16_t baroLag_ms;                  //IIR time to 75% of a step
+};
+
+//Profile for a mission state (falls back to the IDLE profile for unknown states)
+const SamplingProfile& getSamplingProfile(MissionState state);
+
+//Load shedding: the same barometer settings at a lower IMU rate, the
+//baro period and lag never grow (PAD has no slower variant)
+const SamplingProfile& getReducedSamplingProfile(MissionState state);
+
+#endif
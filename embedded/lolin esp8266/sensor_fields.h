@@ -0,0 +1,123 @@
+#ifndef SENSOR_FIELDS_H
+#define SENSOR_FIELDS_H
+
+//Single source of truth for the SensorData layout.
+//sensors.h builds the struct from this list, telemetry_packet.h builds the radio
+//payload from it and the ground-station decoder builds its columns from it,
+//so adding a field here updates all three at once.
+//
+//Plain C header on purpose (no Arduino.h): it is also compiled on the ground,
+//config.h only holds #defines.
+//X(type, name)
+
+#include "config.h"
+
+//Unit-dependent groups: float SI units, or scaled integers with FIXED_POINT_PIPELINE
+//(see fixed_point.h). Field names carry the unit, so the ground side can tell them apart.
+#ifdef FIXED_POINT_PIPELINE
+
+#define SENSOR_BARO_FIELDS(X)                                                          \
+    X(int32_t,  pressure_cPa)       /*Atmospheric pressure in centipascal*/            \
+    X(int16_t,  temperature_cC)     /*Ambient temperature in 0.01 Celsius*/            \
+    X(int32_t,  altitude_MSL_cm)    /*Altitude Mean Sea Level (raw) in cm*/            \
+    X(int32_t,  altitude_AGL_cm)    /*Altitude Above Ground Level in cm*/
+
+#define SENSOR_IMU_FIELDS(X)                                                           \
+    X(int16_t,  pitch_cdeg)         /*Pitch angle in 0.01 degrees*/                    \
+    X(int16_t,  roll_cdeg)          /*Roll angle in 0.01 degrees*/                     \
+    X(int16_t,  accel_x_mg)         /*X-axis acceleration in milli-g*/                 \
+    X(int16_t,  accel_y_mg)         /*Y-axis acceleration in milli-g*/                 \
+    X(int16_t,  accel_z_mg)         /*Z-axis acceleration in milli-g*/
+
+#define SENSOR_GPS_FIELDS(X)                                                           \
+    X(int32_t,  latitude_e7)        /*Latitude in 1e-7 degrees*/                       \
+    X(int32_t,  longitude_e7)       /*Longitude in 1e-7 degrees*/                      \
+    X(int32_t,  gps_altitude_cm)    /*GPS altitude in cm*/                             \
+    X(uint16_t, gps_speed_cmps)     /*Ground speed in cm/s*/
+
+#define SENSOR_LANDING_FIELDS(X)                                                       \
+    X(int16_t,  wind_east_cmps)     /*Horizontal drift east in cm/s*/                  \
+    X(int16_t,  wind_north_cmps)    /*Horizontal drift north in cm/s*/                 \
+    X(int32_t,  landing_lat_e7)     /*Predicted touchdown latitude in 1e-7 degrees*/   \
+    X(int32_t,  landing_lon_e7)     /*Predicted touchdown longitude in 1e-7 degrees*/
+
+#define SENSOR_VIB_FIELDS(X)                                                           \
+    X(uint16_t, swing_freq_cHz)     /*Dominant pendulum swing frequency in 0.01 Hz*/   \
+    X(uint16_t, swing_rms_cdps)     /*Swing band rotation rate RMS in 0.01 deg/s*/     \
+    X(uint16_t, vib_freq_cHz)       /*Dominant vibration frequency above 5 Hz, 0.01 Hz*/
+
+#define SENSOR_POWER_FIELDS(X)                                                         \
+    X(uint16_t, battery_mV)         /*Battery voltage in millivolts*/
+
+#else
+
+#define SENSOR_BARO_FIELDS(X)                                                          \
+    X(float,    pressure_hPa)       /*Atmospheric pressure in hPa*/                    \
+    X(float,    temperature_C)      /*Ambient temperature in Celsius*/                 \
+    X(float,    altitude_MSL)       /*Altitude Mean Sea Level (raw)*/                  \
+    X(float,    altitude_AGL)       /*Altitude Above Ground Level (calibrated!)*/
+
+#define SENSOR_IMU_FIELDS(X)                                                           \
+    X(float,    pitch_deg)          /*Pitch angle in degrees*/                         \
+    X(float,    roll_deg)           /*Roll angle in degrees*/                          \
+    X(float,    accel_x_g)          /*X-axis acceleration in g*/                       \
+    X(float,    accel_y_g)          /*Y-axis acceleration in g*/                       \
+    X(float,    accel_z_g)          /*Z-axis acceleration in g*/
+
+#define SENSOR_GPS_FIELDS(X)                                                           \
+    X(double,   latitude)           /*Latitude in decimal degrees*/                    \
+    X(double,   longitude)          /*Longitude in decimal degrees*/                   \
+    X(float,    gps_altitude_m)     /*GPS altitude in meters*/                         \
+    X(float,    gps_speed_mps)      /*Ground speed in m/s*/
+
+#define SENSOR_LANDING_FIELDS(X)                                                       \
+    X(float,    wind_east_mps)      /*Horizontal drift east in m/s*/                   \
+    X(float,    wind_north_mps)     /*Horizontal drift north in m/s*/                  \
+    X(double,   landing_lat)        /*Predicted touchdown latitude*/                   \
+    X(double,   landing_lon)        /*Predicted touchdown longitude*/
+
+#define SENSOR_VIB_FIELDS(X)                                                           \
+    X(float,    swing_freq_hz)      /*Dominant pendulum swing frequency*/              \
+    X(float,    swing_rms_dps)      /*Horizontal rotation rate RMS in the swing band*/ \
+    X(float,    vib_freq_hz)        /*Dominant vibration frequency above 5 Hz*/
+
+#define SENSOR_POWER_FIELDS(X)                                                         \
+    X(float,    battery_voltage)    /*Battery voltage in volts*/
+
+#endif
+
+#define SENSOR_DATA_FIELDS(X)                                                          \
+    /*TIMESTAMP*/                                                                      \
+    X(uint32_t, timestamp_ms)       /*From RTC or millis()*/                           \
+    X(uint32_t, gps_time)           /*GPS UTC time (if available)*/                    \
+    /*ACQUISITION TIMES (micros(), one clock: skew = difference, see resampler.h)*/    \
+    X(uint32_t, timestamp_us)       /*micros() at the start of readAll*/               \
+    X(uint32_t, bmp_time_us)        /*When the BMP280 sample completed*/               \
+    X(uint32_t, imu_time_us)        /*When the MPU6050 sample completed*/              \
+    X(uint32_t, gps_fix_time_us)    /*When the current GPS position arrived*/          \
+    /*BAROMETRIC SENSOR (BMP280)*/                                                     \
+    SENSOR_BARO_FIELDS(X)                                                              \
+    X(bool,     bmp_valid)          /*True if BMP280 reading successful*/              \
+    /*INERTIAL MEASUREMENT UNIT (MPU6050)*/                                            \
+    SENSOR_IMU_FIELDS(X)                                                               \
+    X(bool,     imu_valid)          /*True if MPU6050 reading successful*/             \
+    /*VIBRATION (FFT of the MPU6050 in DESCENT_STABLE, 0 otherwise)*/                  \
+    SENSOR_VIB_FIELDS(X)                                                               \
+    X(uint16_t, vib_low_mg)         /*|accel| RMS 0.3-5 Hz in milli-g*/                \
+    X(uint16_t, vib_mid_mg)         /*|accel| RMS 5-20 Hz in milli-g*/                 \
+    X(uint16_t, vib_high_mg)        /*|accel| RMS 20-100 Hz in milli-g*/               \
+    /*GPS (NEO-6M)*/                                                                   \
+    SENSOR_GPS_FIELDS(X)                                                               \
+    X(uint8_t,  satellites)         /*Number of satellites in view*/                   \
+    X(bool,     gps_fix)            /*True if GPS has valid 3D fix*/                   \
+    /*LANDING PREDICTION (GPS drift track, DESCENT_FREE..LANDING)*/                    \
+    SENSOR_LANDING_FIELDS(X)                                                           \
+    X(uint16_t, landing_eta_ds)     /*Predicted time to touchdown in 0.1 s*/           \
+    X(bool,     landing_valid)      /*True if the landing fields hold a prediction*/   \
+    /*MISSION STATE*/                                                                  \
+    SENSOR_POWER_FIELDS(X)                                                             \
+    X(uint8_t,  mission_state_id)   /*Current FSM state ID*/                           \
+    /*ERROR FLAGS*/                                                                    \
+    X(uint8_t,  error_flags)        /*Bitfield of sensor errors*/
+
+#endif
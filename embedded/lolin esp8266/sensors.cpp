@@ -0,0 +1,757 @@
+#include "sensors.h"
+#include "config.h"
+#include "cycle_profile.h"
+#include "alloc_tracking.h"
+
+//Fixed-width rows so the whole table stays in flash; print with FPSTR()
+static const char SENSOR_NAMES[SENSOR_COUNT][8] PROGMEM = { "BMP280", "MPU6050", "GPS", "RTC" };
+
+SensorManager::SensorManager()
+    : profile(&getSamplingProfile(MissionState::BOOT)),
+      profileState(MissionState::BOOT),
+      shedMask(0),
+      asyncBmp(false),
+      lastRtcRequest(0),
+      groundPressure_hPa(1013.25),
+      groundAltitude_MSL(0.0),
+#ifdef FIXED_POINT_PIPELINE
+      groundAltitude_cm(0),
+#endif
+      calibrated(false),
+      groundRestored(false),
+      bmp280_initialized(false),
+      mpu6050_initialized(false),
+      gps_initialized(false),
+      rtc_initialized(false),
+      lastHealthCheck(0),
+      lastRtcCheck(0),
+      gpsWindowStart(0),
+      gpsErrorsAtWindow(0),
+#ifdef FIXED_POINT_PIPELINE
+      pressureFilter(3, 300),
+#else
+      pressureFilter(3.0, 0.03),
+#endif
+      vibrationEnabled(false),
+      nextVibSample_us(0),
+      landingEnabled(false),
+      lastLandingFix_us(0) {
+    memset(health, 0, sizeof(health));
+}
+
+uint32_t SensorManager::beginClock() {
+    Wire.begin();
+    rtc_initialized = rtc.begin();
+    if (!rtc_initialized || rtc.lostPowerAtBegin()) {
+        return 0;
+    }
+    return rtc.getUnixTime();
+}
+
+bool SensorManager::begin() {
+    return beginDrivers(false, MissionState::BOOT);
+}
+
+bool SensorManager::beginWarm(float pressure_hPa, float altitude_MSL, MissionState state) {
+    groundPressure_hPa = pressure_hPa;
+    groundAltitude_MSL = altitude_MSL;
+#ifdef FIXED_POINT_PIPELINE
+    groundAltitude_cm = fixedPressureToAltitude((int32_t)(pressure_hPa * 10000.0));
+#endif
+    calibrated = true;
+    groundRestored = true;
+    baseline.restore(pressure_hPa, altitude_MSL);
+    return beginDrivers(true, state);
+}
+
+bool SensorManager::beginDrivers(bool warm, MissionState state) {
+    Serial.println(warm ? F("[SENSORS] Warm restart, re-initializing sensors...")
+                        : F("[SENSORS] Initializing sensors..."));
+    Wire.begin();
+
+    bmp280_initialized = bmp280.begin();
+    mpu6050_initialized = mpu6050.begin(MPU6050_ADDRESS);
+#ifdef GPS_USE_UBX
+    gps_initialized = warm ? gps.resumeUBX(GPS_UBX_BAUD)
+                           : gps.beginUBX(GPS_UBX_BAUD, GPS_UBX_MEAS_RATE_MS);
+#else
+    gps_initialized = gps.begin();
+#endif
+    if (!rtc_initialized) {
+        rtc_initialized = rtc.begin();      //not started by beginClock()
+    }
+
+    //Drivers are configured, from here the bus manager owns Wire at 400 kHz
+    bus.begin(I2C_BUS_CLOCK_HZ);
+    asyncBmp = bmp280_initialized && bmp280.attachBus(&bus);
+    mpu6050.attachBus(&bus);
+    rtc.attachBus(&bus);
+
+    //Warm: the resumed state's profile, BOOT would thaw the restored baseline
+    applyProfile(state);
+
+#ifdef FAULT_INJECTION
+    faultInjector.begin(FAULT_BENCHMARK_SCRIPT, FAULT_BENCHMARK_STEPS, FAULT_INJECTION_SEED);
+#endif
+
+    //Barometer is the only sensor the FSM cannot fly without
+    return bmp280_initialized;
+}
+
+bool SensorManager::readAll(SensorData& data) {
+    PROFILE_SCOPE(PROFILE_READ_ALL);
+    ALLOC_FREE_SCOPE("SensorManager::readAll");
+    data.timestamp_ms = millis();
+    data.timestamp_us = micros();
+    data.error_flags = 0;
+
+    bool bmpOk = readBMP280(data);
+    bool imuOk = readMPU6050(data);
+    readVibration(data);
+    readGPS(data);
+    readLanding(data);
+    readRTC(data);
+
+#ifdef FIXED_POINT_PIPELINE
+    data.battery_mV = readBatteryMillivolts();
+    if (data.battery_mV < LOW_BATTERY_MV) {
+        data.error_flags |= ERROR_LOW_BATTERY;
+    }
+#else
+    data.battery_voltage = readBatteryVoltage();
+    if (data.battery_voltage < LOW_BATTERY_THRESHOLD) {
+        data.error_flags |= ERROR_LOW_BATTERY;
+    }
+#endif
+
+    return bmpOk || imuOk;
+}
+
+void SensorManager::poll() {
+    ALLOC_FREE_SCOPE("SensorManager::poll");
+    //Re-arm as soon as the previous sample completed, the bus coalesces and paces them
+    if (asyncBmp) {
+        bmp280.requestSample();
+    }
+    if (mpu6050_initialized) {
+        mpu6050.requestSample();
+    }
+    if (rtc_initialized && millis() - lastRtcRequest >= 1000) {
+        if (rtc.requestTime()) {
+            lastRtcRequest = millis();
+        }
+    }
+    bus.poll();
+    if (vibrationEnabled) {
+        sampleVibration();
+    }
+
+    unsigned long now = millis();
+#ifdef FAULT_INJECTION
+    faultInjector.update(now);
+#endif
+    if (now - lastHealthCheck >= HEALTH_CHECK_INTERVAL_MS) {
+        lastHealthCheck = now;
+        checkHealth(now);
+    }
+}
+
+const I2CBus& SensorManager::getBus() const {
+    return bus;
+}
+
+const SensorHealth& SensorManager::getHealth(SensorId sensor) const {
+    return health[sensor];
+}
+
+const VibrationAnalyzer& SensorManager::getVibration() const {
+    return vibration;
+}
+
+const LandingPredictor& SensorManager::getLandingPredictor() const {
+    return landing;
+}
+
+float SensorManager::getGroundPressure() const {
+    return groundPressure_hPa;
+}
+
+float SensorManager::getGroundAltitude() const {
+    return groundAltitude_MSL;
+}
+
+bool SensorManager::isCalibrated() const {
+    return calibrated;
+}
+
+const GroundBaseline& SensorManager::getGroundBaseline() const {
+    return baseline;
+}
+
+void SensorManager::printStatus() const {
+    Serial.println(F("[SENSORS] Status:"));
+    Serial.print(F("  BMP280:  ")); Serial.println(bmp280_initialized ? F("OK") : F("FAIL"));
+    Serial.print(F("  MPU6050: ")); Serial.println(mpu6050_initialized ? F("OK") : F("FAIL"));
+    Serial.print(F("  GPS:     ")); Serial.println(gps_initialized ? F("OK") : F("FAIL"));
+    Serial.print(F("  RTC:     ")); Serial.println(rtc_initialized ? F("OK") : F("FAIL"));
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (health[i].faults == 0) {
+            continue;
+        }
+        Serial.print(F("  "));
+        Serial.print(FPSTR(SENSOR_NAMES[i]));
+        Serial.print(health[i].faulted ? F(" FAULT ") : F(" recovered "));
+        Serial.print(FPSTR(getFaultClassName(health[i].cause)));
+        Serial.print(F(" (faults "));
+        Serial.print(health[i].faults);
+        Serial.print(F(", recoveries "));
+        Serial.print(health[i].recoveries);
+        Serial.println(F(")"));
+    }
+    Serial.print(F("  Profile: ")); Serial.println(profile->name);
+    Serial.print(F("  Baro outliers: ")); Serial.println(pressureFilter.getOutlierCount());
+    if (vibration.getReport().valid) {
+        const VibrationReport& vib = vibration.getReport();
+        Serial.print(F("  Swing:   "));
+        Serial.print(vib.swingFreq_hz, 2);
+        Serial.print(F(" Hz, "));
+        Serial.print(vib.swingRms_dps, 1);
+        Serial.print(F(" deg/s, vibration "));
+        Serial.print(vib.vibFreq_hz, 1);
+        Serial.print(F(" Hz, FFT "));
+        Serial.print(vib.cycles);
+        Serial.println(F(" cycles"));
+    }
+    if (landing.getEstimate().valid) {
+        const LandingEstimate& est = landing.getEstimate();
+        Serial.print(F("  Landing: "));
+        Serial.print(est.landingLat_e7 * 1e-7, 6);
+        Serial.print(F(", "));
+        Serial.print(est.landingLon_e7 * 1e-7, 6);
+        Serial.print(F(" in "));
+        Serial.print(est.timeToLanding_s, 1);
+        Serial.print(F(" s, wind "));
+        Serial.print(est.windEast_mps, 1);
+        Serial.print(F(" E "));
+        Serial.print(est.windNorth_mps, 1);
+        Serial.println(F(" N m/s"));
+    }
+    Serial.print(F("  Ground:  "));
+    if (calibrated) {
+        Serial.print(groundPressure_hPa, 2);
+        Serial.print(F(" hPa"));
+        Serial.println(baseline.isFrozen() ? F(" (frozen)") : F(" (tracking)"));
+    } else {
+        Serial.print(F("converging, "));
+        Serial.print(baseline.getCount());
+        Serial.println(F(" samples"));
+    }
+#ifdef ESP8266
+    //Free heap should stay flat across a flight: everything else is static
+    Serial.print(F("  Heap:    "));
+    Serial.print(ESP.getFreeHeap());
+    Serial.print(F(" B free, largest block "));
+    Serial.print(ESP.getMaxFreeBlockSize());
+    Serial.print(F(" B, "));
+    Serial.print(ESP.getHeapFragmentation());
+    Serial.println(F("% fragmented"));
+#endif
+#ifdef CYCLE_PROFILE
+    cycleProfiler.print();
+#endif
+}
+
+void SensorManager::applyProfile(MissionState state) {
+    profileState = state;
+    const SamplingProfile& next = isShed(SHED_SENSOR_RATE) ? getReducedSamplingProfile(state)
+                                                           : getSamplingProfile(state);
+
+    //Baseline only follows the ground while we are on it (and measured it since boot)
+    if ((state == MissionState::BOOT || state == MissionState::IDLE) && !groundRestored) {
+        baseline.thaw();
+    } else {
+        baseline.freeze();
+    }
+
+    //Spectrum only where the camera needs it, the 200 Hz ODR is set by the same profile
+    bool analyse = state == MissionState::DESCENT_STABLE && !isShed(SHED_VIBRATION);
+    if (analyse != vibrationEnabled) {
+        vibration.reset();
+        nextVibSample_us = micros();
+    }
+    vibrationEnabled = analyse;
+
+    //Drift track from the release on; the last prediction stays for FINAL_REPORT
+    bool track = state == MissionState::DESCENT_FREE || state == MissionState::DESCENT_STABLE ||
+                 state == MissionState::LANDING;
+    if (track && !landingEnabled) {
+        landing.reset();
+    } else if (!track && state != MissionState::FINAL_REPORT) {
+        landing.reset();
+    }
+    landingEnabled = track;
+
+    bmp280.setSampling(next.tempSampling, next.pressSampling, next.filter, next.standby);
+    mpu6050.setSampling(next.mpuBandwidth, next.mpuRateDivisor);
+
+    if (&next != profile) {
+        Serial.print(F("[SENSORS] Sampling profile: "));
+        Serial.print(next.name);
+        Serial.print(F(" (baro "));
+        Serial.print(next.baroPeriod_ms);
+        Serial.print(F(" ms period, ~"));
+        Serial.print(next.baroLag_ms);
+        Serial.println(F(" ms lag)"));
+    }
+    profile = &next;
+}
+
+const SamplingProfile& SensorManager::getProfile() const {
+    return *profile;
+}
+
+void SensorManager::setShedMask(uint16_t mask) {
+    uint16_t profileBits = (1u << SHED_SENSOR_RATE) | (1u << SHED_VIBRATION);
+    bool reapply = (mask ^ shedMask) & profileBits;
+    shedMask = mask;
+    if (reapply) {
+        applyProfile(profileState);
+    }
+}
+
+bool SensorManager::isShed(ShedTask task) const {
+    return (shedMask & (1u << task)) != 0;
+}
+
+bool SensorManager::readBMP280(SensorData& data) {
+    if (!bmp280_initialized || health[SENSOR_BMP280].faulted) {
+        data.bmp_valid = false;
+        data.error_flags |= ERROR_BMP280_FAIL;
+        return false;
+    }
+
+#ifdef FIXED_POINT_PIPELINE
+    int32_t pressure_cPa;
+    int16_t temperature_cC;
+    unsigned long sample_us;
+    if (asyncBmp && bmp280.getSampleFixed(pressure_cPa, temperature_cC, sample_us)) {
+        data.temperature_cC = temperature_cC;
+    } else if (asyncBmp) {
+        return data.bmp_valid;
+    } else {
+        //Blocking fallback (trim not loaded), float only here
+        pressure_cPa = (int32_t)(bmp280.readPressure() * 100.0f);
+        data.temperature_cC = (int16_t)(bmp280.readTemperature() * 100.0f);
+        sample_us = micros();
+    }
+    data.bmp_time_us = sample_us;
+
+    data.pressure_cPa = pressureFilter.update(pressure_cPa);
+    data.altitude_MSL_cm = fixedPressureToAltitude(data.pressure_cPa);
+    if (!baseline.isFrozen()) {
+        //On the pad only: the estimator works in hPa
+        updateGroundBaseline(data.pressure_cPa / 10000.0f);
+    }
+    data.altitude_AGL_cm = data.altitude_MSL_cm - groundAltitude_cm;
+    data.bmp_valid = true;
+    recordAltitude(data);
+    return true;
+#else
+    float pressure_Pa, temperature_C;
+    unsigned long sample_us;
+    if (asyncBmp && bmp280.getSample(pressure_Pa, temperature_C, sample_us)) {
+        data.temperature_C = temperature_C;
+    } else if (asyncBmp) {
+        //No new burst since last readAll, keep the previous values in data
+        return data.bmp_valid;
+    } else {
+        pressure_Pa = bmp280.readPressure();
+        data.temperature_C = bmp280.readTemperature();
+        sample_us = micros();
+    }
+    data.bmp_time_us = sample_us;
+
+    //A single spike must not trip an FSM altitude threshold
+    data.pressure_hPa = pressureFilter.update(pressure_Pa / 100.0);
+    data.altitude_MSL = GroundBaseline::pressureToAltitude(data.pressure_hPa);
+    updateGroundBaseline(data.pressure_hPa);
+    data.altitude_AGL = data.altitude_MSL - groundAltitude_MSL;
+    data.bmp_valid = true;
+    recordAltitude(data);
+    return true;
+#endif
+}
+
+bool SensorManager::readMPU6050(SensorData& data) {
+    unsigned long sample_us;
+    if (!mpu6050_initialized || health[SENSOR_MPU6050].faulted) {
+        data.imu_valid = false;
+        data.error_flags |= ERROR_MPU6050_FAIL;
+        return false;
+    }
+#ifdef FIXED_POINT_PIPELINE
+    int16_t accel[3], gyro[3];
+    if (!mpu6050.getSampleRaw(accel, gyro, sample_us)) {
+        return data.imu_valid;
+    }
+    data.imu_time_us = sample_us;
+
+    //Median on the raw registers, then 4096 LSB/g -> mg (x 1000 / 4096 = x 125 / 512)
+    data.accel_x_mg = (int16_t)(((int32_t)accelFilter[0].update(accel[0]) * 125) >> 9);
+    data.accel_y_mg = (int16_t)(((int32_t)accelFilter[1].update(accel[1]) * 125) >> 9);
+    data.accel_z_mg = (int16_t)(((int32_t)accelFilter[2].update(accel[2]) * 125) >> 9);
+    if (!isShed(SHED_ATTITUDE)) {
+        calculateOrientation(data.accel_x_mg, data.accel_y_mg, data.accel_z_mg,
+                             data.pitch_cdeg, data.roll_cdeg);
+    }
+    data.imu_valid = true;
+    return true;
+#else
+    float ax, ay, az, gx, gy, gz;
+    if (!mpu6050.getSample(ax, ay, az, gx, gy, gz, sample_us)) {
+        //No new burst since last readAll, keep the previous values in data
+        return data.imu_valid;
+    }
+    data.imu_time_us = sample_us;
+
+    //Driver gives m/s^2, telemetry is in g
+    //Median of 3 per axis: removes single-sample vibration spikes, one sample of delay
+    const float G = 9.80665;
+    data.accel_x_g = accelFilter[0].update(ax) / G;
+    data.accel_y_g = accelFilter[1].update(ay) / G;
+    data.accel_z_g = accelFilter[2].update(az) / G;
+    if (!isShed(SHED_ATTITUDE)) {
+        calculateOrientation(data.accel_x_g, data.accel_y_g, data.accel_z_g,
+                             data.pitch_deg, data.roll_deg);
+    }
+    data.imu_valid = true;
+    return true;
+#endif
+}
+
+void SensorManager::readVibration(SensorData& data) {
+    const VibrationReport& vib = vibration.getReport();
+#ifdef FIXED_POINT_PIPELINE
+    data.swing_freq_cHz = vib.swingFreq_cHz;
+    data.swing_rms_cdps = vib.swingRms_cdps;
+    data.vib_freq_cHz = vib.vibFreq_cHz;
+#else
+    data.swing_freq_hz = vib.swingFreq_hz;
+    data.swing_rms_dps = vib.swingRms_dps;
+    data.vib_freq_hz = vib.vibFreq_hz;
+#endif
+    data.vib_low_mg = vib.bandLow_mg;
+    data.vib_mid_mg = vib.bandMid_mg;
+    data.vib_high_mg = vib.bandHigh_mg;
+}
+
+//Wind is kept while hovering, landing_valid marks the touchdown fields
+void SensorManager::readLanding(SensorData& data) {
+    const LandingEstimate& est = landing.getEstimate();
+#ifdef FIXED_POINT_PIPELINE
+    data.wind_east_cmps = est.windEast_cmps;
+    data.wind_north_cmps = est.windNorth_cmps;
+    data.landing_lat_e7 = est.landingLat_e7;
+    data.landing_lon_e7 = est.landingLon_e7;
+#else
+    data.wind_east_mps = est.windEast_mps;
+    data.wind_north_mps = est.windNorth_mps;
+    data.landing_lat = est.landingLat_e7 * 1e-7;
+    data.landing_lon = est.landingLon_e7 * 1e-7;
+#endif
+    data.landing_eta_ds = est.timeToLanding_ds;
+    data.landing_valid = est.valid;
+}
+
+/**
+ Take the latest MPU6050 registers on a fixed VIB_SAMPLE_PERIOD_US grid.
+ poll() runs far more often than the ODR, so the jitter is one loop iteration;
+ a stall longer than a few periods restarts the block instead of stretching it.
+ */
+void SensorManager::sampleVibration() {
+    unsigned long now_us = micros();
+    if ((long)(now_us - nextVibSample_us) < 0) {
+        return;
+    }
+    if (now_us - nextVibSample_us > 4 * VIB_SAMPLE_PERIOD_US ||
+        health[SENSOR_MPU6050].faulted) {
+        vibration.discardBlock();
+        nextVibSample_us = now_us + VIB_SAMPLE_PERIOD_US;
+        return;
+    }
+    nextVibSample_us += VIB_SAMPLE_PERIOD_US;
+
+    int16_t accel[3], gyro[3];
+    if (mpu6050.getLatestRaw(accel, gyro) && vibration.addSample(accel, gyro)) {
+        vibration.process(millis());
+    }
+}
+
+bool SensorManager::readGPS(SensorData& data) {
+    if (!gps_initialized) {
+        data.gps_fix = false;
+        data.error_flags |= ERROR_GPS_NO_FIX;
+        return false;
+    }
+
+    gps.update();
+
+    uint8_t hour, minute, second;
+    gps.getTime(hour, minute, second);
+    data.gps_time = (uint32_t)hour * 10000UL + minute * 100UL + second;   //hhmmss
+
+    data.gps_fix = gps.hasFix();
+#ifdef FIXED_POINT_PIPELINE
+    data.latitude_e7 = gps.getLatitudeE7();
+    data.longitude_e7 = gps.getLongitudeE7();
+    data.gps_altitude_cm = gps.getAltitudeCm();
+    data.gps_speed_cmps = gps.getSpeedCmps();
+#else
+    data.latitude = gps.getLatitude();
+    data.longitude = gps.getLongitude();
+    data.gps_altitude_m = gps.getAltitude();
+    data.gps_speed_mps = gps.getSpeed();
+#endif
+    data.satellites = gps.getSatellites();
+    data.gps_fix_time_us = gps.getFixTime_us();
+
+    if (!data.gps_fix) {
+        data.error_flags |= ERROR_GPS_NO_FIX;
+    } else if (landingEnabled && !isShed(SHED_LANDING)) {
+        //Once per fix, keyed on its arrival time (a key derived from millis()
+        //could shift by 1 ms between readAll calls and add the fix twice)
+        if (data.gps_fix_time_us != lastLandingFix_us) {
+            lastLandingFix_us = data.gps_fix_time_us;
+            unsigned long fix_ms = millis() - gps.getFixAge();
+#ifdef FIXED_POINT_PIPELINE
+            float altitude_m = data.altitude_AGL_cm * 0.01f;
+#else
+            float altitude_m = data.altitude_AGL;
+#endif
+            //Altitude at the fix time; the current one if the fix is older than the history
+            float fixAltitude_m;
+            uint32_t age_us;
+            if (altitudeHistory.valueAt(data.gps_fix_time_us, ResampleMode::INTERPOLATE,
+                                        ALTITUDE_MAX_GAP_US, fixAltitude_m, age_us)) {
+                altitude_m = fixAltitude_m;
+            }
+            landing.addFix(gps.getLatitudeE7(), gps.getLongitudeE7(), altitude_m, fix_ms);
+        }
+    }
+    if (health[SENSOR_GPS].faulted && health[SENSOR_GPS].cause == FaultClass::GPS_DROPOUT) {
+        data.error_flags |= ERROR_SENSOR_TIMEOUT;
+    }
+    return data.gps_fix;
+}
+
+void SensorManager::recordAltitude(const SensorData& data) {
+#ifdef FIXED_POINT_PIPELINE
+    altitudeHistory.push(data.bmp_time_us, data.altitude_AGL_cm * 0.01f);
+#else
+    altitudeHistory.push(data.bmp_time_us, data.altitude_AGL);
+#endif
+}
+
+bool SensorManager::readRTC(SensorData& data) {
+    if (!rtc_initialized || rtc.getLatestLostPower()) {
+        data.error_flags |= ERROR_RTC_FAIL;
+        return false;
+    }
+    return true;
+}
+
+//One new barometer sample: feed the estimator and take its reference once converged
+void SensorManager::updateGroundBaseline(float pressure_hPa) {
+    if (!baseline.addSample(pressure_hPa, millis()) || !baseline.isReady()) {
+        return;
+    }
+    groundPressure_hPa = baseline.getPressure();
+    groundAltitude_MSL = baseline.getAltitude();
+#ifdef FIXED_POINT_PIPELINE
+    groundAltitude_cm = fixedPressureToAltitude((int32_t)(groundPressure_hPa * 10000.0));
+#endif
+    calibrated = true;
+}
+
+float SensorManager::readBatteryVoltage() {
+    //LOLIN A0 has an on-board divider: 0-1023 maps to 0-3.2 V
+    int raw = analogRead(BATTERY_PIN);
+    return (raw / 1023.0) * (BATTERY_ADC_FULL_SCALE_MV / 1000.0) * BATTERY_DIVIDER_RATIO;
+}
+
+uint16_t SensorManager::readBatteryMillivolts() {
+    //Same divider as readBatteryVoltage, 1023 = BATTERY_FULL_SCALE_MV
+    uint32_t raw = analogRead(BATTERY_PIN);
+    return (uint16_t)(raw * BATTERY_FULL_SCALE_MV / 1023UL);
+}
+
+void SensorManager::calculateOrientation(float ax, float ay, float az,
+                                         float& pitch, float& roll) {
+    //Tilt from gravity only, valid while the payload is not accelerating hard
+    pitch = atan2(-ax, sqrt(ay * ay + az * az)) * 180.0 / PI;
+    roll = atan2(ay, az) * 180.0 / PI;
+}
+
+void SensorManager::calculateOrientation(int16_t ax_mg, int16_t ay_mg, int16_t az_mg,
+                                         int16_t& pitch_cdeg, int16_t& roll_cdeg) {
+    //Same as the float version, +-8 g keeps ay^2 + az^2 below 2^32
+    uint32_t yz = (uint32_t)((int32_t)ay_mg * ay_mg) + (uint32_t)((int32_t)az_mg * az_mg);
+    pitch_cdeg = fixedAtan2(-(int32_t)ax_mg, fixedSqrt(yz));
+    roll_cdeg = fixedAtan2(ay_mg, az_mg);
+}
+
+/**
+ Fault detection and recovery, runs from poll()
+ - I2C sensors: NAK bursts (failed reads in a row) and stuck data (successful
+   reads returning identical raw registers for longer than the sensor's output
+   period allows, gaps in polling do not count), re-init every
+   RECOVERY_INTERVAL_MS once the address ACKs again
+ - GPS: dropout (no bytes) and garbage (checksum failures), UBX mode is
+   reconfigured since a receiver reset comes back at 9600 baud NMEA
+ - RTC: oscillator stop flag, time restored from GPS or the compile time
+ */
+void SensorManager::checkHealth(unsigned long now) {
+    if (asyncBmp) {
+        unsigned long stuck_ms = STUCK_MIN_MS + 4UL * profile->baroPeriod_ms;
+        checkI2CSensor(SENSOR_BMP280, bmp280.getConsecutiveFailures(), bmp280.getLastChangeTime(),
+                       bmp280.getUnchangedTime() > stuck_ms, now);
+    }
+    if (mpu6050_initialized) {
+        checkI2CSensor(SENSOR_MPU6050, mpu6050.getConsecutiveFailures(), mpu6050.getLastChangeTime(),
+                       mpu6050.getUnchangedTime() > STUCK_MIN_MS, now);
+    }
+    if (gps_initialized) {
+        checkGPS(now);
+    }
+    if (rtc_initialized && now - lastRtcCheck >= RTC_CHECK_INTERVAL_MS) {
+        lastRtcCheck = now;
+        checkRTC(now);
+    }
+}
+
+void SensorManager::checkI2CSensor(SensorId sensor, uint8_t failures, unsigned long lastChange,
+                                   bool stuck, unsigned long now) {
+    SensorHealth& h = health[sensor];
+    if (!h.faulted) {
+        if (failures >= I2C_FAIL_THRESHOLD) {
+            markFault(sensor, FaultClass::I2C_NAK, now);
+        } else if (stuck) {
+            markFault(sensor, FaultClass::STUCK_VALUE, now);
+        }
+        return;
+    }
+
+    //Healthy again once bursts succeed and the data moved after the fault was seen
+    if (failures == 0 && (long)(lastChange - h.faultSince_ms) > 0) {
+        markRecovered(sensor, now);
+        return;
+    }
+    if (now - h.lastRecoveryAttempt_ms >= RECOVERY_INTERVAL_MS) {
+        h.lastRecoveryAttempt_ms = now;
+        reinitI2CSensor(sensor);
+    }
+}
+
+bool SensorManager::reinitI2CSensor(SensorId sensor) {
+    if (sensor == SENSOR_BMP280) {
+        if (!bus.probe(bmp280.getAddress())) {
+            return false;
+        }
+        //begin() re-applies the stored sampling settings, trim is reloaded
+        return bmp280.begin(bmp280.getAddress()) && bmp280.attachBus(&bus);
+    }
+    if (sensor == SENSOR_MPU6050) {
+        if (!bus.probe(mpu6050.getAddress())) {
+            return false;
+        }
+        return mpu6050.begin(mpu6050.getAddress());
+    }
+    return false;
+}
+
+void SensorManager::checkGPS(unsigned long now) {
+    SensorHealth& h = health[SENSOR_GPS];
+    bool silent = now - gps.getLastByteTime() > GPS_DROPOUT_MS;
+
+    if (now - gpsWindowStart >= GPS_ERROR_WINDOW_MS) {
+        uint32_t errors = gps.getChecksumErrors();
+        uint32_t newErrors = errors - gpsErrorsAtWindow;
+        gpsErrorsAtWindow = errors;
+        gpsWindowStart = now;
+
+        if (!h.faulted && newErrors >= GPS_GARBAGE_ERRORS) {
+            markFault(SENSOR_GPS, FaultClass::GPS_GARBAGE, now);
+        } else if (h.faulted && h.cause == FaultClass::GPS_GARBAGE && newErrors == 0 && !silent) {
+            markRecovered(SENSOR_GPS, now);
+        }
+    }
+
+    if (!h.faulted && silent) {
+        markFault(SENSOR_GPS, FaultClass::GPS_DROPOUT, now);
+    } else if (h.faulted && h.cause == FaultClass::GPS_DROPOUT && !silent) {
+        markRecovered(SENSOR_GPS, now);
+    }
+
+#ifdef GPS_USE_UBX
+    //Persistent garbage in UBX mode = receiver rebooted to 9600 baud NMEA
+    if (h.faulted && h.cause == FaultClass::GPS_GARBAGE &&
+        now - h.lastRecoveryAttempt_ms >= GPS_REINIT_MS) {
+        h.lastRecoveryAttempt_ms = now;
+        gps.beginUBX(GPS_UBX_BAUD, GPS_UBX_MEAS_RATE_MS);
+    }
+#endif
+}
+
+void SensorManager::checkRTC(unsigned long now) {
+    SensorHealth& h = health[SENSOR_RTC];
+    bool lost = rtc.getLatestLostPower();
+    if (!h.faulted) {
+        if (lost) {
+            markFault(SENSOR_RTC, FaultClass::RTC_POWER_LOSS, now);
+        }
+        return;
+    }
+    if (!lost) {
+        markRecovered(SENSOR_RTC, now);
+        return;
+    }
+
+    //Prefer GPS UTC, fall back to the compile time like begin() does
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+    gps.getDate(day, month, year);
+    gps.getTime(hour, minute, second);
+    if (gps.hasFix() && year >= 2024) {
+        rtc.setTime(year, month, day, hour, minute, second);
+    } else if (now - h.faultSince_ms >= RTC_RESTORE_TIMEOUT_MS) {
+        rtc.setTimeFromCompile();
+    }
+}
+
+void SensorManager::markFault(SensorId sensor, FaultClass cause, unsigned long now) {
+    SensorHealth& h = health[sensor];
+    h.faulted = true;
+    h.cause = cause;
+    h.faultSince_ms = now;
+    h.lastRecoveryAttempt_ms = now;
+    h.faults++;
+
+    Serial.print(F("[SENSORS] "));
+    Serial.print(FPSTR(SENSOR_NAMES[sensor]));
+    Serial.print(F(" fault: "));
+    Serial.println(FPSTR(getFaultClassName(cause)));
+    FAULT_DETECTED(cause);
+}
+
+void SensorManager::markRecovered(SensorId sensor, unsigned long now) {
+    SensorHealth& h = health[sensor];
+    h.faulted = false;
+    h.recoveries++;
+
+    Serial.print(F("[SENSORS] "));
+    Serial.print(FPSTR(SENSOR_NAMES[sensor]));
+    Serial.print(F(" recovered after "));
+    Serial.print(now - h.faultSince_ms);
+    Serial.println(F(" ms"));
+    FAULT_RECOVERED(h.cause);
+}
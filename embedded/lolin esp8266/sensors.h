@@ -1,101 +1,246 @@
-#ifndef SENSORS_H
-#define SENSORS_H
-
-#include <Arduino.h>
-
-
-struct SensorData {
-    //TIMESTAMP 
-    uint32_t timestamp_ms;          //From RTC or millis()
-    uint32_t gps_time;              //GPS UTC time (if available)
-    
-    //BAROMETRIC SENSOR (BMP280)
-    float pressure_hPa;             //Atmospheric pressure in hPa
-    float temperature_C;            //Ambient temperature in Celsius
-    float altitude_MSL;             //Altitude Mean Sea Level (raw)
-    float altitude_AGL;             //Altitude Above Ground Level (calibrated!)
-    bool bmp_valid;                 //True if BMP280 reading successful
-    
-    //INERTIAL MEASUREMENT UNIT (MPU6050)
-    float pitch_deg;                //Pitch angle in degrees
-    float roll_deg;                 //Roll angle in degrees
-    float accel_x_g;                //X-axis acceleration in g
-    float accel_y_g;                //Y-axis acceleration in g
-    float accel_z_g;                //Z-axis acceleration in g
-    bool imu_valid;                 //True if MPU6050 reading successful
-    
-    //GPS (NEO-6M)
-    double latitude;                //Latitude in decimal degrees
-    double longitude;               //Longitude in decimal degrees
-    float gps_altitude_m;           //GPS altitude in meters
-    float gps_speed_mps;            //Ground speed in m/s
-    uint8_t satellites;             //Number of satellites in view
-    bool gps_fix;                   //True if GPS has valid 3D fix
-    
-    //MISSION STATE
-    float battery_voltage;          //Battery voltage in volts
-    uint8_t mission_state_id;       //Current FSM state ID
-    
-    //ERROR FLAGS
-    uint8_t error_flags;            //Bitfield of sensor errors
-};
-
-//Error flag bits
-#define ERROR_BMP280_FAIL    (1 << 0)
-#define ERROR_MPU6050_FAIL   (1 << 1)
-#define ERROR_GPS_NO_FIX     (1 << 2)
-#define ERROR_RTC_FAIL       (1 << 3)
-#define ERROR_LOW_BATTERY    (1 << 4)
-#define ERROR_SENSOR_TIMEOUT (1 << 5)
-
-
-//SensorManager, manages all sensor hardware and provides unified interface
-class SensorManager {
-public:
-    SensorManager();
-    
-    //Initialize all sensors, return true if critical sensors initialized successfully
-    bool begin();
-    
-    //Perform ground calibration (altitude "tare"), num_samples is number of readings to average (20), return true if calibration successful
-    bool calibrateGround(uint8_t num_samples = 20);
-    
-    /**
-     Read all sensors and populate SensorData struct
-     return true if at least one critical sensor read successfully
-     */
-    bool readAll(SensorData& data);
-    
-    float getGroundPressure() const;
-    float getGroundAltitude() const;
-    bool isCalibrated() const;
-    void printStatus() const;
-
-private:
-    //Ground calibration values
-    float groundPressure_hPa;
-    float groundAltitude_MSL;
-    bool calibrated;
-    
-    //Sensor health tracking
-    bool bmp280_initialized;
-    bool mpu6050_initialized;
-    bool gps_initialized;
-    bool rtc_initialized;
-    
-    //Battery monitoring
-    const uint8_t BATTERY_PIN = 34;
-    const float BATTERY_DIVIDER_RATIO = 2.0;
-    const float LOW_BATTERY_THRESHOLD = 3.3;
-    
-    //Private methods
-    bool readBMP280(SensorData& data);
-    bool readMPU6050(SensorData& data);
-    bool readGPS(SensorData& data);
-    bool readRTC(SensorData& data);
-    float readBatteryVoltage();
-    void calculateOrientation(float ax, float ay, float az, 
-                             float& pitch, float& roll);
-};
-
-#endif
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "sensor_fields.h"
+#include "fsm.h"
+#include "sampling_profiles.h"
+#include "ground_baseline.h"
+#include "filters.h"
+#include "fixed_point.h"
+#include "vibration.h"
+#include "landing_predictor.h"
+#include "resampler.h"
+#include "load_shedding.h"
+#include "i2c_bus.h"
+#include "fault_injection.h"
+#include "sensors/bmp280.h"
+#include "sensors/mpu6050.h"
+#include "sensors/gps.h"
+#include "sensors/rtc_drivers.h"
+
+
+//Field list lives in sensor_fields.h (shared with telemetry and the ground decoder)
+struct SensorData {
+#define SENSOR_FIELD_DECLARE(type, name) type name;
+    SENSOR_DATA_FIELDS(SENSOR_FIELD_DECLARE)
+#undef SENSOR_FIELD_DECLARE
+};
+
+//Error flag bits
+#define ERROR_BMP280_FAIL    (1 << 0)
+#define ERROR_MPU6050_FAIL   (1 << 1)
+#define ERROR_GPS_NO_FIX     (1 << 2)
+#define ERROR_RTC_FAIL       (1 << 3)
+#define ERROR_LOW_BATTERY    (1 << 4)
+#define ERROR_SENSOR_TIMEOUT (1 << 5)
+
+//Sensors with health tracking
+enum SensorId : uint8_t {
+    SENSOR_BMP280,
+    SENSOR_MPU6050,
+    SENSOR_GPS,
+    SENSOR_RTC,
+    SENSOR_COUNT
+};
+
+//Fault state of one sensor, detected in poll() and cleared once data is live again
+struct SensorHealth {
+    bool faulted;
+    FaultClass cause;
+    unsigned long faultSince_ms;
+    unsigned long lastRecoveryAttempt_ms;
+    uint16_t faults;
+    uint16_t recoveries;
+};
+
+
+//SensorManager, manages all sensor hardware and provides unified interface
+class SensorManager {
+public:
+    SensorManager();
+    
+    /**
+     DS3231 only, ahead of the checkpoint load (CheckpointStore::begin):
+     return its unix time, 0 if there is no RTC or its oscillator had
+     stopped (time since the last checkpoint unknown). begin() and
+     beginWarm() keep the RTC as started here.
+     */
+    uint32_t beginClock();
+
+    //Initialize all sensors, return true if critical sensors initialized successfully
+    bool begin();
+
+    /**
+     Warm restart (mission checkpoint found): same drivers, but the ground
+     calibration comes from the checkpoint instead of the baseline estimator,
+     which would take the current altitude as ground. No blocking GPS reconfiguration.
+     state is the resumed FSM state: its sampling profile is applied directly.
+     The restored baseline stays frozen, also when resumed in IDLE (the reset
+     may have hit the pad wait with the drone already lifting).
+     */
+    bool beginWarm(float groundPressure_hPa, float groundAltitude_MSL, MissionState state);
+    
+    /**
+     Read all sensors and populate SensorData struct
+     return true if at least one critical sensor read successfully
+     */
+    bool readAll(SensorData& data);
+
+    /**
+     Service the shared I2C bus, call every loop() (much more often than readAll)
+     Keeps one BMP280 and one MPU6050 burst in flight and the RTC once per second;
+     readAll() then uses the latest completed samples instead of blocking reads
+     */
+    void poll();
+
+    const I2CBus& getBus() const;
+    const SensorHealth& getHealth(SensorId sensor) const;
+
+    /**
+     IMU spectrum, fed from poll() at VIB_SAMPLE_RATE_HZ while the profile is
+     DESCENT_STABLE; isStableForCapture() gates the camera (see FSM::setPlatformStable)
+     */
+    const VibrationAnalyzer& getVibration() const;
+
+    /**
+     Wind drift and touchdown point from the GPS track, fed once per new fix
+     from DESCENT_FREE to LANDING (frame origin = first fix after release)
+     and held through FINAL_REPORT for the recovery team
+     */
+    const LandingPredictor& getLandingPredictor() const;
+    
+    /**
+     Ground reference (altitude "tare"), estimated in the background by
+     readAll() during BOOT/IDLE and frozen on liftoff (see GroundBaseline).
+     isCalibrated() becomes true once the baseline has converged.
+     */
+    float getGroundPressure() const;
+    float getGroundAltitude() const;
+    bool isCalibrated() const;
+    const GroundBaseline& getGroundBaseline() const;
+    void printStatus() const;
+
+    //Switch BMP280/MPU6050 sampling to the profile of this mission state (call on every transition)
+    void applyProfile(MissionState state);
+    const SamplingProfile& getProfile() const;
+
+    /**
+     Work given up under load (LoadShedder::getShedMask, bit per ShedTask):
+     vibration analysis, attitude, landing fixes and the IMU rate
+     (reduced profile). Shed values keep their last reading in SensorData.
+     */
+    void setShedMask(uint16_t mask);
+
+private:
+    //Hardware drivers
+    I2CBus bus;
+    BMP280_Driver bmp280;
+    MPU6050_Driver mpu6050;
+    GPS_Driver gps;
+    RTC_Driver rtc;
+    const SamplingProfile* profile;
+    MissionState profileState;      //state of the last applyProfile
+    uint16_t shedMask;
+    bool isShed(ShedTask task) const;
+    bool asyncBmp;                  //BMP280 trim loaded, async reads available
+    unsigned long lastRtcRequest;
+
+    //Ground calibration values
+    GroundBaseline baseline;
+    float groundPressure_hPa;
+    float groundAltitude_MSL;
+#ifdef FIXED_POINT_PIPELINE
+    int32_t groundAltitude_cm;      //same table as altitude_MSL_cm, so AGL is exactly 0 on the pad
+#endif
+    bool calibrated;
+    bool groundRestored;            //beginWarm: the checkpoint baseline is never thawed
+    void updateGroundBaseline(float pressure_hPa);
+    
+    //Sensor health tracking
+    bool bmp280_initialized;
+    bool mpu6050_initialized;
+    bool gps_initialized;
+    bool rtc_initialized;
+
+    //Fault detection / recovery (checkHealth)
+    SensorHealth health[SENSOR_COUNT];
+    unsigned long lastHealthCheck;
+    unsigned long lastRtcCheck;
+    unsigned long gpsWindowStart;
+    uint32_t gpsErrorsAtWindow;
+    const uint8_t I2C_FAIL_THRESHOLD = 3;              //failed bursts in a row
+    const unsigned long HEALTH_CHECK_INTERVAL_MS = 20;
+    const unsigned long RECOVERY_INTERVAL_MS = 500;    //between re-init attempts
+    const unsigned long STUCK_MIN_MS = 300;            //+4 baro periods for the BMP280
+    const unsigned long GPS_DROPOUT_MS = 2500;         //NMEA arrives in 1 Hz bursts
+    const unsigned long GPS_ERROR_WINDOW_MS = 1000;
+    const uint8_t GPS_GARBAGE_ERRORS = 3;              //checksum failures per window
+    const unsigned long GPS_REINIT_MS = 10000;         //UBX reconfiguration blocks ~350 ms
+    const unsigned long RTC_CHECK_INTERVAL_MS = 1000;
+    const unsigned long RTC_RESTORE_TIMEOUT_MS = 5000; //wait for GPS time, then compile time
+
+    //Outlier rejection before values reach the FSM
+#ifdef FIXED_POINT_PIPELINE
+    HampelFilter<int32_t, 7> pressureFilter;  //k = 3, sigma floor 300 cPa (~0.25 m)
+    MedianFilter<int16_t, 3> accelFilter[3];  //raw registers
+#else
+    HampelFilter<float, 7> pressureFilter;    //k = 3, sigma floor 0.03 hPa (~0.25 m)
+    MedianFilter<float, 3> accelFilter[3];
+#endif
+
+    //Vibration analysis (DESCENT_STABLE only, 200 Hz ODR)
+    VibrationAnalyzer vibration;
+    bool vibrationEnabled;
+    unsigned long nextVibSample_us;
+    void sampleVibration();
+
+    //Landing prediction (DESCENT_FREE..LANDING)
+    LandingPredictor landing;
+    bool landingEnabled;
+    uint32_t lastLandingFix_us;          //gps_fix_time_us of the last fix added
+
+    //Barometric AGL by bmp_time_us: a GPS fix is paired with the altitude at
+    //its own time, not the newer one of the readAll that picks it up
+    SampleStream altitudeHistory;
+    const uint32_t ALTITUDE_MAX_GAP_US = 500000;     //interpolate across up to this
+    void recordAltitude(const SensorData& data);
+    
+    //Battery monitoring
+    const uint8_t BATTERY_PIN = A0;           //only ADC on the ESP8266
+    const uint16_t BATTERY_ADC_FULL_SCALE_MV = 3200;  //LOLIN A0 on-board divider: 1023 = 3.2 V
+    const float BATTERY_DIVIDER_RATIO = 2.0;
+    //Integer scale of readBatteryMillivolts, set once from the two above
+    const uint32_t BATTERY_FULL_SCALE_MV = (uint32_t)(BATTERY_ADC_FULL_SCALE_MV * BATTERY_DIVIDER_RATIO + 0.5f);
+    const float LOW_BATTERY_THRESHOLD = 3.3;
+    const uint16_t LOW_BATTERY_MV = 3300;
+    
+    //Private methods
+    bool readBMP280(SensorData& data);
+    bool readMPU6050(SensorData& data);
+    void readVibration(SensorData& data);
+    void readLanding(SensorData& data);
+    bool readGPS(SensorData& data);
+    bool readRTC(SensorData& data);
+    float readBatteryVoltage();
+    uint16_t readBatteryMillivolts();
+    void checkHealth(unsigned long now);
+    void checkI2CSensor(SensorId sensor, uint8_t failures, unsigned long lastChange,
+                        bool stuck, unsigned long now);
+    void checkGPS(unsigned long now);
+    void checkRTC(unsigned long now);
+    bool reinitI2CSensor(SensorId sensor);
+    void markFault(SensorId sensor, FaultClass cause, unsigned long now);
+    void markRecovered(SensorId sensor, unsigned long now);
+    void calculateOrientation(float ax, float ay, float az, 
+                             float& pitch, float& roll);
+    void calculateOrientation(int16_t ax_mg, int16_t ay_mg, int16_t az_mg,
+                              int16_t& pitch_cdeg, int16_t& roll_cdeg);
+    bool beginDrivers(bool warm, MissionState state);
+};
+
+#endif
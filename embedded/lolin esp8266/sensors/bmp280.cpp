@@ -1,59 +1,32 @@
-#include "bmp280_driver.h"
+#include "bmp280.h"
 
-BMP280_Driver::BMP280_Driver() : initialized(false) {
-}
+template class BMP280_DriverT<TargetHal>;
 
-bool BMP280_Driver::begin(uint8_t address) {
-    Serial.print("[BMP280] Initializing at address 0x");
-    Serial.print(address, HEX);
-    Serial.print("... ");
-    
-    if (!bmp.begin(address)) {
-        Serial.println("FAILED!");
-        initialized = false;
-        return false;
-    }
-    
-    //Configure sensor for optimal settings
-    bmp.setSampling(
-        Adafruit_BMP280::MODE_NORMAL,  
-        Adafruit_BMP280::SAMPLING_X2,    
-        Adafruit_BMP280::SAMPLING_X16,    
-        Adafruit_BMP280::FILTER_X16,      
-        Adafruit_BMP280::STANDBY_MS_500   
-    );
-    
-    initialized = true;
-    Serial.println("OK");
-    
-    //Serial print sensor info
-    Serial.print("[BMP280] Chip ID: 0x");
-    Serial.println(bmp.sensorID(), HEX);
-    
-    return true;
-}
+//Datasheet integer compensation (3.11.3) of the raw sample
+//temperature in 0.01 C, pressure in Pa as Q24.8
+bool BMP280_Compensation::compensate(int32_t& temperature, uint32_t& pressure) const {
+    int32_t adc_T = rawTemperature;
+    int32_t var1 = ((((adc_T >> 3) - ((int32_t)dig_T1 << 1))) * ((int32_t)dig_T2)) >> 11;
+    int32_t var2 = (((((adc_T >> 4) - ((int32_t)dig_T1)) * ((adc_T >> 4) - ((int32_t)dig_T1))) >> 12) *
+                    ((int32_t)dig_T3)) >> 14;
+    int32_t t_fine = var1 + var2;
+    temperature = (t_fine * 5 + 128) >> 8;
 
-float BMP280_Driver::readPressure() {
-    if (!initialized) {
-        return 0.0;
+    int64_t p1 = ((int64_t)t_fine) - 128000;
+    int64_t p2 = p1 * p1 * (int64_t)dig_P6;
+    p2 = p2 + ((p1 * (int64_t)dig_P5) << 17);
+    p2 = p2 + (((int64_t)dig_P4) << 35);
+    p1 = ((p1 * p1 * (int64_t)dig_P3) >> 8) + ((p1 * (int64_t)dig_P2) << 12);
+    p1 = (((((int64_t)1) << 47) + p1)) * ((int64_t)dig_P1) >> 33;
+    if (p1 == 0) {
+        return false;  //avoid division by zero (bad trim)
     }
-    return bmp.readPressure();
-}
+    int64_t p = 1048576 - rawPressure;
+    p = (((p << 31) - p2) * 3125) / p1;
+    p1 = (((int64_t)dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    p2 = (((int64_t)dig_P8) * p) >> 19;
+    p = ((p + p1 + p2) >> 8) + (((int64_t)dig_P7) << 4);
 
-float BMP280_Driver::readTemperature() {
-    if (!initialized) {
-        return 0.0;
-    }
-    return bmp.readTemperature();
-}
-
-float BMP280_Driver::readAltitude(float seaLevelPressure) {
-    if (!initialized) {
-        return 0.0;
-    }
-    return bmp.readAltitude(seaLevelPressure); //We need this to calibrate Above Ground Level in .ino
+    pressure = (uint32_t)p;
+    return true;
 }
-
-bool BMP280_Driver::isConnected() {
-    return initialized;
-}
\ No newline at end of file
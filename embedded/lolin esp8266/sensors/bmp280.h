@@ -1,13 +1,37 @@
 #ifndef BMP280_DRIVER_H
 #define BMP280_DRIVER_H
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <Adafruit_BMP280.h>
+#include "../hal.h"
 
-class BMP280_Driver {
+//Raw sample and factory trim: the part of the driver that does not depend on the hardware policy
+struct BMP280_Compensation {
+    int32_t rawPressure;
+    int32_t rawTemperature;
+
+    //Factory trim (datasheet 3.11.2)
+    uint16_t dig_T1;
+    int16_t dig_T2, dig_T3;
+    uint16_t dig_P1;
+    int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+
+    BMP280_Compensation() : rawPressure(0), rawTemperature(0) {}
+
+    //Compiled once in bmp280.cpp whatever the policy
+    bool compensate(int32_t& temperature, uint32_t& pressure) const;
+};
+
+/**
+ BMP280 barometer
+ Hal: hardware policy (hal.h), BMP280 library, Bus and Clock are taken from it
+ */
+template <class Hal>
+class BMP280_DriverT {
 public:
-    BMP280_Driver();
+    typedef typename Hal::BMP280 Sensor;
+    typedef typename Hal::Bus Bus;
+    typedef typename Hal::Clock Clock;
+
+    BMP280_DriverT();
     
     bool begin(uint8_t address = 0x76);
     
@@ -20,9 +44,287 @@ public:
 
     bool isConnected();
 
+    /**
+     Change oversampling, IIR filter and standby at runtime (sensor stays in NORMAL mode)
+     Output rate ~ 1 / (measurement time + standby), IIR lag ~ (filter - 1) output periods
+     */
+    bool setSampling(typename Sensor::sensor_sampling tempSampling,
+                     typename Sensor::sensor_sampling pressSampling,
+                     typename Sensor::sensor_filter filter,
+                     typename Sensor::standby_duration standby);
+
+    /**
+     Asynchronous path through the shared bus manager
+     attachBus() loads the trim registers once (blocking, call after begin)
+     requestSample() queues one 6-byte burst of pressure + temperature,
+     the compensated result is picked up later with getSample()
+     */
+    bool attachBus(Bus* bus);
+    bool requestSample();
+    bool hasSample() const;
+    bool getSample(float& pressure_Pa, float& temperature_C, unsigned long& time_us);
+    bool getSampleFixed(int32_t& pressure_cPa, int16_t& temperature_cC, unsigned long& time_us);
+
+    /**
+     Health inputs for SensorManager
+     consecutive failed bursts (NAK / short read) and the last time the raw
+     pressure/temperature changed (a live sensor always has some noise in the LSBs)
+     */
+    uint8_t getConsecutiveFailures() const;
+    unsigned long getLastChangeTime() const;
+    unsigned long getUnchangedTime() const;     //ms of successful reads with identical data
+    uint8_t getAddress() const;
+
 private:
-    Adafruit_BMP280 bmp;
+    Sensor bmp;
     bool initialized;
+    uint8_t address;
+
+    //Async state
+    Bus* bus;
+    bool requestPending;
+    bool sampleReady;
+    unsigned long sampleTime_us;
+    uint8_t consecutiveFailures;
+    unsigned long lastChange_ms;
+    unsigned long lastRead_ms;
+    BMP280_Compensation sample;
+
+    static void onSample(void* context, const uint8_t* data, uint8_t len, bool ok);
+    typename Sensor::sensor_sampling tempSampling;
+    typename Sensor::sensor_sampling pressSampling;
+    typename Sensor::sensor_filter filter;
+    typename Sensor::standby_duration standby;
 };
 
-#endif
\ No newline at end of file
+
+template <class Hal>
+BMP280_DriverT<Hal>::BMP280_DriverT()
+    : initialized(false),
+      address(0x76),
+      bus(nullptr),
+      requestPending(false),
+      sampleReady(false),
+      sampleTime_us(0),
+      consecutiveFailures(0),
+      lastChange_ms(0),
+      lastRead_ms(0),
+      tempSampling(Sensor::SAMPLING_X2),
+      pressSampling(Sensor::SAMPLING_X16),
+      filter(Sensor::FILTER_X2),
+      standby(Sensor::STANDBY_MS_500) {
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::begin(uint8_t address) {
+    this->address = address;
+
+    Serial.print(F("[BMP280] Initializing at address 0x"));
+    Serial.print(address, HEX);
+    Serial.print(F("... "));
+    
+    if (!bmp.begin(address)) {
+        Serial.println(F("FAILED!"));
+        initialized = false;
+        return false;
+    }
+    
+    //Start with the last requested settings (pad defaults until a profile is applied)
+    bmp.setSampling(
+        Sensor::MODE_NORMAL,  
+        tempSampling,
+        pressSampling,
+        filter,
+        standby
+    );
+    
+    initialized = true;
+    consecutiveFailures = 0;
+    Serial.println(F("OK"));
+    
+    //Serial print sensor info
+    Serial.print(F("[BMP280] Chip ID: 0x"));
+    Serial.println(bmp.sensorID(), HEX);
+    
+    return true;
+}
+
+template <class Hal>
+float BMP280_DriverT<Hal>::readPressure() {
+    if (!initialized) {
+        return 0.0;
+    }
+    return bmp.readPressure();
+}
+
+template <class Hal>
+float BMP280_DriverT<Hal>::readTemperature() {
+    if (!initialized) {
+        return 0.0;
+    }
+    return bmp.readTemperature();
+}
+
+template <class Hal>
+float BMP280_DriverT<Hal>::readAltitude(float seaLevelPressure) {
+    if (!initialized) {
+        return 0.0;
+    }
+    return bmp.readAltitude(seaLevelPressure); //We need this to calibrate Above Ground Level in .ino
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::isConnected() {
+    return initialized;
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::setSampling(typename Sensor::sensor_sampling newTempSampling,
+                                 typename Sensor::sensor_sampling newPressSampling,
+                                 typename Sensor::sensor_filter newFilter,
+                                 typename Sensor::standby_duration newStandby) {
+    tempSampling = newTempSampling;
+    pressSampling = newPressSampling;
+    filter = newFilter;
+    standby = newStandby;
+
+    if (!initialized) {
+        return false;  //kept, applied by begin()
+    }
+
+    //Single config write, next conversion already uses the new settings
+    bmp.setSampling(Sensor::MODE_NORMAL, tempSampling, pressSampling, filter, standby);
+    return true;
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::attachBus(Bus* i2cBus) {
+    if (!initialized || i2cBus == nullptr) {
+        return false;
+    }
+
+    uint8_t trim[24];
+    if (!i2cBus->readRegisters(address, 0x88, trim, sizeof(trim))) {
+        Serial.println(F("[BMP280] Could not read trim registers"));
+        return false;
+    }
+
+    sample.dig_T1 = (uint16_t)(trim[0] | (trim[1] << 8));
+    sample.dig_T2 = (int16_t)(trim[2] | (trim[3] << 8));
+    sample.dig_T3 = (int16_t)(trim[4] | (trim[5] << 8));
+    sample.dig_P1 = (uint16_t)(trim[6] | (trim[7] << 8));
+    sample.dig_P2 = (int16_t)(trim[8] | (trim[9] << 8));
+    sample.dig_P3 = (int16_t)(trim[10] | (trim[11] << 8));
+    sample.dig_P4 = (int16_t)(trim[12] | (trim[13] << 8));
+    sample.dig_P5 = (int16_t)(trim[14] | (trim[15] << 8));
+    sample.dig_P6 = (int16_t)(trim[16] | (trim[17] << 8));
+    sample.dig_P7 = (int16_t)(trim[18] | (trim[19] << 8));
+    sample.dig_P8 = (int16_t)(trim[20] | (trim[21] << 8));
+    sample.dig_P9 = (int16_t)(trim[22] | (trim[23] << 8));
+
+    bus = i2cBus;
+    return true;
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::requestSample() {
+    if (bus == nullptr || requestPending) {
+        return false;
+    }
+    //0xF7..0xFC: press_msb, press_lsb, press_xlsb, temp_msb, temp_lsb, temp_xlsb
+    requestPending = bus->submitRead(address, 0xF7, 6, onSample, this);
+    return requestPending;
+}
+
+template <class Hal>
+bool BMP280_DriverT<Hal>::hasSample() const {
+    return sampleReady;
+}
+
+//Consumes the sample
+template <class Hal>
+bool BMP280_DriverT<Hal>::getSample(float& pressure_Pa, float& temperature_C, unsigned long& time_us) {
+    if (!sampleReady) {
+        return false;
+    }
+    sampleReady = false;
+
+    int32_t temperature;
+    uint32_t pressure;
+    if (!sample.compensate(temperature, pressure)) {
+        return false;
+    }
+    temperature_C = temperature / 100.0;
+    pressure_Pa = pressure / 256.0;   //Q24.8
+    time_us = sampleTime_us;
+    return true;
+}
+
+//Same sample without leaving integer arithmetic (FIXED_POINT_PIPELINE)
+template <class Hal>
+bool BMP280_DriverT<Hal>::getSampleFixed(int32_t& pressure_cPa, int16_t& temperature_cC, unsigned long& time_us) {
+    if (!sampleReady) {
+        return false;
+    }
+    sampleReady = false;
+
+    int32_t temperature;
+    uint32_t pressure;
+    if (!sample.compensate(temperature, pressure)) {
+        return false;
+    }
+    temperature_cC = (int16_t)temperature;
+    pressure_cPa = (int32_t)((pressure * 25) >> 6);   //Q24.8 Pa * 100 / 256
+    time_us = sampleTime_us;
+    return true;
+}
+
+template <class Hal>
+void BMP280_DriverT<Hal>::onSample(void* context, const uint8_t* data, uint8_t len, bool ok) {
+    BMP280_DriverT* self = static_cast<BMP280_DriverT*>(context);
+    self->requestPending = false;
+    if (!ok || len < 6) {
+        if (self->consecutiveFailures < 255) {
+            self->consecutiveFailures++;
+        }
+        return;
+    }
+    self->consecutiveFailures = 0;
+
+    int32_t pressure = ((int32_t)data[0] << 12) | ((int32_t)data[1] << 4) | (data[2] >> 4);
+    int32_t temperature = ((int32_t)data[3] << 12) | ((int32_t)data[4] << 4) | (data[5] >> 4);
+    if (pressure != self->sample.rawPressure || temperature != self->sample.rawTemperature) {
+        self->lastChange_ms = Clock::millis();
+    }
+    self->lastRead_ms = Clock::millis();
+    self->sample.rawPressure = pressure;
+    self->sample.rawTemperature = temperature;
+    self->sampleTime_us = Clock::micros();
+    self->sampleReady = true;
+}
+
+template <class Hal>
+uint8_t BMP280_DriverT<Hal>::getConsecutiveFailures() const {
+    return consecutiveFailures;
+}
+
+template <class Hal>
+unsigned long BMP280_DriverT<Hal>::getLastChangeTime() const {
+    return lastChange_ms;
+}
+
+template <class Hal>
+uint8_t BMP280_DriverT<Hal>::getAddress() const {
+    return address;
+}
+
+template <class Hal>
+unsigned long BMP280_DriverT<Hal>::getUnchangedTime() const {
+    return lastRead_ms - lastChange_ms;
+}
+
+//Flight build or host simulation (TargetHal), instantiated once in bmp280.cpp
+extern template class BMP280_DriverT<TargetHal>;
+typedef BMP280_DriverT<TargetHal> BMP280_Driver;
+
+#endif
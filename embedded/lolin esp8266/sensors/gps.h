@@ -1,16 +1,52 @@
 #ifndef GPS_DRIVER_H
 #define GPS_DRIVER_H
 
-#include <Arduino.h>
-#include <TinyGPSPlus.h>
-#include <SoftwareSerial.h> //ESP8266
+#include "../hal.h"
+#include "../fault_injection.h"
+#include "ubx.h"
 
-class GPS_Driver {
+//GPS week 0 started 1980-01-06, 3657 days after the Unix epoch
+#define GPS_EPOCH_UNIX_DAYS   3657UL
+#define GPS_UTC_LEAP_SECONDS  18UL      //GPS - UTC since 2017-01-01
+
+enum class GPSMode {
+    NMEA,   //factory default: 9600 baud ASCII, 1 Hz, parsed by TinyGPSPlus
+    UBX     //binary NAV-POSLLH/VELNED/SOL, up to 5 Hz (see beginUBX)
+};
+
+/**
+ NEO-6M GPS receiver
+ Hal: hardware policy (hal.h), NMEA parser, GpsSerial and Clock are taken from it
+ */
+template <class Hal>
+class GPS_DriverT {
 public:
+    typedef typename Hal::NMEA Nmea;
+    typedef typename Hal::GpsSerial Uart;
+    typedef typename Hal::Clock Clock;
+
     //TX to D2 and RX to D1
-    GPS_Driver(uint8_t rxPin = 4, uint8_t txPin = 5);
+    GPS_DriverT(uint8_t rxPin = 4, uint8_t txPin = 5);
     
     bool begin(uint32_t baudRate = 9600);
+
+    /**
+     Reconfigure the receiver for binary output and switch to UBX parsing
+     The NEO-6M boots at 9600 baud NMEA: we send CFG-PRT (new baud, UBX only),
+     CFG-RATE (navigation period) and CFG-MSG for the three NAV messages.
+     Settings are not saved to the receiver, a power cycle restores NMEA.
+     baudRate 38400 keeps SoftwareSerial reliable, measRate_ms 200 = 5 Hz (NEO-6M max)
+     */
+    bool beginUBX(uint32_t baudRate = 38400, uint16_t measRate_ms = 200);
+
+    /**
+     Warm restart after an MCU-only reset: the receiver kept its UBX settings,
+     so only the UART is reopened (no CFG messages, no ACK wait).
+     If the receiver did reset, SensorManager sees garbage and reconfigures it.
+     */
+    bool resumeUBX(uint32_t baudRate = 38400);
+
+    GPSMode getMode() const;
     
     //update gps data
     void update();
@@ -22,6 +58,10 @@ public:
     double getLongitude(); //Longitude in decimal degrees
     float getAltitude(); //Altitude in meters (less acurrate than bmp280)
     float getSpeed();    //Speed in m/s
+    int32_t getLatitudeE7();    //Latitude in 1e-7 degrees (FIXED_POINT_PIPELINE)
+    int32_t getLongitudeE7();   //Longitude in 1e-7 degrees
+    int32_t getAltitudeCm();    //Altitude in cm
+    uint16_t getSpeedCmps();    //Speed in cm/s
     uint8_t getSatellites(); //Number of sattelites in view
     float getHDOP();     //Precision (less is better)
     
@@ -31,17 +71,482 @@ public:
     
     //Info
     uint32_t getFixAge(); //Get milliseconds since last valid location update
+    uint32_t getFixTime_us(); //micros() when the current position arrived (receiver latency not included)
     bool isConnected();   //check if sensor is working
     uint32_t getCharsProcessed(); //number of characters processed
     uint32_t getSentencesWithFix(); //number of sentences received
+    uint32_t getChecksumErrors();   //NMEA sentences / UBX frames that failed the checksum or length check
+    unsigned long getLastByteTime() const; //millis() of the last byte from the receiver
+    const UBX_Parser& getUBXParser() const; //UBX statistics
 
 private:
-    TinyGPSPlus gps;
-    SoftwareSerial* gpsSerial;
+    Nmea gps;
+    UBX_Parser ubx;
+    Uart gpsSerial;
+    GPSMode mode;
+    uint32_t lastPositionCount;     //ubx posllhCount at last update()
+    unsigned long lastPositionTime; //millis() when a new NAV-POSLLH arrived
+    uint32_t lastPositionTime_us;   //same, micros()
+    unsigned long lastByteTime;
     
     uint8_t rxPin;
     uint8_t txPin;
     bool initialized;
+
+    void sendUBX(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t len);
+    bool ubxHasFix() const;
+    void ubxUtc(uint32_t& secondsOfDay, uint32_t& daysSinceEpoch) const;
 };
 
-#endif
\ No newline at end of file
+
+//GPS UART (SoftwareSerial on the ESP8266), a member so it lives in the driver's static storage (no heap)
+template <class Hal>
+GPS_DriverT<Hal>::GPS_DriverT(uint8_t rxPin, uint8_t txPin) 
+    : gpsSerial(rxPin, txPin),
+      rxPin(rxPin),
+      txPin(txPin),
+      initialized(false) {
+    mode = GPSMode::NMEA;
+    lastPositionCount = 0;
+    lastPositionTime = 0;
+    lastPositionTime_us = 0;
+    lastByteTime = 0;
+}
+
+template <class Hal>
+bool GPS_DriverT<Hal>::begin(uint32_t baudRate) {
+    Serial.print(F("[GPS] Initializing on RX:"));
+    Serial.print(rxPin);
+    Serial.print(F(" TX:"));
+    Serial.print(txPin);
+    Serial.print(F(" @ "));
+    Serial.print(baudRate);
+    Serial.print(F(" baud"));
+    
+    Serial.print(F(" (SoftwareSerial)... "));
+    gpsSerial.begin(baudRate);
+    
+    initialized = true;
+    Serial.println(F("OK"));
+    
+    Serial.println(F("[GPS] Waiting for satellite fix..."));
+    Serial.println(F("[GPS] This may take 1-5 minutes outdoors"));
+    Serial.println(F("[GPS] GPS will NOT work indoors!"));
+    
+    return true;
+}
+
+template <class Hal>
+bool GPS_DriverT<Hal>::beginUBX(uint32_t baudRate, uint16_t measRate_ms) {
+    Serial.print(F("[GPS] Switching to UBX binary @ "));
+    Serial.print(baudRate);
+    Serial.print(F(" baud, "));
+    Serial.print(1000 / measRate_ms);
+    Serial.print(F(" Hz... "));
+
+    //CFG-PRT: UART1, 8N1, new baud, accept UBX+NMEA in, UBX only out
+    uint8_t prt[20] = {0};
+    prt[0] = 1;                                  //portID UART1
+    prt[4] = 0xD0; prt[5] = 0x08;                //mode 0x000008D0 = 8N1
+    prt[8] = (uint8_t)(baudRate);
+    prt[9] = (uint8_t)(baudRate >> 8);
+    prt[10] = (uint8_t)(baudRate >> 16);
+    prt[11] = (uint8_t)(baudRate >> 24);
+    prt[12] = 0x03;                              //inProtoMask UBX | NMEA
+    prt[14] = 0x01;                              //outProtoMask UBX
+
+    //Receiver may be at factory 9600 or already at baudRate (MCU reset only)
+    gpsSerial.begin(9600);
+    sendUBX(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+    Clock::delay(100);                           //let the receiver switch baud
+    gpsSerial.begin(baudRate);
+    sendUBX(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+
+    //CFG-RATE: measurement period, 1 cycle per solution, GPS time reference
+    uint8_t rate[6] = {
+        (uint8_t)(measRate_ms & 0xFF), (uint8_t)(measRate_ms >> 8),
+        0x01, 0x00,
+        0x01, 0x00
+    };
+    sendUBX(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+
+    //CFG-MSG: one of each NAV message per navigation solution
+    const uint8_t navMessages[3] = { UBX_NAV_POSLLH, UBX_NAV_VELNED, UBX_NAV_SOL };
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t msg[3] = { UBX_CLASS_NAV, navMessages[i], 0x01 };
+        sendUBX(UBX_CLASS_CFG, UBX_CFG_MSG, msg, sizeof(msg));
+    }
+
+    mode = GPSMode::UBX;
+    initialized = true;
+
+    //Collect the ACKs (one per CFG message), only for the boot log
+    unsigned long start = Clock::millis();
+    while (Clock::millis() - start < 250 && ubx.getAcks() + ubx.getNaks() < 5) {
+        update();
+        Clock::yield();
+    }
+
+    Serial.print(F("OK (ACK "));
+    Serial.print(ubx.getAcks());
+    Serial.print(F(", NAK "));
+    Serial.print(ubx.getNaks());
+    Serial.println(F(")"));
+    return true;
+}
+
+template <class Hal>
+bool GPS_DriverT<Hal>::resumeUBX(uint32_t baudRate) {
+    gpsSerial.begin(baudRate);
+    mode = GPSMode::UBX;
+    initialized = true;
+
+    Serial.print(F("[GPS] Resuming UBX @ "));
+    Serial.print(baudRate);
+    Serial.println(F(" baud"));
+    return true;
+}
+
+template <class Hal>
+GPSMode GPS_DriverT<Hal>::getMode() const {
+    return mode;
+}
+
+template <class Hal>
+void GPS_DriverT<Hal>::update() {
+    if (!initialized) {
+        return;
+    }
+    
+    //Feed the GPS analyzer with the serial data
+    if (mode == GPSMode::UBX) {
+        while (gpsSerial.available() > 0) {
+            int c = FAULT_GPS_BYTE(gpsSerial.read());
+            if (c < 0) {
+                continue;
+            }
+            lastByteTime = Clock::millis();
+            ubx.parse((uint8_t)c);
+        }
+        const UBX_Solution& solution = ubx.getSolution();
+        if (solution.posllhCount != lastPositionCount) {
+            lastPositionCount = solution.posllhCount;
+            lastPositionTime = Clock::millis();
+            lastPositionTime_us = Clock::micros();
+        }
+        return;
+    }
+
+    while (gpsSerial.available() > 0) {
+        int c = FAULT_GPS_BYTE(gpsSerial.read());
+        if (c < 0) {
+            continue;
+        }
+        lastByteTime = Clock::millis();
+        gps.encode((char)c);
+    }
+}
+
+template <class Hal>
+bool GPS_DriverT<Hal>::hasFix() {
+    if (mode == GPSMode::UBX) {
+        return ubxHasFix();
+    }
+    return gps.location.isValid();
+}
+
+template <class Hal>
+double GPS_DriverT<Hal>::getLatitude() {
+    if (!hasFix()) {
+        return 0.0;
+    }
+    if (mode == GPSMode::UBX) {
+        return ubx.getSolution().posllh.lat * 1e-7;
+    }
+    return gps.location.lat();
+}
+
+template <class Hal>
+double GPS_DriverT<Hal>::getLongitude() {
+    if (!hasFix()) {
+        return 0.0;
+    }
+    if (mode == GPSMode::UBX) {
+        return ubx.getSolution().posllh.lon * 1e-7;
+    }
+    return gps.location.lng();
+}
+
+template <class Hal>
+float GPS_DriverT<Hal>::getAltitude() {
+    if (mode == GPSMode::UBX) {
+        if (!ubxHasFix()) {
+            return 0.0;
+        }
+        return ubx.getSolution().posllh.hMSL / 1000.0;
+    }
+    if (!gps.altitude.isValid()) {
+        return 0.0;
+    }
+    return gps.altitude.meters();
+}
+
+template <class Hal>
+float GPS_DriverT<Hal>::getSpeed() {
+    if (mode == GPSMode::UBX) {
+        if (!ubxHasFix() || !ubx.getSolution().haveVelned) {
+            return 0.0;
+        }
+        return ubx.getSolution().velned.gSpeed / 100.0;
+    }
+    if (!gps.speed.isValid()) {
+        return 0.0;
+    }
+    return gps.speed.mps();
+}
+
+//Scaled integers for FIXED_POINT_PIPELINE: UBX already is integer,
+//NMEA comes from TinyGPSPlus raw fields (no double on the way)
+static inline int32_t rawDegreesToE7(const RawDegrees& raw) {
+    int32_t e7 = (int32_t)raw.deg * 10000000L + (int32_t)(raw.billionths / 100);
+    return raw.negative ? -e7 : e7;
+}
+
+template <class Hal>
+int32_t GPS_DriverT<Hal>::getLatitudeE7() {
+    if (!hasFix()) {
+        return 0;
+    }
+    if (mode == GPSMode::UBX) {
+        return ubx.getSolution().posllh.lat;
+    }
+    return rawDegreesToE7(gps.location.rawLat());
+}
+
+template <class Hal>
+int32_t GPS_DriverT<Hal>::getLongitudeE7() {
+    if (!hasFix()) {
+        return 0;
+    }
+    if (mode == GPSMode::UBX) {
+        return ubx.getSolution().posllh.lon;
+    }
+    return rawDegreesToE7(gps.location.rawLng());
+}
+
+template <class Hal>
+int32_t GPS_DriverT<Hal>::getAltitudeCm() {
+    if (mode == GPSMode::UBX) {
+        if (!ubxHasFix()) {
+            return 0;
+        }
+        return ubx.getSolution().posllh.hMSL / 10;
+    }
+    if (!gps.altitude.isValid()) {
+        return 0;
+    }
+    return gps.altitude.value();    //already cm
+}
+
+template <class Hal>
+uint16_t GPS_DriverT<Hal>::getSpeedCmps() {
+    uint32_t speed;
+    if (mode == GPSMode::UBX) {
+        if (!ubxHasFix() || !ubx.getSolution().haveVelned) {
+            return 0;
+        }
+        speed = ubx.getSolution().velned.gSpeed;
+    } else {
+        if (!gps.speed.isValid()) {
+            return 0;
+        }
+        speed = (uint32_t)gps.speed.value() * 51444UL / 100000UL;   //0.01 knot to cm/s
+    }
+    return speed > 65535 ? 65535 : (uint16_t)speed;
+}
+
+template <class Hal>
+uint8_t GPS_DriverT<Hal>::getSatellites() {
+    if (mode == GPSMode::UBX) {
+        return ubx.getSolution().haveSol ? ubx.getSolution().sol.numSV : 0;
+    }
+    if (!gps.satellites.isValid()) {
+        return 0;
+    }
+    return gps.satellites.value();
+}
+
+template <class Hal>
+float GPS_DriverT<Hal>::getHDOP() {
+    if (mode == GPSMode::UBX) {
+        //NAV-SOL only carries PDOP (always >= HDOP), good enough as a quality gate
+        if (!ubx.getSolution().haveSol) {
+            return 9999.0;
+        }
+        return ubx.getSolution().sol.pDOP / 100.0;
+    }
+    if (!gps.hdop.isValid()) {
+        return 9999.0;
+    }
+    return gps.hdop.hdop();
+}
+
+template <class Hal>
+void GPS_DriverT<Hal>::getTime(uint8_t& hour, uint8_t& minute, uint8_t& second) {
+    if (mode == GPSMode::UBX) {
+        uint32_t secondsOfDay, days;
+        ubxUtc(secondsOfDay, days);
+        hour = secondsOfDay / 3600;
+        minute = (secondsOfDay / 60) % 60;
+        second = secondsOfDay % 60;
+    } else if (gps.time.isValid()) {
+        hour = gps.time.hour();
+        minute = gps.time.minute();
+        second = gps.time.second();
+    } else {
+        hour = 0;
+        minute = 0;
+        second = 0;
+    }
+}
+
+template <class Hal>
+void GPS_DriverT<Hal>::getDate(uint8_t& day, uint8_t& month, uint16_t& year) {
+    if (mode == GPSMode::UBX) {
+        uint32_t secondsOfDay, days;
+        ubxUtc(secondsOfDay, days);
+        if (days == 0) {
+            day = 0;
+            month = 0;
+            year = 0;
+            return;
+        }
+        //Days since 1970-01-01 to civil date (H. Hinnant's algorithm)
+        int32_t z = (int32_t)days + 719468;
+        int32_t era = z / 146097;
+        uint32_t doe = (uint32_t)(z - era * 146097);
+        uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        uint32_t mp = (5 * doy + 2) / 153;
+        day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+        month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+        year = (uint16_t)(yoe + era * 400 + (month <= 2 ? 1 : 0));
+    } else if (gps.date.isValid()) {
+        day = gps.date.day();
+        month = gps.date.month();
+        year = gps.date.year();
+    } else {
+        day = 0;
+        month = 0;
+        year = 0;
+    }
+}
+
+template <class Hal>
+uint32_t GPS_DriverT<Hal>::getFixAge() {
+    if (mode == GPSMode::UBX) {
+        if (lastPositionCount == 0) {
+            return 0xFFFFFFFF;  //same "never" value as TinyGPSPlus
+        }
+        return Clock::millis() - lastPositionTime;
+    }
+    return gps.location.age();
+}
+
+template <class Hal>
+uint32_t GPS_DriverT<Hal>::getFixTime_us() {
+    if (mode == GPSMode::UBX) {
+        return lastPositionTime_us;
+    }
+    //TinyGPSPlus only keeps millis() of the sentence, good to 1 ms
+    uint32_t age = gps.location.age();
+    return age == 0xFFFFFFFF ? 0 : Clock::micros() - age * 1000UL;
+}
+
+template <class Hal>
+bool GPS_DriverT<Hal>::isConnected() {
+    if (!initialized) {
+        return false;
+    }
+    
+    //Check if we are receiving data
+    return getCharsProcessed() > 10; 
+}
+
+template <class Hal>
+uint32_t GPS_DriverT<Hal>::getCharsProcessed() {
+    if (mode == GPSMode::UBX) {
+        return ubx.getBytesProcessed();
+    }
+    return gps.charsProcessed();
+}
+
+template <class Hal>
+uint32_t GPS_DriverT<Hal>::getSentencesWithFix() {
+    if (mode == GPSMode::UBX) {
+        return ubx.getMessagesOk();
+    }
+    return gps.sentencesWithFix();
+}
+
+template <class Hal>
+uint32_t GPS_DriverT<Hal>::getChecksumErrors() {
+    if (mode == GPSMode::UBX) {
+        return ubx.getChecksumErrors() + ubx.getLengthErrors();
+    }
+    return gps.failedChecksum();
+}
+
+template <class Hal>
+unsigned long GPS_DriverT<Hal>::getLastByteTime() const {
+    return lastByteTime;
+}
+
+template <class Hal>
+const UBX_Parser& GPS_DriverT<Hal>::getUBXParser() const {
+    return ubx;
+}
+
+template <class Hal>
+void GPS_DriverT<Hal>::sendUBX(uint8_t msgClass, uint8_t msgId, const uint8_t* payload, uint16_t len) {
+    uint8_t frame[32];
+    uint16_t n = UBX_Parser::buildFrame(msgClass, msgId, payload, len, frame, sizeof(frame));
+    gpsSerial.write(frame, n);
+}
+
+//3D fix reported valid by the receiver (same meaning as SensorData.gps_fix)
+template <class Hal>
+bool GPS_DriverT<Hal>::ubxHasFix() const {
+    const UBX_Solution& solution = ubx.getSolution();
+    if (!solution.haveSol || !solution.havePosllh) {
+        return false;
+    }
+    bool fixOk = (solution.sol.flags & 0x01) != 0;
+    return fixOk && (solution.sol.gpsFix == 3 || solution.sol.gpsFix == 4);
+}
+
+//UTC from GPS week + time of week, days = 0 if the receiver has no valid time yet
+template <class Hal>
+void GPS_DriverT<Hal>::ubxUtc(uint32_t& secondsOfDay, uint32_t& daysSinceEpoch) const {
+    const UBX_Solution& solution = ubx.getSolution();
+    secondsOfDay = 0;
+    daysSinceEpoch = 0;
+    if (!solution.haveSol || (solution.sol.flags & 0x0C) != 0x0C) {  //WKNSET and TOWSET
+        return;
+    }
+
+    uint32_t gpsSeconds = (uint32_t)solution.sol.week * 604800UL + solution.posllh.iTOW / 1000;
+    if (!solution.havePosllh) {
+        gpsSeconds = (uint32_t)solution.sol.week * 604800UL + solution.sol.iTOW / 1000;
+    }
+    uint32_t utcSeconds = gpsSeconds - GPS_UTC_LEAP_SECONDS;
+
+    secondsOfDay = utcSeconds % 86400UL;
+    daysSinceEpoch = utcSeconds / 86400UL + GPS_EPOCH_UNIX_DAYS;
+}
+
+//Flight build or host simulation (TargetHal), instantiated once in gps.cpp
+extern template class GPS_DriverT<TargetHal>;
+typedef GPS_DriverT<TargetHal> GPS_Driver;
+
+#endif
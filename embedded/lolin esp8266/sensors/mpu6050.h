@@ -1,14 +1,21 @@
 #ifndef MPU6050_DRIVER_H
 #define MPU6050_DRIVER_H
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <Adafruit_MPU6050.h>
-#include <Adafruit_Sensor.h>
+#include "../hal.h"
 
-class MPU6050_Driver {
+/**
+ MPU6050 accelerometer / gyroscope
+ Hal: hardware policy (hal.h), MPU6050 library, Bus and Clock are taken from it
+ */
+template <class Hal>
+class MPU6050_DriverT {
 public:
-    MPU6050_Driver();
+    typedef typename Hal::MPU6050 Sensor;
+    typedef typename Hal::Bus Bus;
+    typedef typename Hal::Clock Clock;
+    typedef typename Hal::MPU6050Bandwidth Bandwidth;
+
+    MPU6050_DriverT();
     
     bool begin(uint8_t address = 0x68);
     
@@ -30,9 +37,320 @@ public:
     //return true if sensor responds
     bool isConnected();
 
+    /**
+     Change digital low pass filter and output data rate at runtime
+     ODR = gyro rate / (1 + rateDivisor), gyro rate is 1 kHz with DLPF on
+     */
+    bool setSampling(Bandwidth bandwidth, uint8_t rateDivisor);
+
+    /**
+     Asynchronous path through the shared bus manager
+     requestSample() queues one 14-byte burst (accel, temp, gyro from 0x3B),
+     getSample() returns the latest completed one in the same units as read()
+     */
+    void attachBus(Bus* bus);
+    bool requestSample();
+    bool hasSample() const;
+    bool getSample(float& accel_x, float& accel_y, float& accel_z,
+                   float& gyro_x, float& gyro_y, float& gyro_z,
+                   unsigned long& time_us);
+
+    //Same sample as raw registers (FIXED_POINT_PIPELINE), consumes it like getSample()
+    bool getSampleRaw(int16_t accel[3], int16_t gyro[3], unsigned long& time_us);
+
+    //Latest raw registers without consuming the sample (fixed-rate consumers such as the FFT)
+    bool getLatestRaw(int16_t accel[3], int16_t gyro[3]) const;
+
+    //Health inputs for SensorManager: failed bursts in a row, last time any raw axis changed
+    uint8_t getConsecutiveFailures() const;
+    unsigned long getLastChangeTime() const;
+    unsigned long getUnchangedTime() const;     //ms of successful reads with identical data
+    uint8_t getAddress() const;
+
 private:
-    Adafruit_MPU6050 mpu;
+    Sensor mpu;
     bool initialized;
+    Bandwidth bandwidth;
+    uint8_t rateDivisor;
+    uint8_t address;
+
+    //Async state
+    Bus* bus;
+    bool requestPending;
+    bool sampleReady;
+    unsigned long sampleTime_us;
+    int16_t rawAccel[3];
+    int16_t rawGyro[3];
+    uint8_t consecutiveFailures;
+    unsigned long lastChange_ms;
+    unsigned long lastRead_ms;
+
+    static void onSample(void* context, const uint8_t* data, uint8_t len, bool ok);
 };
 
-#endif
\ No newline at end of file
+
+template <class Hal>
+MPU6050_DriverT<Hal>::MPU6050_DriverT()
+    : initialized(false),
+      bandwidth(MPU6050_BAND_21_HZ),
+      rateDivisor(0),
+      address(0x68),
+      bus(nullptr),
+      requestPending(false),
+      sampleReady(false),
+      sampleTime_us(0),
+      consecutiveFailures(0),
+      lastChange_ms(0),
+      lastRead_ms(0) {
+    memset(rawAccel, 0, sizeof(rawAccel));
+    memset(rawGyro, 0, sizeof(rawGyro));
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::begin(uint8_t address) {
+    this->address = address;
+
+    Serial.print(F("[MPU6050] Initializing at address 0x"));
+    Serial.print(address, HEX);
+    Serial.print(F("... "));
+    
+    if (!mpu.begin(address)) {
+        Serial.println(F("FAILED!"));
+        initialized = false;
+        return false;
+    }
+    
+    //Configure sensor ranges
+    mpu.setAccelerometerRange(MPU6050_RANGE_8_G);   //±8g (sufficient for freefall)
+    mpu.setGyroRange(MPU6050_RANGE_500_DEG);        //±500°/s
+    mpu.setFilterBandwidth(bandwidth);              //Low pass filter (see setSampling)
+    mpu.setSampleRateDivisor(rateDivisor);
+    
+    initialized = true;
+    consecutiveFailures = 0;
+    Serial.println(F("OK"));
+    
+    //Print configuration
+    Serial.print(F("[MPU6050] Accel range: ±"));
+    switch (mpu.getAccelerometerRange()) {
+        case MPU6050_RANGE_2_G:  Serial.println(F("2G"));  break;
+        case MPU6050_RANGE_4_G:  Serial.println(F("4G"));  break;
+        case MPU6050_RANGE_8_G:  Serial.println(F("8G"));  break;
+        case MPU6050_RANGE_16_G: Serial.println(F("16G")); break;
+    }
+    
+    Serial.print(F("[MPU6050] Gyro range: ±"));
+    switch (mpu.getGyroRange()) {
+        case MPU6050_RANGE_250_DEG:  Serial.println(F("250°/s"));  break;
+        case MPU6050_RANGE_500_DEG:  Serial.println(F("500°/s"));  break;
+        case MPU6050_RANGE_1000_DEG: Serial.println(F("1000°/s")); break;
+        case MPU6050_RANGE_2000_DEG: Serial.println(F("2000°/s")); break;
+    }
+    
+    return true;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::read(float& accel_x, float& accel_y, float& accel_z,
+                         float& gyro_x, float& gyro_y, float& gyro_z) {
+    if (!initialized) {
+        return false;
+    }
+    
+    sensors_event_t a, g, temp;
+    mpu.getEvent(&a, &g, &temp);
+    
+    //Acceleration in m/s
+    accel_x = a.acceleration.x;
+    accel_y = a.acceleration.y;
+    accel_z = a.acceleration.z;
+    
+    //Gyroscope in rad/s
+    gyro_x = g.gyro.x;
+    gyro_y = g.gyro.y;
+    gyro_z = g.gyro.z;
+    
+    return true;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::readAccel(float& x, float& y, float& z) {
+    if (!initialized) {
+        return false;
+    }
+    
+    sensors_event_t a, g, temp;
+    mpu.getEvent(&a, &g, &temp);
+    
+    x = a.acceleration.x;
+    y = a.acceleration.y;
+    z = a.acceleration.z;
+    
+    return true;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::readGyro(float& x, float& y, float& z) {
+    if (!initialized) {
+        return false;
+    }
+    
+    sensors_event_t a, g, temp;
+    mpu.getEvent(&a, &g, &temp);
+    
+    x = g.gyro.x;
+    y = g.gyro.y;
+    z = g.gyro.z;
+    
+    return true;
+}
+
+template <class Hal>
+float MPU6050_DriverT<Hal>::readTemperature() {
+    if (!initialized) {
+        return 0.0;
+    }
+    
+    sensors_event_t a, g, temp;
+    mpu.getEvent(&a, &g, &temp);
+    
+    return temp.temperature;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::isConnected() {
+    return initialized;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::setSampling(Bandwidth newBandwidth, uint8_t newRateDivisor) {
+    bandwidth = newBandwidth;
+    rateDivisor = newRateDivisor;
+
+    if (!initialized) {
+        return false;  //kept, applied by begin()
+    }
+
+    mpu.setFilterBandwidth(bandwidth);
+    mpu.setSampleRateDivisor(rateDivisor);
+    return true;
+}
+
+template <class Hal>
+void MPU6050_DriverT<Hal>::attachBus(Bus* i2cBus) {
+    bus = i2cBus;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::requestSample() {
+    if (!initialized || bus == nullptr || requestPending) {
+        return false;
+    }
+    //0x3B..0x48: ACCEL_XOUT_H .. GYRO_ZOUT_L, big-endian
+    requestPending = bus->submitRead(address, 0x3B, 14, onSample, this);
+    return requestPending;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::hasSample() const {
+    return sampleReady;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::getSample(float& accel_x, float& accel_y, float& accel_z,
+                               float& gyro_x, float& gyro_y, float& gyro_z,
+                               unsigned long& time_us) {
+    if (!sampleReady) {
+        return false;
+    }
+    sampleReady = false;
+
+    //Scale for the ranges set in begin(): +-8g = 4096 LSB/g, +-500 deg/s = 65.5 LSB/(deg/s)
+    const float ACCEL_SCALE = 9.80665 / 4096.0;               //m/s^2 per LSB
+    const float GYRO_SCALE = (PI / 180.0) / 65.5;             //rad/s per LSB
+    accel_x = rawAccel[0] * ACCEL_SCALE;
+    accel_y = rawAccel[1] * ACCEL_SCALE;
+    accel_z = rawAccel[2] * ACCEL_SCALE;
+    gyro_x = rawGyro[0] * GYRO_SCALE;
+    gyro_y = rawGyro[1] * GYRO_SCALE;
+    gyro_z = rawGyro[2] * GYRO_SCALE;
+    time_us = sampleTime_us;
+    return true;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::getSampleRaw(int16_t accel[3], int16_t gyro[3], unsigned long& time_us) {
+    if (!sampleReady) {
+        return false;
+    }
+    sampleReady = false;
+
+    memcpy(accel, rawAccel, sizeof(rawAccel));
+    memcpy(gyro, rawGyro, sizeof(rawGyro));
+    time_us = sampleTime_us;
+    return true;
+}
+
+template <class Hal>
+bool MPU6050_DriverT<Hal>::getLatestRaw(int16_t accel[3], int16_t gyro[3]) const {
+    if (!initialized || lastRead_ms == 0) {
+        return false;
+    }
+    memcpy(accel, rawAccel, sizeof(rawAccel));
+    memcpy(gyro, rawGyro, sizeof(rawGyro));
+    return true;
+}
+
+template <class Hal>
+void MPU6050_DriverT<Hal>::onSample(void* context, const uint8_t* data, uint8_t len, bool ok) {
+    MPU6050_DriverT* self = static_cast<MPU6050_DriverT*>(context);
+    self->requestPending = false;
+    if (!ok || len < 14) {
+        if (self->consecutiveFailures < 255) {
+            self->consecutiveFailures++;
+        }
+        return;
+    }
+    self->consecutiveFailures = 0;
+
+    bool changed = false;
+    for (uint8_t i = 0; i < 3; i++) {
+        int16_t accel = (int16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+        int16_t gyro = (int16_t)((data[8 + 2 * i] << 8) | data[8 + 2 * i + 1]);
+        changed = changed || accel != self->rawAccel[i] || gyro != self->rawGyro[i];
+        self->rawAccel[i] = accel;
+        self->rawGyro[i] = gyro;
+    }
+    if (changed) {
+        self->lastChange_ms = Clock::millis();
+    }
+    self->lastRead_ms = Clock::millis();
+    self->sampleTime_us = Clock::micros();
+    self->sampleReady = true;
+}
+
+template <class Hal>
+uint8_t MPU6050_DriverT<Hal>::getConsecutiveFailures() const {
+    return consecutiveFailures;
+}
+
+template <class Hal>
+unsigned long MPU6050_DriverT<Hal>::getLastChangeTime() const {
+    return lastChange_ms;
+}
+
+template <class Hal>
+uint8_t MPU6050_DriverT<Hal>::getAddress() const {
+    return address;
+}
+
+template <class Hal>
+unsigned long MPU6050_DriverT<Hal>::getUnchangedTime() const {
+    return lastRead_ms - lastChange_ms;
+}
+
+//Flight build or host simulation (TargetHal), instantiated once in mpu6050.cpp
+extern template class MPU6050_DriverT<TargetHal>;
+typedef MPU6050_DriverT<TargetHal> MPU6050_Driver;
+
+#endif
@@ -1,13 +1,26 @@
 #ifndef RTC_DRIVER_H
 #define RTC_DRIVER_H
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <RTClib.h>
+#include "../hal.h"
+#include "../fault_injection.h"
 
-class RTC_Driver {
+#define RTC_ISO8601_SIZE 20     //"2026-02-06 15:00:00" + NUL
+#define DS3231_ADDRESS 0x68
+#define DS3231_STATUS_REG 0x0F
+#define DS3231_OSF 0x80          //oscillator stop flag: time is invalid
+
+/**
+ DS3231 real-time clock
+ Hal: hardware policy (hal.h), RTC library, Bus and Clock are taken from it
+ */
+template <class Hal>
+class RTC_DriverT {
 public:
-    RTC_Driver();
+    typedef typename Hal::RTC Sensor;
+    typedef typename Hal::Bus Bus;
+    typedef typename Hal::Clock Clock;
+
+    RTC_DriverT();
     
     bool begin();
     
@@ -36,20 +49,296 @@ public:
      Check if RTC lost power since last use
      If true, time needs to be reset
      return true if power was lost
+     Blocking bus read, for begin()/setup only, see getLatestLostPower()
      */
     bool lostPower();
+
+    //Oscillator stop flag as begin() found it, before it set the compile time
+    bool lostPowerAtBegin() const;
     
 
     //Check if sensor is responding, return true if RTC responds
     bool isConnected();
     
     
-    //Time in format
-    String getISO8601();
+    /**
+     Time as "YYYY-MM-DD hh:mm:ss" into a caller buffer of at least
+     RTC_ISO8601_SIZE bytes (no String, no heap), return buffer
+     */
+    char* getISO8601(char* buffer, size_t size);
+
+    /**
+     Asynchronous path through the shared bus manager
+     requestTime() queues one 16-byte burst of the time and status registers,
+     getLatestUnixTime() returns the last decoded value (0 until the first one)
+     and getLatestLostPower() the oscillator stop flag of the same burst
+     (the value read by begin() until then), neither touches the bus
+     */
+    void attachBus(Bus* bus);
+    bool requestTime();
+    uint32_t getLatestUnixTime() const;
+    bool getLatestLostPower() const;
 
 private:
-    RTC_DS3231 rtc;
+    Sensor rtc;
     bool initialized;
+    bool powerLostAtBegin;
+
+    //Async state
+    Bus* bus;
+    bool requestPending;
+    uint32_t latestUnixTime;
+    bool latestLostPower;
+
+    static void onTime(void* context, const uint8_t* data, uint8_t len, bool ok);
 };
 
-#endif
\ No newline at end of file
+
+
+template <class Hal>
+RTC_DriverT<Hal>::RTC_DriverT()
+    : initialized(false),                         //sensor is off
+      powerLostAtBegin(false),
+      bus(nullptr),
+      requestPending(false),
+      latestUnixTime(0),
+      latestLostPower(true) {
+}
+
+template <class Hal>
+bool RTC_DriverT<Hal>::begin() {                        //sensor is on
+    Serial.print(F("Initializing RTC DS3231... "));
+    
+    if (!rtc.begin()) {
+        Serial.println(F("FAILED!"));
+        initialized = false;
+        return false;          //.ino gets this information
+    }
+    
+    initialized = true;
+    Serial.println(F("OK"));
+    
+    //check if RTC lost power
+    latestLostPower = false;
+    powerLostAtBegin = rtc.lostPower();
+    if (powerLostAtBegin) {
+        Serial.println(F("[RTC] WARNING: RTC lost power"));
+        Serial.println(F("[RTC] Setting time from las compile.."));
+        setTimeFromCompile();
+    }
+    
+    //Print current time
+    DateTime now = rtc.now();
+    Serial.print(F("[RTC] Current time: "));
+    Serial.print(now.year(), DEC);
+    Serial.print('/');
+    Serial.print(now.month(), DEC);
+    Serial.print('/');
+    Serial.print(now.day(), DEC);
+    Serial.print(F(" "));
+    Serial.print(now.hour(), DEC);
+    Serial.print(':');
+    Serial.print(now.minute(), DEC);
+    Serial.print(':');
+    Serial.print(now.second(), DEC);
+    Serial.println();
+    
+    return true;
+}
+
+template <class Hal>
+void RTC_DriverT<Hal>::setTimeFromCompile() {
+    if (!initialized) {         
+        return;               //if sensor is off do anything
+    }
+    
+    //Set time
+    rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));   //also clears the stop flag
+    latestLostPower = false;
+    FAULT_RTC_RESTORED();
+    
+    Serial.println(F("[RTC] Time set from compilation timestamp"));
+}
+
+template <class Hal>
+void RTC_DriverT<Hal>::setTime(uint16_t year, uint8_t month, uint8_t day,
+                        uint8_t hour, uint8_t minute, uint8_t second) {
+    if (!initialized) {
+        return;
+    }
+    
+    DateTime dt(year, month, day, hour, minute, second);
+    rtc.adjust(dt);
+    latestLostPower = false;
+    FAULT_RTC_RESTORED();
+    
+    Serial.println(F("[RTC] Time manually set"));
+}
+
+template <class Hal>
+bool RTC_DriverT<Hal>::lostPowerAtBegin() const {
+    return powerLostAtBegin;
+}
+
+template <class Hal>
+uint32_t RTC_DriverT<Hal>::getUnixTime() {
+    if (!initialized) {
+        return 0;
+    }
+    
+    DateTime now = rtc.now();
+    return now.unixtime();
+}
+
+
+template <class Hal>
+uint64_t RTC_DriverT<Hal>::getMillis() {
+    if (!initialized) {
+        return 0;
+    }
+    
+    //Tomamos los segundos del RTC y los hacemos milisegundos (*1000)
+    uint32_t unixTime = getUnixTime();
+    uint64_t millis = (uint64_t)unixTime * 1000ULL;
+    
+    //add milliseconds
+    millis += (Clock::millis() % 1000);
+    
+    return millis;
+}
+
+//time
+template <class Hal>
+void RTC_DriverT<Hal>::getTime(uint8_t& hour, uint8_t& minute, uint8_t& second) {
+    if (!initialized) {  //if sensor is off time is 0
+        hour = 0;
+        minute = 0;
+        second = 0;
+        return;
+    }
+    
+    DateTime now = rtc.now();
+    hour = now.hour();
+    minute = now.minute();
+    second = now.second();
+}
+
+//date
+template <class Hal>
+void RTC_DriverT<Hal>::getDate(uint16_t& year, uint8_t& month, uint8_t& day) {
+    if (!initialized) {
+        year = 0;
+        month = 0;
+        day = 0;
+        return;
+    }
+    
+    DateTime now = rtc.now();
+    year = now.year();
+    month = now.month();
+    day = now.day();
+}
+
+//temperature
+template <class Hal>
+float RTC_DriverT<Hal>::getTemperature() {
+    if (!initialized) {
+        return 0.0;
+    }
+    
+    return rtc.getTemperature();   //aditional temperature sensor from RTC
+}
+
+
+template <class Hal>
+bool RTC_DriverT<Hal>::lostPower() {
+    if (!initialized) {
+        return true;   
+    }
+    if (FAULT_RTC_POWER_LOST()) {
+        return true;
+    }
+    
+    return rtc.lostPower();    //.ino gets this information
+}
+
+template <class Hal>
+bool RTC_DriverT<Hal>::isConnected() {
+    return initialized;
+}
+
+
+
+//text format: "2026-02-06 15:00:00"
+template <class Hal>
+char* RTC_DriverT<Hal>::getISO8601(char* buffer, size_t size) {
+    if (!initialized) {
+        snprintf(buffer, size, "0000-00-00 00:00:00");
+        return buffer;
+    }
+    
+    DateTime now = rtc.now();
+    
+    snprintf(buffer, size, "%04d-%02d-%02d %02d:%02d:%02d",   //fill digits with 0 on the left
+             now.year(), now.month(), now.day(),
+             now.hour(), now.minute(), now.second());
+    return buffer;
+}
+
+template <class Hal>
+void RTC_DriverT<Hal>::attachBus(Bus* i2cBus) {
+    bus = i2cBus;
+}
+
+template <class Hal>
+bool RTC_DriverT<Hal>::requestTime() {
+    if (!initialized || bus == nullptr || requestPending) {
+        return false;
+    }
+    //0x00..0x06: seconds, minutes, hours, day, date, month/century, year (BCD)
+    //0x07..0x0E alarms and control, 0x0F status (OSF)
+    requestPending = bus->submitRead(DS3231_ADDRESS, 0x00, DS3231_STATUS_REG + 1, onTime, this);
+    return requestPending;
+}
+
+template <class Hal>
+uint32_t RTC_DriverT<Hal>::getLatestUnixTime() const {
+    return latestUnixTime;
+}
+
+template <class Hal>
+bool RTC_DriverT<Hal>::getLatestLostPower() const {
+    if (!initialized || FAULT_RTC_POWER_LOST()) {
+        return true;
+    }
+    return latestLostPower;
+}
+
+static inline uint8_t bcdToBin(uint8_t value) {
+    return value - 6 * (value >> 4);
+}
+
+template <class Hal>
+void RTC_DriverT<Hal>::onTime(void* context, const uint8_t* data, uint8_t len, bool ok) {
+    RTC_DriverT* self = static_cast<RTC_DriverT*>(context);
+    self->requestPending = false;
+    if (!ok || len < DS3231_STATUS_REG + 1) {
+        return;
+    }
+    self->latestLostPower = (data[DS3231_STATUS_REG] & DS3231_OSF) != 0;
+
+    uint8_t second = bcdToBin(data[0] & 0x7F);
+    uint8_t minute = bcdToBin(data[1]);
+    uint8_t hour = bcdToBin(data[2] & 0x3F);      //24h mode, as set by RTClib
+    uint8_t day = bcdToBin(data[4]);
+    uint8_t month = bcdToBin(data[5] & 0x7F);
+    uint16_t year = 2000 + bcdToBin(data[6]);
+
+    self->latestUnixTime = DateTime(year, month, day, hour, minute, second).unixtime();
+}
+
+//Flight build or host simulation (TargetHal), instantiated once in rtc.cpp
+extern template class RTC_DriverT<TargetHal>;
+typedef RTC_DriverT<TargetHal> RTC_Driver;
+
+#endif
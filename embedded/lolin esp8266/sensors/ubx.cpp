@@ -0,0 +1,225 @@
+#include "ubx.h"
+
+#include <string.h>
+
+UBX_Parser::UBX_Parser()
+    : state(WAIT_SYNC_1),
+      msgClass(0),
+      msgId(0),
+      length(0),
+      index(0),
+      ckA(0),
+      ckB(0),
+      target(nullptr),
+      bytesProcessed(0),
+      messagesOk(0),
+      checksumErrors(0),
+      lengthErrors(0),
+      acks(0),
+      naks(0) {
+    memset(&solution, 0, sizeof(solution));
+}
+
+bool UBX_Parser::parse(uint8_t c) {
+    bytesProcessed++;
+
+    switch (state) {
+        case WAIT_SYNC_1:
+            if (c == UBX_SYNC_1) {
+                state = WAIT_SYNC_2;
+            }
+            return false;
+
+        case WAIT_SYNC_2:
+            if (c == UBX_SYNC_2) {
+                state = READ_CLASS;
+                ckA = 0;
+                ckB = 0;
+            } else {
+                state = (c == UBX_SYNC_1) ? WAIT_SYNC_2 : WAIT_SYNC_1;
+            }
+            return false;
+
+        case READ_CLASS:
+            msgClass = c;
+            checksum(c);
+            state = READ_ID;
+            return false;
+
+        case READ_ID:
+            msgId = c;
+            checksum(c);
+            state = READ_LEN_1;
+            return false;
+
+        case READ_LEN_1:
+            length = c;
+            checksum(c);
+            state = READ_LEN_2;
+            return false;
+
+        case READ_LEN_2:
+            length |= (uint16_t)c << 8;
+            if (length > UBX_MAX_FRAME_PAYLOAD) {
+                lengthErrors++;
+                state = WAIT_SYNC_1;
+                return false;
+            }
+            checksum(c);
+            index = 0;
+            selectTarget();
+            state = (length == 0) ? READ_CK_A : READ_PAYLOAD;
+            return false;
+
+        case READ_PAYLOAD:
+            checksum(c);
+            if (target != nullptr) {
+                target[index] = c;
+            }
+            if (++index >= length) {
+                state = READ_CK_A;
+            }
+            return false;
+
+        case READ_CK_A:
+            if (c != ckA) {
+                checksumErrors++;
+                state = (c == UBX_SYNC_1) ? WAIT_SYNC_2 : WAIT_SYNC_1;
+                return false;
+            }
+            state = READ_CK_B;
+            return false;
+
+        case READ_CK_B:
+            state = WAIT_SYNC_1;
+            if (c != ckB) {
+                checksumErrors++;
+                if (c == UBX_SYNC_1) {
+                    state = WAIT_SYNC_2;
+                }
+                return false;
+            }
+            messagesOk++;
+            return complete();
+    }
+    return false;
+}
+
+uint16_t UBX_Parser::parse(const uint8_t* data, size_t len) {
+    uint16_t completed = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (parse(data[i])) {
+            completed++;
+        }
+    }
+    return completed;
+}
+
+const UBX_Solution& UBX_Parser::getSolution() const {
+    return solution;
+}
+
+uint32_t UBX_Parser::getBytesProcessed() const {
+    return bytesProcessed;
+}
+
+uint32_t UBX_Parser::getMessagesOk() const {
+    return messagesOk;
+}
+
+uint32_t UBX_Parser::getChecksumErrors() const {
+    return checksumErrors;
+}
+
+uint32_t UBX_Parser::getLengthErrors() const {
+    return lengthErrors;
+}
+
+uint32_t UBX_Parser::getAcks() const {
+    return acks;
+}
+
+uint32_t UBX_Parser::getNaks() const {
+    return naks;
+}
+
+uint16_t UBX_Parser::buildFrame(uint8_t msgClass, uint8_t msgId,
+                                const uint8_t* payload, uint16_t len,
+                                uint8_t* out, uint16_t maxLen) {
+    uint16_t total = len + 8;
+    if (total > maxLen) {
+        return 0;
+    }
+
+    out[0] = UBX_SYNC_1;
+    out[1] = UBX_SYNC_2;
+    out[2] = msgClass;
+    out[3] = msgId;
+    out[4] = (uint8_t)(len & 0xFF);
+    out[5] = (uint8_t)(len >> 8);
+    if (len > 0) {
+        memcpy(out + 6, payload, len);
+    }
+
+    uint8_t a = 0;
+    uint8_t b = 0;
+    for (uint16_t i = 2; i < len + 6; i++) {
+        a += out[i];
+        b += a;
+    }
+    out[len + 6] = a;
+    out[len + 7] = b;
+    return total;
+}
+
+//8-bit Fletcher over class, id, length and payload
+void UBX_Parser::checksum(uint8_t c) {
+    ckA += c;
+    ckB += ckA;
+}
+
+//Decide where the payload goes before the first payload byte arrives
+void UBX_Parser::selectTarget() {
+    target = nullptr;
+    if (msgClass != UBX_CLASS_NAV) {
+        return;
+    }
+    if ((msgId == UBX_NAV_POSLLH && length == sizeof(UBX_NavPosllh)) ||
+        (msgId == UBX_NAV_VELNED && length == sizeof(UBX_NavVelned)) ||
+        (msgId == UBX_NAV_SOL && length == sizeof(UBX_NavSol))) {
+        target = payload.raw;
+    }
+}
+
+//Checksum matched: publish the message
+bool UBX_Parser::complete() {
+    if (msgClass == UBX_CLASS_ACK) {
+        if (msgId == UBX_ACK_ACK) {
+            acks++;
+        } else if (msgId == UBX_ACK_NAK) {
+            naks++;
+        }
+        return false;
+    }
+
+    if (target == nullptr) {
+        return false;  //valid but not a message we use
+    }
+
+    switch (msgId) {
+        case UBX_NAV_POSLLH:
+            solution.posllh = payload.posllh;
+            solution.havePosllh = true;
+            solution.posllhCount++;
+            break;
+        case UBX_NAV_VELNED:
+            solution.velned = payload.velned;
+            solution.haveVelned = true;
+            break;
+        case UBX_NAV_SOL:
+            solution.sol = payload.sol;
+            solution.haveSol = true;
+            break;
+    }
+    return true;
+}
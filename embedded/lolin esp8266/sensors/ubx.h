@@ -0,0 +1,173 @@
+#ifndef UBX_H
+#define UBX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//u-blox UBX binary protocol (NEO-6M, protocol 7)
+//Frame: 0xB5 0x62 class id len(LE16) payload ck_a ck_b
+//No Arduino dependency so the parser also builds on the host.
+
+#define UBX_SYNC_1          0xB5
+#define UBX_SYNC_2          0x62
+
+#define UBX_CLASS_NAV       0x01
+#define UBX_CLASS_ACK       0x05
+#define UBX_CLASS_CFG       0x06
+
+#define UBX_NAV_POSLLH      0x02
+#define UBX_NAV_SOL         0x06
+#define UBX_NAV_VELNED      0x12
+#define UBX_ACK_NAK         0x00
+#define UBX_ACK_ACK         0x01
+#define UBX_CFG_PRT         0x00
+#define UBX_CFG_MSG         0x01
+#define UBX_CFG_RATE        0x08
+
+#pragma pack(push, 1)
+
+struct UBX_NavPosllh {
+    uint32_t iTOW;          //GPS time of week (ms)
+    int32_t lon;            //1e-7 deg
+    int32_t lat;            //1e-7 deg
+    int32_t height;         //above ellipsoid (mm)
+    int32_t hMSL;           //above mean sea level (mm)
+    uint32_t hAcc;          //mm
+    uint32_t vAcc;          //mm
+};
+
+struct UBX_NavVelned {
+    uint32_t iTOW;
+    int32_t velN;           //cm/s
+    int32_t velE;           //cm/s
+    int32_t velD;           //cm/s (positive = down)
+    uint32_t speed;         //3D speed (cm/s)
+    uint32_t gSpeed;        //ground speed (cm/s)
+    int32_t heading;        //1e-5 deg
+    uint32_t sAcc;          //cm/s
+    uint32_t cAcc;          //1e-5 deg
+};
+
+struct UBX_NavSol {
+    uint32_t iTOW;
+    int32_t fTOW;           //ns
+    int16_t week;           //GPS week
+    uint8_t gpsFix;         //0 none, 2 2D, 3 3D, 4 GPS+DR
+    uint8_t flags;          //bit0 gpsFixOk, bit2 WKNSET, bit3 TOWSET
+    int32_t ecefX;
+    int32_t ecefY;
+    int32_t ecefZ;
+    uint32_t pAcc;
+    int32_t ecefVX;
+    int32_t ecefVY;
+    int32_t ecefVZ;
+    uint32_t sAcc;
+    uint16_t pDOP;          //0.01
+    uint8_t reserved1;
+    uint8_t numSV;
+    uint32_t reserved2;
+};
+
+#pragma pack(pop)
+
+#define UBX_MAX_PAYLOAD     sizeof(UBX_NavSol)
+
+//Longest payload accepted even for skipped messages: NEO-6M NAV/ACK/CFG
+//messages are far smaller, a larger length field is a corrupted header
+#define UBX_MAX_FRAME_PAYLOAD 512
+
+
+//Latest navigation solution assembled from NAV-POSLLH / NAV-VELNED / NAV-SOL
+struct UBX_Solution {
+    UBX_NavPosllh posllh;
+    UBX_NavVelned velned;
+    UBX_NavSol sol;
+    bool havePosllh;
+    bool haveVelned;
+    bool haveSol;
+    uint32_t posllhCount;   //increments on every new NAV-POSLLH
+};
+
+
+/**
+ Byte-at-a-time UBX state machine:
+ - Fletcher checksum accumulated as bytes arrive, no second pass
+ - Payload of wanted messages lands directly in the message struct, other
+   messages are checksummed and skipped without being stored
+ - A length above UBX_MAX_FRAME_PAYLOAD drops the header and resyncs, so one
+   corrupted length byte cannot swallow the frames behind it
+ - The solution is only updated after the checksum matches
+ */
+class UBX_Parser {
+public:
+    UBX_Parser();
+
+    //Feed one byte, return true when it completed a valid NAV message
+    bool parse(uint8_t c);
+
+    //Feed a buffer, return number of valid NAV messages completed
+    uint16_t parse(const uint8_t* data, size_t len);
+
+    const UBX_Solution& getSolution() const;
+
+    //Statistics
+    uint32_t getBytesProcessed() const;
+    uint32_t getMessagesOk() const;
+    uint32_t getChecksumErrors() const;
+    uint32_t getLengthErrors() const;
+    uint32_t getAcks() const;
+    uint32_t getNaks() const;
+
+    /**
+     Build a UBX frame (sync, header, payload, checksum) into out
+     return frame length, 0 if out is too small
+     */
+    static uint16_t buildFrame(uint8_t msgClass, uint8_t msgId,
+                               const uint8_t* payload, uint16_t len,
+                               uint8_t* out, uint16_t maxLen);
+
+private:
+    enum State : uint8_t {
+        WAIT_SYNC_1,
+        WAIT_SYNC_2,
+        READ_CLASS,
+        READ_ID,
+        READ_LEN_1,
+        READ_LEN_2,
+        READ_PAYLOAD,
+        READ_CK_A,
+        READ_CK_B
+    };
+
+    State state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint16_t length;
+    uint16_t index;
+    uint8_t ckA;
+    uint8_t ckB;
+    uint8_t* target;        //where payload bytes go (nullptr = skip)
+
+    //Payload lands here, overlaid on the message struct
+    union {
+        uint8_t raw[UBX_MAX_PAYLOAD];
+        UBX_NavPosllh posllh;
+        UBX_NavVelned velned;
+        UBX_NavSol sol;
+    } payload;
+
+    UBX_Solution solution;
+
+    uint32_t bytesProcessed;
+    uint32_t messagesOk;
+    uint32_t checksumErrors;
+    uint32_t lengthErrors;
+    uint32_t acks;
+    uint32_t naks;
+
+    void checksum(uint8_t c);
+    void selectTarget();
+    bool complete();
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "telemetry.h"
+#include "alloc_tracking.h"
+
+Telemetry::Telemetry() : link(nullptr), sequence(0) {
+}
+
+bool Telemetry::begin(RadioLink* radioLink) {
+    link = radioLink;
+    sequence = 0;
+
+    Serial.print(F("[TELEMETRY] Frame size: "));
+    Serial.print((unsigned)TELEMETRY_FRAME_SIZE);
+    Serial.println(F(" bytes"));
+    return link != nullptr;
+}
+
+uint16_t Telemetry::encode(const SensorData& data, uint8_t* buffer, uint16_t maxLen) {
+    if (maxLen < TELEMETRY_FRAME_SIZE) {
+        return 0;
+    }
+
+    TelemetryHeader header;
+    header.sync[0] = TELEMETRY_SYNC_0;
+    header.sync[1] = TELEMETRY_SYNC_1;
+    header.version = TELEMETRY_VERSION;
+    header.payload_len = TELEMETRY_PAYLOAD_SIZE;
+    header.sequence = sequence++;
+
+    //Field by field: SensorData is padded, the payload is packed
+    TelemetryPayload payload;
+#define TELEMETRY_FIELD_COPY(type, name) payload.name = data.name;
+    SENSOR_DATA_FIELDS(TELEMETRY_FIELD_COPY)
+#undef TELEMETRY_FIELD_COPY
+
+    memcpy(buffer, &header, TELEMETRY_HEADER_SIZE);
+    memcpy(buffer + TELEMETRY_HEADER_SIZE, &payload, TELEMETRY_PAYLOAD_SIZE);
+
+    uint16_t crcLen = TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE;
+    uint16_t crc = telemetryCrc16(buffer + 2, crcLen - 2);
+    buffer[crcLen] = (uint8_t)(crc & 0xFF);
+    buffer[crcLen + 1] = (uint8_t)(crc >> 8);
+
+    return TELEMETRY_FRAME_SIZE;
+}
+
+bool Telemetry::send(const SensorData& data) {
+    ALLOC_FREE_SCOPE("Telemetry::send");
+    if (link == nullptr) {
+        return false;
+    }
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    uint16_t len = encode(data, frame, sizeof(frame));
+    return link->send(frame, len);
+}
+
+uint16_t Telemetry::getSequence() const {
+    return sequence;
+}
@@ -0,0 +1,42 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal_linux_core.h"
+#endif
+#include "sensors.h"
+#include "telemetry_packet.h"
+#include "radio.h"
+
+/**
+ Responsibilities:
+ - Serialize SensorData into the frame defined in telemetry_packet.h
+ - Stamp sequence number and CRC
+ - Hand the frame to the radio link (never blocks)
+ */
+class Telemetry {
+public:
+    Telemetry();
+
+    bool begin(RadioLink* link);
+
+    /**
+     Build one frame from data into buffer
+     return frame size in bytes (0 if buffer too small)
+     */
+    uint16_t encode(const SensorData& data, uint8_t* buffer, uint16_t maxLen);
+
+    //Encode and queue on the radio, return false if link rejected the frame
+    bool send(const SensorData& data);
+
+    //Sequence number that the next frame will carry
+    uint16_t getSequence() const;
+
+private:
+    RadioLink* link;
+    uint16_t sequence;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_PACKET_H
+#define TELEMETRY_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sensor_fields.h"
+
+//Telemetry frame on the wire (little-endian, packed), shared with the ground decoder:
+//
+//  [sync0][sync1][version][payload_len][sequence lo][sequence hi][payload ...][crc lo][crc hi]
+//
+//payload is every SENSOR_DATA_FIELDS entry in order, bool as one byte.
+//crc is CRC-16/CCITT-FALSE over everything after the two sync bytes.
+
+#define TELEMETRY_SYNC_0       0xCB
+#define TELEMETRY_SYNC_1       0x5A
+#ifdef FIXED_POINT_PIPELINE
+#define TELEMETRY_VERSION      9   //3: scaled integer fields (FIXED_POINT_PIPELINE), 5: landing prediction, 7: acquisition times, 9: scaled vibration fields
+#else
+#define TELEMETRY_VERSION      6   //2: vibration fields, 4: landing prediction, 6: acquisition times
+#endif
+
+#pragma pack(push, 1)
+
+struct TelemetryHeader {
+    uint8_t sync[2];
+    uint8_t version;
+    uint8_t payload_len;
+    uint16_t sequence;
+};
+
+struct TelemetryPayload {
+#define TELEMETRY_FIELD_DECLARE(type, name) type name;
+    SENSOR_DATA_FIELDS(TELEMETRY_FIELD_DECLARE)
+#undef TELEMETRY_FIELD_DECLARE
+};
+
+#pragma pack(pop)
+
+#define TELEMETRY_HEADER_SIZE  sizeof(TelemetryHeader)
+#define TELEMETRY_PAYLOAD_SIZE sizeof(TelemetryPayload)
+#define TELEMETRY_CRC_SIZE     2
+#define TELEMETRY_FRAME_SIZE   (TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE + TELEMETRY_CRC_SIZE)
+
+static_assert(TELEMETRY_PAYLOAD_SIZE <= 255, "payload_len is one byte");
+
+
+//CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), nibble table: 32 bytes, cheap on the ESP8266
+static inline uint16_t telemetryCrc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);
+        crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ (data[i] & 0x0F)) & 0x0F]);
+    }
+    return crc;
+}
+
+#endif
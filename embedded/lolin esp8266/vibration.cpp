@@ -0,0 +1,340 @@
+#include "vibration.h"
+#include "fixed_point.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef ARDUINO
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#endif
+
+//Q15 tables for N = VIB_FFT_SIZE, generated with
+//  round(32768 * f), clamped to 32767
+//cos(2*pi*k/N), k < N/2
+static const int16_t TWIDDLE_COS[128] PROGMEM = {
+     32767,  32758,  32729,  32679,  32610,  32522,  32413,  32286,
+     32138,  31972,  31786,  31581,  31357,  31114,  30853,  30572,
+     30274,  29957,  29622,  29269,  28899,  28511,  28106,  27684,
+     27246,  26791,  26320,  25833,  25330,  24812,  24279,  23732,
+     23170,  22595,  22006,  21403,  20788,  20160,  19520,  18868,
+     18205,  17531,  16846,  16151,  15447,  14733,  14010,  13279,
+     12540,  11793,  11039,  10279,   9512,   8740,   7962,   7180,
+      6393,   5602,   4808,   4011,   3212,   2411,   1608,    804,
+         0,   -804,  -1608,  -2411,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7180,  -7962,  -8740,  -9512, -10279, -11039, -11793,
+    -12540, -13279, -14010, -14733, -15447, -16151, -16846, -17531,
+    -18205, -18868, -19520, -20160, -20788, -21403, -22006, -22595,
+    -23170, -23732, -24279, -24812, -25330, -25833, -26320, -26791,
+    -27246, -27684, -28106, -28511, -28899, -29269, -29622, -29957,
+    -30274, -30572, -30853, -31114, -31357, -31581, -31786, -31972,
+    -32138, -32286, -32413, -32522, -32610, -32679, -32729, -32758
+};
+
+//sin(2*pi*k/N), k < N/2
+static const int16_t TWIDDLE_SIN[128] PROGMEM = {
+         0,    804,   1608,   2411,   3212,   4011,   4808,   5602,
+      6393,   7180,   7962,   8740,   9512,  10279,  11039,  11793,
+     12540,  13279,  14010,  14733,  15447,  16151,  16846,  17531,
+     18205,  18868,  19520,  20160,  20788,  21403,  22006,  22595,
+     23170,  23732,  24279,  24812,  25330,  25833,  26320,  26791,
+     27246,  27684,  28106,  28511,  28899,  29269,  29622,  29957,
+     30274,  30572,  30853,  31114,  31357,  31581,  31786,  31972,
+     32138,  32286,  32413,  32522,  32610,  32679,  32729,  32758,
+     32767,  32758,  32729,  32679,  32610,  32522,  32413,  32286,
+     32138,  31972,  31786,  31581,  31357,  31114,  30853,  30572,
+     30274,  29957,  29622,  29269,  28899,  28511,  28106,  27684,
+     27246,  26791,  26320,  25833,  25330,  24812,  24279,  23732,
+     23170,  22595,  22006,  21403,  20788,  20160,  19520,  18868,
+     18205,  17531,  16846,  16151,  15447,  14733,  14010,  13279,
+     12540,  11793,  11039,  10279,   9512,   8740,   7962,   7180,
+      6393,   5602,   4808,   4011,   3212,   2411,   1608,    804
+};
+
+//Periodic Hann, n <= N/2 (w[N-n] = w[n])
+static const int16_t HANN_WINDOW[129] PROGMEM = {
+         0,      5,     20,     44,     79,    123,    177,    241,
+       315,    398,    491,    593,    705,    827,    958,   1098,
+      1247,   1406,   1573,   1749,   1935,   2128,   2331,   2542,
+      2761,   2989,   3224,   3468,   3719,   3978,   4244,   4518,
+      4799,   5087,   5381,   5682,   5990,   6304,   6624,   6950,
+      7282,   7619,   7961,   8308,   8661,   9018,   9379,   9745,
+     10114,  10487,  10864,  11245,  11628,  12014,  12403,  12794,
+     13188,  13583,  13980,  14378,  14778,  15179,  15580,  15982,
+     16384,  16786,  17188,  17589,  17990,  18390,  18788,  19185,
+     19580,  19974,  20365,  20754,  21140,  21523,  21904,  22281,
+     22654,  23023,  23389,  23750,  24107,  24460,  24807,  25149,
+     25486,  25818,  26144,  26464,  26778,  27086,  27387,  27681,
+     27969,  28250,  28524,  28790,  29049,  29300,  29544,  29779,
+     30007,  30226,  30437,  30640,  30833,  31019,  31195,  31362,
+     31521,  31670,  31810,  31941,  32063,  32175,  32277,  32370,
+     32453,  32527,  32591,  32645,  32689,  32724,  32748,  32763,
+     32767
+};
+
+static const float ACCEL_LSB_PER_G = 2048.0;    //accelMag is stored at half the register resolution
+static const float GYRO_LSB_PER_DPS = 65.5;
+static const float HANN_POWER_GAIN = 0.375;     //mean of w^2
+static const float BIN_HZ = (float)VIB_SAMPLE_RATE_HZ / VIB_FFT_SIZE;
+static const int8_t FFT_BITS = 8;               //log2(VIB_FFT_SIZE)
+static_assert(1 << FFT_BITS == VIB_FFT_SIZE, "FFT_BITS must match VIB_FFT_SIZE");
+
+static inline int16_t readQ15(const int16_t* table, uint16_t index) {
+    return (int16_t)pgm_read_word(&table[index]);
+}
+
+static inline int16_t hann(uint16_t n) {
+    return readQ15(HANN_WINDOW, n <= VIB_FFT_SIZE / 2 ? n : VIB_FFT_SIZE - n);
+}
+
+//RMS (input units) of the part of the signal covered by a one-sided power sum (Parseval)
+static inline float powerToRms(float power) {
+    return sqrtf(2.0 * power / ((float)VIB_FFT_SIZE * VIB_FFT_SIZE * HANN_POWER_GAIN));
+}
+
+static inline uint16_t scaled(float value, float scale) {
+    float s = value * scale + 0.5f;
+    return s < 65535.0f ? (uint16_t)s : 65535;
+}
+
+
+VibrationAnalyzer::VibrationAnalyzer() {
+    reset();
+}
+
+void VibrationAnalyzer::reset() {
+    count = 0;
+    memset(&report, 0, sizeof(report));
+}
+
+void VibrationAnalyzer::discardBlock() {
+    count = 0;
+}
+
+bool VibrationAnalyzer::addSample(const int16_t accel[3], const int16_t gyro[3]) {
+    if (count >= VIB_FFT_SIZE) {
+        return true;  //previous block not processed yet, drop
+    }
+    uint32_t sq = (uint32_t)((int32_t)accel[0] * accel[0]) +
+                  (uint32_t)((int32_t)accel[1] * accel[1]) +
+                  (uint32_t)((int32_t)accel[2] * accel[2]);
+    accelMag[count] = (int16_t)(fixedSqrt(sq) >> 1);
+    gyroX[count] = gyro[0];
+    gyroY[count] = gyro[1];
+    count++;
+    return count >= VIB_FFT_SIZE;
+}
+
+bool VibrationAnalyzer::isBlockReady() const {
+    return count >= VIB_FFT_SIZE;
+}
+
+void VibrationAnalyzer::process(unsigned long now_ms) {
+    if (count < VIB_FFT_SIZE) {
+        return;
+    }
+#ifdef ESP8266
+    uint32_t start = ESP.getCycleCount();
+#endif
+
+    //Swing: horizontal rotation, x and y spectra add up
+    powerSpectrum(gyroX, swingPower);
+    powerSpectrum(gyroY, accelPower);
+    for (uint16_t k = 0; k < VIB_BINS; k++) {
+        swingPower[k] += accelPower[k];
+    }
+    powerSpectrum(accelMag, accelPower);
+
+    report.swingFreq_hz = peakFrequency(swingPower, VIB_SWING_MIN_HZ, VIB_SWING_MAX_HZ);
+    report.swingRms_dps = powerToRms(bandPower(swingPower, VIB_SWING_MIN_HZ, VIB_SWING_MAX_HZ)) /
+                          GYRO_LSB_PER_DPS;
+    report.vibFreq_hz = peakFrequency(accelPower, VIB_SWING_MAX_HZ, VIB_SAMPLE_RATE_HZ);
+    report.bandLow_g = powerToRms(bandPower(accelPower, VIB_SWING_MIN_HZ, VIB_SWING_MAX_HZ)) /
+                       ACCEL_LSB_PER_G;
+    report.bandMid_g = powerToRms(bandPower(accelPower, VIB_SWING_MAX_HZ, VIB_MID_MAX_HZ)) /
+                       ACCEL_LSB_PER_G;
+    report.bandHigh_g = powerToRms(bandPower(accelPower, VIB_MID_MAX_HZ, VIB_SAMPLE_RATE_HZ)) /
+                        ACCEL_LSB_PER_G;
+    report.swingFreq_cHz = scaled(report.swingFreq_hz, 100.0f);
+    report.swingRms_cdps = scaled(report.swingRms_dps, 100.0f);
+    report.vibFreq_cHz = scaled(report.vibFreq_hz, 100.0f);
+    report.bandLow_mg = scaled(report.bandLow_g, 1000.0f);
+    report.bandMid_mg = scaled(report.bandMid_g, 1000.0f);
+    report.bandHigh_mg = scaled(report.bandHigh_g, 1000.0f);
+    report.time_ms = now_ms;
+    report.valid = true;
+    count = 0;
+
+#ifdef ESP8266
+    report.cycles = ESP.getCycleCount() - start;
+#endif
+}
+
+const VibrationReport& VibrationAnalyzer::getReport() const {
+    return report;
+}
+
+bool VibrationAnalyzer::isStableForCapture(unsigned long now_ms) const {
+    const unsigned long maxAge_ms = 2000UL * VIB_FFT_SIZE / VIB_SAMPLE_RATE_HZ;
+    if (!report.valid || now_ms - report.time_ms > maxAge_ms) {
+        return false;
+    }
+    return report.swingRms_dps < VIB_STABLE_SWING_DPS && report.bandHigh_g < VIB_STABLE_HIGH_G;
+}
+
+void VibrationAnalyzer::powerSpectrum(const int16_t* samples, float* power) {
+    const uint16_t N = VIB_FFT_SIZE;
+    const uint16_t M = VIB_FFT_SIZE / 2;
+    int16_t re[M];
+    int16_t im[M];
+
+    //Mean (gravity, gyro bias) would only leak into the low bins
+    int32_t sum = 0;
+    for (uint16_t n = 0; n < N; n++) {
+        sum += samples[n];
+    }
+    int32_t mean = sum / N;
+
+    //Block floating point: largest sample to 2^13..2^14 so a complex value is
+    //below 2^14 * sqrt(2) and the 1/2-per-stage butterflies cannot overflow
+    int32_t peak = 0;
+    for (uint16_t n = 0; n < N; n++) {
+        int32_t d = samples[n] - mean;
+        if (d < 0) {
+            d = -d;
+        }
+        if (d > peak) {
+            peak = d;
+        }
+    }
+    int8_t shift = 0;
+    while (peak >= 16384) {
+        peak >>= 1;
+        shift--;
+    }
+    while (peak != 0 && peak < 8192) {
+        peak <<= 1;
+        shift++;
+    }
+
+    //Window and pack even/odd samples as one complex sequence of length N/2.
+    //N * x - sum removes the exact mean; the truncated one above (enough for
+    //the peak) would leave up to 1 LSB of offset in the low bins
+    int8_t down = FFT_BITS - shift;
+    for (uint16_t n = 0; n < N; n++) {
+        int32_t d = (int32_t)samples[n] * N - sum;
+        d = down > 0 ? (d + (1L << (down - 1))) >> down : d * (1L << -down);
+        int16_t v = (int16_t)((d * hann(n) + 16384) >> 15);
+        if (n & 1) {
+            im[n >> 1] = v;
+        } else {
+            re[n >> 1] = v;
+        }
+    }
+
+    fft(re, im);
+
+    //Split: X[k] = E[k] + W^k O[k], computed as 2 * X[k] to keep the low bit
+    //Z was scaled by 1/M and the input by 2^shift, undone in the float scale
+    float scale = (float)M / (shift >= 0 ? (float)(1L << shift) : 1.0f / (float)(1L << -shift));
+    scale = scale * scale * 0.25f;
+    for (uint16_t k = 0; k <= M; k++) {
+        uint16_t a = k & (M - 1);
+        uint16_t b = (M - k) & (M - 1);
+        int32_t evenRe = (int32_t)re[a] + re[b];
+        int32_t evenIm = (int32_t)im[a] - im[b];
+        int32_t oddRe = (int32_t)im[a] + im[b];
+        int32_t oddIm = (int32_t)re[b] - re[a];
+        int32_t xr, xi;
+        if (k == M) {
+            xr = evenRe - oddRe;   //W^(N/2) = -1
+            xi = evenIm - oddIm;
+        } else {
+            int32_t c = readQ15(TWIDDLE_COS, k);
+            int32_t s = readQ15(TWIDDLE_SIN, k);
+            xr = evenRe + ((c * oddRe) >> 15) + ((s * oddIm) >> 15);
+            xi = evenIm + ((c * oddIm) >> 15) - ((s * oddRe) >> 15);
+        }
+        float fr = (float)xr;
+        float fi = (float)xi;
+        power[k] = (fr * fr + fi * fi) * scale;
+    }
+}
+
+//In-place radix-2 DIT FFT of N/2 complex Q15 values, every stage scaled by 1/2
+void VibrationAnalyzer::fft(int16_t* re, int16_t* im) {
+    const uint16_t M = VIB_FFT_SIZE / 2;
+
+    for (uint16_t i = 1, j = 0; i < M; i++) {
+        uint16_t bit = M >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint16_t half = 1; half < M; half <<= 1) {
+        //W_(2*half)^j = W_N^(j * stride)
+        uint16_t stride = VIB_FFT_SIZE / (2 * half);
+        for (uint16_t j = 0; j < half; j++) {
+            int32_t c = readQ15(TWIDDLE_COS, j * stride);
+            int32_t s = readQ15(TWIDDLE_SIN, j * stride);
+            for (uint16_t i = j; i < M; i += 2 * half) {
+                uint16_t k = i + half;
+                int32_t tr = (c * re[k] + s * im[k]) >> 15;
+                int32_t ti = (c * im[k] - s * re[k]) >> 15;
+                int32_t ur = re[i];
+                int32_t ui = im[i];
+                re[i] = (int16_t)((ur + tr) >> 1);
+                im[i] = (int16_t)((ui + ti) >> 1);
+                re[k] = (int16_t)((ur - tr) >> 1);
+                im[k] = (int16_t)((ui - ti) >> 1);
+            }
+        }
+    }
+}
+
+//Sum of power over the bins with centre frequency in [fromHz, toHz)
+float VibrationAnalyzer::bandPower(const float* power, float fromHz, float toHz) {
+    uint16_t from = (uint16_t)ceilf(fromHz / BIN_HZ);
+    uint16_t to = (uint16_t)ceilf(toHz / BIN_HZ);
+    if (to > VIB_BINS) {
+        to = VIB_BINS;
+    }
+    float sum = 0.0;
+    for (uint16_t k = from; k < to; k++) {
+        sum += power[k];
+    }
+    return sum;
+}
+
+//Strongest bin in [fromHz, toHz), refined by a parabola through its neighbours
+float VibrationAnalyzer::peakFrequency(const float* power, float fromHz, float toHz) {
+    uint16_t from = (uint16_t)ceilf(fromHz / BIN_HZ);
+    uint16_t to = (uint16_t)ceilf(toHz / BIN_HZ);
+    if (to > VIB_BINS) {
+        to = VIB_BINS;
+    }
+    uint16_t best = from;
+    for (uint16_t k = from; k < to; k++) {
+        if (power[k] > power[best]) {
+            best = k;
+        }
+    }
+    if (power[best] <= 0.0) {
+        return 0.0;
+    }
+    float offset = 0.0;
+    if (best > 0 && best + 1 < VIB_BINS) {
+        float left = power[best - 1];
+        float right = power[best + 1];
+        float denom = left - 2.0f * power[best] + right;
+        if (denom < 0.0) {
+            offset = 0.5f * (left - right) / denom;
+        }
+    }
+    return (best + offset) * BIN_HZ;
+}
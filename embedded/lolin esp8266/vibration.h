@@ -0,0 +1,109 @@
+#ifndef VIBRATION_H
+#define VIBRATION_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#endif
+
+#define VIB_FFT_SIZE          256      //real samples per block, power of 2
+#define VIB_SAMPLE_RATE_HZ    200      //MPU6050 ODR in the DESCENT profile
+#define VIB_SAMPLE_PERIOD_US  (1000000UL / VIB_SAMPLE_RATE_HZ)
+#define VIB_BINS              (VIB_FFT_SIZE / 2 + 1)
+
+//Frequency bands (Hz), bin width is VIB_SAMPLE_RATE_HZ / VIB_FFT_SIZE = 0.78 Hz
+#define VIB_SWING_MIN_HZ      0.3      //pendulum swing of the payload under the canopy
+#define VIB_SWING_MAX_HZ      5.0
+#define VIB_MID_MAX_HZ        20.0     //canopy flutter / breathing
+                                       //above: structural vibration up to Nyquist
+
+//Gate for the camera (RMS over the last block)
+#define VIB_STABLE_SWING_DPS  15.0     //horizontal rotation rate in the swing band
+#define VIB_STABLE_HIGH_G     0.05     //accel magnitude above VIB_MID_MAX_HZ
+
+
+//Result of one analysed block
+struct VibrationReport {
+    bool valid;
+    unsigned long time_ms;        //when the block was completed
+    float swingFreq_hz;           //dominant frequency of gyro x/y in the swing band
+    float swingRms_dps;           //gyro x/y RMS in the swing band
+    float vibFreq_hz;             //dominant frequency of |accel| above VIB_SWING_MAX_HZ
+    float bandLow_g;              //|accel| RMS, VIB_SWING_MIN_HZ .. VIB_SWING_MAX_HZ
+    float bandMid_g;              //|accel| RMS, VIB_SWING_MAX_HZ .. VIB_MID_MAX_HZ
+    float bandHigh_g;             //|accel| RMS, VIB_MID_MAX_HZ .. Nyquist
+    //Same results scaled once per block for SensorData (saturated at 65535)
+    uint16_t swingFreq_cHz;
+    uint16_t swingRms_cdps;
+    uint16_t vibFreq_cHz;
+    uint16_t bandLow_mg;
+    uint16_t bandMid_mg;
+    uint16_t bandHigh_mg;
+    uint32_t cycles;              //CPU cycles spent in process() (ESP.getCycleCount)
+};
+
+
+/**
+ Spectrum of the IMU during the stable descent
+ Responsibilities:
+ - Collect VIB_FFT_SIZE raw MPU6050 samples at a fixed rate (|accel|, gyro x, gyro y)
+ - Hann window + Q15 radix-2 real FFT (N/2 complex FFT + split), twiddles
+   and window in flash, no floating point in the butterflies
+ - Dominant swing / vibration frequency and band RMS of each block
+ - "Stable enough to shoot" gate for the camera
+
+ Input is the raw register value (+-8 g = 4096 LSB/g, +-500 deg/s = 65.5 LSB/(deg/s)).
+ Each block is normalised (block floating point) before the FFT, so a 10 mg
+ vibration keeps the same relative precision as a 2 g one. Against a double
+ precision DFT the peak bin matches and the total RMS is within 0.1%. A swing
+ below ~1 Hz reads up to 10% low: the window main lobe reaches the DC bin.
+ */
+class VibrationAnalyzer {
+public:
+    VibrationAnalyzer();
+
+    //Drop the partial block and the last report (analysis restarts)
+    void reset();
+
+    //Drop only the partial block (sampling gap), the last report stays
+    void discardBlock();
+
+    //One raw sample at VIB_SAMPLE_RATE_HZ, return true when a block is complete
+    bool addSample(const int16_t accel[3], const int16_t gyro[3]);
+    bool isBlockReady() const;
+
+    //FFT of the complete block and update the report (~2 ms at 80 MHz)
+    void process(unsigned long now_ms);
+
+    const VibrationReport& getReport() const;
+
+    /**
+     True if the last block (no older than two block lengths) shows little swing
+     and no strong high frequency vibration
+     */
+    bool isStableForCapture(unsigned long now_ms) const;
+
+    /**
+     Power spectrum of VIB_FFT_SIZE real samples (mean removed, Hann window)
+     power[k] is |X[k]|^2 in input units, k = 0..N/2
+     */
+    static void powerSpectrum(const int16_t* samples, float* power);
+
+private:
+    int16_t accelMag[VIB_FFT_SIZE];    //|accel| at 2048 LSB/g (fits int16 up to 16 g)
+    int16_t gyroX[VIB_FFT_SIZE];
+    int16_t gyroY[VIB_FFT_SIZE];
+    uint16_t count;
+    VibrationReport report;
+
+    //Spectra of the last block, static instead of 1 KB on the loop stack
+    float accelPower[VIB_BINS];
+    float swingPower[VIB_BINS];
+
+    static void fft(int16_t* re, int16_t* im);
+    static float bandPower(const float* power, float fromHz, float toHz);
+    static float peakFrequency(const float* power, float fromHz, float toHz);
+};
+
+#endif
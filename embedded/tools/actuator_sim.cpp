@@ -0,0 +1,356 @@
+//Host check of the parachute release actuator on the mock timer.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o actuator_sim actuator_sim.cpp "../lolin esp8266/actuator.cpp"
+//  ./actuator_sim [seed]
+//
+//Every scenario runs on ActuatorMockTimer with 2-8 us of random interrupt
+//latency and checks the recorded pin edges:
+//  release         FIRE from SAFE (ARM, settle, FIRE, hold, SAFE)
+//  pre-armed       ARM on the landing prediction, FIRE right after the decision
+//  interlocks      FIRE / ARM outside their states, FIRE before the ARM settled (held)
+//  abort           SAFE_MODE in the middle of a sequence
+//  arm timeout     ARMED and never fired
+//  micros() wrap   release across the 32-bit wrap
+//Then the same release driven from a jittery main loop (software PWM), which
+//is what the timer replaces. Exit status 1 if any check fails.
+
+#include "actuator.h"
+
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SIM_STEP_US          250
+#define SIM_LATENCY_MIN_US   2
+#define SIM_LATENCY_MAX_US   8
+#define SIM_WIDTH_TOL_US     (SIM_LATENCY_MAX_US + 1)
+
+static std::mt19937 rng;
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//Advance the mock clock in small steps, new interrupt latency every step
+static void runUntil(uint32_t t_us) {
+    std::uniform_int_distribution<uint32_t> latency(SIM_LATENCY_MIN_US, SIM_LATENCY_MAX_US);
+    uint32_t now = ActuatorMockTimer::now();
+    while ((int32_t)(t_us - now) > 0) {
+        uint32_t step = (uint32_t)(t_us - now) < SIM_STEP_US ? t_us - now : SIM_STEP_US;
+        ActuatorMockTimer::setInterruptLatency(latency(rng));
+        now += step;
+        ActuatorMockTimer::advanceTo(now);
+    }
+}
+
+static std::vector<ActuatorEvent> drain(ServoActuator& actuator) {
+    std::vector<ActuatorEvent> events;
+    ActuatorEvent e;
+    while (actuator.popEvent(e)) {
+        events.push_back(e);
+    }
+    return events;
+}
+
+static const ActuatorEvent* findEvent(const std::vector<ActuatorEvent>& events, ActuatorCommand command) {
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].command == command) {
+            return &events[i];
+        }
+    }
+    return nullptr;
+}
+
+struct PulseCheck {
+    uint32_t pulses;
+    uint32_t locked;
+    uint32_t released;
+    uint32_t badWidth;                    //neither position within tolerance (cut short or stretched)
+    uint32_t shortGap;                    //low time below ACTUATOR_MIN_GAP_US between pulses
+    uint32_t maxWidthError_us;
+};
+
+static bool near(uint32_t width, uint32_t target, uint32_t& error) {
+    if (width < target) {
+        return false;                     //never cut short
+    }
+    error = width - target;
+    return error <= SIM_WIDTH_TOL_US;
+}
+
+static PulseCheck checkPulses() {
+    PulseCheck c = { 0, 0, 0, 0, 0, 0 };
+    uint16_t n = ActuatorMockTimer::getEdgeCount();
+    uint32_t lastFall = 0;
+    bool haveFall = false;
+    for (uint16_t i = 0; i + 1 < n; i++) {
+        if (!ActuatorMockTimer::getEdgeLevel(i)) {
+            continue;
+        }
+        uint32_t rise = ActuatorMockTimer::getEdgeTime(i);
+        uint32_t width = ActuatorMockTimer::getEdgeTime(i + 1) - rise;
+        uint32_t error = 0;
+        c.pulses++;
+        if (near(width, ACTUATOR_PULSE_LOCKED_US, error)) {
+            c.locked++;
+        } else if (near(width, ACTUATOR_PULSE_RELEASED_US, error)) {
+            c.released++;
+        } else {
+            c.badWidth++;
+        }
+        if (error > c.maxWidthError_us) {
+            c.maxWidthError_us = error;
+        }
+        if (haveFall && rise - lastFall < ACTUATOR_MIN_GAP_US) {
+            c.shortGap++;
+        }
+        lastFall = ActuatorMockTimer::getEdgeTime(i + 1);
+        haveFall = true;
+    }
+    return c;
+}
+
+struct ReleaseResult {
+    uint32_t latency_us;                  //decision -> first RELEASED edge
+    uint32_t maxWidthError_us;
+};
+
+static void start(ServoActuator& actuator, uint32_t t0_us) {
+    ActuatorMockTimer::reset(t0_us);
+    actuator = ServoActuator();
+    actuator.begin(0);
+}
+
+//Release from SAFE
+static ReleaseResult scenarioRelease(ServoActuator& actuator, uint32_t t0_us, const char* name) {
+    printf("%s\n", name);
+    start(actuator, t0_us);
+    actuator.setInterlocks(true, true);
+    runUntil(t0_us + 7000);
+    uint32_t decision = ActuatorMockTimer::now();
+    check(actuator.scheduleRelease(decision), "sequence queued");
+    runUntil(decision + ACTUATOR_ARM_SETTLE_US + ACTUATOR_RELEASE_HOLD_US + 100000);
+
+    std::vector<ActuatorEvent> events = drain(actuator);
+    const ActuatorEvent* arm = findEvent(events, ActuatorCommand::ARM);
+    const ActuatorEvent* fire = findEvent(events, ActuatorCommand::FIRE);
+    const ActuatorEvent* safe = findEvent(events, ActuatorCommand::SAFE);
+    for (size_t i = 0; i < events.size(); i++) {
+        ServoActuator::printEvent(events[i]);
+    }
+    bool complete = arm && fire && safe && arm->outcome == ActuatorOutcome::DONE &&
+                    fire->outcome == ActuatorOutcome::DONE && safe->outcome == ActuatorOutcome::DONE;
+    check(complete, "ARM, FIRE, SAFE executed");
+    ReleaseResult result = { 0, 0 };
+    if (!complete) {
+        return result;
+    }
+    check(arm->edge_us - decision <= SIM_LATENCY_MAX_US + ACTUATOR_TIMER_MIN_US, "ARM pulse starts at the decision");
+    uint32_t fireLatency = fire->edge_us - fire->due_us;
+    check(fireLatency <= ACTUATOR_PULSE_LOCKED_US + ACTUATOR_MIN_GAP_US + 2 * SIM_LATENCY_MAX_US,
+          "FIRE edge within one pulse + min gap of due");
+    check(safe->applied_us - fire->applied_us + 2 * (SIM_LATENCY_MAX_US + ACTUATOR_TIMER_MIN_US) >= ACTUATOR_RELEASE_HOLD_US,
+          "RELEASED held for the hold time");
+
+    PulseCheck p = checkPulses();
+    printf("  pulses %u (locked %u, released %u), max width error %u us\n", p.pulses, p.locked, p.released,
+           p.maxWidthError_us);
+    check(p.badWidth == 0, "every pulse is LOCKED or RELEASED, none cut short");
+    check(p.shortGap == 0, "no low gap below ACTUATOR_MIN_GAP_US");
+    check(p.released >= ACTUATOR_RELEASE_HOLD_US / ACTUATOR_FRAME_US, "RELEASED frames for the whole hold");
+    check(ActuatorMockTimer::getEdgeCount() % 2 == 0 && actuator.getState() == ActuatorState::SAFE,
+          "output low and SAFE at the end");
+    result.latency_us = fire->edge_us - decision;
+    result.maxWidthError_us = p.maxWidthError_us;
+    return result;
+}
+
+static ReleaseResult scenarioPreArmed(ServoActuator& actuator) {
+    printf("pre-armed (ARM on the landing prediction, decision 300 ms later)\n");
+    start(actuator, 1000000);
+    actuator.setInterlocks(true, false);                  //DESCENT_STABLE
+    uint32_t t = ActuatorMockTimer::now();
+    actuator.schedule(ActuatorCommand::ARM, t, t);
+    runUntil(t + 300000);
+    actuator.setInterlocks(true, true);                   //LANDING
+    uint32_t decision = ActuatorMockTimer::now() + 4321;   //mid-frame
+    runUntil(decision);
+    actuator.scheduleRelease(decision);
+    runUntil(decision + ACTUATOR_RELEASE_HOLD_US + 100000);
+
+    std::vector<ActuatorEvent> events = drain(actuator);
+    const ActuatorEvent* fire = findEvent(events, ActuatorCommand::FIRE);
+    check(fire && fire->outcome == ActuatorOutcome::DONE && fire->due_us == decision, "FIRE due at the decision");
+    ReleaseResult result = { 0, 0 };
+    if (!fire) {
+        return result;
+    }
+    ServoActuator::printEvent(*fire);
+    check(fire->edge_us - decision <= ACTUATOR_PULSE_LOCKED_US + ACTUATOR_MIN_GAP_US + 2 * SIM_LATENCY_MAX_US,
+          "decision -> RELEASED edge under 4 ms + latency");
+    PulseCheck p = checkPulses();
+    check(p.badWidth == 0, "no pulse cut short by the frame restart");
+    result.latency_us = fire->edge_us - decision;
+    result.maxWidthError_us = p.maxWidthError_us;
+    return result;
+}
+
+static void scenarioInterlocks(ServoActuator& actuator) {
+    printf("interlocks\n");
+    start(actuator, 2000000);
+    uint32_t t = ActuatorMockTimer::now();
+
+    actuator.setInterlocks(false, false);                 //IDLE / ASCENT
+    actuator.schedule(ActuatorCommand::ARM, t, t);
+    actuator.schedule(ActuatorCommand::FIRE, t + 1000, t);
+    runUntil(t + 50000);
+    std::vector<ActuatorEvent> events = drain(actuator);
+    check(events.size() == 2 && events[0].outcome == ActuatorOutcome::NOT_PERMITTED &&
+          events[1].outcome == ActuatorOutcome::NOT_PERMITTED, "ARM and FIRE refused outside their states");
+    check(ActuatorMockTimer::getEdgeCount() == 0, "no pulse on the pin");
+
+    actuator.setInterlocks(true, false);                  //DESCENT_STABLE: may arm, not fire
+    t = ActuatorMockTimer::now();
+    actuator.schedule(ActuatorCommand::ARM, t, t);
+    actuator.schedule(ActuatorCommand::FIRE, t + ACTUATOR_ARM_SETTLE_US + 1000, t);
+    runUntil(t + ACTUATOR_ARM_SETTLE_US + 50000);
+    events = drain(actuator);
+    const ActuatorEvent* fire = findEvent(events, ActuatorCommand::FIRE);
+    check(fire && fire->outcome == ActuatorOutcome::NOT_PERMITTED && actuator.getState() == ActuatorState::ARMED,
+          "FIRE refused in DESCENT_STABLE, stays ARMED");
+
+    actuator.setInterlocks(true, true);
+    actuator.abort(ActuatorMockTimer::now());
+    runUntil(ActuatorMockTimer::now() + 50000);
+    drain(actuator);
+    t = ActuatorMockTimer::now();
+    ActuatorMockTimer::clearEdges();
+    actuator.schedule(ActuatorCommand::FIRE, t, t);
+    runUntil(t + 50000);
+    events = drain(actuator);
+    check(events.size() == 1 && events[0].outcome == ActuatorOutcome::NOT_ARMED &&
+          checkPulses().pulses == 0, "FIRE refused while SAFE");
+
+    t = ActuatorMockTimer::now();
+    actuator.schedule(ActuatorCommand::ARM, t, t);
+    actuator.schedule(ActuatorCommand::FIRE, t + ACTUATOR_ARM_SETTLE_US / 2, t);
+    runUntil(t + ACTUATOR_ARM_SETTLE_US + 50000);
+    events = drain(actuator);
+    const ActuatorEvent* arm = findEvent(events, ActuatorCommand::ARM);
+    fire = findEvent(events, ActuatorCommand::FIRE);
+    check(arm && fire && fire->outcome == ActuatorOutcome::DONE &&
+          fire->applied_us - arm->applied_us >= ACTUATOR_ARM_SETTLE_US,
+          "FIRE before the ARM settled is held until it has");
+    actuator.printStatus();
+}
+
+static void scenarioAbort(ServoActuator& actuator) {
+    printf("abort (SAFE_MODE 50 ms into a release)\n");
+    start(actuator, 3000000);
+    actuator.setInterlocks(true, true);
+    uint32_t t = ActuatorMockTimer::now();
+    actuator.scheduleRelease(t);
+    runUntil(t + 40000 + 500);                            //inside the third LOCKED pulse
+    actuator.setInterlocks(false, false);
+    actuator.abort(ActuatorMockTimer::now());
+    runUntil(t + ACTUATOR_ARM_SETTLE_US + ACTUATOR_RELEASE_HOLD_US + 100000);
+
+    std::vector<ActuatorEvent> events = drain(actuator);
+    uint32_t cancelled = 0;
+    const ActuatorEvent* safe = nullptr;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].outcome == ActuatorOutcome::CANCELLED) {
+            cancelled++;
+        } else if (events[i].command == ActuatorCommand::SAFE) {
+            safe = &events[i];
+        }
+    }
+    check(cancelled == 2, "pending FIRE and SAFE cancelled");
+    check(safe && safe->edge_us > safe->applied_us, "SAFE waits for the pulse in progress to end");
+    PulseCheck p = checkPulses();
+    check(p.released == 0 && p.badWidth == 0, "never released, last pulse complete");
+    check(actuator.getPending() == 0 && actuator.getState() == ActuatorState::SAFE, "queue empty, SAFE");
+}
+
+static void scenarioTimeout(ServoActuator& actuator) {
+    printf("arm timeout\n");
+    start(actuator, 4000000);
+    actuator.setInterlocks(true, false);
+    uint32_t t = ActuatorMockTimer::now();
+    actuator.schedule(ActuatorCommand::ARM, t, t);
+    runUntil(t + ACTUATOR_ARM_TIMEOUT_US + 100000);
+    std::vector<ActuatorEvent> events = drain(actuator);
+    const ActuatorEvent* safe = findEvent(events, ActuatorCommand::SAFE);
+    check(safe && safe->outcome == ActuatorOutcome::TIMEOUT &&
+          safe->applied_us - t >= ACTUATOR_ARM_TIMEOUT_US &&
+          safe->applied_us - t <= ACTUATOR_ARM_TIMEOUT_US + 2 * (SIM_LATENCY_MAX_US + ACTUATOR_TIMER_MIN_US),
+          "automatic SAFE after ACTUATOR_ARM_TIMEOUT_US");
+    check(actuator.getState() == ActuatorState::SAFE, "SAFE");
+}
+
+/**
+ Baseline: the same release with software PWM from loop(). Pulses start and
+ end at loop iterations, loops take 2-15 ms plus an occasional flash write.
+ */
+static void baselineLoop(uint32_t& fireLatency_us, uint32_t& maxWidthError_us) {
+    std::uniform_int_distribution<uint32_t> loopTime(2000, 15000);
+    std::uniform_int_distribution<uint32_t> flash(0, 49);
+    uint32_t now = 0;
+    uint32_t decision = 7000;
+    uint32_t fireDue = decision + ACTUATOR_ARM_SETTLE_US;
+    uint32_t end = fireDue + ACTUATOR_RELEASE_HOLD_US;
+    bool high = false;
+    uint32_t rise = 0;
+    uint32_t nextFrame = decision;
+    fireLatency_us = 0;
+    maxWidthError_us = 0;
+    while (now < end) {
+        uint32_t width = now >= fireDue ? ACTUATOR_PULSE_RELEASED_US : ACTUATOR_PULSE_LOCKED_US;
+        if (high && now - rise >= width) {
+            uint32_t error = now - rise - width;
+            if (error > maxWidthError_us) {
+                maxWidthError_us = error;
+            }
+            high = false;
+        }
+        if (!high && now >= nextFrame) {
+            if (now >= fireDue && fireLatency_us == 0) {
+                fireLatency_us = now - decision;
+            }
+            high = true;
+            rise = now;
+            nextFrame = now + ACTUATOR_FRAME_US;
+        }
+        now += loopTime(rng) + (flash(rng) == 0 ? 200000 : 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t seed = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1;
+    rng.seed(seed);
+    ServoActuator actuator;
+
+    ReleaseResult release = scenarioRelease(actuator, 1000, "release from SAFE");
+    ReleaseResult preArmed = scenarioPreArmed(actuator);
+    scenarioInterlocks(actuator);
+    scenarioAbort(actuator);
+    scenarioTimeout(actuator);
+    ReleaseResult wrapped = scenarioRelease(actuator, 0xFFFFFFFFu - 60000, "micros() wrap during the release");
+
+    uint32_t loopLatency = 0;
+    uint32_t loopWidthError = 0;
+    baselineLoop(loopLatency, loopWidthError);
+
+    printf("\n%-32s %20s %16s\n", "", "decision->RELEASED", "max width error");
+    printf("%-32s %17u us %13u us\n", "timer, from SAFE (incl. settle)", release.latency_us, release.maxWidthError_us);
+    printf("%-32s %17u us %13u us\n", "timer, pre-armed", preArmed.latency_us, preArmed.maxWidthError_us);
+    printf("%-32s %17u us %13u us\n", "timer, across micros() wrap", wrapped.latency_us, wrapped.maxWidthError_us);
+    printf("%-32s %17u us %13u us\n", "main loop software PWM", loopLatency, loopWidthError);
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
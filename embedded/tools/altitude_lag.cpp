@@ -0,0 +1,177 @@
+//Host replay of the altitude lag of each BMP280 sampling profile, as the FSM sees it.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o altitude_lag altitude_lag.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./altitude_lag
+//
+//The flight modules run on LinuxSimHal through flight_sim.h, the BMP280 model
+//converts at the rate and through the IIR filter the driver programmed.
+//1. Step: on the pad, each profile in turn is applied and the payload jumps
+//   SIM_STEP_M (below the liftoff threshold). Output rate from the
+//   conversions counted over SIM_RATE_WINDOW_MS, time for readAll's
+//   altitude_MSL to cover 75% of the step (MSL: on the pad the baseline
+//   follows the first 0.1 hPa of a slow step, see boot_replay). Both are
+//   checked against the datasheet figures in sampling_profiles.cpp: the lag
+//   may exceed the IIR figure by the Hampel filter (it runs per readAll, on
+//   repeated outputs too), one output period and one 20 Hz loop.
+//2. Ramp: the flight_sim.h drop, true minus measured altitude (MSL) in
+//   each phase while moving in the phase's direction, in m and as a delay
+//   at the phase speed, at most the profile's IIR figure + one loop (a
+//   first-order filter trails a ramp by less than its 75% step time).
+//3. Load shedding: for every state the reduced profile keeps the BMP280
+//   settings, period and lag of the full one and only lowers the IMU rate.
+//   The step of part 1 is repeated with SHED_SENSOR_RATE set.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+#include "load_shedding.h"
+
+#include <stdio.h>
+
+#define SIM_STEP_M           5.0
+#define SIM_SETTLE_MS        60000      //5 x the pad IIR lag before the step
+#define SIM_RATE_WINDOW_MS   10000
+#define SIM_HAMPEL_DELAY     3          //samples, centre of the 7-sample window
+#define SIM_FLIGHT_END_MS    200000
+#define SIM_RAMP_MIN_SAMPLES 20
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static void stepResponse(const char* name, MissionState state, bool shed) {
+    const SamplingProfile& profile = shed ? getReducedSamplingProfile(state) : getSamplingProfile(state);
+    printf("\n%s profile (%s), %.0f m step\n", profile.name, name, SIM_STEP_M);
+
+    SimFlightProfile pad = SIM_DEFAULT_FLIGHT;
+    pad.padSeconds = 1e6;
+    FlightSim sim(pad);
+    sim.boot();
+    sim.runUntil(SIM_SETTLE_MS, [&] { return false; });
+    sim.sensors().setShedMask(shed ? 1u << SHED_SENSOR_RATE : 0u);
+    sim.sensors().applyProfile(state);
+
+    uint32_t start_ms = sim.flightMs();
+    uint32_t startConversions = sim.bmp.getConversions();
+    sim.runUntil(start_ms + SIM_RATE_WINDOW_MS, [&] { return false; });
+    double period_ms = (double)SIM_RATE_WINDOW_MS / (sim.bmp.getConversions() - startConversions);
+
+    double before_m = sim.measuredAltitudeMSL();
+    sim.hold(SIM_STEP_M);
+    uint32_t step_ms = sim.flightMs();
+    sim.runUntil(step_ms + 4 * SIM_SETTLE_MS / 5, [&] {
+        return sim.measuredAltitudeMSL() - before_m >= 0.75 * SIM_STEP_M;
+    });
+    uint32_t lag_ms = sim.flightMs() - step_ms;
+
+    char what[80];
+    snprintf(what, sizeof(what), "output period %.1f ms (datasheet %u ms)", period_ms, profile.baroPeriod_ms);
+    check(fabs(period_ms - profile.baroPeriod_ms) <= 0.05 * profile.baroPeriod_ms + 1.0, what);
+    uint32_t sample_ms = profile.baroPeriod_ms > SIM_LOOP_MS ? profile.baroPeriod_ms : SIM_LOOP_MS;
+    uint32_t bound_ms = profile.baroLag_ms + (SIM_HAMPEL_DELAY + 1) * sample_ms + SIM_LOOP_MS;
+    snprintf(what, sizeof(what), "75%% of the step after %u ms (IIR %u ms, bound %u)", lag_ms, profile.baroLag_ms,
+             bound_ms);
+    check(sim.measuredAltitudeMSL() - before_m >= 0.75 * SIM_STEP_M && lag_ms <= bound_ms, what);
+    check(sim.state() == MissionState::IDLE, "the step stayed below liftoff");
+}
+
+struct PhaseLag {
+    const char* name;
+    MissionState state;
+    double sum_m;
+    double speed_sum;
+    uint32_t samples;
+};
+
+static void rampLag() {
+    printf("\nflight_sim.h drop, true - measured altitude\n");
+    PhaseLag phases[] = {
+        { "ASCENT", MissionState::ASCENT, 0.0, 0.0, 0 },
+        { "DESCENT_FREE", MissionState::DESCENT_FREE, 0.0, 0.0, 0 },
+        { "DESCENT_STABLE", MissionState::DESCENT_STABLE, 0.0, 0.0, 0 },
+    };
+    const uint8_t count = sizeof(phases) / sizeof(phases[0]);
+
+    FlightSim sim;
+    sim.boot();
+    MissionState last = MissionState::BOOT;
+    uint32_t entered_ms = 0;
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        if (sim.state() != last) {
+            last = sim.state();
+            entered_ms = sim.flightMs();
+        }
+        //Skip the profile switch: the IIR of the previous profile is still draining
+        bool settled = sim.flightMs() - entered_ms >= 2u * getSamplingProfile(last).baroLag_ms + 500u;
+        //ASCENT lasts past the release until the fall is seen
+        bool moving = last == MissionState::ASCENT ? sim.trueVerticalSpeed() > 0.0 : sim.trueVerticalSpeed() < 0.0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (phases[i].state == last && settled && moving) {
+                phases[i].sum_m += SIM_GROUND_MSL_M + sim.trueAltitudeAGL() - sim.measuredAltitudeMSL();
+                phases[i].speed_sum += sim.trueVerticalSpeed();
+                phases[i].samples++;
+            }
+        }
+        return last == MissionState::FINAL_REPORT || last == MissionState::SAFE_MODE;
+    });
+
+    for (uint8_t i = 0; i < count; i++) {
+        const PhaseLag& p = phases[i];
+        if (p.samples < SIM_RAMP_MIN_SAMPLES) {
+            printf("  %-16s %u settled samples, phase too short to measure\n", p.name, p.samples);
+            continue;
+        }
+        double lag_m = p.sum_m / p.samples;
+        double speed = p.speed_sum / p.samples;
+        double delay_ms = lag_m / speed * 1000.0;
+        uint32_t bound_ms = getSamplingProfile(p.state).baroLag_ms + SIM_LOOP_MS;
+        char what[80];
+        snprintf(what, sizeof(what), "%-15s %5.2f m at %5.2f m/s = %3.0f ms (bound %u)", p.name, lag_m, speed,
+                 delay_ms, bound_ms);
+        check(delay_ms >= 0.0 && delay_ms <= bound_ms, what);
+    }
+    check(sim.state() == MissionState::FINAL_REPORT, "flight ends in FINAL_REPORT");
+}
+
+static void shedProfiles() {
+    static const char* const STATE_NAMES[] = {
+        "BOOT", "IDLE", "ASCENT", "DESCENT_FREE", "DESCENT_STABLE", "LANDING", "FINAL_REPORT", "SAFE_MODE"
+    };
+    printf("\nreduced profiles (load shedding)\n");
+    for (uint8_t i = 0; i < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]); i++) {
+        MissionState state = static_cast<MissionState>(i);
+        const SamplingProfile& full = getSamplingProfile(state);
+        const SamplingProfile& reduced = getReducedSamplingProfile(state);
+        bool sameBaro = reduced.tempSampling == full.tempSampling && reduced.pressSampling == full.pressSampling &&
+                        reduced.filter == full.filter && reduced.standby == full.standby;
+        char what[80];
+        snprintf(what, sizeof(what), "%-14s %s -> %s, lag %u -> %u ms", STATE_NAMES[i], full.name, reduced.name,
+                 full.baroLag_ms, reduced.baroLag_ms);
+        check(sameBaro && reduced.baroLag_ms <= full.baroLag_ms && reduced.baroPeriod_ms <= full.baroPeriod_ms &&
+              reduced.mpuRateDivisor >= full.mpuRateDivisor, what);
+    }
+}
+
+int main() {
+#ifdef FIXED_POINT_PIPELINE
+    printf("altitude lag, fixed-point build\n");
+#else
+    printf("altitude lag, float build\n");
+#endif
+    SimPrint::setEnabled(false);
+
+    stepResponse("IDLE", MissionState::IDLE, false);
+    stepResponse("ASCENT", MissionState::ASCENT, false);
+    stepResponse("DESCENT_STABLE", MissionState::DESCENT_STABLE, false);
+    rampLag();
+    shedProfiles();
+    stepResponse("ASCENT, shed", MissionState::ASCENT, true);
+    stepResponse("DESCENT_STABLE, shed", MissionState::DESCENT_STABLE, true);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+//Host replay of the ground baseline: boot to ready, pad wait, slow lift and warm resets at altitude.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o boot_replay boot_replay.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./boot_replay [-v]
+//
+//The flight modules run on LinuxSimHal through flight_sim.h (20 Hz loop,
+//1.5 Pa baro noise, 488 m ground); -v shows their boot log.
+//1. Cold boot on the pad: BOOT must end on the estimator, not on a timeout,
+//   with the ground pressure of the model.
+//2. Four minutes on the pad (the IDLE timeout is five) while a front passes
+//   (-200 Pa/h): the baseline follows the weather and never restarts.
+//3. The drone lifts the payload at 2 m/s: every step stays below the motion
+//   gate, the baseline must not ride up with it (liftoff missed) and the
+//   reference must stay within SIM_LIFT_TOL_M of the ground. Liftoff comes
+//   late by up to the IIR lag of the pad profile (~1.1 s to 75%), one of
+//   its output periods (~0.54 s, the sample may just have been taken) and
+//   one loop.
+//4. Watchdog reset at altitude, climbing and under canopy: the board boots
+//   warm, the restored ground pressure never moves for the rest of the flight
+//   and the flight still ends in FINAL_REPORT.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_READY_MAX_MS     3000
+#define SIM_GROUND_TOL_HPA   0.03       //~0.25 m
+#define SIM_PAD_WAIT_S       240
+#define SIM_FRONT_PA_H       -200.0
+#define SIM_LIFT_TOL_M       1.5
+#define SIM_FLIGHT_END_MS    200000
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static uint32_t transitionTime(const FlightSim& sim, MissionState state) {
+    const std::vector<SimTransition>& log = sim.transitions();
+    for (size_t i = 0; i < log.size(); i++) {
+        if (log[i].state == state) {
+            return log[i].flight_ms;
+        }
+    }
+    return 0;
+}
+
+static double groundErrorMeters(const FlightSim& sim, double groundPressure_hPa) {
+    return GroundBaseline::pressureToAltitude(groundPressure_hPa) -
+           GroundBaseline::pressureToAltitude(sim.trueGroundPressure_hPa());
+}
+
+static void coldBoot() {
+    printf("\ncold boot on the pad\n");
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_READY_MAX_MS + 2000, [&] { return sim.state() != MissionState::BOOT; });
+
+    char what[80];
+    uint32_t ready_ms = transitionTime(sim, MissionState::IDLE);
+    snprintf(what, sizeof(what), "BOOT -> IDLE on the estimator (%u ms)", ready_ms);
+    check(sim.state() == MissionState::IDLE && ready_ms <= SIM_READY_MAX_MS, what);
+    double error = sim.sensors().getGroundPressure() - sim.trueGroundPressure_hPa();
+    snprintf(what, sizeof(what), "ground pressure within %.2f hPa (%+.3f)", SIM_GROUND_TOL_HPA, error);
+    check(fabs(error) <= SIM_GROUND_TOL_HPA, what);
+}
+
+static void padWait() {
+    printf("\n%d s on the pad, weather %+.0f Pa/h\n", SIM_PAD_WAIT_S, SIM_FRONT_PA_H);
+    SimFlightProfile profile = SIM_DEFAULT_FLIGHT;
+    profile.padSeconds = SIM_PAD_WAIT_S + 10;
+    profile.weather_Pa_h = SIM_FRONT_PA_H;
+    FlightSim sim(profile);
+    sim.boot();
+
+    uint32_t restarts = 0;
+    bool wasReady = false;
+    double maxError = 0.0;
+    sim.runUntil(SIM_PAD_WAIT_S * 1000, [&] {
+        bool ready = sim.sensors().getGroundBaseline().isReady();
+        if (wasReady && !ready) {
+            restarts++;
+        }
+        wasReady = ready;
+        if (ready) {
+            double error = fabs(sim.sensors().getGroundPressure() - sim.trueGroundPressure_hPa());
+            if (error > maxError) {
+                maxError = error;
+            }
+        }
+        return false;
+    });
+
+    char what[80];
+    check(sim.state() == MissionState::IDLE, "still IDLE");
+    snprintf(what, sizeof(what), "baseline never restarted (%u restarts)", restarts);
+    check(restarts == 0, what);
+    snprintf(what, sizeof(what), "follows the weather within %.2f hPa (max %.3f)", SIM_GROUND_TOL_HPA, maxError);
+    check(maxError <= SIM_GROUND_TOL_HPA, what);
+}
+
+static void slowLift() {
+    printf("\nslow lift at %.0f m/s\n", SIM_DEFAULT_FLIGHT.climb_mps);
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] { return sim.state() == MissionState::ASCENT; });
+
+    char what[80];
+    const SamplingProfile& pad = getSamplingProfile(MissionState::IDLE);
+    double lag_s = (pad.baroLag_ms + pad.baroPeriod_ms + SIM_LOOP_MS) / 1000.0;
+    double latest_m = 10.0 + SIM_DEFAULT_FLIGHT.climb_mps * lag_s;
+    snprintf(what, sizeof(what), "liftoff below %.1f m true AGL (%.1f m)", latest_m, sim.trueAltitudeAGL());
+    check(sim.state() == MissionState::ASCENT && sim.trueAltitudeAGL() < latest_m, what);
+    double error = groundErrorMeters(sim, sim.sensors().getGroundPressure());
+    snprintf(what, sizeof(what), "frozen reference within %.1f m of the ground (%+.2f m)", SIM_LIFT_TOL_M, error);
+    check(fabs(error) <= SIM_LIFT_TOL_M && sim.sensors().getGroundBaseline().isFrozen(), what);
+}
+
+//Reset once stop() says so, then fly on and watch the reference
+static void warmReset(const char* name, MissionState resetState, double resetAGL_m) {
+    printf("\nwatchdog reset in %s at %.0f m\n", name, resetAGL_m);
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        return sim.state() == resetState &&
+               (resetState == MissionState::ASCENT ? sim.trueAltitudeAGL() >= resetAGL_m
+                                                   : sim.trueAltitudeAGL() <= resetAGL_m);
+    });
+    float before = sim.sensors().getGroundPressure();
+    bool warm = sim.boot();
+
+    char what[80];
+    snprintf(what, sizeof(what), "boots warm in %s", name);
+    check(warm && sim.state() == resetState, what);
+    check(sim.sensors().getGroundBaseline().isFrozen(), "restored baseline is frozen");
+
+    uint32_t moved = 0;
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        if (sim.sensors().getGroundPressure() != before || !sim.sensors().getGroundBaseline().isFrozen()) {
+            moved++;
+        }
+        return sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+    });
+    snprintf(what, sizeof(what), "ground pressure unchanged to the end (%.3f hPa, %u moves)", before, moved);
+    check(moved == 0 && sim.sensors().getGroundPressure() == before, what);
+    snprintf(what, sizeof(what), "flight ends in FINAL_REPORT (%u ms)", sim.flightMs());
+    check(sim.state() == MissionState::FINAL_REPORT, what);
+}
+
+int main(int argc, char** argv) {
+    SimPrint::setEnabled(argc > 1 && strcmp(argv[1], "-v") == 0);
+#ifdef FIXED_POINT_PIPELINE
+    printf("boot replay, fixed-point build\n");
+#else
+    printf("boot replay, float build\n");
+#endif
+
+    coldBoot();
+    padWait();
+    slowLift();
+    warmReset("ASCENT", MissionState::ASCENT, 50.0);
+    warmReset("DESCENT_STABLE", MissionState::DESCENT_STABLE, 50.0);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+//Host run of the fault injection benchmark over the simulated flight: detection, recovery and FSM effect.
+//
+//  g++ -O2 -std=c++11 -DFAULT_INJECTION -DGPS_USE_UBX -I"../lolin esp8266" -o fault_replay fault_replay.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./fault_replay [-v]
+//
+//The flight modules run on LinuxSimHal through flight_sim.h with the GPS in
+//UBX mode (the host NMEA parser is a stub) and a 5 Hz NAV stream with a 3D
+//fix on its UART; -v shows the [FAULT] / [FSM] log and the board's report.
+//1. FAULT_BENCHMARK_SCRIPT, the bench the board runs, from boot: on the pad
+//   and through the climb of a higher, slower drop so the script ends before
+//   the release. Every step is detected and recovers within the bounds of
+//   SensorManager's health checks, except the GPS dropout shorter than
+//   GPS_DROPOUT_MS, which must go unnoticed.
+//2. A descent script: barometer and IMU NAKs in free fall, a stuck barometer
+//   and IMU under the canopy.
+//For both, the transitions are compared with the same flight (same seed,
+//same baro noise) without faults: same sequence, and a transition may come
+//late by at most the fault that hid the data plus its recovery, never early.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_FLIGHT_END_MS    400000
+#define SIM_GPS_PERIOD_MS    200
+#define SIM_GPS_PIN          4          //GPS_DriverT default RX pin
+#define SIM_BMP280           0x76
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//Climb 2 m/s to 220 m (release at 120 s, after the 105 s bench), free fall to the 80 m deploy
+static const SimFlightProfile SIM_BENCH_FLIGHT = { 10.0, 220.0, 2.0, 80.0, -25.0, -5.0, 1.5, 0.0 };
+
+//Descent faults, start_ms from boot: release at 120 s, free fall to ~128 s, canopy to ~141 s
+static const FaultStep DESCENT_SCRIPT[] = {
+    //fault                        addr             start_ms  duration_ms
+    { FaultClass::I2C_NAK,         SIM_BMP280,        119500,      2000 },    //across the release
+    { FaultClass::I2C_NAK,         MPU6050_ADDRESS,   123000,      1000 },
+    { FaultClass::STUCK_VALUE,     SIM_BMP280,        130000,      5000 },
+    { FaultClass::STUCK_VALUE,     MPU6050_ADDRESS,   136000,      5000 },
+};
+static const uint8_t DESCENT_STEPS = sizeof(DESCENT_SCRIPT) / sizeof(DESCENT_SCRIPT[0]);
+
+static const char* stateName(MissionState state) {
+    switch (state) {
+        case MissionState::BOOT:            return "BOOT";
+        case MissionState::IDLE:            return "IDLE";
+        case MissionState::ASCENT:          return "ASCENT";
+        case MissionState::DESCENT_FREE:    return "DESCENT_FREE";
+        case MissionState::DESCENT_STABLE:  return "DESCENT_STABLE";
+        case MissionState::LANDING:         return "LANDING";
+        case MissionState::FINAL_REPORT:    return "FINAL_REPORT";
+        case MissionState::SAFE_MODE:       return "SAFE_MODE";
+        default:                            return "?";
+    }
+}
+
+static void appendFrame(std::vector<uint8_t>& out, uint8_t msgId, const void* payload, uint16_t len) {
+    uint8_t frame[UBX_MAX_PAYLOAD + 8];
+    uint16_t n = UBX_Parser::buildFrame(UBX_CLASS_NAV, msgId, (const uint8_t*)payload, len, frame, sizeof(frame));
+    out.insert(out.end(), frame, frame + n);
+}
+
+//One NAV epoch with a 3D fix over the pad, week 2440 (2026) so the RTC can be set from it
+static void sendEpoch(uint32_t flight_ms) {
+    uint32_t iTOW = 345600000 + flight_ms;
+    UBX_NavPosllh p;
+    memset(&p, 0, sizeof(p));
+    p.iTOW = iTOW;
+    p.lat = 475000000;
+    p.lon = 190000000;
+    p.hMSL = (int32_t)(SIM_GROUND_MSL_M * 1000);
+    p.height = p.hMSL + 42000;
+    p.hAcc = 2500;
+    p.vAcc = 4000;
+    UBX_NavVelned v;
+    memset(&v, 0, sizeof(v));
+    v.iTOW = iTOW;
+    UBX_NavSol s;
+    memset(&s, 0, sizeof(s));
+    s.iTOW = iTOW;
+    s.week = 2440;
+    s.gpsFix = 3;
+    s.flags = 0x0D;
+    s.numSV = 8;
+
+    std::vector<uint8_t> epoch;
+    appendFrame(epoch, UBX_NAV_POSLLH, &p, sizeof(p));
+    appendFrame(epoch, UBX_NAV_VELNED, &v, sizeof(v));
+    appendFrame(epoch, UBX_NAV_SOL, &s, sizeof(s));
+    SimUart::inject(SIM_GPS_PIN, epoch.data(), (uint16_t)epoch.size());
+}
+
+//Fly to FINAL_REPORT with the GPS stream, script == nullptr: no faults
+static void fly(FlightSim& sim, const FaultStep* script, uint8_t steps) {
+    sim.boot();
+    faultInjector.begin(script, steps, FAULT_INJECTION_SEED);
+    uint32_t nextEpoch_ms = 0;
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        while (sim.flightMs() >= nextEpoch_ms) {
+            sendEpoch(nextEpoch_ms);
+            nextEpoch_ms += SIM_GPS_PERIOD_MS;
+        }
+        //Let the injector settle and report before stopping
+        bool done = sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+        return done && (script == nullptr || faultInjector.isFinished());
+    });
+}
+
+//Worst case between the fault showing and SensorManager calling it, per class
+static uint32_t detectBound_ms(const FaultStep& step) {
+    switch (step.fault) {
+        case FaultClass::I2C_NAK:
+            return 3 * SIM_LOOP_MS + 100;                  //3 failed bursts, one per loop at worst
+        case FaultClass::STUCK_VALUE:
+            return 300 + 4 * 526 + 100;                    //STUCK_MIN_MS + 4 pad baro periods
+        case FaultClass::GPS_GARBAGE:
+            return 2 * 1000 + 100;                         //two error windows
+        case FaultClass::GPS_DROPOUT:
+            return 2500 + SIM_GPS_PERIOD_MS + 100;         //GPS_DROPOUT_MS after the last byte
+        case FaultClass::RTC_POWER_LOSS:
+            return 2 * 1000 + 100;                         //next async read, next RTC check
+        default:
+            return 0;
+    }
+}
+
+static uint32_t recoverBound_ms(const FaultStep& step) {
+    switch (step.fault) {
+        case FaultClass::I2C_NAK:
+        case FaultClass::STUCK_VALUE:
+            return 500 + 526 + 100;                        //next re-init, next changed sample
+        case FaultClass::GPS_GARBAGE:
+            return 2 * 1000 + 100;                         //one clean error window
+        case FaultClass::GPS_DROPOUT:
+            return SIM_GPS_PERIOD_MS + 100;                //first byte back
+        case FaultClass::RTC_POWER_LOSS:
+            return 4 * 1000 + 100;                         //latched: detected, set from GPS, next check
+        default:
+            return 0;
+    }
+}
+
+static void report(const FaultStep* script, uint8_t steps) {
+    printf("  step  class            addr  start_ms  dur_ms  detect_ms  recover_ms  fsm\n");
+    uint8_t missed = 0, slow = 0, unrecovered = 0, expectedMiss = 0;
+    for (uint8_t i = 0; i < steps; i++) {
+        const FaultStep& step = script[i];
+        const FaultStepResult& r = faultInjector.getResult(i);
+        printf("  %4u  %-15s  0x%02X  %8u  %6u  ", i, getFaultClassName(step.fault), step.address,
+               step.start_ms, step.duration_ms);
+        if (r.detected) {
+            printf("%9u  ", r.detect_ms);
+        } else {
+            printf("%9s  ", "-");
+        }
+        if (r.recovered) {
+            printf("%10u  ", r.recover_ms);
+        } else {
+            printf("%10s  ", "-");
+        }
+        printf("%3u\n", r.transitions);
+
+        //Shorter than the dropout timeout: by design never a fault
+        bool tooShort = step.fault == FaultClass::GPS_DROPOUT && step.duration_ms < 2500;
+        if (tooShort) {
+            expectedMiss += r.detected ? 0 : 1;
+            continue;
+        }
+        if (!r.detected) {
+            missed++;
+            continue;
+        }
+        if (r.detect_ms > detectBound_ms(step)) {
+            slow++;
+        }
+        if (!r.recovered || r.recover_ms > recoverBound_ms(step)) {
+            unrecovered++;
+        }
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "every fault detected (%u missed)", missed);
+    check(missed == 0, what);
+    snprintf(what, sizeof(what), "detected within the health check bounds (%u late)", slow);
+    check(slow == 0, what);
+    snprintf(what, sizeof(what), "recovered within the health check bounds (%u not)", unrecovered);
+    check(unrecovered == 0, what);
+}
+
+//Transitions against the clean flight: same sequence, late by at most the fault window
+static void compare(const FlightSim& clean, const FlightSim& faulted, const FaultStep* script, uint8_t steps) {
+    const std::vector<SimTransition>& a = clean.transitions();
+    const std::vector<SimTransition>& b = faulted.transitions();
+    bool same = a.size() == b.size();
+    for (size_t i = 0; same && i < a.size(); i++) {
+        same = a[i].state == b[i].state;
+    }
+    printf("  transitions      clean  faulted\n");
+    for (size_t i = 0; i < a.size() || i < b.size(); i++) {
+        printf("  %-14s %7d  %7d\n", stateName(i < b.size() ? b[i].state : a[i].state),
+               i < a.size() ? (int)a[i].flight_ms : -1, i < b.size() ? (int)b[i].flight_ms : -1);
+    }
+    check(same, "same transition sequence as the clean flight");
+
+    uint32_t worstLate = 0;
+    bool early = false;
+    for (size_t i = 0; same && i < a.size(); i++) {
+        if (b[i].flight_ms + SIM_LOOP_MS < a[i].flight_ms) {
+            early = true;
+        }
+        if (b[i].flight_ms > a[i].flight_ms && b[i].flight_ms - a[i].flight_ms > worstLate) {
+            worstLate = b[i].flight_ms - a[i].flight_ms;
+        }
+    }
+    uint32_t longest = 0;
+    for (uint8_t i = 0; i < steps; i++) {
+        uint32_t window = script[i].duration_ms + recoverBound_ms(script[i]);
+        longest = window > longest ? window : longest;
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "no transition early, late by %u ms at most (bound %u)", worstLate, longest);
+    check(same && !early && worstLate <= longest, what);
+}
+
+static void run(const char* name, const SimFlightProfile& profile, const FaultStep* script, uint8_t steps,
+                bool verbose) {
+    printf("\n%s, %u steps\n", name, steps);
+    FlightSim clean(profile);
+    fly(clean, nullptr, 0);
+    FlightSim faulted(profile);
+    fly(faulted, script, steps);
+    if (verbose) {
+        faultInjector.printReport();
+    }
+    report(script, steps);
+    compare(clean, faulted, script, steps);
+    check(faulted.state() == MissionState::FINAL_REPORT, "flight ends in FINAL_REPORT");
+}
+
+int main(int argc, char** argv) {
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+#ifdef FIXED_POINT_PIPELINE
+    printf("fault replay, fixed-point build\n");
+#else
+    printf("fault replay, float build\n");
+#endif
+
+    //Boot logs only in verbose mode, the clean flights stay quiet
+    SimPrint::setEnabled(verbose);
+    run("FAULT_BENCHMARK_SCRIPT, pad and climb", SIM_BENCH_FLIGHT, FAULT_BENCHMARK_SCRIPT, FAULT_BENCHMARK_STEPS,
+        verbose);
+    run("descent script", SIM_BENCH_FLIGHT, DESCENT_SCRIPT, DESCENT_STEPS, verbose);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
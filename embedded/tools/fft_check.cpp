@@ -0,0 +1,243 @@
+//Host accuracy check and benchmark of the VibrationAnalyzer Q15 FFT against a double precision DFT.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o fft_check fft_check.cpp "../lolin esp8266/vibration.cpp" "../lolin esp8266/fixed_point.cpp"
+//  ./fft_check [-v]
+//
+//1. Random blocks: SIM_BLOCKS blocks of VIB_FFT_SIZE samples, a dominant
+//   tone, up to two weaker ones, white noise and an offset (gravity, gyro
+//   bias), amplitudes from a 10 mg vibration to a few g. powerSpectrum() is
+//   compared with a double DFT of the same samples (double mean removed,
+//   exact Hann window): the peak bin must match and the total RMS (Parseval
+//   over all bins) must be within SIM_RMS_TOLERANCE.
+//2. Tones through addSample()/process(): the report frequencies within half
+//   a bin, the band RMS within a few percent of the tone's, a swing below
+//   1 Hz within the 10% the vibration.h comment allows.
+//3. Host ns per powerSpectrum() and per process() (three spectra). The
+//   LX106 has no FPU and runs the butterflies in integer; its cycles are in
+//   VibrationReport::cycles on the board.
+//-v lists every random block.
+
+#include "vibration.h"
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_BLOCKS           200
+#define SIM_RMS_TOLERANCE    0.001      //0.1%, the vibration.h figure
+#define SIM_BENCH_PASSES     2000
+#define ACCEL_LSB_PER_G      4096.0     //raw register, +-8 g
+#define GYRO_LSB_PER_DPS     65.5
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//|X[k]|^2 of the mean-removed, Hann-windowed block, k = 0..N/2
+static void referenceSpectrum(const int16_t* samples, double* power) {
+    const int N = VIB_FFT_SIZE;
+    double mean = 0.0;
+    for (int n = 0; n < N; n++) {
+        mean += samples[n];
+    }
+    mean /= N;
+    double x[VIB_FFT_SIZE];
+    for (int n = 0; n < N; n++) {
+        x[n] = (samples[n] - mean) * 0.5 * (1.0 - cos(2.0 * M_PI * n / N));
+    }
+    for (int k = 0; k < VIB_BINS; k++) {
+        double re = 0.0, im = 0.0;
+        for (int n = 0; n < N; n++) {
+            double a = 2.0 * M_PI * k * n / N;
+            re += x[n] * cos(a);
+            im -= x[n] * sin(a);
+        }
+        power[k] = re * re + im * im;
+    }
+}
+
+template <typename T>
+static int peakBin(const T* power) {
+    int best = 0;
+    for (int k = 1; k < VIB_BINS; k++) {
+        if (power[k] > power[best]) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+static int16_t clamp16(double v) {
+    v = floor(v + 0.5);
+    return (int16_t)(v > 32767.0 ? 32767.0 : (v < -32768.0 ? -32768.0 : v));
+}
+
+//Dominant tone of amplitude `amplitude` LSB, two weaker ones, noise and offset
+static void randomBlock(std::mt19937& rng, int16_t* samples, double& amplitude, double& freq) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    const double nyquist = VIB_SAMPLE_RATE_HZ / 2.0;
+    const double binHz = (double)VIB_SAMPLE_RATE_HZ / VIB_FFT_SIZE;
+
+    //41 LSB (10 mg at 4096 LSB/g) .. 12000 LSB, log uniform
+    amplitude = 41.0 * pow(12000.0 / 41.0, unit(rng));
+    //2 bins clear of DC and Nyquist so the main lobe is whole
+    freq = 2.0 * binHz + unit(rng) * (nyquist - 4.0 * binHz);
+    double phase = 2.0 * M_PI * unit(rng);
+    double offset = (unit(rng) - 0.5) * (32767.0 - amplitude * 1.6) * 0.5;
+    double f2 = 2.0 * binHz + unit(rng) * (nyquist - 4.0 * binHz);
+    double f3 = 2.0 * binHz + unit(rng) * (nyquist - 4.0 * binHz);
+    double a2 = amplitude * 0.4 * unit(rng);
+    double a3 = amplitude * 0.2 * unit(rng);
+    double noise = amplitude * 0.05 + 1.0;
+    for (int n = 0; n < VIB_FFT_SIZE; n++) {
+        double t = (double)n / VIB_SAMPLE_RATE_HZ;
+        double v = offset + amplitude * sin(2.0 * M_PI * freq * t + phase) +
+                   a2 * sin(2.0 * M_PI * f2 * t) + a3 * cos(2.0 * M_PI * f3 * t) + noise * gauss(rng);
+        samples[n] = clamp16(v);
+    }
+}
+
+static void randomBlocks(bool verbose) {
+    printf("\n%u random blocks against a double DFT\n", SIM_BLOCKS);
+    std::mt19937 rng(1);
+    uint32_t peakMismatch = 0;
+    double worstRms = 0.0;
+    double sumRms = 0.0;
+    double worstBin_dB = -1000.0;
+    for (uint32_t b = 0; b < SIM_BLOCKS; b++) {
+        int16_t samples[VIB_FFT_SIZE];
+        double amplitude, freq;
+        randomBlock(rng, samples, amplitude, freq);
+
+        float power[VIB_BINS];
+        double reference[VIB_BINS];
+        VibrationAnalyzer::powerSpectrum(samples, power);
+        referenceSpectrum(samples, reference);
+
+        int peak = peakBin(power);
+        int refPeak = peakBin(reference);
+        double total = 0.0, refTotal = 0.0, errorPeak = 0.0;
+        for (int k = 0; k < VIB_BINS; k++) {
+            total += power[k];
+            refTotal += reference[k];
+            double e = fabs(sqrt((double)power[k]) - sqrt(reference[k]));
+            errorPeak = e > errorPeak ? e : errorPeak;
+        }
+        double rmsError = fabs(sqrt(total / refTotal) - 1.0);
+        //Largest magnitude error of any bin relative to the peak
+        double bin_dB = 20.0 * log10(errorPeak / sqrt(reference[refPeak]) + 1e-12);
+
+        peakMismatch += peak != refPeak ? 1 : 0;
+        worstRms = rmsError > worstRms ? rmsError : worstRms;
+        sumRms += rmsError;
+        worstBin_dB = bin_dB > worstBin_dB ? bin_dB : worstBin_dB;
+        if (verbose) {
+            printf("  %3u  %7.1f LSB %6.2f Hz  peak %3d/%3d  RMS %+.4f%%  bin error %6.1f dB\n", b, amplitude,
+                   freq, peak, refPeak, 100.0 * (sqrt(total / refTotal) - 1.0), bin_dB);
+        }
+    }
+
+    char what[80];
+    snprintf(what, sizeof(what), "peak bin matches (%u mismatches)", peakMismatch);
+    check(peakMismatch == 0, what);
+    snprintf(what, sizeof(what), "total RMS within %.2f%% (max %.4f%%, mean %.4f%%)", 100.0 * SIM_RMS_TOLERANCE,
+             100.0 * worstRms, 100.0 * sumRms / SIM_BLOCKS);
+    check(worstRms <= SIM_RMS_TOLERANCE, what);
+    printf("  worst bin magnitude error %.1f dB below the peak\n", worstBin_dB);
+}
+
+//One block of a gyro x swing and an |accel| vibration on top of 1 g
+static const VibrationReport& tones(VibrationAnalyzer& analyzer, double swingHz, double swing_dps, double vibHz,
+                                    double vib_g) {
+    analyzer.reset();
+    for (int n = 0; n < VIB_FFT_SIZE; n++) {
+        double t = (double)n / VIB_SAMPLE_RATE_HZ;
+        int16_t accel[3] = { 0, 0, clamp16(ACCEL_LSB_PER_G * (1.0 + vib_g * sin(2.0 * M_PI * vibHz * t))) };
+        int16_t gyro[3] = { clamp16(GYRO_LSB_PER_DPS * swing_dps * sin(2.0 * M_PI * swingHz * t)), 0, 0 };
+        analyzer.addSample(accel, gyro);
+    }
+    analyzer.process(0);
+    return analyzer.getReport();
+}
+
+static void toneReports() {
+    printf("\ntones through process()\n");
+    const double halfBin = 0.5 * VIB_SAMPLE_RATE_HZ / VIB_FFT_SIZE;
+    VibrationAnalyzer analyzer;
+    char what[80];
+
+    const VibrationReport& r = tones(analyzer, 2.3, 20.0, 47.0, 0.1);
+    snprintf(what, sizeof(what), "swing 2.30 Hz reads %.2f Hz", r.swingFreq_hz);
+    check(fabs(r.swingFreq_hz - 2.3) <= halfBin, what);
+    snprintf(what, sizeof(what), "swing 20 dps RMS %.2f reads %.2f", 20.0 / sqrt(2.0), r.swingRms_dps);
+    check(fabs(r.swingRms_dps / (20.0 / sqrt(2.0)) - 1.0) < 0.03, what);
+    snprintf(what, sizeof(what), "vibration 47.00 Hz reads %.2f Hz", r.vibFreq_hz);
+    check(fabs(r.vibFreq_hz - 47.0) <= halfBin, what);
+    snprintf(what, sizeof(what), "0.1 g RMS %.4f reads %.4f g in the high band", 0.1 / sqrt(2.0), r.bandHigh_g);
+    check(fabs(r.bandHigh_g / (0.1 / sqrt(2.0)) - 1.0) < 0.03, what);
+    snprintf(what, sizeof(what), "low and mid band quiet (%.4f, %.4f g)", r.bandLow_g, r.bandMid_g);
+    check(r.bandLow_g < 0.002 && r.bandMid_g < 0.002, what);
+
+    const VibrationReport& slow = tones(analyzer, 0.8, 20.0, 47.0, 0.01);
+    snprintf(what, sizeof(what), "0.80 Hz swing RMS %.2f reads %.2f (10%% low at most)", 20.0 / sqrt(2.0),
+             slow.swingRms_dps);
+    check(slow.swingRms_dps > 0.9 * 20.0 / sqrt(2.0) && slow.swingRms_dps < 1.03 * 20.0 / sqrt(2.0), what);
+    snprintf(what, sizeof(what), "10 mg RMS %.2f reads %.2f mg", 10.0 / sqrt(2.0), 1000.0 * slow.bandHigh_g);
+    check(fabs(slow.bandHigh_g / (0.01 / sqrt(2.0)) - 1.0) < 0.05, what);
+}
+
+static void bench() {
+    printf("\nhost time\n");
+    std::mt19937 rng(2);
+    int16_t samples[VIB_FFT_SIZE];
+    double amplitude, freq;
+    randomBlock(rng, samples, amplitude, freq);
+    float power[VIB_BINS];
+    volatile float sink = 0.0f;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t pass = 0; pass < SIM_BENCH_PASSES; pass++) {
+        samples[pass & (VIB_FFT_SIZE - 1)] ^= 1;
+        VibrationAnalyzer::powerSpectrum(samples, power);
+        sink = sink + power[pass % VIB_BINS];
+    }
+    double spectrum_ns = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 /
+                         SIM_BENCH_PASSES;
+
+    VibrationAnalyzer analyzer;
+    double process_s = 0.0;
+    for (uint32_t pass = 0; pass < SIM_BENCH_PASSES; pass++) {
+        for (int n = 0; n < VIB_FFT_SIZE; n++) {
+            int16_t accel[3] = { samples[n], 200, 4000 };
+            int16_t gyro[3] = { samples[(n + 7) & (VIB_FFT_SIZE - 1)], samples[(n + 61) & (VIB_FFT_SIZE - 1)], 0 };
+            analyzer.addSample(accel, gyro);
+        }
+        start = std::chrono::steady_clock::now();
+        analyzer.process(pass);
+        process_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink = sink + analyzer.getReport().bandHigh_g;
+    }
+    printf("  powerSpectrum() %.0f ns, process() %.0f ns per block of %.2f s\n", spectrum_ns,
+           process_s * 1e9 / SIM_BENCH_PASSES, (double)VIB_FFT_SIZE / VIB_SAMPLE_RATE_HZ);
+}
+
+int main(int argc, char** argv) {
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    printf("FFT check, %u samples at %u Hz (%.2f Hz bins)\n", VIB_FFT_SIZE, VIB_SAMPLE_RATE_HZ,
+           (double)VIB_SAMPLE_RATE_HZ / VIB_FFT_SIZE);
+
+    randomBlocks(verbose);
+    toneReports();
+    bench();
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
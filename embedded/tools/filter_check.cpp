@@ -0,0 +1,294 @@
+//Host check of filters.h against naive references, plus the sorting-network microbenchmark.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o filter_check filter_check.cpp
+//  ./filter_check [samples]
+//
+//  networks      every SortingNetwork size used, all 0/1 inputs (0-1 principle:
+//                a network that sorts those sorts everything)
+//  median        MedianFilter<T, N> vs std::sort of the same window, including
+//                the padded start (window not full yet)
+//  hampel        HampelFilter<T, 7> vs a std::sort median / MAD, same outliers
+//  moving stats  mean / variance / min / max vs a full-window recompute,
+//                int16 over the full range and int32 around 1e7 (cPa) included
+//Then ns per update() of each filter against the naive version. x86 -O2
+//figures, the ratio is what carries over to the target. Exit status 1 if any
+//check fails.
+
+#include "filters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Last N samples as SampleWindow::copyTo gives them (not full: padded with the newest)
+template <typename T, uint8_t N>
+static void referenceWindow(const std::vector<T>& in, size_t i, T* out) {
+    size_t count = i + 1 < N ? i + 1 : N;
+    for (uint8_t k = 0; k < N; k++) {
+        out[k] = k < count ? in[i + 1 - count + k] : in[i];
+    }
+}
+
+template <typename T, uint8_t N>
+static T referenceMedian(const T* window) {
+    T v[N];
+    std::copy(window, window + N, v);
+    std::sort(v, v + N);
+    return v[N / 2];
+}
+
+template <uint8_t N>
+static bool networkSortsZeroOne() {
+    for (uint32_t bits = 0; bits < (1u << N); bits++) {
+        uint8_t v[N];
+        for (uint8_t i = 0; i < N; i++) {
+            v[i] = (bits >> i) & 1;
+        }
+        SortingNetwork<uint8_t, N>::sort(v);
+        for (uint8_t i = 1; i < N; i++) {
+            if (v[i - 1] > v[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename T, uint8_t N>
+static bool medianMatches(const std::vector<T>& in) {
+    MedianFilter<T, N> filter;
+    for (size_t i = 0; i < in.size(); i++) {
+        T window[N];
+        referenceWindow<T, N>(in, i, window);
+        if (filter.update(in[i]) != referenceMedian<T, N>(window)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Naive Hampel with the same sigma rule (float: 1.4826, integers: 759 / 512)
+template <typename T>
+static size_t hampelMismatches(const std::vector<T>& in, T k, T minSigma, size_t& outliers) {
+    HampelFilter<T, 7> filter(k, minSigma);
+    size_t mismatches = 0;
+    outliers = 0;
+    for (size_t i = 0; i < in.size(); i++) {
+        T out = filter.update(in[i]);
+        T expected = in[i];
+        bool outlier = false;
+        if (i >= 6) {
+            T window[7];
+            referenceWindow<T, 7>(in, i, window);
+            T median = referenceMedian<T, 7>(window);
+            T dev[7];
+            for (uint8_t j = 0; j < 7; j++) {
+                dev[j] = window[j] > median ? window[j] - median : median - window[j];
+            }
+            T sigma = sigmaFromMad(referenceMedian<T, 7>(dev));
+            if (sigma < minSigma) {
+                sigma = minSigma;
+            }
+            T distance = in[i] > median ? in[i] - median : median - in[i];
+            outlier = distance > k * sigma;
+            if (outlier) {
+                expected = median;
+                outliers++;
+            }
+        }
+        if (out != expected || filter.wasOutlier() != outlier) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+//Mean and min/max exact (mean truncated like MovingStats for integers), variance within
+//absTol + relTol * variance (integers: the two truncating divisions, under 2 units)
+template <typename T, uint8_t N>
+static bool statsMatch(const std::vector<T>& in, double absTol, double relTol, double& worst) {
+    MovingStats<T, N> stats;
+    worst = 0.0;
+    for (size_t i = 0; i < in.size(); i++) {
+        stats.update(in[i]);
+        size_t count = i + 1 < N ? i + 1 : N;
+        double sum = 0.0;
+        T lo = in[i];
+        T hi = in[i];
+        for (size_t j = i + 1 - count; j <= i; j++) {
+            sum += (double)in[j];
+            lo = std::min(lo, in[j]);
+            hi = std::max(hi, in[j]);
+        }
+        double mean = sum / count;
+        double var = 0.0;
+        for (size_t j = i + 1 - count; j <= i; j++) {
+            var += ((double)in[j] - mean) * ((double)in[j] - mean);
+        }
+        var /= count;
+        double error = fabs((double)stats.variance() - var);
+        worst = std::max(worst, error);
+        if (stats.min() != lo || stats.max() != hi || fabs((double)stats.mean() - mean) > 1.0 + fabs(mean) * 1e-6 ||
+            error > absTol + relTol * var) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static std::vector<T> noisy(size_t n, double center, double sigma, double spikeRate, double spike, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, sigma);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<T> out(n);
+    for (size_t i = 0; i < n; i++) {
+        double v = center + noise(rng);
+        if (uniform(rng) < spikeRate) {
+            v += uniform(rng) < 0.5 ? -spike : spike;
+        }
+        out[i] = (T)v;
+    }
+    return out;
+}
+
+template <typename T>
+static std::vector<T> uniformRange(size_t n, double lo, double hi, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> value(lo, hi);
+    std::vector<T> out(n);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (T)value(rng);
+    }
+    return out;
+}
+
+//ns per call of fn over in, best of 5 runs (sink keeps the result alive)
+template <typename T, typename Fn>
+static double timeUpdates(const std::vector<T>& in, Fn fn) {
+    double best = 1e30;
+    volatile double sink = 0.0;
+    for (int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double acc = 0.0;
+        for (size_t i = 0; i < in.size(); i++) {
+            acc += (double)fn(i);
+        }
+        best = std::min(best, secondsSince(start) * 1e9 / in.size());
+        sink = sink + acc;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t samples = argc > 1 ? (size_t)atol(argv[1]) : 20000;
+
+    printf("networks\n");
+    check(networkSortsZeroOne<3>(), "SortingNetwork<3> sorts all 0/1 inputs");
+    check(networkSortsZeroOne<5>(), "SortingNetwork<5> sorts all 0/1 inputs");
+    check(networkSortsZeroOne<7>(), "SortingNetwork<7> sorts all 0/1 inputs");
+    check(networkSortsZeroOne<9>(), "SortingNetwork<9> (odd-even transposition) sorts all 0/1");
+    check(networkSortsZeroOne<15>(), "SortingNetwork<15> (odd-even transposition) sorts all 0/1");
+
+    std::vector<float> pressure_hPa = noisy<float>(samples, 1013.25, 0.02, 0.01, 2.0, 1);
+    std::vector<int32_t> pressure_cPa = noisy<int32_t>(samples, 10132500.0, 200.0, 0.01, 20000.0, 2);
+    std::vector<int16_t> accel = noisy<int16_t>(samples, 4096.0, 40.0, 0.02, 3000.0, 3);
+
+    printf("median\n");
+    check(medianMatches<float, 3>(pressure_hPa), "MedianFilter<float, 3>");
+    check(medianMatches<float, 5>(pressure_hPa), "MedianFilter<float, 5>");
+    check(medianMatches<float, 7>(pressure_hPa), "MedianFilter<float, 7>");
+    check(medianMatches<float, 9>(pressure_hPa), "MedianFilter<float, 9>");
+    check(medianMatches<int16_t, 3>(accel), "MedianFilter<int16_t, 3>");
+    check(medianMatches<int32_t, 7>(pressure_cPa), "MedianFilter<int32_t, 7>");
+
+    printf("hampel\n");
+    size_t outliers = 0;
+    char what[96];
+    size_t mismatches = hampelMismatches<float>(pressure_hPa, 3.0f, 0.03f, outliers);
+    snprintf(what, sizeof(what), "HampelFilter<float, 7>, %zu outliers, %zu mismatches", outliers, mismatches);
+    check(mismatches == 0 && outliers > 0, what);
+    mismatches = hampelMismatches<int32_t>(pressure_cPa, 3, 300, outliers);
+    snprintf(what, sizeof(what), "HampelFilter<int32_t, 7>, %zu outliers, %zu mismatches", outliers, mismatches);
+    check(mismatches == 0 && outliers > 0, what);
+
+    printf("moving stats\n");
+    double worst = 0.0;
+    bool ok = statsMatch<int16_t, 255>(uniformRange<int16_t>(samples, -32768.0, 32767.0, 4), 2.0, 0.0, worst);
+    snprintf(what, sizeof(what), "MovingStats<int16_t, 255> full range (var off by %.2f)", worst);
+    check(ok, what);
+    ok = statsMatch<int32_t, 255>(pressure_cPa, 2.0, 0.0, worst);
+    snprintf(what, sizeof(what), "MovingStats<int32_t, 255> around 1e7 cPa (var off by %.2f)", worst);
+    check(ok, what);
+    ok = statsMatch<int32_t, 32>(uniformRange<int32_t>(samples, -134217727.0, 134217727.0, 5), 2.0, 1e-12, worst);
+    snprintf(what, sizeof(what), "MovingStats<int32_t, 32> at +-2^27 (var off by %.2g)", worst);
+    check(ok, what);
+    //float running sums cancel around a large mean, that is what the periodic re-sum bounds
+    ok = statsMatch<float, 32>(noisy<float>(samples, 20.0, 5.0, 0.0, 0.0, 6), 1e-4, 1e-3, worst);
+    snprintf(what, sizeof(what), "MovingStats<float, 32> (var off by %.1e)", worst);
+    check(ok, what);
+
+    printf("\n%-30s %10s %10s\n", "ns per update()", "filter", "naive");
+    MedianFilter<float, 5> median5;
+    double t = timeUpdates(pressure_hPa, [&](size_t i) { return median5.update(pressure_hPa[i]); });
+    double naive = timeUpdates(pressure_hPa, [&](size_t i) {
+        float window[5];
+        referenceWindow<float, 5>(pressure_hPa, i, window);
+        return referenceMedian<float, 5>(window);
+    });
+    printf("%-30s %10.1f %10.1f  (std::sort)\n", "median of 5, float", t, naive);
+
+    MedianFilter<float, 7> median7;
+    t = timeUpdates(pressure_hPa, [&](size_t i) { return median7.update(pressure_hPa[i]); });
+    naive = timeUpdates(pressure_hPa, [&](size_t i) {
+        float window[7];
+        referenceWindow<float, 7>(pressure_hPa, i, window);
+        return referenceMedian<float, 7>(window);
+    });
+    printf("%-30s %10.1f %10.1f  (std::sort)\n", "median of 7, float", t, naive);
+
+    HampelFilter<int32_t, 7> hampel(3, 300);
+    t = timeUpdates(pressure_cPa, [&](size_t i) { return hampel.update(pressure_cPa[i]); });
+    printf("%-30s %10.1f\n", "Hampel 7, int32", t);
+
+    MovingStats<float, 32> stats;
+    t = timeUpdates(pressure_hPa, [&](size_t i) {
+        stats.update(pressure_hPa[i]);
+        return stats.variance() + stats.min() + stats.max();
+    });
+    naive = timeUpdates(pressure_hPa, [&](size_t i) {
+        size_t count = i + 1 < 32 ? i + 1 : 32;
+        float sum = 0.0f;
+        float sumSq = 0.0f;
+        float lo = pressure_hPa[i];
+        float hi = pressure_hPa[i];
+        for (size_t j = i + 1 - count; j <= i; j++) {
+            sum += pressure_hPa[j];
+            sumSq += pressure_hPa[j] * pressure_hPa[j];
+            lo = std::min(lo, pressure_hPa[j]);
+            hi = std::max(hi, pressure_hPa[j]);
+        }
+        float mean = sum / count;
+        return sumSq / count - mean * mean + lo + hi;
+    });
+    printf("%-30s %10.1f %10.1f  (full window)\n", "MovingStats 32, float", t, naive);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
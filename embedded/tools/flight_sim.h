@@ -0,0 +1,419 @@
+//Host flight loop shared by the replay tools: the flight modules (SensorManager,
+//FSM, CheckpointStore, I2CBus and the drivers) on LinuxSimHal, driven through a
+//scripted drop in simulated time.
+//
+//Include it from a tool built with the firmware sources, e.g.
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o X X.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//
+//Physics: on the pad for padSeconds, carried up by the drone at climb_mps to
+//releaseAGL_m, free fall with drag (terminal freefallVt_mps) to deployAGL_m,
+//then the canopy (canopyVt_mps) down to the ground. The BMP280 model gets the
+//pressure of the true altitude (international formula, SIM_GROUND_MSL_M ground)
+//plus weather drift and gaussian noise every tick and converts it at the rate
+//and through the IIR filter of the sampling profile; the MPU6050 reads 1 g
+//except in free fall. Both get the datasheet noise on every channel, also
+//the BMP280 temperature: SensorManager calls identical raw data stuck, and
+//the real parts never repeat a sample for long. Every SIM_TICK_US the loop polls the bus, every SIM_LOOP_MS it runs
+//readAll + FSM::update the way the flight loop does (ground reference once
+//calibrated, sampling profile on every transition, after a warm boot no
+//FSM::update before the first barometer sample).
+//
+//hold() takes over from the profile for scripted tests: the payload jumps to
+//and stays at the given altitude, a step for the sensors.
+//
+//The parachute release servo runs on ActuatorMockTimer, clocked with micros()
+//every tick and rebuilt with the board (a reset drops the pin). Its executed
+//commands are kept with the flight time of their output edge, see actuations().
+//
+//reset() is a watchdog / brownout reset: the board (RAM) is rebuilt and boots
+//again through the checkpoint store, millis() restarts at 0, the devices, RTC
+//memory, EEPROM and the flight itself carry on. powerCycle() also clears the
+//RTC memory, and can keep the board off for a while (the flight goes on).
+//The DS3231 runs on flight time from SIM_RTC_START_HOUR (same day, so
+//flights and outages under ~14 h); rtc.setPowerLost() stops it for a test.
+
+#ifndef FLIGHT_SIM_H
+#define FLIGHT_SIM_H
+
+#include "hal.h"
+#include "sensors.h"
+#include "fsm.h"
+#include "mission_checkpoint.h"
+#include "actuator.h"
+#include "config.h"
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#define SIM_TICK_US          1000        //poll() period
+#define SIM_LOOP_MS          50          //readAll + FSM::update period (20 Hz)
+#define SIM_GROUND_MSL_M     488.0
+#define SIM_BMP280_ADDRESS   0x76
+#define SIM_TEMPERATURE_C    20.0
+#define SIM_TEMPERATURE_NOISE_C 0.005    //BMP280 at x2 temperature oversampling
+#define SIM_ACCEL_NOISE_LSB  8.0         //~2 mg at +-8 g
+#define SIM_GYRO_NOISE_LSB   3.0         //~0.05 deg/s at +-500 deg/s
+#define SIM_RTC_START_HOUR   10          //2026-06-01 10:00:00 at flight time 0
+
+struct SimFlightProfile {
+    double padSeconds;
+    double releaseAGL_m;
+    double climb_mps;
+    double deployAGL_m;
+    double freefallVt_mps;       //negative, down
+    double canopyVt_mps;
+    double baroNoise_Pa;         //gaussian sigma (BMP280 at x4..x16: ~1.3..2.6 Pa)
+    double weather_Pa_h;         //ground pressure change per hour (front passing: ~-100..-300)
+};
+
+static const SimFlightProfile SIM_DEFAULT_FLIGHT = { 10.0, 100.0, 2.0, 80.0, -25.0, -5.0, 1.5, 0.0 };
+
+//One FSM transition, flight time (not millis(), which restarts on reset)
+struct SimTransition {
+    uint32_t flight_ms;
+    MissionState state;
+};
+
+//One executed actuator command, flight time of its output edge
+struct SimActuation {
+    uint32_t flight_ms;
+    ActuatorCommand command;
+    ActuatorOutcome outcome;
+};
+
+//Everything in RAM: rebuilt by a reset
+struct SimBoard {
+    SensorManager sensors;
+    FSM fsm;
+    ServoActuator actuator;
+    CheckpointStore store;
+    SensorData data;
+    bool warm;
+    bool baroSeen;               //first barometer sample since boot, see mission_checkpoint.h
+};
+
+class FlightSim {
+public:
+    explicit FlightSim(const SimFlightProfile& profile = SIM_DEFAULT_FLIGHT, uint32_t seed = 1)
+        : profile(profile),
+          rng(seed),
+          noise(0.0, 1.0),
+          auxRng(seed + 1),
+          auxNoise(0.0, 1.0),
+          board(nullptr),
+          flight_us(0),
+          boot_us(0),
+          nextLoop_us(0),
+          h(0.0),
+          v(0.0),
+          accel_g(1.0),
+          phase(PAD),
+          readAll_ns(0),
+          update_ns(0),
+          loops(0) {
+        SimWire::detachAll();
+        SimWire::attach(SIM_BMP280_ADDRESS, &bmp);
+        SimWire::attach(MPU6050_ADDRESS, &mpu);
+        SimWire::attach(DS3231_ADDRESS, &rtc);
+        setRtc();
+        rtc.setPowerLost(false);
+        SimUart::reset();
+        SimEEPROM::erase();
+        SimEsp::powerCycle();
+        SimClock::set(0);
+        setBaro();
+    }
+
+    ~FlightSim() {
+        delete board;
+    }
+
+    //Boot sequence of mission_checkpoint.h, true if the mission was resumed
+    bool boot() {
+        delete board;
+        board = new SimBoard();
+        memset(&board->data, 0, sizeof(board->data));
+        board->baroSeen = false;
+        boot_us = flight_us;
+        SimClock::set(0);
+        ActuatorMockTimer::reset(0);
+        nextLoop_us = flight_us;
+        board->actuator.begin(PARACHUTE_SERVO_PIN);
+
+        MissionCheckpoint cp;
+        setRtc();
+        board->store.begin(board->sensors.beginClock());
+        board->warm = board->store.load(cp) && board->fsm.resume(cp);
+        if (board->warm) {
+            board->sensors.beginWarm(cp.groundPressure_hPa, cp.groundAltitude_MSL, board->fsm.getState());
+        } else {
+            board->sensors.begin();
+            board->fsm.begin();
+        }
+        board->fsm.attachCheckpoint(&board->store);
+        board->fsm.attachActuator(&board->actuator);
+        //begin() spent simulated time (GPS configuration, Wire), the flight went on meanwhile
+        advanceFlight(boot_us + SimClock::now_us);
+        return board->warm;
+    }
+
+    void reset() {
+        boot();
+    }
+
+    void powerCycle(uint32_t off_ms = 0) {
+        SimEsp::powerCycle();
+        advanceFlight(flight_us + (uint64_t)off_ms * 1000);
+        reset();
+    }
+
+    void hold(double agl_m) {
+        phase = HELD;
+        h = agl_m;
+        v = 0.0;
+        setAccel(1.0);
+    }
+
+    //Run until flight time until_ms or stop() returns true (checked after every loop)
+    template <typename Stop>
+    void runUntil(uint32_t until_ms, Stop stop) {
+        while (flight_us < (uint64_t)until_ms * 1000) {
+            tick();
+            if (flight_us >= nextLoop_us) {
+                nextLoop_us += SIM_LOOP_MS * 1000;
+                loop();
+                if (stop()) {
+                    return;
+                }
+            }
+        }
+    }
+
+    void runUntil(uint32_t until_ms) {
+        runUntil(until_ms, [] { return false; });
+    }
+
+    SensorManager& sensors() { return board->sensors; }
+    FSM& fsm() { return board->fsm; }
+    const SensorData& data() const { return board->data; }
+    bool isWarm() const { return board->warm; }
+    MissionState state() const { return board->fsm.getState(); }
+
+    uint32_t flightMs() const { return (uint32_t)(flight_us / 1000); }
+    double trueAltitudeAGL() const { return h; }
+    double trueVerticalSpeed() const { return v; }
+    bool onGround() const { return phase == LANDED; }
+    const std::vector<SimTransition>& transitions() const { return log; }
+    const std::vector<SimActuation>& actuations() const { return actuatorLog; }
+
+    //Executed (DONE) commands of one kind, all boots
+    uint32_t countActuations(ActuatorCommand command) const {
+        uint32_t count = 0;
+        for (size_t i = 0; i < actuatorLog.size(); i++) {
+            if (actuatorLog[i].command == command && actuatorLog[i].outcome == ActuatorOutcome::DONE) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    //Host ns per call (readAll, FSM::update), loops since the last clearTimes()
+    double readAllNs() const { return loops ? (double)readAll_ns / loops : 0.0; }
+    double updateNs() const { return loops ? (double)update_ns / loops : 0.0; }
+    void clearTimes() { readAll_ns = update_ns = 0; loops = 0; }
+
+    //Altitude the FSM sees, in meters for both layouts
+    double measuredAltitudeAGL() const {
+#ifdef FIXED_POINT_PIPELINE
+        return board->data.altitude_AGL_cm / 100.0;
+#else
+        return board->data.altitude_AGL;
+#endif
+    }
+
+    //The same before the ground reference (no baseline in the way)
+    double measuredAltitudeMSL() const {
+#ifdef FIXED_POINT_PIPELINE
+        return board->data.altitude_MSL_cm / 100.0;
+#else
+        return board->data.altitude_MSL;
+#endif
+    }
+
+    //Ground pressure now (hPa), what the baseline should be tracking
+    double trueGroundPressure_hPa() const {
+        return (altitudeToPressure_Pa(SIM_GROUND_MSL_M) + weatherOffset_Pa()) / 100.0;
+    }
+
+    static double altitudeToPressure_Pa(double altitudeMSL_m) {
+        return 101325.0 * pow(1.0 - altitudeMSL_m / 44330.0, 1.0 / 0.1903);
+    }
+
+    SimBMP280Device bmp;
+    SimMPU6050Device mpu;
+    SimDS3231Device rtc;
+
+private:
+    enum Phase { PAD, CLIMB, FREE_FALL, CANOPY, LANDED, HELD };
+
+    SimFlightProfile profile;
+    std::mt19937 rng;
+    std::normal_distribution<double> noise;
+    std::mt19937 auxRng;         //IMU and temperature noise, the baro noise keeps its own sequence
+    std::normal_distribution<double> auxNoise;
+    SimBoard* board;
+
+    uint64_t flight_us;
+    uint64_t boot_us;            //flight time of the last boot, millis() counts from there
+    uint64_t nextLoop_us;
+    double h;
+    double v;
+    double accel_g;
+    Phase phase;
+    std::vector<SimTransition> log;
+    std::vector<SimActuation> actuatorLog;
+
+    uint64_t readAll_ns;
+    uint64_t update_ns;
+    uint32_t loops;
+
+    static uint64_t nowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void physics(double dt) {
+        switch (phase) {
+            case PAD:
+                if (flight_us >= (uint64_t)(profile.padSeconds * 1e6)) {
+                    phase = CLIMB;
+                }
+                break;
+            case CLIMB:
+                v = profile.climb_mps;
+                if (h >= profile.releaseAGL_m) {
+                    phase = FREE_FALL;
+                    setAccel(0.0);
+                }
+                break;
+            case FREE_FALL:
+            case CANOPY: {
+                if (phase == FREE_FALL && h <= profile.deployAGL_m) {
+                    phase = CANOPY;
+                    setAccel(1.0);
+                }
+                //Drag-limited: dv/dt = -g (1 - (v / vt)^2), also slows a fall faster than vt
+                double vt = phase == FREE_FALL ? profile.freefallVt_mps : profile.canopyVt_mps;
+                v += -9.80665 * (1.0 - (v / vt) * (v / vt)) * dt;
+                break;
+            }
+            case LANDED:
+            case HELD:
+                break;
+        }
+        h += v * dt;
+        if ((phase == FREE_FALL || phase == CANOPY) && h <= 0.0) {
+            h = 0.0;
+            v = 0.0;
+            phase = LANDED;
+        }
+    }
+
+    void setRtc() {
+        uint32_t s = (uint32_t)(flight_us / 1000000);
+        rtc.setTime(2026, 6, 1, (uint8_t)(SIM_RTC_START_HOUR + s / 3600), (uint8_t)(s / 60 % 60), (uint8_t)(s % 60));
+    }
+
+    double weatherOffset_Pa() const {
+        return profile.weather_Pa_h * (double)flight_us / 3.6e9;
+    }
+
+    void setAccel(double g) {
+        accel_g = g;
+        setImu();
+    }
+
+    void setImu() {
+        int16_t accel[3];
+        int16_t gyro[3];
+        for (uint8_t i = 0; i < 3; i++) {
+            double g = i == 2 ? accel_g : 0.0;
+            accel[i] = (int16_t)lround(g * 4096 + SIM_ACCEL_NOISE_LSB * auxNoise(auxRng));     //+-8 g range
+            gyro[i] = (int16_t)lround(SIM_GYRO_NOISE_LSB * auxNoise(auxRng));
+        }
+        mpu.setRaw(accel, 0, gyro);
+    }
+
+    void setBaro() {
+        double p = altitudeToPressure_Pa(SIM_GROUND_MSL_M + h) + weatherOffset_Pa() + profile.baroNoise_Pa * noise(rng);
+        double t = SIM_TEMPERATURE_C + SIM_TEMPERATURE_NOISE_C * auxNoise(auxRng);
+        bmp.update(p, t, flight_us);
+    }
+
+    void advanceFlight(uint64_t target_us) {
+        while (flight_us + SIM_TICK_US <= target_us) {
+            flight_us += SIM_TICK_US;
+            physics(SIM_TICK_US * 1e-6);
+        }
+    }
+
+    void tick() {
+        flight_us += SIM_TICK_US;
+        physics(SIM_TICK_US * 1e-6);
+        if (flight_us % 1000000 == 0) {
+            setRtc();
+        }
+        setBaro();
+        setImu();
+        //Bus transfers advanced the clock within the tick, never move it back
+        if (SimClock::now_us < flight_us - boot_us) {
+            SimClock::set(flight_us - boot_us);
+        }
+        board->sensors.poll();
+        ActuatorMockTimer::advanceTo((uint32_t)SimClock::now_us);
+    }
+
+    void loop() {
+        SensorData& data = board->data;
+        uint64_t start = nowNs();
+        board->sensors.readAll(data);
+        uint64_t mid = nowNs();
+
+        if (board->sensors.isCalibrated()) {
+            board->fsm.setGroundReference(board->sensors.getGroundPressure(), board->sensors.getGroundAltitude());
+        }
+        MissionState before = board->fsm.getState();
+#ifdef FIXED_POINT_PIPELINE
+        altitude_t altitude = data.altitude_AGL_cm;
+#else
+        altitude_t altitude = data.altitude_AGL;
+#endif
+        board->baroSeen = board->baroSeen || data.bmp_valid;
+        uint64_t fsmStart = nowNs();
+        if (board->baroSeen || !board->warm) {
+            board->fsm.update(altitude, millis(), data.gps_fix);
+        }
+        uint64_t end = nowNs();
+
+        readAll_ns += mid - start;
+        update_ns += end - fsmStart;
+        loops++;
+
+        MissionState after = board->fsm.getState();
+        if (after != before) {
+            board->sensors.applyProfile(after);
+            SimTransition t = { flightMs(), after };
+            log.push_back(t);
+        }
+
+        ActuatorEvent e;
+        while (board->actuator.popEvent(e)) {
+            SimActuation a = { (uint32_t)((boot_us + e.edge_us) / 1000), e.command, e.outcome };
+            actuatorLog.push_back(a);
+        }
+    }
+};
+
+#endif
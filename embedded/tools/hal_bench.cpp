@@ -0,0 +1,595 @@
+//Host benchmark of the sensor drivers on the compile-time HAL policies.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o hal_bench hal_bench.cpp "../lolin esp8266/hal_linux.cpp" "../lolin esp8266/i2c_bus.cpp" "../lolin esp8266/fault_injection.cpp" "../lolin esp8266/sensors/bmp280.cpp" "../lolin esp8266/sensors/mpu6050.cpp" "../lolin esp8266/sensors/rtc.cpp" "../lolin esp8266/sensors/gps.cpp" "../lolin esp8266/sensors/ubx.cpp"
+//  ./hal_bench [samples]
+//
+//1. The four drivers run unmodified on LinuxSimHal against the simulated
+//   BMP280 / MPU6050 / DS3231 / NEO-6M and their outputs are checked
+//   (datasheet compensation example, sensor scaling, BCD time, UBX fix).
+//2. Per-sample cost of each driver's flight-loop path (request -> bus
+//   completion -> decode, GPS: one NAV-POSLLH through update()) with
+//     static    LinuxSimHal: policy calls resolved at compile time, as Esp8266Hal does
+//     virtual   VirtualHal: the same devices behind abstract Clock / Bus / Serial
+//               interfaces (what a runtime HAL would cost)
+//     sim only  the simulated bus / UART with no driver, subtracted for "driver"
+//   The three run interleaved and the median is reported with the spread of
+//   the runs: run one after the other, whichever ran first looked slower
+//   (MPU6050 static 46 ns vs virtual 36 ns, BMP280 +185% in earlier
+//   figures were that, not the HAL). On a shared host core the simulated
+//   bus dominates and a few ns of dispatch stay below the noise, so this is
+//   a functional and a "no large regression" check, not a proof of zero
+//   overhead. What the static policy costs on the target is read from the
+//   flight build's .text against the previous one:
+//  python3 memory_report.py /tmp/build-new --compare /tmp/build-old
+//Exit status 1 if any check fails.
+
+#include "hal.h"
+#include "sensors/bmp280.h"
+#include "sensors/mpu6050.h"
+#include "sensors/rtc_drivers.h"
+#include "sensors/gps.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES        200000
+#define BENCH_REPEATS        11          //interleaved runs per variant, the sandbox shares one core
+#define BENCH_BMP280_ADDRESS 0x76
+#define BENCH_MPU6050_ADDRESS 0x68
+#define BENCH_GPS_RX_PIN     4
+#define BENCH_GPS_TX_PIN     5
+#define BENCH_SAMPLE_US      5000        //simulated time between samples (200 Hz)
+
+static int failures = 0;
+static volatile double sink = 0;        //keeps the measured work alive
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//I2CBus advances one bus phase per poll(), run it until the burst is delivered
+template <class Bus>
+static void drain(Bus& bus) {
+    while (!bus.isIdle()) {
+        bus.poll();
+    }
+}
+
+
+//Runtime HAL for comparison: same simulated devices, every access through a virtual call
+
+class ClockInterface {
+public:
+    virtual ~ClockInterface() {}
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;
+    virtual void delay(unsigned long ms) = 0;
+    virtual void yield() = 0;
+};
+
+class BusInterface {
+public:
+    virtual ~BusInterface() {}
+    virtual bool submitRead(uint8_t address, uint8_t reg, uint8_t length,
+                            I2CCallback callback, void* context) = 0;
+    virtual void poll() = 0;
+    virtual bool isIdle() const = 0;
+    virtual bool readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length) = 0;
+};
+
+class SerialInterface {
+public:
+    virtual ~SerialInterface() {}
+    virtual void begin(uint32_t baud) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+};
+
+class SimClockAdapter : public ClockInterface {
+public:
+    unsigned long millis() { return SimClock::millis(); }
+    unsigned long micros() { return SimClock::micros(); }
+    void delay(unsigned long ms) { SimClock::delay(ms); }
+    void yield() { SimClock::yield(); }
+};
+
+class SimBusAdapter : public BusInterface {
+public:
+    bool submitRead(uint8_t address, uint8_t reg, uint8_t length, I2CCallback callback, void* context) {
+        return bus.submitRead(address, reg, length, callback, context);
+    }
+    void poll() { bus.poll(); }
+    bool isIdle() const { return bus.isIdle(); }
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length) {
+        return bus.readRegisters(address, reg, buffer, length);
+    }
+
+private:
+    I2CBus bus;
+};
+
+class SimSerialAdapter : public SerialInterface {
+public:
+    SimSerialAdapter() : uart(BENCH_GPS_RX_PIN, BENCH_GPS_TX_PIN) {}
+    void begin(uint32_t baud) { uart.begin(baud); }
+    int available() { return uart.available(); }
+    int read() { return uart.read(); }
+    size_t write(const uint8_t* buffer, size_t size) { return uart.write(buffer, size); }
+
+private:
+    SimUart uart;
+};
+
+static ClockInterface* virtualClock = nullptr;
+static SerialInterface* virtualSerial = nullptr;
+
+struct VirtualClock {
+    static unsigned long millis() { return virtualClock->millis(); }
+    static unsigned long micros() { return virtualClock->micros(); }
+    static void delay(unsigned long ms) { virtualClock->delay(ms); }
+    static void yield() { virtualClock->yield(); }
+};
+
+//Constructed by the driver like SoftwareSerial, forwards to the registered port
+class VirtualUart {
+public:
+    VirtualUart(uint8_t rxPin, uint8_t txPin) : port(virtualSerial) { (void)rxPin; (void)txPin; }
+    void begin(uint32_t baud) { port->begin(baud); }
+    int available() { return port->available(); }
+    int read() { return port->read(); }
+    size_t write(const uint8_t* buffer, size_t size) { return port->write(buffer, size); }
+
+private:
+    SerialInterface* port;
+};
+
+//Policies compose: only Clock, Bus and GpsSerial change
+struct VirtualHal : LinuxSimHal {
+    typedef VirtualClock Clock;
+    typedef BusInterface Bus;
+    typedef VirtualUart GpsSerial;
+};
+
+
+//Simulated receiver output
+
+static uint16_t ubxFrame(uint8_t msgId, const void* payload, uint16_t len, uint8_t* out) {
+    return UBX_Parser::buildFrame(UBX_CLASS_NAV, msgId, (const uint8_t*)payload, len, out, 128);
+}
+
+static UBX_NavPosllh benchPosllh(uint32_t iTOW) {
+    UBX_NavPosllh p;
+    memset(&p, 0, sizeof(p));
+    p.iTOW = iTOW;
+    p.lat = 473977420;
+    p.lon = 85455940;
+    p.hMSL = 488000;
+    return p;
+}
+
+static void injectFix() {
+    uint8_t frame[128];
+    UBX_NavSol sol;
+    memset(&sol, 0, sizeof(sol));
+    sol.iTOW = 313200000;
+    sol.week = 2405;
+    sol.gpsFix = 3;
+    sol.flags = 0x0D;           //gpsFixOk, WKNSET, TOWSET
+    sol.pDOP = 150;
+    sol.numSV = 9;
+    SimUart::inject(BENCH_GPS_RX_PIN, frame, ubxFrame(UBX_NAV_SOL, &sol, sizeof(sol), frame));
+
+    UBX_NavVelned velned;
+    memset(&velned, 0, sizeof(velned));
+    velned.iTOW = sol.iTOW;
+    velned.gSpeed = 123;
+    SimUart::inject(BENCH_GPS_RX_PIN, frame, ubxFrame(UBX_NAV_VELNED, &velned, sizeof(velned), frame));
+
+    UBX_NavPosllh posllh = benchPosllh(sol.iTOW);
+    SimUart::inject(BENCH_GPS_RX_PIN, frame, ubxFrame(UBX_NAV_POSLLH, &posllh, sizeof(posllh), frame));
+}
+
+
+//1. Functional checks on LinuxSimHal
+
+static void checkBMP280() {
+    printf("BMP280\n");
+    SimWire::detachAll();
+    SimBMP280Device device;
+    SimWire::attach(BENCH_BMP280_ADDRESS, &device);
+    I2CBus bus;
+    BMP280_Driver bmp;
+
+    check(bmp.begin(BENCH_BMP280_ADDRESS) && bmp.attachBus(&bus), "begin + trim through the bus");
+    bmp.requestSample();
+    drain(bus);
+    float pressure = 0, temperature = 0;
+    unsigned long time_us = 0;
+    check(bmp.getSample(pressure, temperature, time_us) && fabsf(pressure - 100653.27f) < 0.05f &&
+          fabsf(temperature - 25.08f) < 0.001f, "datasheet example: 100653.27 Pa, 25.08 C");
+    check(fabsf(bmp.readPressure() - pressure) < 0.05f, "blocking read matches the async path");
+
+    bmp.requestSample();
+    drain(bus);
+    int32_t pressure_cPa = 0;
+    int16_t temperature_cC = 0;
+    check(bmp.getSampleFixed(pressure_cPa, temperature_cC, time_us) && abs(pressure_cPa - 10065327) <= 3 &&
+          temperature_cC == 2508, "fixed point: 10065327 cPa, 2508 cC");
+
+    device.setPresent(false);
+    bmp.requestSample();
+    drain(bus);
+    check(bmp.getConsecutiveFailures() == 1 && !bmp.hasSample(), "unplugged device counts a failure");
+}
+
+static void checkMPU6050() {
+    printf("MPU6050\n");
+    SimWire::detachAll();
+    SimMPU6050Device device;
+    SimWire::attach(BENCH_MPU6050_ADDRESS, &device);
+    I2CBus bus;
+    MPU6050_Driver mpu;
+
+    check(mpu.begin(BENCH_MPU6050_ADDRESS), "begin, +-8 g / +-500 deg/s");
+    const int16_t accel[3] = { 0, -2048, 4096 };
+    const int16_t gyro[3] = { 655, 0, -131 };
+    device.setRaw(accel, 0, gyro);
+    mpu.attachBus(&bus);
+    mpu.requestSample();
+    drain(bus);
+
+    float ax, ay, az, gx, gy, gz;
+    unsigned long time_us;
+    check(mpu.getSample(ax, ay, az, gx, gy, gz, time_us) && fabsf(az - 9.80665f) < 1e-4f &&
+          fabsf(ay + 4.903325f) < 1e-4f && fabsf(gx - 0.174533f) < 1e-5f, "scaled: 1 g on Z, 10 deg/s on X");
+
+    float bx, by, bz, hx, hy, hz;
+    check(mpu.read(bx, by, bz, hx, hy, hz) && fabsf(bz - az) < 1e-4f && fabsf(hx - gx) < 1e-5f &&
+          fabsf(hz - gz) < 1e-5f, "blocking read matches the async path");
+}
+
+static void checkRTC() {
+    printf("RTC\n");
+    SimWire::detachAll();
+    SimDS3231Device device;
+    SimWire::attach(DS3231_ADDRESS, &device);
+    I2CBus bus;
+    RTC_Driver rtc;
+
+    device.setTime(2026, 2, 6, 15, 0, 0);
+    device.setPowerLost(false);
+    check(rtc.begin() && !rtc.lostPower(), "begin, oscillator running");
+    rtc.attachBus(&bus);
+    rtc.requestTime();
+    drain(bus);
+    check(rtc.getLatestUnixTime() == 1770390000UL, "BCD time registers: 2026-02-06 15:00:00");
+
+    char iso[RTC_ISO8601_SIZE];
+    check(strcmp(rtc.getISO8601(iso, sizeof(iso)), "2026-02-06 15:00:00") == 0, "ISO 8601 text");
+
+    //rtc.cpp has its own __TIME__, compiled in the same build but not the same second
+    device.setPowerLost(true);
+    int32_t skew = (int32_t)(rtc.begin() ? rtc.getUnixTime() - DateTime(__DATE__, __TIME__).unixtime() : 0x7FFFFFFF);
+    check(!rtc.lostPower() && abs(skew) <= 600, "power lost: time restored from the compile time");
+}
+
+static void checkGPS() {
+    printf("GPS\n");
+    SimUart::reset();
+    SimClock::set(1000000);
+    GPS_Driver gps(BENCH_GPS_RX_PIN, BENCH_GPS_TX_PIN);
+
+    gps.beginUBX(38400, 200);
+    check(SimUart::getWritten(BENCH_GPS_RX_PIN) == 103 && SimUart::getBaud(BENCH_GPS_RX_PIN) == 38400,
+          "beginUBX: CFG-PRT x2, CFG-RATE, CFG-MSG x3 at 38400");
+
+    injectFix();
+    gps.update();
+    check(gps.hasFix() && gps.getLatitudeE7() == 473977420 && gps.getLongitudeE7() == 85455940,
+          "UBX fix: position");
+    check(gps.getAltitudeCm() == 48800 && gps.getSpeedCmps() == 123 && gps.getSatellites() == 9,
+          "UBX fix: altitude, speed, satellites");
+    check(gps.getFixAge() == 0 && gps.getFixTime_us() == SimClock::micros(), "fix timestamp from the clock policy");
+}
+
+
+//2. Cost per sample
+
+//Median and spread (half the interquartile range) of one variant's repeats, ns per sample
+struct Timing {
+    double median_ns;
+    double spread_ns;
+};
+
+struct Cost {
+    Timing staticHal;
+    Timing virtualHal;
+    Timing simOnly;
+};
+
+static Timing summarize(double* ns, int n) {
+    std::sort(ns, ns + n);
+    Timing t;
+    t.median_ns = ns[n / 2];
+    t.spread_ns = (ns[(3 * n) / 4] - ns[n / 4]) / 2;
+    return t;
+}
+
+/**
+ Interleaved runs of the three variants: every repeat runs each once, in a
+ rotating order, so clock ramp-up, cache state and neighbours on the shared
+ core hit all three alike instead of whichever ran first
+ */
+template <class Static, class Virtual, class Sim>
+static Cost measure(Static& staticRun, Virtual& virtualRun, Sim& simRun, uint32_t samples) {
+    double ns[3][BENCH_REPEATS];
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        for (int k = 0; k < 3; k++) {
+            int variant = (r + k) % 3;
+            uint64_t start = nowNs();
+            if (variant == 0) {
+                staticRun.run(samples);
+            } else if (variant == 1) {
+                virtualRun.run(samples);
+            } else {
+                simRun.run(samples);
+            }
+            ns[variant][r] = (double)(nowNs() - start) / samples;
+        }
+    }
+    Cost c;
+    c.staticHal = summarize(ns[0], BENCH_REPEATS);
+    c.virtualHal = summarize(ns[1], BENCH_REPEATS);
+    c.simOnly = summarize(ns[2], BENCH_REPEATS);
+    return c;
+}
+
+static void nullCallback(void* context, const uint8_t* data, uint8_t len, bool ok) {
+    (void)context;
+    sink += ok ? data[len - 1] : 0;
+}
+
+template <class Hal>
+class Bmp280Run {
+public:
+    explicit Bmp280Run(typename Hal::Bus& bus) : bus(bus) {
+        bmp.begin(BENCH_BMP280_ADDRESS);
+        bmp.attachBus(&bus);
+    }
+
+    void run(uint32_t n) {
+        float pressure = 0, temperature = 0;
+        unsigned long time_us = 0;
+        double sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            SimClock::advance(BENCH_SAMPLE_US);
+            bmp.requestSample();
+            drain(bus);
+            bmp.getSample(pressure, temperature, time_us);
+            sum += pressure;
+        }
+        sink += sum;
+    }
+
+private:
+    typename Hal::Bus& bus;
+    BMP280_DriverT<Hal> bmp;
+};
+
+template <class Hal>
+class Mpu6050Run {
+public:
+    explicit Mpu6050Run(typename Hal::Bus& bus) : bus(bus) {
+        mpu.begin(BENCH_MPU6050_ADDRESS);
+        mpu.attachBus(&bus);
+    }
+
+    void run(uint32_t n) {
+        float ax = 0, ay = 0, az = 0, gx = 0, gy = 0, gz = 0;
+        unsigned long time_us = 0;
+        double sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            SimClock::advance(BENCH_SAMPLE_US);
+            mpu.requestSample();
+            drain(bus);
+            mpu.getSample(ax, ay, az, gx, gy, gz, time_us);
+            sum += az + gx;
+        }
+        sink += sum;
+    }
+
+private:
+    typename Hal::Bus& bus;
+    MPU6050_DriverT<Hal> mpu;
+};
+
+template <class Hal>
+class RtcRun {
+public:
+    explicit RtcRun(typename Hal::Bus& bus) : bus(bus) {
+        rtc.begin();
+        rtc.attachBus(&bus);
+    }
+
+    void run(uint32_t n) {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            rtc.requestTime();
+            drain(bus);
+            sum += rtc.getLatestUnixTime();
+        }
+        sink += sum;
+    }
+
+private:
+    typename Hal::Bus& bus;
+    RTC_DriverT<Hal> rtc;
+};
+
+//One NAV-POSLLH frame per sample, already on the line (the UART side is not part of the driver)
+template <class Hal>
+class GpsRun {
+public:
+    GpsRun() : gps(BENCH_GPS_RX_PIN, BENCH_GPS_TX_PIN) {
+        gps.resumeUBX(38400);
+        UBX_NavPosllh posllh = benchPosllh(0);
+        len = ubxFrame(UBX_NAV_POSLLH, &posllh, sizeof(posllh), frame);
+    }
+
+    void run(uint32_t n) {
+        int64_t sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            SimClock::advance(BENCH_SAMPLE_US);
+            SimUart::inject(BENCH_GPS_RX_PIN, frame, len);
+            gps.update();
+            sum += gps.getLatitudeE7();
+        }
+        sink += sum;
+    }
+
+private:
+    GPS_DriverT<Hal> gps;
+    uint8_t frame[128];
+    uint16_t len;
+};
+
+//The same bus transfers with no driver around them
+class BusOnlyRun {
+public:
+    BusOnlyRun(uint8_t address, uint8_t reg, uint8_t length) : address(address), reg(reg), length(length) {}
+
+    void run(uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            SimClock::advance(BENCH_SAMPLE_US);
+            bus.submitRead(address, reg, length, nullCallback, nullptr);
+            drain(bus);
+        }
+    }
+
+private:
+    I2CBus bus;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+};
+
+class UartOnlyRun {
+public:
+    UartOnlyRun() : uart(BENCH_GPS_RX_PIN, BENCH_GPS_TX_PIN) {
+        UBX_NavPosllh posllh = benchPosllh(0);
+        len = ubxFrame(UBX_NAV_POSLLH, &posllh, sizeof(posllh), frame);
+    }
+
+    void run(uint32_t n) {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            SimClock::advance(BENCH_SAMPLE_US);
+            SimUart::inject(BENCH_GPS_RX_PIN, frame, len);
+            while (uart.available() > 0) {
+                sum += uart.read();
+            }
+        }
+        sink += sum;
+    }
+
+private:
+    SimUart uart;
+    uint8_t frame[128];
+    uint16_t len;
+};
+
+/**
+ The driver share is what is left after the simulated bus / UART; the
+ virtual column says "noise" when the difference between the two HALs is
+ within the combined run-to-run spread of their driver shares
+ */
+static void printCost(const char* name, const Cost& c) {
+    double driverStatic = c.staticHal.median_ns - c.simOnly.median_ns;
+    double driverVirtual = c.virtualHal.median_ns - c.simOnly.median_ns;
+    double noise = c.staticHal.spread_ns + c.virtualHal.spread_ns + 2 * c.simOnly.spread_ns;
+    printf("%-22s %9.1f %9.1f %9.1f %11.1f %11.1f %7.1f", name, c.staticHal.median_ns, c.virtualHal.median_ns,
+           c.simOnly.median_ns, driverStatic, driverVirtual, noise);
+    if (fabs(driverVirtual - driverStatic) <= noise) {
+        printf("   noise\n");
+    } else {
+        printf("  %+6.1f\n", driverVirtual - driverStatic);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t samples = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : BENCH_SAMPLES;
+    if (samples == 0) {
+        samples = BENCH_SAMPLES;
+    }
+    SimPrint::setEnabled(false);       //driver boot logs
+
+    checkBMP280();
+    checkMPU6050();
+    checkRTC();
+    checkGPS();
+
+    SimClockAdapter clockAdapter;
+    SimSerialAdapter serialAdapter;
+    virtualClock = &clockAdapter;
+    virtualSerial = &serialAdapter;
+
+    SimWire::detachAll();
+    SimBMP280Device bmpDevice;
+    SimMPU6050Device mpuDevice;
+    SimDS3231Device rtcDevice;
+    rtcDevice.setTime(2026, 2, 6, 15, 0, 0);
+    rtcDevice.setPowerLost(false);
+    SimWire::attach(BENCH_BMP280_ADDRESS, &bmpDevice);
+    SimWire::attach(BENCH_MPU6050_ADDRESS, &mpuDevice);
+    SimWire::attach(DS3231_ADDRESS, &rtcDevice);
+
+    I2CBus bus;
+    SimBusAdapter busAdapter;
+    BusInterface* volatile opaqueBus = &busAdapter;      //keeps the compiler from resolving the calls
+    BusInterface& virtualBus = *opaqueBus;
+
+    Bmp280Run<LinuxSimHal> bmpStatic(bus);
+    Bmp280Run<VirtualHal> bmpVirtual(virtualBus);
+    BusOnlyRun bmpBus(BENCH_BMP280_ADDRESS, 0xF7, 6);
+    Cost bmp = measure(bmpStatic, bmpVirtual, bmpBus, samples);
+
+    Mpu6050Run<LinuxSimHal> mpuStatic(bus);
+    Mpu6050Run<VirtualHal> mpuVirtual(virtualBus);
+    BusOnlyRun mpuBus(BENCH_MPU6050_ADDRESS, 0x3B, 14);
+    Cost mpu = measure(mpuStatic, mpuVirtual, mpuBus, samples);
+
+    RtcRun<LinuxSimHal> rtcStatic(bus);
+    RtcRun<VirtualHal> rtcVirtual(virtualBus);
+    BusOnlyRun rtcBus(DS3231_ADDRESS, 0x00, 7);
+    Cost rtc = measure(rtcStatic, rtcVirtual, rtcBus, samples);
+
+    SimUart::reset();
+    GpsRun<LinuxSimHal> gpsStatic;
+    GpsRun<VirtualHal> gpsVirtual;
+    UartOnlyRun gpsUart;
+    Cost gps = measure(gpsStatic, gpsVirtual, gpsUart, samples);
+
+    printf("\nns per sample, median of %d interleaved runs x %u samples (host)\n", BENCH_REPEATS, samples);
+    printf("%-22s %9s %9s %9s %11s %11s %7s %7s\n", "", "static", "virtual", "sim only",
+           "driver/st", "driver/virt", "noise", "virt-st");
+    printCost("BMP280 6-byte burst", bmp);
+    printCost("MPU6050 14-byte burst", mpu);
+    printCost("DS3231 time", rtc);
+    printCost("GPS NAV-POSLLH", gps);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,350 @@
+//Host tests of I2CBus against the simulated bus with per-byte timing.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o i2c_bus_check i2c_bus_check.cpp "../lolin esp8266/hal_linux.cpp" "../lolin esp8266/i2c_bus.cpp" "../lolin esp8266/fault_injection.cpp"
+//  ./i2c_bus_check
+//
+//SimTwoWire advances the simulated clock by 9 clocks per byte plus ~2 for
+//start / stop at the setClock() rate, so a burst of N bytes (pointer write
+//with repeated start, then the read) costs 9 N + 31 bit times: 392.5 us for
+//the MPU6050's 14 bytes at 400 kHz.
+//1. One bus phase per poll(), callbacks only from the DELIVER phase
+//2. Coalescing: adjacent / overlapping reads of one device merge up to
+//   I2C_MAX_BURST bytes, a gap, another device or the size limit split them,
+//   every callback gets its own registers
+//3. Bus time per burst matches the per-byte model at 100 and 400 kHz
+//4. NAK: an unplugged device fails its callbacks and counts in its own stats
+//   only; MPU6050_ADDRESS and DS3231_ADDRESS are separate devices
+//5. Flight load: MPU6050 at 200 Hz, BMP280 at ~70 Hz, DS3231 at 1 Hz through
+//   one bus. With poll() every 100 us every stream keeps up and the MPU6050
+//   latency stays below its period; wire occupancy comes from the model
+//   (busTime_us runs from the SEND_REGISTER poll to DELIVER, so it also
+//   holds the gaps between polls). With poll() every 1 ms the four phases
+//   cap the bus at 250 bursts/s, below the 272/s asked: the loop must not
+//   block for a millisecond between polls.
+//All times are simulated bus time, not host time.
+
+#include "config.h"
+#include "hal_linux.h"
+#include "i2c_bus.h"
+#include "sensors/rtc_drivers.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#define CHECK_BMP280_ADDRESS  0x76
+#define CHECK_LOAD_MS         10000
+#define CHECK_FAST_LOOP_US    100       //poll() period of the flight loop
+#define CHECK_SLOW_LOOP_US    1000
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//Register bank where every register reads back as address ^ register
+class PatternDevice : public SimI2CDevice {
+public:
+    explicit PatternDevice(uint8_t address) {
+        for (uint16_t reg = 0; reg < 256; reg++) {
+            registers[reg] = (uint8_t)(address ^ reg);
+        }
+    }
+};
+
+//What one callback received
+struct Completion {
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+    bool ok;
+    bool called;
+    bool dataOk;
+};
+
+static void onRead(void* context, const uint8_t* data, uint8_t len, bool ok) {
+    Completion* c = (Completion*)context;
+    c->called = true;
+    c->ok = ok;
+    c->dataOk = len == c->length;
+    for (uint8_t i = 0; ok && i < len; i++) {
+        if (data[i] != (uint8_t)(c->address ^ (c->reg + i))) {
+            c->dataOk = false;
+        }
+    }
+}
+
+static Completion request(uint8_t address, uint8_t reg, uint8_t length) {
+    Completion c = { address, reg, length, false, false, false };
+    return c;
+}
+
+static bool submit(I2CBus& bus, Completion& c) {
+    return bus.submitRead(c.address, c.reg, c.length, onRead, &c);
+}
+
+static uint32_t drain(I2CBus& bus) {
+    uint32_t polls = 0;
+    while (!bus.isIdle() && polls < 1000) {
+        bus.poll();
+        polls++;
+    }
+    return polls;
+}
+
+//Bit times of one burst of n bytes at clockHz, as SimTwoWire counts them
+static double burstUs(uint8_t n, uint32_t clockHz) {
+    return (9.0 * n + 31.0) * 1e6 / clockHz;
+}
+
+static void phases(I2CBus& bus) {
+    printf("\nphases\n");
+    Completion c = request(MPU6050_ADDRESS, 0x3B, 14);
+    submit(bus, c);
+    uint8_t polls = 0;
+    while (!c.called && polls < 10) {
+        bus.poll();
+        polls++;
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "one read completes on the 4th poll (%u)", polls);
+    check(polls == 4 && c.ok && c.dataOk, what);
+    check(bus.isIdle(), "bus idle afterwards");
+}
+
+static void coalescing(I2CBus& bus) {
+    printf("\ncoalescing\n");
+    char what[80];
+
+    //MPU6050 accel / temp / gyro as three requests: one 14-byte burst
+    const I2CDeviceStats* s = bus.getStats(MPU6050_ADDRESS);
+    uint32_t bursts = s ? s->transactions : 0;
+    Completion accel = request(MPU6050_ADDRESS, 0x3B, 6);
+    Completion temp = request(MPU6050_ADDRESS, 0x41, 2);
+    Completion gyro = request(MPU6050_ADDRESS, 0x43, 6);
+    submit(bus, accel);
+    submit(bus, temp);
+    submit(bus, gyro);
+    drain(bus);
+    s = bus.getStats(MPU6050_ADDRESS);
+    snprintf(what, sizeof(what), "adjacent reads -> one burst (%u)", s->transactions - bursts);
+    check(s->transactions - bursts == 1, what);
+    check(accel.ok && accel.dataOk && temp.ok && temp.dataOk && gyro.ok && gyro.dataOk,
+          "each callback gets its own registers");
+
+    //Overlap: 0x3B..0x48 and 0x41..0x42 inside it
+    bursts = s->transactions;
+    Completion all = request(MPU6050_ADDRESS, 0x3B, 14);
+    Completion inside = request(MPU6050_ADDRESS, 0x41, 2);
+    submit(bus, all);
+    submit(bus, inside);
+    drain(bus);
+    check(s->transactions - bursts == 1 && all.dataOk && inside.dataOk, "overlapping read rides along");
+
+    //Gap of one register: two bursts
+    bursts = s->transactions;
+    Completion a = request(MPU6050_ADDRESS, 0x3B, 6);
+    Completion b = request(MPU6050_ADDRESS, 0x42, 2);
+    submit(bus, a);
+    submit(bus, b);
+    drain(bus);
+    check(s->transactions - bursts == 2 && a.dataOk && b.dataOk, "a gap splits the burst");
+
+    //Another device in between: no reordering across it
+    bursts = s->transactions;
+    Completion m1 = request(MPU6050_ADDRESS, 0x3B, 6);
+    Completion rtc = request(DS3231_ADDRESS, 0x00, 7);
+    Completion m2 = request(MPU6050_ADDRESS, 0x41, 8);
+    submit(bus, m1);
+    submit(bus, rtc);
+    submit(bus, m2);
+    drain(bus);
+    check(s->transactions - bursts == 2 && m1.dataOk && rtc.dataOk && m2.dataOk,
+          "another device in between keeps the order");
+
+    //I2C_MAX_BURST: 20 + 20 adjacent bytes do not fit in one burst
+    const I2CDeviceStats* bmp = bus.getStats(CHECK_BMP280_ADDRESS);
+    bursts = bmp ? bmp->transactions : 0;
+    Completion low = request(CHECK_BMP280_ADDRESS, 0x80, 20);
+    Completion high = request(CHECK_BMP280_ADDRESS, 0x94, 20);
+    submit(bus, low);
+    submit(bus, high);
+    drain(bus);
+    bmp = bus.getStats(CHECK_BMP280_ADDRESS);
+    snprintf(what, sizeof(what), "%u bytes split at I2C_MAX_BURST (%u bursts)", 40, bmp->transactions - bursts);
+    check(bmp->transactions - bursts == 2 && low.dataOk && high.dataOk, what);
+
+    //Queue limit
+    Completion q[I2C_QUEUE_SIZE + 1];
+    uint8_t accepted = 0;
+    for (uint8_t i = 0; i <= I2C_QUEUE_SIZE; i++) {
+        q[i] = request(DS3231_ADDRESS, (uint8_t)(0x20 * i), 1);
+        accepted += submit(bus, q[i]) ? 1 : 0;
+    }
+    snprintf(what, sizeof(what), "queue takes %u descriptors, refuses the next", I2C_QUEUE_SIZE);
+    check(accepted == I2C_QUEUE_SIZE, what);
+    drain(bus);
+    Completion tooLong = request(DS3231_ADDRESS, 0x00, I2C_MAX_BURST + 1);
+    check(!submit(bus, tooLong), "read longer than I2C_MAX_BURST refused");
+}
+
+static void timing() {
+    printf("\nbus time per burst (simulated)\n");
+    const uint32_t clocks[2] = { 100000, 400000 };
+    const uint8_t lengths[3] = { 1, 14, 32 };
+    for (uint8_t k = 0; k < 2; k++) {
+        I2CBus bus;
+        bus.begin(clocks[k]);
+        for (uint8_t i = 0; i < 3; i++) {
+            const I2CDeviceStats* s = bus.getStats(MPU6050_ADDRESS);
+            uint32_t before = s ? s->busTime_us : 0;
+            Completion c = request(MPU6050_ADDRESS, 0x00, lengths[i]);
+            submit(bus, c);
+            drain(bus);
+            s = bus.getStats(MPU6050_ADDRESS);
+            uint32_t us = s->busTime_us - before;
+            double expected = burstUs(lengths[i], clocks[k]);
+            char what[80];
+            snprintf(what, sizeof(what), "%3u kHz, %2u bytes: %4u us (model %.1f)", clocks[k] / 1000, lengths[i], us,
+                     expected);
+            check(c.dataOk && fabs(us - expected) <= 1.0, what);
+        }
+    }
+}
+
+static void naks(I2CBus& bus, SimI2CDevice& mpu) {
+    printf("\nNAK and per-device statistics\n");
+    const I2CDeviceStats* m = bus.getStats(MPU6050_ADDRESS);
+    const I2CDeviceStats* r = bus.getStats(DS3231_ADDRESS);
+    uint32_t mpuNaks = m->naks;
+    uint32_t rtcNaks = r->naks;
+    uint32_t rtcBursts = r->transactions;
+
+    mpu.setPresent(false);
+    Completion lost = request(MPU6050_ADDRESS, 0x3B, 14);
+    Completion rtc = request(DS3231_ADDRESS, 0x00, 16);
+    submit(bus, lost);
+    submit(bus, rtc);
+    drain(bus);
+    mpu.setPresent(true);
+
+    check(lost.called && !lost.ok, "unplugged MPU6050: callback with ok = false");
+    check(rtc.ok && rtc.dataOk, "DS3231 behind it unaffected");
+    char what[80];
+    snprintf(what, sizeof(what), "NAK counted at 0x%02X only (+%u / +%u)", MPU6050_ADDRESS, m->naks - mpuNaks,
+             r->naks - rtcNaks);
+    check(m->naks - mpuNaks == 1 && r->naks == rtcNaks && r->transactions == rtcBursts + 1, what);
+    check(!bus.probe(0x50) && bus.probe(MPU6050_ADDRESS), "probe: empty address NAKs, MPU6050 ACKs");
+}
+
+struct LoadStream {
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+    uint32_t period_us;
+    uint32_t next_us;
+    Completion pending;
+    uint32_t completed;
+    uint32_t skipped;          //period came while the previous read was queued
+};
+
+static void flightLoad(uint32_t loop_us) {
+    printf("\nflight load, %u s at 400 kHz, poll() every %u us\n", CHECK_LOAD_MS / 1000, loop_us);
+    I2CBus bus;
+    bus.begin(I2C_BUS_CLOCK_HZ);
+    LoadStream streams[3] = {
+        { MPU6050_ADDRESS, 0x3B, 14, 5000, 0, Completion(), 0, 0 },
+        { CHECK_BMP280_ADDRESS, 0xF7, 6, 14000, 0, Completion(), 0, 0 },
+        { DS3231_ADDRESS, 0x00, 16, 1000000, 0, Completion(), 0, 0 },
+    };
+    for (uint8_t i = 0; i < 3; i++) {
+        streams[i].pending.called = true;
+    }
+
+    uint64_t start_us = SimClock::now_us;
+    uint64_t end_us = start_us + (uint64_t)CHECK_LOAD_MS * 1000;
+    uint64_t nextLoop_us = start_us;
+    while (SimClock::now_us < end_us) {
+        if (SimClock::now_us < nextLoop_us) {
+            SimClock::set(nextLoop_us);
+        }
+        nextLoop_us += loop_us;
+        uint32_t t = (uint32_t)(SimClock::now_us - start_us);
+        for (uint8_t i = 0; i < 3; i++) {
+            LoadStream& s = streams[i];
+            if (t < s.next_us) {
+                continue;
+            }
+            s.next_us += s.period_us;
+            if (!s.pending.called) {
+                s.skipped++;
+                continue;
+            }
+            if (s.pending.ok) {
+                s.completed++;
+            }
+            s.pending = request(s.address, s.reg, s.length);
+            submit(bus, s.pending);
+        }
+        bus.poll();
+    }
+
+    double wire_us = 0.0;
+    uint32_t busy_us = 0;
+    uint32_t bursts = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        const LoadStream& s = streams[i];
+        const I2CDeviceStats* st = bus.getStats(s.address);
+        wire_us += st->transactions * burstUs(s.length, I2C_BUS_CLOCK_HZ);
+        busy_us += st->busTime_us;
+        bursts += st->transactions;
+        printf("  0x%02X  %2u bytes every %7.1f ms: %5u reads, %u skipped, max bus %3u us, max latency %4u us\n",
+               s.address, s.length, s.period_us / 1000.0, st->transactions, s.skipped, st->maxBusTime_us,
+               st->maxLatency_us);
+    }
+    double window_us = (double)CHECK_LOAD_MS * 1000;
+    printf("  busTime_us with the gaps between polls: %.1f%% of the time\n", 100.0 * busy_us / window_us);
+    bool none = streams[0].skipped == 0 && streams[1].skipped == 0 && streams[2].skipped == 0;
+    char what[80];
+    if (loop_us == CHECK_SLOW_LOOP_US) {
+        uint32_t cap = (uint32_t)(window_us / (4.0 * loop_us));
+        snprintf(what, sizeof(what), "%u bursts, at most one per 4 polls (%u)", bursts, cap);
+        check(bursts <= cap && !none, what);
+        return;
+    }
+    snprintf(what, sizeof(what), "wire occupancy %.1f%% (per-byte model)", 100.0 * wire_us / window_us);
+    check(wire_us < 0.25 * window_us, what);
+    check(none, "every stream keeps up");
+    const I2CDeviceStats* mpu = bus.getStats(MPU6050_ADDRESS);
+    snprintf(what, sizeof(what), "MPU6050 latency below one 200 Hz period (%u us)", mpu->maxLatency_us);
+    check(mpu->maxLatency_us < 5000, what);
+}
+
+int main() {
+    printf("I2CBus on the simulated bus\n");
+    SimPrint::setEnabled(false);
+
+    SimWire::detachAll();
+    PatternDevice mpu(MPU6050_ADDRESS);
+    PatternDevice rtc(DS3231_ADDRESS);
+    PatternDevice bmp(CHECK_BMP280_ADDRESS);
+    bool attached = SimWire::attach(MPU6050_ADDRESS, &mpu);
+    attached = SimWire::attach(DS3231_ADDRESS, &rtc) && attached;
+    attached = SimWire::attach(CHECK_BMP280_ADDRESS, &bmp) && attached;
+    check(attached && MPU6050_ADDRESS != DS3231_ADDRESS, "MPU6050, DS3231, BMP280 on separate addresses");
+
+    I2CBus bus;
+    bus.begin(I2C_BUS_CLOCK_HZ);
+    phases(bus);
+    coalescing(bus);
+    timing();
+    naks(bus, mpu);
+    flightLoad(CHECK_FAST_LOOP_US);
+    flightLoad(CHECK_SLOW_LOOP_US);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
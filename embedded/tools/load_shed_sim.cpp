@@ -0,0 +1,305 @@
+//Host replay of load shedding in flight: LoadShedder driving SensorManager and FSM.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o load_shed_sim load_shed_sim.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./load_shed_sim
+//
+//The flight modules run on LinuxSimHal through flight_sim.h, on a drop with
+//a long canopy descent. After every 20 Hz loop the shedder gets an injected
+//loop time and the battery the SensorManager read from the ADC; a level
+//change goes to SensorManager::setShedMask and FSM::setShedMask, as in the
+//load_shedding.h main loop contract. The loop time is a cost model (host
+//times say nothing about the LX106) built from what the modules actually do:
+//IMU samples at the ODR of the profile SensorManager applied, an FFT when
+//the VibrationAnalyzer completes a block, a telemetry frame when
+//FSM::shouldTransmitTelemetry lets one out; logging, attitude and the
+//landing fit are charged while not shed. The SIM_COST_* figures are assumed
+//round numbers, not target measurements: the checks are on the controller
+//and on the modules applying its decisions, not on the figures. A loop over
+//SIM_LOOP_MS misses its deadline (the sim keeps the 50 ms grid).
+//
+//Phases, from the DESCENT_STABLE transition:
+//  0-10 s   nominal, battery 3.95 V
+//  10-30 s  CPU hog: +SIM_HOG_US per loop (flash writes / WiFi stack)
+//  30-50 s  recovery
+//  50-60 s  battery 3.25 V, below LOAD_BATTERY_CRITICAL_MV
+//  60-70 s  battery 3.35 V: above the threshold, inside the hysteresis
+//  70-80 s  battery 3.55 V: critical floor released, reduced one held
+//  80-90 s  battery 3.90 V
+//A telemetry frame sags the next ADC reading by SIM_RADIO_SAG_MV.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+#include "load_shedding.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_FLIGHT_END_MS    400000
+#define SIM_BUDGET_US        (SIM_LOOP_MS * 1000UL)
+
+//Assumed per-loop costs at the 20 Hz loop, us
+#define SIM_COST_CORE_US     8000     //readAll baro + RTC + FSM::update + checkpoint, never shed
+#define SIM_COST_IMU_US      300      //per MPU6050 sample read in poll()
+#define SIM_COST_ATTITUDE_US 1500
+#define SIM_COST_VIB_US      40       //per sample into the block
+#define SIM_COST_FFT_US      6000     //VibrationAnalyzer::process
+#define SIM_COST_LANDING_US  2000
+#define SIM_COST_LOG_US      20000    //printStatus, Serial blocks once the UART FIFO is full
+#define SIM_LOG_LOOPS        10       //printStatus twice a second
+#define SIM_COST_TX_US       5000     //encode + radio hand-off
+#define SIM_HOG_US           35000
+
+#define SIM_RADIO_SAG_MV     150
+#define SIM_HOG_SETTLE_MS    4000     //levels climb per interval, then on spikes only
+#define SIM_PHASES           7
+
+//A canopy descent long enough for all the phases
+static const SimFlightProfile SIM_LONG_DESCENT = { 10.0, 600.0, 20.0, 550.0, -25.0, -5.0, 1.5, 0.0 };
+
+static const uint32_t PHASE_END_MS[SIM_PHASES] = { 10000, 30000, 50000, 60000, 70000, 80000, 90000 };
+static const uint16_t PHASE_BATTERY_MV[SIM_PHASES] = { 3950, 3950, 3950, 3250, 3350, 3550, 3900 };
+static const char* const PHASE_NAMES[SIM_PHASES] = {
+    "nominal", "cpu hog", "recovery", "battery 3.25 V", "battery 3.35 V", "battery 3.55 V", "battery 3.90 V"
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+struct PhaseStats {
+    uint32_t loops;
+    uint32_t misses;
+    uint32_t lastMiss_ms;         //flight time
+    uint32_t maxLoop_us;
+    uint8_t minLevel;
+    uint8_t maxLevel;
+    uint8_t endLevel;
+    uint32_t telemetryFrames;
+    uint32_t minStretchedGap_ms;  //between frames both sent with SHED_TELEMETRY_RATE set
+    bool reducedImu;              //IMU on the reduced profile at some point
+    bool baroKept;                //barometer settings of the full profile throughout
+};
+
+struct LevelChange {
+    uint32_t flight_ms;
+    uint8_t level;
+};
+
+static uint16_t batteryMillivolts(const SensorData& data) {
+#ifdef FIXED_POINT_PIPELINE
+    return data.battery_mV;
+#else
+    return (uint16_t)lround(data.battery_voltage * 1000.0f);
+#endif
+}
+
+//Raw A0 reading for a cell voltage (1023 = 3.2 V behind the 2:1 divider)
+static void setBattery(uint16_t mV) {
+    SimAdc::set((uint16_t)((uint32_t)mV * 1023 / 6400));
+}
+
+int main() {
+    printf("load shedding replay\n");
+    SimPrint::setEnabled(false);
+
+    FlightSim sim(SIM_LONG_DESCENT, 1);
+    setBattery(PHASE_BATTERY_MV[0]);
+    sim.boot();
+    LoadShedder shedder;
+    shedder.begin(SIM_BUDGET_US);
+
+    PhaseStats stats[SIM_PHASES];
+    for (uint8_t p = 0; p < SIM_PHASES; p++) {
+        memset(&stats[p], 0, sizeof(stats[p]));
+        stats[p].minLevel = LOAD_LEVEL_MAX;
+        stats[p].minStretchedGap_ms = 0xFFFFFFFF;
+        stats[p].baroKept = true;
+    }
+    std::vector<LevelChange> changes;
+
+    const SamplingProfile& full = getSamplingProfile(MissionState::DESCENT_STABLE);
+    const SamplingProfile& reduced = getReducedSamplingProfile(MissionState::DESCENT_STABLE);
+    uint32_t stable_ms = 0;
+    uint32_t loop = 0;
+    unsigned long lastBlock_ms = 0;
+    uint32_t lastFrame_ms = 0;
+    bool lastFrameStretched = false;
+    uint32_t maxGap_ms = 0;
+
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        loop++;
+        uint32_t now_ms = sim.flightMs();
+        if (stable_ms == 0 && sim.state() == MissionState::DESCENT_STABLE) {
+            stable_ms = now_ms;
+        }
+        int8_t phase = -1;
+        uint32_t t_ms = now_ms - stable_ms;
+        if (stable_ms != 0 && t_ms < PHASE_END_MS[SIM_PHASES - 1]) {
+            phase = 0;
+            while (t_ms >= PHASE_END_MS[phase]) {
+                phase++;
+            }
+        }
+
+        //What the modules did this loop
+        SensorManager& sensors = sim.sensors();
+        const SamplingProfile& profile = sensors.getProfile();
+        uint32_t samples = SIM_LOOP_MS / (1 + profile.mpuRateDivisor);
+        bool vibration = sim.state() == MissionState::DESCENT_STABLE && shedder.isEnabled(SHED_VIBRATION);
+        unsigned long block_ms = sensors.getVibration().getReport().time_ms;
+        bool fft = block_ms != lastBlock_ms;
+        lastBlock_ms = block_ms;
+        bool stretched = !shedder.isEnabled(SHED_TELEMETRY_RATE);
+        bool frame = sim.fsm().shouldTransmitTelemetry(millis());
+
+        uint32_t cost = SIM_COST_CORE_US + samples * SIM_COST_IMU_US;
+        cost += vibration ? samples * SIM_COST_VIB_US : 0;
+        cost += fft ? SIM_COST_FFT_US : 0;
+        cost += shedder.isEnabled(SHED_ATTITUDE) ? SIM_COST_ATTITUDE_US : 0;
+        cost += shedder.isEnabled(SHED_LANDING) ? SIM_COST_LANDING_US : 0;
+        cost += shedder.isEnabled(SHED_VERBOSE_LOG) && loop % SIM_LOG_LOOPS == 0 ? SIM_COST_LOG_US : 0;
+        cost += frame ? SIM_COST_TX_US : 0;
+        cost += phase == 1 ? SIM_HOG_US : 0;
+
+        uint16_t battery_mV = phase >= 0 ? PHASE_BATTERY_MV[phase] : PHASE_BATTERY_MV[SIM_PHASES - 1];
+        setBattery(frame ? battery_mV - SIM_RADIO_SAG_MV : battery_mV);
+
+        shedder.update(cost, batteryMillivolts(sim.data()), millis(), sim.state() == MissionState::SAFE_MODE);
+        if (shedder.hasChanged()) {
+            sensors.setShedMask(shedder.getShedMask());
+            sim.fsm().setShedMask(shedder.getShedMask());
+            LevelChange c = { now_ms, shedder.getLevel() };
+            changes.push_back(c);
+        }
+
+        if (frame && stable_ms != 0 && sim.state() == MissionState::DESCENT_STABLE) {
+            if (lastFrame_ms != 0) {
+                maxGap_ms = std::max(maxGap_ms, now_ms - lastFrame_ms);
+            }
+        }
+        if (phase >= 0) {
+            PhaseStats& s = stats[phase];
+            s.loops++;
+            if (cost > SIM_BUDGET_US) {
+                s.misses++;
+                s.lastMiss_ms = now_ms;
+            }
+            s.maxLoop_us = std::max(s.maxLoop_us, cost);
+            uint8_t level = shedder.getLevel();
+            s.minLevel = std::min(s.minLevel, level);
+            s.maxLevel = std::max(s.maxLevel, level);
+            s.endLevel = level;
+            const SamplingProfile& applied = sensors.getProfile();
+            s.reducedImu = s.reducedImu || &applied == &reduced;
+            s.baroKept = s.baroKept && applied.pressSampling == full.pressSampling &&
+                         applied.filter == full.filter && applied.standby == full.standby &&
+                         applied.baroPeriod_ms == full.baroPeriod_ms && applied.baroLag_ms == full.baroLag_ms;
+            if (frame) {
+                s.telemetryFrames++;
+                if (stretched && lastFrameStretched && lastFrame_ms != 0) {
+                    s.minStretchedGap_ms = std::min(s.minStretchedGap_ms, now_ms - lastFrame_ms);
+                }
+            }
+        }
+        if (frame) {
+            lastFrame_ms = now_ms;
+            lastFrameStretched = stretched;
+        }
+        return sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+    });
+
+    printf("\nDESCENT_STABLE at %u ms, level changes:\n", stable_ms);
+    for (size_t i = 0; i < changes.size(); i++) {
+        printf("  %8.2f s  level %u\n", (changes[i].flight_ms - stable_ms) / 1000.0, changes[i].level);
+    }
+    printf("\n  %-15s %6s %7s %8s %11s %5s\n", "phase", "loops", "misses", "max_ms", "level", "tlm");
+    for (uint8_t p = 0; p < SIM_PHASES; p++) {
+        const PhaseStats& s = stats[p];
+        printf("  %-15s %6u %7u %8.1f %5u..%-5u %5u\n", PHASE_NAMES[p], s.loops, s.misses,
+               s.maxLoop_us / 1000.0, s.minLevel, s.maxLevel, s.telemetryFrames);
+    }
+
+    //Level changes inside [from_ms, to_ms) of the phases, relative to DESCENT_STABLE
+    std::vector<LevelChange> window[SIM_PHASES];
+    for (size_t i = 0; i < changes.size(); i++) {
+        uint32_t t_ms = changes[i].flight_ms - stable_ms;
+        for (uint8_t p = 0; p < SIM_PHASES && stable_ms != 0 && changes[i].flight_ms >= stable_ms; p++) {
+            if (t_ms < PHASE_END_MS[p]) {
+                window[p].push_back(changes[i]);
+                break;
+            }
+        }
+    }
+
+    const PhaseStats& nominal = stats[0];
+    const PhaseStats& hog = stats[1];
+    const PhaseStats& recovery = stats[2];
+    const uint8_t reducedLevel = SHED_SENSOR_RATE + 1;
+    char what[96];
+
+    printf("\nnominal\n");
+    check(stable_ms != 0 && nominal.loops > 0, "DESCENT_STABLE reached, phases replayed");
+    check(nominal.maxLevel == 0, "nothing shed");
+    check(nominal.misses == 0, "no missed deadline");
+    check(nominal.telemetryFrames >= 9 && nominal.telemetryFrames <= 11, "telemetry at 1 Hz");
+
+    printf("\ncpu hog\n");
+    bool stepwise = true;
+    for (size_t i = 1; i < window[1].size(); i++) {
+        stepwise = stepwise && window[1][i].level == window[1][i - 1].level + 1 &&
+                   window[1][i].flight_ms - window[1][i - 1].flight_ms >= LOAD_EVAL_INTERVAL_MS;
+    }
+    check(!window[1].empty() && stepwise, "one level up per evaluation interval");
+    check(hog.maxLevel >= reducedLevel && hog.maxLevel <= LOAD_OVERLOAD_LEVEL_MAX,
+          "sheds down to the IMU rate, never the camera");
+    uint32_t settled_ms = window[1].empty() ? 0 : window[1].back().flight_ms;
+    snprintf(what, sizeof(what), "level settled within %u ms of the onset (%u ms)",
+             SIM_HOG_SETTLE_MS, settled_ms - stable_ms - PHASE_END_MS[0]);
+    check(settled_ms != 0 && settled_ms - stable_ms - PHASE_END_MS[0] <= SIM_HOG_SETTLE_MS, what);
+    snprintf(what, sizeof(what), "no missed deadline once settled (%u while climbing)", hog.misses);
+    check(hog.lastMiss_ms <= settled_ms, what);
+    check(hog.reducedImu, "SensorManager on the reduced IMU profile");
+    check(hog.baroKept, "barometer settings of the DESCENT profile kept");
+    check(hog.telemetryFrames >= 19 && hog.telemetryFrames <= 21, "telemetry at 1 Hz (rate not shed by the CPU)");
+
+    printf("\nrecovery\n");
+    bool restoreHeld = !window[2].empty();
+    for (size_t i = 0; i < window[2].size(); i++) {
+        uint8_t before = i == 0 ? hog.endLevel : window[2][i - 1].level;
+        restoreHeld = restoreHeld && window[2][i].level + 1 == before;
+        if (i > 0) {
+            restoreHeld = restoreHeld && window[2][i].flight_ms - window[2][i - 1].flight_ms >= LOAD_RESTORE_HOLD_MS;
+        }
+    }
+    check(restoreHeld, "one level back per LOAD_RESTORE_HOLD_MS, none up again");
+    check(recovery.endLevel == 0, "back to level 0");
+    check(recovery.misses == 0, "no missed deadline while restoring");
+    check(&sim.sensors().getProfile() == &full || sim.state() != MissionState::DESCENT_STABLE,
+          "full DESCENT profile again");
+
+    printf("\nbattery\n");
+    check(stats[3].endLevel == LOAD_LEVEL_MAX, "3.25 V: everything shed");
+    snprintf(what, sizeof(what), "3.25 V: telemetry stretched to %u ms",
+             (unsigned)(1000 * LOAD_TELEMETRY_STRETCH));
+    check(stats[3].minStretchedGap_ms >= 1000 * LOAD_TELEMETRY_STRETCH &&
+          stats[3].minStretchedGap_ms != 0xFFFFFFFF, what);
+    check(stats[3].baroKept, "3.25 V: barometer settings kept");
+    check(stats[4].minLevel == LOAD_LEVEL_MAX && window[4].empty(), "3.35 V: critical floor held (hysteresis)");
+    check(stats[5].endLevel == reducedLevel && window[5].size() == 1, "3.55 V: critical released once, reduced floor held");
+    check(stats[6].endLevel == 0 && window[6].size() == 1, "3.90 V: reduced floor released once");
+
+    printf("\nflight\n");
+    snprintf(what, sizeof(what), "telemetry never silent in DESCENT_STABLE (max gap %u ms)", maxGap_ms);
+    check(maxGap_ms <= 1000 * LOAD_TELEMETRY_STRETCH + SIM_LOOP_MS, what);
+    check(sim.state() == MissionState::FINAL_REPORT, "flight ends in FINAL_REPORT");
+    check(sim.countActuations(ActuatorCommand::FIRE) == 1, "release fired once");
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+RAM / flash footprint of the ESP8266 firmware, per object file and per symbol.
+
+Point it at the Arduino build directory (arduino-cli compile --build-path DIR,
+or the sketch folder under /tmp in the IDE with verbose output on):
+
+    python3 memory_report.py /tmp/arduino-build --top 25
+
+--compare puts a second build next to it, per object and for the linked .elf
+(e.g. the same sketch before and after a refactor, to check that it costs no
+flash or RAM):
+
+    python3 memory_report.py /tmp/build-new --compare /tmp/build-old
+
+On the ESP8266 .rodata is placed in DRAM, so it counts as RAM next to .data and
+.bss. String literals wrapped in F() / PROGMEM go to .irom0.text (flash) instead.
+
+Object sections are counted where the core's linker script (eagle.app.v6.common.ld)
+puts them: in *.c.o / *.cpp.o files plain .text* / .literal* go to .irom0.text
+(flash), only .iram.* (ICACHE_RAM_ATTR / IRAM_ATTR) goes to IRAM. Other objects
+(assembler, prebuilt SDK archives) are not matched by those rules and their code
+stays in IRAM. In the linked .elf, .text is the IRAM segment.
+"""
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+RAM_SECTIONS = ('.data', '.rodata', '.bss')
+FLASH_SECTIONS = ('.irom', '.flash')
+CODE_SECTIONS = ('.text', '.literal')      #flash or IRAM, depending on the file (see above)
+IRAM_SECTIONS = ('.iram',)
+ELF_IRAM_SECTIONS = ('.text',)             #linked: the IRAM segment
+FLASH_OBJECT_SUFFIXES = ('.c.o', '.cpp.o')
+
+#nm symbol types that live in RAM: data, read-only data, bss (and their local forms)
+RAM_SYMBOL_TYPES = set('dDrRbBcC')
+
+
+def run(cmd):
+    try:
+        return subprocess.check_output(cmd, universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('[MEM] %s failed: %s' % (cmd[0], e))
+
+
+def section_sizes(size_tool, path):
+    linked = path.endswith('.elf')
+    code_in_flash = not linked and path.endswith(FLASH_OBJECT_SUFFIXES)
+    ram = iram = flash = 0
+    for line in run([size_tool, '-A', path]).splitlines():
+        parts = line.split()
+        if len(parts) < 2 or not parts[1].isdigit():
+            continue
+        name, size = parts[0], int(parts[1])
+        if name.startswith(FLASH_SECTIONS):
+            flash += size
+        elif name.startswith(RAM_SECTIONS):
+            ram += size
+        elif name.startswith(IRAM_SECTIONS):
+            iram += size
+        elif linked:
+            if name.startswith(ELF_IRAM_SECTIONS):
+                iram += size
+        elif name.startswith(CODE_SECTIONS):
+            if code_in_flash:
+                flash += size
+            else:
+                iram += size
+    return ram, iram, flash
+
+
+def ram_symbols(nm_tool, path):
+    symbols = []
+    for line in run([nm_tool, '-S', '--size-sort', '-C', path]).splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in RAM_SYMBOL_TYPES:
+            symbols.append((int(parts[1], 16), parts[3]))
+    return symbols
+
+
+def object_files(build_dir):
+    objects = sorted(glob.glob(os.path.join(build_dir, 'sketch', '**', '*.o'), recursive=True))
+    if not objects:
+        objects = sorted(glob.glob(os.path.join(build_dir, '**', '*.o'), recursive=True))
+    if not objects:
+        sys.exit('[MEM] no object files under %s' % build_dir)
+    return objects
+
+
+def compare(size_tool, build_dir, baseline_dir):
+    sizes = {}
+    for index, directory in enumerate((baseline_dir, build_dir)):
+        for path in object_files(directory):
+            name = os.path.relpath(path, directory)
+            sizes.setdefault(name, [(0, 0, 0), (0, 0, 0)])[index] = section_sizes(size_tool, path)
+
+    print('%8s %8s %8s  %s' % ('dRAM', 'dIRAM', 'dFLASH', 'OBJECT (this build - baseline)'))
+    total = [0, 0, 0]
+    for name in sorted(sizes):
+        before, after = sizes[name]
+        delta = [a - b for a, b in zip(after, before)]
+        total = [t + d for t, d in zip(total, delta)]
+        if any(delta):
+            print('%+8d %+8d %+8d  %s' % (delta[0], delta[1], delta[2], name))
+    print('%+8d %+8d %+8d  %s' % (total[0], total[1], total[2], '(sketch objects)'))
+
+    elves = [glob.glob(os.path.join(d, '*.elf')) for d in (baseline_dir, build_dir)]
+    if elves[0] and elves[1]:
+        before = section_sizes(size_tool, elves[0][0])
+        after = section_sizes(size_tool, elves[1][0])
+        print('%+8d %+8d %+8d  %s (linked)' % (after[0] - before[0], after[1] - before[1],
+                                              after[2] - before[2], os.path.basename(elves[1][0])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('build_dir', help='Arduino build directory (.o files and the .elf)')
+    parser.add_argument('--top', type=int, default=20, help='largest RAM symbols to list')
+    parser.add_argument('--tool-prefix', default='xtensa-lx106-elf-',
+                        help='binutils prefix (default: %(default)s)')
+    parser.add_argument('--compare', metavar='BASELINE_DIR',
+                        help='print size differences against another build directory')
+    args = parser.parse_args()
+
+    size_tool = args.tool_prefix + 'size'
+    nm_tool = args.tool_prefix + 'nm'
+
+    if args.compare:
+        compare(size_tool, args.build_dir, args.compare)
+        return
+
+    rows = []
+    for path in object_files(args.build_dir):
+        ram, iram, flash = section_sizes(size_tool, path)
+        rows.append((ram, iram, flash, os.path.relpath(path, args.build_dir)))
+    rows.sort(reverse=True)
+
+    print('%8s %8s %8s  %s' % ('RAM', 'IRAM', 'FLASH', 'OBJECT'))
+    for ram, iram, flash, name in rows:
+        print('%8d %8d %8d  %s' % (ram, iram, flash, name))
+    print('%8d %8d %8d  %s' % (sum(r[0] for r in rows), sum(r[1] for r in rows),
+                               sum(r[2] for r in rows), '(sketch objects)'))
+
+    elves = glob.glob(os.path.join(args.build_dir, '*.elf'))
+    if elves:
+        ram, iram, flash = section_sizes(size_tool, elves[0])
+        print('%8d %8d %8d  %s (linked, incl. core and libraries)' % (ram, iram, flash, os.path.basename(elves[0])))
+
+        print('\nLargest RAM symbols:')
+        for size, name in sorted(ram_symbols(nm_tool, elves[0]), reverse=True)[:args.top]:
+            print('%8d  %s' % (size, name))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,215 @@
+//Host comparison of the flight pipeline (readAll + FSM::update), float vs fixed-point build.
+//
+//  g++ -O2 -std=c++11 -DALLOC_TRACKING -I"../lolin esp8266" -o pipeline_float pipeline_bench.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  g++ -O2 -std=c++11 -DALLOC_TRACKING -DFIXED_POINT_PIPELINE -I"../lolin esp8266" -o pipeline_fixed pipeline_bench.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./pipeline_float --out float.txt
+//  ./pipeline_fixed --ref float.txt
+//
+//Flies the flight_sim.h drop (pad, 2 m/s lift to 100 m, free fall, canopy
+//at 80 m) from a cold boot to FINAL_REPORT, SIM_RUNS times with different
+//baro noise seeds. Every run must go through the whole state sequence. With
+//--ref, each transition of the other build's runs must come within one
+//baro output period of the profile that saw it plus one 20 Hz loop (the
+//rounding of the two layouts may put a threshold crossing on the next
+//output), and the per-call times are put side by side. The release servo
+//(ServoActuator on ActuatorMockTimer) must be armed ahead of LANDING and
+//drive its FIRE edge within one servo frame of the transition.
+//The times are host figures: x86 has an FPU, so float vs fixed here says
+//little about the LX106, and readAll() is mostly the simulated bus. They
+//catch a layout that got much slower; cycles on the target come from a
+//CYCLE_PROFILE build on the board.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_RUNS             7
+#define SIM_FLIGHT_END_MS    200000
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static const MissionState SEQUENCE[] = {
+    MissionState::IDLE, MissionState::ASCENT, MissionState::DESCENT_FREE,
+    MissionState::DESCENT_STABLE, MissionState::LANDING, MissionState::FINAL_REPORT
+};
+static const uint8_t SEQUENCE_LENGTH = sizeof(SEQUENCE) / sizeof(SEQUENCE[0]);
+static const uint8_t SEQUENCE_LANDING = 4;
+static const char* const SEQUENCE_NAMES[] = {
+    "IDLE", "ASCENT", "DESCENT_FREE", "DESCENT_STABLE", "LANDING", "FINAL_REPORT"
+};
+
+//One flight: transition times in SEQUENCE order, host ns per call
+struct Run {
+    bool complete;
+    uint32_t transition_ms[SEQUENCE_LENGTH];
+    bool released;              //pre-armed, FIRE edge within a servo frame of LANDING
+    double readAll_ns;
+    double update_ns;
+};
+
+static Run fly(uint32_t seed) {
+    FlightSim sim(SIM_DEFAULT_FLIGHT, seed);
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        return sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+    });
+
+    Run run;
+    const std::vector<SimTransition>& log = sim.transitions();
+    run.complete = log.size() == SEQUENCE_LENGTH;
+    for (uint8_t i = 0; i < SEQUENCE_LENGTH; i++) {
+        bool match = i < log.size() && log[i].state == SEQUENCE[i];
+        run.transition_ms[i] = match ? log[i].flight_ms : 0;
+        run.complete = run.complete && match;
+    }
+    uint32_t landing_ms = run.transition_ms[SEQUENCE_LANDING];
+    bool armed = false;
+    bool fired = false;
+    const std::vector<SimActuation>& actuations = sim.actuations();
+    for (size_t i = 0; i < actuations.size(); i++) {
+        const SimActuation& a = actuations[i];
+        if (a.outcome != ActuatorOutcome::DONE) {
+            continue;
+        }
+        armed = armed || (a.command == ActuatorCommand::ARM && a.flight_ms < landing_ms);
+        fired = fired || (a.command == ActuatorCommand::FIRE && a.flight_ms >= landing_ms &&
+                          a.flight_ms - landing_ms <= ACTUATOR_FRAME_US / 1000);
+    }
+    run.released = run.complete && armed && fired;
+    run.readAll_ns = sim.readAllNs();
+    run.update_ns = sim.updateNs();
+    return run;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = nullptr;
+    const char* refPath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--out") == 0) {
+            outPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--ref") == 0) {
+            refPath = argv[i + 1];
+        }
+    }
+
+#ifdef FIXED_POINT_PIPELINE
+    printf("pipeline bench, fixed-point build\n\n");
+#else
+    printf("pipeline bench, float build\n\n");
+#endif
+    SimPrint::setEnabled(false);
+
+    Run runs[SIM_RUNS];
+    std::vector<double> readAll;
+    std::vector<double> update;
+    uint8_t complete = 0;
+    uint8_t released = 0;
+    for (uint32_t r = 0; r < SIM_RUNS; r++) {
+        runs[r] = fly(r + 1);
+        readAll.push_back(runs[r].readAll_ns);
+        update.push_back(runs[r].update_ns);
+        if (runs[r].complete) {
+            complete++;
+        }
+        if (runs[r].released) {
+            released++;
+        }
+        printf("  run %u:", r + 1);
+        for (uint8_t i = 0; i < SEQUENCE_LENGTH; i++) {
+            printf(" %6u", runs[r].transition_ms[i]);
+        }
+        printf(" ms   readAll %5.0f ns  update %5.0f ns\n", runs[r].readAll_ns, runs[r].update_ns);
+    }
+    double readAll_ns = median(readAll);
+    double update_ns = median(update);
+
+    printf("\n");
+    char what[80];
+    snprintf(what, sizeof(what), "every run goes IDLE .. FINAL_REPORT (%u/%u)", complete, SIM_RUNS);
+    check(complete == SIM_RUNS, what);
+    snprintf(what, sizeof(what), "armed ahead, FIRE edge at LANDING (%u/%u)", released, SIM_RUNS);
+    check(released == SIM_RUNS, what);
+
+    if (outPath) {
+        FILE* f = fopen(outPath, "w");
+        if (!f) {
+            perror(outPath);
+            return 1;
+        }
+        fprintf(f, "%.1f,%.1f\n", readAll_ns, update_ns);
+        for (uint32_t r = 0; r < SIM_RUNS; r++) {
+            for (uint8_t i = 0; i < SEQUENCE_LENGTH; i++) {
+                fprintf(f, "%u%c", runs[r].transition_ms[i], i + 1 < SEQUENCE_LENGTH ? ',' : '\n');
+            }
+        }
+        fclose(f);
+    }
+
+    if (refPath) {
+        FILE* f = fopen(refPath, "r");
+        if (!f) {
+            perror(refPath);
+            return 1;
+        }
+        double refReadAll_ns = 0.0;
+        double refUpdate_ns = 0.0;
+        bool header = fscanf(f, "%lf,%lf", &refReadAll_ns, &refUpdate_ns) == 2;
+        uint32_t compared = 0;
+        uint32_t maxDiff_ms[SEQUENCE_LENGTH] = { 0 };
+        for (uint32_t r = 0; header && r < SIM_RUNS; r++) {
+            uint32_t ref_ms[SEQUENCE_LENGTH];
+            bool ok = true;
+            for (uint8_t i = 0; i < SEQUENCE_LENGTH && ok; i++) {
+                ok = fscanf(f, i == 0 ? "%u" : ",%u", &ref_ms[i]) == 1;
+            }
+            if (!ok) {
+                break;
+            }
+            for (uint8_t i = 0; i < SEQUENCE_LENGTH; i++) {
+                uint32_t a = runs[r].transition_ms[i];
+                uint32_t diff = a > ref_ms[i] ? a - ref_ms[i] : ref_ms[i] - a;
+                maxDiff_ms[i] = std::max(maxDiff_ms[i], diff);
+            }
+            compared++;
+        }
+        fclose(f);
+
+        printf("\nagainst %s, max transition difference over %u runs:\n", refPath, compared);
+        bool agree = true;
+        for (uint8_t i = 0; i < SEQUENCE_LENGTH; i++) {
+            MissionState before = i == 0 ? MissionState::BOOT : SEQUENCE[i - 1];
+            uint32_t tolerance_ms = getSamplingProfile(before).baroPeriod_ms + SIM_LOOP_MS;
+            printf("  %-16s %4u ms (tolerance %u)\n", SEQUENCE_NAMES[i], maxDiff_ms[i], tolerance_ms);
+            agree = agree && maxDiff_ms[i] <= tolerance_ms;
+        }
+        check(compared == SIM_RUNS, "reference covers the same runs");
+        check(agree, "transitions agree with the reference");
+
+        printf("\n  host ns per call      this    ref   ratio\n");
+        printf("  readAll()            %5.0f  %5.0f   %.2f\n", readAll_ns, refReadAll_ns,
+               refReadAll_ns > 0.0 ? readAll_ns / refReadAll_ns : 0.0);
+        printf("  FSM::update()        %5.0f  %5.0f   %.2f\n", update_ns, refUpdate_ns,
+               refUpdate_ns > 0.0 ? update_ns / refUpdate_ns : 0.0);
+    }
+
+    printf("\nmedian of %u runs: readAll %.0f ns, FSM::update %.0f ns per call (host)\n",
+           SIM_RUNS, readAll_ns, update_ns);
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
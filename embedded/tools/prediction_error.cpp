@@ -0,0 +1,238 @@
+//Host replay of the trajectory predictor's crossing error on simulated descents.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o prediction_error prediction_error.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./prediction_error
+//
+//The flight modules run on LinuxSimHal through flight_sim.h, so the
+//predictor is the FSM's own (FSM::getPredictor), fed the altitude readAll
+//produced: baro noise, the profile's IIR filter and the Hampel filter
+//included. Each drop is flown with SIM_SEEDS noise seeds. For every target
+//(deploy 80 m, image 40 m, landing 10 m) the crossing predicted
+//SIM_HORIZON_MS[i] ahead is compared with the loop in which the predictor
+//saw the crossing (what the FSM acts on), and with the true altitude
+//crossing (adds the sensor lag, printed only). The predictor's own score
+//(lastError_ms, PREDICTOR_HORIZON_MS ahead) must agree with this one.
+//Only the image and landing targets arm anything. From a 100 m release the
+//fall reaches 80 m after ~2.3 s, with the fit still catching up with the
+//acceleration behind the baro filter, so the deploy crossing comes ~0.9 s
+//before its prediction: the short drops' deploy error has its own bound
+//(SIM_SHORT_FALL_MAX_MS), the 300 m drop's the tight one.
+//Drops:
+//  100 m    flight_sim.h default drop, canopy at the FSM's -5 m/s
+//  300 m    free fall long enough to reach the -25 m/s terminal velocity
+//  canopy   -6.5 m/s under canopy: the drag model is off by 30%
+//  front    default drop with the ground pressure falling 300 Pa/h
+
+#include "flight_sim.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_SEEDS            4
+#define SIM_FLIGHT_END_MS    300000
+#define SIM_TARGETS          3
+#define SIM_HORIZONS         2
+#define SIM_ERROR_MAX_MS     400        //1 s ahead, image and landing, deploy after a long fall
+#define SIM_SHORT_FALL_MAX_MS 1000      //1 s ahead, deploy 20 m below the release
+#define SIM_SCORE_TOL_MS     SIM_LOOP_MS
+#define SIM_SPEED_ERROR_MPS  0.5        //fit below the image target, model drops only
+#define SIM_SIGMA_MAX_MS     100        //landing, last second
+
+struct SimDrop {
+    const char* name;
+    SimFlightProfile profile;
+    bool modelled;                      //canopy speed matches the FSM's drag model
+    bool longFall;                      //near terminal velocity at the deploy target
+};
+
+static const SimDrop DROPS[] = {
+    { "100 m",  { 10.0, 100.0, 2.0, 80.0, -25.0, -5.0, 1.5, 0.0 },    true,  false },
+    { "300 m",  { 10.0, 300.0, 5.0, 80.0, -25.0, -5.0, 1.5, 0.0 },    true,  true },
+    { "canopy", { 10.0, 100.0, 2.0, 80.0, -25.0, -6.5, 1.5, 0.0 },    false, false },
+    { "front",  { 10.0, 100.0, 2.0, 80.0, -25.0, -5.0, 1.5, -300.0 }, true,  false },
+};
+static const uint8_t DROP_COUNT = sizeof(DROPS) / sizeof(DROPS[0]);
+
+static const double TARGET_M[SIM_TARGETS] = { 80.0, 40.0, 10.0 };
+static const char* const TARGET_NAMES[SIM_TARGETS] = { "deploy", "image", "landing" };
+static const uint32_t SIM_HORIZON_MS[SIM_HORIZONS] = { PREDICTOR_HORIZON_MS, 3000 };
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//One target in one descent
+struct TargetRun {
+    bool predicted[SIM_HORIZONS];
+    uint32_t predicted_ms[SIM_HORIZONS];    //flight time of the predicted crossing
+    bool crossed;
+    uint32_t crossed_ms;                    //loop in which the predictor saw it
+    double trueCrossed_ms;                  //true altitude, interpolated between loops
+    bool scored;                            //predictor's own score
+    int32_t score_ms;
+};
+
+struct DescentRun {
+    TargetRun target[SIM_TARGETS];
+    double canopySpeedError_mps;            //max below the image target
+    bool landingSeen;                       //valid landing prediction within 1 s of the crossing
+    uint32_t landingSigma_ms;               //the last one's sigma
+};
+
+//Error statistics of one target and horizon over a drop's seeds
+struct ErrorStats {
+    uint32_t count;
+    double sum_ms;
+    double maxAbs_ms;
+    double trueSum_ms;
+
+    void add(double error_ms, double trueError_ms) {
+        count++;
+        sum_ms += error_ms;
+        maxAbs_ms = std::max(maxAbs_ms, fabs(error_ms));
+        trueSum_ms += trueError_ms;
+    }
+};
+
+static DescentRun fly(const SimDrop& drop, uint32_t seed) {
+    FlightSim sim(drop.profile, seed);
+    sim.boot();
+    DescentRun run;
+    memset(&run, 0, sizeof(run));
+    double lastTrue = 0.0;
+    uint32_t last_ms = 0;
+    MissionState lastState = sim.state();
+
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] {
+        const TrajectoryPredictor& predictor = sim.fsm().getPredictor();
+        uint32_t now_ms = sim.flightMs();
+        double h = sim.trueAltitudeAGL();
+        bool descending = sim.state() >= MissionState::DESCENT_FREE && sim.state() <= MissionState::LANDING;
+        bool transition = sim.state() != lastState;
+        lastState = sim.state();
+
+        for (uint8_t k = 0; k < SIM_TARGETS && descending; k++) {
+            TargetRun& t = run.target[k];
+            const AltitudePrediction& p = predictor.getPrediction(k);
+            if (!t.crossed && p.crossed) {
+                t.crossed = true;
+                t.crossed_ms = now_ms;
+                t.scored = p.errorAvailable;
+                t.score_ms = p.lastError_ms;
+            }
+            //First prediction the FSM would act on (isArmed: valid, sigma gate),
+            //flight time. A transition changes the drag model: earlier ones are dropped
+            for (uint8_t i = 0; i < SIM_HORIZONS && !t.crossed; i++) {
+                if (transition) {
+                    t.predicted[i] = false;
+                }
+                if (!t.predicted[i] && predictor.isArmed(k, SIM_HORIZON_MS[i])) {
+                    t.predicted[i] = true;
+                    t.predicted_ms[i] = now_ms + p.timeToTarget_ms;
+                }
+            }
+            if (t.trueCrossed_ms == 0.0 && lastTrue > TARGET_M[k] && h <= TARGET_M[k]) {
+                t.trueCrossed_ms = last_ms + (lastTrue - TARGET_M[k]) / (lastTrue - h) * (now_ms - last_ms);
+            }
+            if (k == SIM_TARGETS - 1 && p.valid && !p.crossed && p.timeToTarget_ms <= 1000) {
+                run.landingSeen = true;
+                run.landingSigma_ms = p.sigma_ms;
+            }
+        }
+        if (descending && h < TARGET_M[1] && sim.trueVerticalSpeed() < 0.0) {
+            double error = fabs(VSPEED_TO_MPS(predictor.getVerticalSpeed()) - sim.trueVerticalSpeed());
+            run.canopySpeedError_mps = std::max(run.canopySpeedError_mps, error);
+        }
+        lastTrue = h;
+        last_ms = now_ms;
+        return sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+    });
+    return run;
+}
+
+int main() {
+    printf("prediction error replay, %u drops x %u seeds\n", DROP_COUNT, SIM_SEEDS);
+    SimPrint::setEnabled(false);
+
+    bool allPredicted = true;
+    bool scoreAgrees = true;
+    double worst1s_ms = 0.0;
+    double worstShortFall_ms = 0.0;
+    double worstSpeed_mps = 0.0;
+    uint32_t worstSigma_ms = 0;
+    bool sigmaSeen = true;
+
+    printf("\n  %-7s %-8s %-7s %5s %9s %9s %11s\n", "drop", "target", "ahead", "n", "mean_ms", "max|e|", "vs true_ms");
+    for (uint8_t d = 0; d < DROP_COUNT; d++) {
+        const SimDrop& drop = DROPS[d];
+        ErrorStats stats[SIM_TARGETS][SIM_HORIZONS];
+        memset(stats, 0, sizeof(stats));
+        double speedError = 0.0;
+
+        for (uint32_t seed = 1; seed <= SIM_SEEDS; seed++) {
+            DescentRun run = fly(drop, seed);
+            for (uint8_t k = 0; k < SIM_TARGETS; k++) {
+                const TargetRun& t = run.target[k];
+                allPredicted = allPredicted && t.crossed && t.predicted[0];
+                for (uint8_t i = 0; i < SIM_HORIZONS; i++) {
+                    if (t.crossed && t.predicted[i]) {
+                        stats[k][i].add((double)t.crossed_ms - t.predicted_ms[i], t.trueCrossed_ms - t.predicted_ms[i]);
+                    }
+                }
+                if (t.crossed && t.predicted[0]) {
+                    int32_t own = (int32_t)t.crossed_ms - (int32_t)t.predicted_ms[0];
+                    scoreAgrees = scoreAgrees && t.scored && abs(own - t.score_ms) <= SIM_SCORE_TOL_MS;
+                }
+            }
+            speedError = std::max(speedError, run.canopySpeedError_mps);
+            if (drop.modelled) {
+                sigmaSeen = sigmaSeen && run.landingSeen;
+                worstSigma_ms = std::max(worstSigma_ms, run.landingSigma_ms);
+            }
+        }
+
+        for (uint8_t k = 0; k < SIM_TARGETS; k++) {
+            for (uint8_t i = 0; i < SIM_HORIZONS; i++) {
+                const ErrorStats& s = stats[k][i];
+                double n = s.count ? s.count : 1;
+                printf("  %-7s %-8s %5.1f s %5u %9.0f %9.0f %11.0f\n", drop.name, TARGET_NAMES[k],
+                       SIM_HORIZON_MS[i] / 1000.0, s.count, s.sum_ms / n, s.maxAbs_ms, s.trueSum_ms / n);
+            }
+            if (k == 0 && !drop.longFall) {
+                worstShortFall_ms = std::max(worstShortFall_ms, stats[k][0].maxAbs_ms);
+            } else {
+                worst1s_ms = std::max(worst1s_ms, stats[k][0].maxAbs_ms);
+            }
+        }
+        printf("  %-7s fit speed below %.0f m: max error %.2f m/s\n", drop.name, TARGET_M[1], speedError);
+        if (drop.modelled) {
+            worstSpeed_mps = std::max(worstSpeed_mps, speedError);
+        }
+    }
+
+    printf("\n");
+    char what[96];
+    check(allPredicted, "every target predicted 1 s ahead and crossed");
+    snprintf(what, sizeof(what), "1 s ahead crossing error within %u ms (max %.0f)", SIM_ERROR_MAX_MS, worst1s_ms);
+    check(worst1s_ms <= SIM_ERROR_MAX_MS, what);
+    snprintf(what, sizeof(what), "deploy after a 20 m fall within %u ms (max %.0f)", SIM_SHORT_FALL_MAX_MS,
+             worstShortFall_ms);
+    check(worstShortFall_ms <= SIM_SHORT_FALL_MAX_MS, what);
+    check(scoreAgrees, "predictor's own score agrees within one loop");
+    snprintf(what, sizeof(what), "fit speed below %.0f m within %.1f m/s (max %.2f)", TARGET_M[1],
+             SIM_SPEED_ERROR_MPS, worstSpeed_mps);
+    check(worstSpeed_mps < SIM_SPEED_ERROR_MPS, what);
+    snprintf(what, sizeof(what), "landing sigma below %u ms in the last second (%u ms)", SIM_SIGMA_MAX_MS, worstSigma_ms);
+    check(sigmaSeen && worstSigma_ms < SIM_SIGMA_MAX_MS, what);
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
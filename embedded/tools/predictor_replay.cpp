@@ -0,0 +1,200 @@
+//Host replay of the trajectory predictor on a synthetic drop, float vs fixed-point build.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266" -o predictor_float predictor_replay.cpp "../lolin esp8266/predictor.cpp" "../lolin esp8266/fixed_point.cpp"
+//  g++ -O2 -std=c++11 -DFIXED_POINT_PIPELINE -I"../lolin esp8266" -o predictor_fixed predictor_replay.cpp "../lolin esp8266/predictor.cpp" "../lolin esp8266/fixed_point.cpp"
+//  ./predictor_float --out float.csv
+//  ./predictor_fixed --ref float.csv
+//
+//Flight at 20 Hz with +-0.3 m of uniform baro noise: 10 s climb at 2 m/s, free fall
+//with drag (vt -25 m/s) down to 80 m, canopy (vt -5 m/s) to the ground. The FSM
+//targets (80 / 40 / 10 m) and phase drag models are set the way FSM does.
+//Every target must be predicted and crossed; with --ref, every sample of
+//the other build's run must agree within SIM_REF_TOL_MS / SIM_REF_TOL_CMPS
+//(speed once the fit is ready: the float RLS starts from a prior, the integer
+//fit from the exact least squares line, so the first 2 s differ).
+//The ns per update() are host figures (x86 has an FPU), cycles on the target
+//come from CYCLE_PROFILE. The prediction error on flown descents (sensor
+//lag included) is prediction_error.cpp.
+
+#include "predictor.h"
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_RATE_HZ          20
+#define SIM_NOISE_M          0.3
+#define SIM_CLIMB_S          10
+#define SIM_DEPLOY_M         80.0
+#define SIM_IMAGE_M          40.0
+#define SIM_LANDING_M        10.0
+#define SIM_REF_TOL_MS       20
+#define SIM_REF_TOL_CMPS     10
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//One update() worth of output, what --out writes and --ref compares
+struct Sample {
+    uint32_t time_ms;
+    uint8_t ready;
+    int32_t speed_cmps;
+    uint8_t valid[3];
+    uint32_t timeToTarget_ms[3];
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = nullptr;
+    const char* refPath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--out") == 0) {
+            outPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--ref") == 0) {
+            refPath = argv[i + 1];
+        }
+    }
+
+#ifdef FIXED_POINT_PIPELINE
+    printf("predictor replay, fixed-point build\n");
+#else
+    printf("predictor replay, float build\n");
+#endif
+
+    TrajectoryPredictor predictor;
+    predictor.begin();
+    predictor.addTarget(ALTITUDE_FROM_M(SIM_DEPLOY_M));
+    predictor.addTarget(ALTITUDE_FROM_M(SIM_IMAGE_M));
+    predictor.addTarget(ALTITUDE_FROM_M(SIM_LANDING_M));
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> noise(-SIM_NOISE_M, SIM_NOISE_M);
+    std::vector<Sample> run;
+    double h = 150.0;
+    double v = 0.0;
+    int phase = 0;
+    bool predicted[3] = { false, false, false };
+    double update_s = 0.0;
+    const double dt = 1.0 / SIM_RATE_HZ;
+
+    for (uint32_t i = 0; h > 0.0; i++) {
+        uint32_t t_ms = i * 1000 / SIM_RATE_HZ;
+        if (i < SIM_CLIMB_S * SIM_RATE_HZ) {
+            v = 2.0;
+        } else {
+            //Drag-limited: dv/dt = -g (1 - (v / vt)^2), also slows a fall faster than vt
+            double vt = h > SIM_DEPLOY_M ? -25.0 : -5.0;
+            int next = h > SIM_DEPLOY_M ? 1 : 2;
+            if (next != phase) {
+                phase = next;
+                predictor.setTerminalVelocity(VSPEED_FROM_MPS(vt));
+            }
+            v += -9.80665 * (1.0 - (v / vt) * (v / vt)) * dt;
+        }
+        h += v * dt;
+
+        altitude_t measured = ALTITUDE_FROM_M(h + noise(rng));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        predictor.update(measured, t_ms);
+        update_s += secondsSince(start);
+
+        Sample s;
+        s.time_ms = t_ms;
+        s.ready = predictor.isReady();
+        s.speed_cmps = (int32_t)lround(VSPEED_TO_MPS(predictor.getVerticalSpeed()) * 100.0);
+        for (uint8_t k = 0; k < 3; k++) {
+            const AltitudePrediction& p = predictor.getPrediction(k);
+            s.valid[k] = p.valid;
+            s.timeToTarget_ms[k] = p.valid ? p.timeToTarget_ms : 0;
+            predicted[k] = predicted[k] || p.valid;
+        }
+        run.push_back(s);
+
+        if (i % (2 * SIM_RATE_HZ) == 0) {
+            printf("  t %5.1f s  h %6.1f m  v %6.2f m/s  fit v %6.2f  T(40 m) %6u ms  T(10 m) %6u ms\n",
+                   t_ms / 1000.0, h, v, (double)VSPEED_TO_MPS(predictor.getVerticalSpeed()),
+                   s.timeToTarget_ms[1], s.timeToTarget_ms[2]);
+        }
+    }
+
+    printf("\n");
+    const char* names[3] = { "deploy", "image", "landing" };
+    for (uint8_t k = 0; k < 3; k++) {
+        char what[80];
+        snprintf(what, sizeof(what), "%s predicted and crossed", names[k]);
+        check(predicted[k] && predictor.getPrediction(k).crossed, what);
+    }
+
+    if (outPath) {
+        FILE* f = fopen(outPath, "w");
+        if (!f) {
+            perror(outPath);
+            return 1;
+        }
+        for (size_t i = 0; i < run.size(); i++) {
+            const Sample& s = run[i];
+            fprintf(f, "%u,%u,%d,%u,%u,%u,%u,%u,%u\n", s.time_ms, s.ready, s.speed_cmps, s.valid[0], s.timeToTarget_ms[0],
+                    s.valid[1], s.timeToTarget_ms[1], s.valid[2], s.timeToTarget_ms[2]);
+        }
+        fclose(f);
+    }
+
+    if (refPath) {
+        FILE* f = fopen(refPath, "r");
+        if (!f) {
+            perror(refPath);
+            return 1;
+        }
+        size_t compared = 0;
+        size_t validMismatch = 0;
+        uint32_t maxTimeDiff_ms = 0;
+        int32_t maxSpeedDiff_cmps = 0;
+        Sample r;
+        unsigned ready;
+        unsigned valid[3];
+        while (compared < run.size() &&
+               fscanf(f, "%u,%u,%d,%u,%u,%u,%u,%u,%u", &r.time_ms, &ready, &r.speed_cmps, &valid[0], &r.timeToTarget_ms[0],
+                      &valid[1], &r.timeToTarget_ms[1], &valid[2], &r.timeToTarget_ms[2]) == 9) {
+            const Sample& s = run[compared++];
+            int32_t speedDiff = abs(s.speed_cmps - r.speed_cmps);
+            if (s.ready && ready && speedDiff > maxSpeedDiff_cmps) {
+                maxSpeedDiff_cmps = speedDiff;
+            }
+            for (uint8_t k = 0; k < 3; k++) {
+                if (s.valid[k] != (valid[k] != 0)) {
+                    validMismatch++;  //a prediction right at a gate (hovering, crossing) may flip
+                    continue;
+                }
+                uint32_t diff = s.timeToTarget_ms[k] > r.timeToTarget_ms[k] ? s.timeToTarget_ms[k] - r.timeToTarget_ms[k]
+                                                                            : r.timeToTarget_ms[k] - s.timeToTarget_ms[k];
+                if (diff > maxTimeDiff_ms) {
+                    maxTimeDiff_ms = diff;
+                }
+            }
+        }
+        fclose(f);
+        printf("\nagainst %s: %zu samples, time-to-target max diff %u ms, speed max diff %d cm/s, "
+               "%zu validity flips\n", refPath, compared, maxTimeDiff_ms, maxSpeedDiff_cmps, validMismatch);
+        check(compared == run.size(), "reference covers the same run");
+        check(maxTimeDiff_ms <= SIM_REF_TOL_MS, "time-to-target matches the reference");
+        check(maxSpeedDiff_cmps <= SIM_REF_TOL_CMPS, "fitted speed matches the reference once ready");
+        check(validMismatch <= run.size() / 200, "validity agrees on 99.5% of the predictions");
+    }
+
+    printf("\n%.0f ns per update() (host), %zu updates\n", update_s * 1e9 / run.size(), run.size());
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
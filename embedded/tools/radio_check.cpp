@@ -0,0 +1,297 @@
+//Host check of RadioLink over the Linux pipe backend: throughput, reassembly, TX policy.
+//
+//  g++ -O2 -std=c++11 -DALLOC_TRACKING -I"../lolin esp8266" -o radio_check radio_check.cpp "../lolin esp8266/radio.cpp" "../lolin esp8266/alloc_tracking.cpp"
+//  ./radio_check
+//
+//1. Loopback (FdRadioBackend::openLoopback, the link receives what it
+//   sends): SIM_FRAMES frames of every length from 1 to RADIO_MAX_FRAME
+//   bytes, one at a time, each read back and compared byte for byte. No
+//   poll() hands more than its maxFragments to the backend, a frame takes
+//   ceil(fragments / maxFragments) polls, and none of it touches the heap
+//   (ALLOC_FREE_SCOPE aborts the run).
+//2. Pipelined: the next frame is queued while the previous one is on air.
+//   Frames of more than SIM_MAX_FRAGMENTS fragments complete at most one
+//   per poll, so all arrive; shorter ones may complete two per poll and
+//   the older is dropped unread (newest wins, as on TX).
+//3. TX policy: a third frame queued behind a full double buffer replaces the
+//   waiting one. Between two links with the peer not polling, the pipe
+//   fills: poll() returns (txBusyPolls) and the link resumes once drained.
+//4. Receive errors: a bad fragment header, a frame cut short by the next
+//   sequence and one whose last fragment never comes (reassembly timeout,
+//   real time: radio.cpp's host millis() is CLOCK_MONOTONIC).
+//Throughput figures are host numbers (a pipe, not a radio).
+
+#include "radio.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_FRAMES           2000
+#define SIM_MAX_FRAGMENTS    3          //poll(maxFragments), the flight loop's default
+#define SIM_POLL_LIMIT       100000
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static uint16_t frameLength(uint32_t n) {
+    return (uint16_t)(n * 37 % RADIO_MAX_FRAME + 1);    //37 is coprime with 448: all lengths
+}
+
+static void fillFrame(uint8_t* frame, uint16_t len, uint32_t n) {
+    for (uint16_t i = 0; i < len; i++) {
+        frame[i] = (uint8_t)(n * 131 + i * 7 + (i >> 8));
+    }
+}
+
+static uint8_t fragmentsOf(uint16_t len) {
+    return (uint8_t)((len + RADIO_FRAG_DATA - 1) / RADIO_FRAG_DATA);
+}
+
+static void loopback() {
+    printf("\nloopback, one frame at a time\n");
+    int rxFd = -1;
+    int txFd = -1;
+    bool open = FdRadioBackend::openLoopback(rxFd, txFd);
+    FdRadioBackend backend(rxFd, txFd);
+    RadioLink link;
+    check(open && link.begin(&backend), "loopback pipe opened, link started");
+
+    uint8_t frame[RADIO_MAX_FRAME];
+    uint8_t received[RADIO_MAX_FRAME];
+    uint32_t intact = 0;
+    uint32_t inOrder = 0;
+    uint32_t polls = 0;
+    uint32_t slowFrames = 0;
+    bool perPoll = true;
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t n = 0; n < SIM_FRAMES; n++) {
+        uint16_t len = frameLength(n);
+        fillFrame(frame, len, n);
+        link.send(frame, len);
+        uint32_t framePolls = 0;
+        while (!link.available() && framePolls < SIM_POLL_LIMIT) {
+            uint32_t before = link.getStats().fragmentsSent;
+            link.poll(SIM_MAX_FRAGMENTS);
+            perPoll = perPoll && link.getStats().fragmentsSent - before <= SIM_MAX_FRAGMENTS;
+            framePolls++;
+        }
+        uint16_t got = link.read(received, sizeof(received));
+        if (got == len && memcmp(frame, received, len) == 0) {
+            intact++;
+        }
+        if (link.lastRxSequence() == (uint8_t)n) {
+            inOrder++;
+        }
+        if (framePolls > (uint32_t)(fragmentsOf(len) + SIM_MAX_FRAGMENTS - 1) / SIM_MAX_FRAGMENTS) {
+            slowFrames++;
+        }
+        polls += framePolls;
+        bytes += len;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const RadioStats& s = link.getStats();
+    char what[96];
+    snprintf(what, sizeof(what), "frames reassembled intact (%u/%u)", intact, SIM_FRAMES);
+    check(intact == SIM_FRAMES, what);
+    check(inOrder == SIM_FRAMES && s.sequenceGaps == 0, "sequence numbers consecutive, wrap included");
+    check(s.framesSent == SIM_FRAMES && s.framesReceived == SIM_FRAMES, "link counters: all sent, all received");
+    check(s.fragmentsMalformed == 0 && s.framesIncomplete == 0 && s.framesUnread == 0 &&
+          s.framesOverwritten == 0, "no malformed, incomplete, unread or replaced frames");
+    snprintf(what, sizeof(what), "at most %u fragments per poll()", SIM_MAX_FRAGMENTS);
+    check(perPoll, what);
+    snprintf(what, sizeof(what), "every frame in ceil(fragments / %u) polls (%u slower)", SIM_MAX_FRAGMENTS, slowFrames);
+    check(slowFrames == 0, what);
+    printf("  %u frames, %llu bytes, %u fragments in %u polls: %.0f frames/s, %.1f MB/s (host)\n",
+           SIM_FRAMES, (unsigned long long)bytes, s.fragmentsSent, polls, SIM_FRAMES / seconds, bytes / seconds / 1e6);
+    close(rxFd);
+    close(txFd);
+}
+
+static void pipelined() {
+    printf("\npipelined, next frame queued while one is on air\n");
+    int rxFd;
+    int txFd;
+    FdRadioBackend::openLoopback(rxFd, txFd);
+    FdRadioBackend backend(rxFd, txFd);
+    RadioLink link;
+    link.begin(&backend);
+
+    uint8_t frame[RADIO_MAX_FRAME];
+    uint8_t received[RADIO_MAX_FRAME];
+    const uint16_t minLength = SIM_MAX_FRAGMENTS * RADIO_FRAG_DATA + 1;
+    uint32_t queued = 0;
+    uint32_t intact = 0;
+    uint32_t polls = 0;
+    uint8_t expected[256];
+    uint16_t expectedLength[256];
+    while (intact < SIM_FRAMES && polls < SIM_POLL_LIMIT) {
+        const RadioStats& s = link.getStats();
+        if (queued < SIM_FRAMES && s.framesQueued - s.framesSent <= 1) {
+            uint16_t len = (uint16_t)(minLength + queued * 37 % (RADIO_MAX_FRAME - minLength + 1));
+            fillFrame(frame, len, queued);
+            expected[queued & 0xFF] = (uint8_t)(queued * 131);
+            expectedLength[queued & 0xFF] = len;
+            link.send(frame, len);
+            queued++;
+        }
+        link.poll(SIM_MAX_FRAGMENTS);
+        polls++;
+        uint16_t got = link.read(received, sizeof(received));
+        uint8_t seq = link.lastRxSequence();
+        if (got > 0 && got == expectedLength[seq] && received[0] == expected[seq]) {
+            intact++;
+        }
+    }
+
+    const RadioStats& s = link.getStats();
+    char what[96];
+    snprintf(what, sizeof(what), "frames over %u fragments all arrive (%u/%u)", SIM_MAX_FRAGMENTS, intact, SIM_FRAMES);
+    check(intact == SIM_FRAMES && s.framesUnread == 0, what);
+    check(s.framesOverwritten == 0 && s.sequenceGaps == 0, "double buffer: nothing replaced, no sequence gap");
+    double fragmentsPerPoll = polls ? (double)s.fragmentsSent / polls : 0.0;
+    snprintf(what, sizeof(what), "radio kept busy: %.2f fragments per poll (max %u)", fragmentsPerPoll, SIM_MAX_FRAGMENTS);
+    check(fragmentsPerPoll > SIM_MAX_FRAGMENTS - 0.1, what);
+    close(rxFd);
+    close(txFd);
+}
+
+static void txPolicy() {
+    printf("\nTX policy\n");
+    int rxFd;
+    int txFd;
+    FdRadioBackend::openLoopback(rxFd, txFd);
+    FdRadioBackend backend(rxFd, txFd);
+    RadioLink link;
+    link.begin(&backend);
+
+    //Three frames before any poll: the first goes on air, the third replaces the second
+    uint8_t frame[RADIO_MAX_FRAME];
+    uint8_t received[RADIO_MAX_FRAME];
+    for (uint8_t n = 0; n < 3; n++) {
+        memset(frame, 'a' + n, 100);
+        link.send(frame, 100);
+    }
+    uint8_t first[2] = { 0, 0 };
+    uint8_t got = 0;
+    for (uint32_t i = 0; i < 100 && got < 2; i++) {
+        link.poll(SIM_MAX_FRAGMENTS);
+        if (link.read(received, sizeof(received)) == 100) {
+            first[got++] = received[0];
+        }
+    }
+    const RadioStats& s = link.getStats();
+    check(s.framesOverwritten == 1 && got == 2 && first[0] == 'a' && first[1] == 'c',
+          "third frame replaces the waiting one, on-air frame kept");
+    check(s.sequenceGaps == 1, "receiver counts the replaced frame as a gap");
+    close(rxFd);
+    close(txFd);
+
+    //Two links, the peer not polling: the pipe fills and poll() returns
+    int aToB[2];
+    int bToA[2];
+    bool open = pipe(aToB) == 0 && pipe(bToA) == 0;
+    FdRadioBackend aBackend(bToA[0], aToB[1]);
+    FdRadioBackend bBackend(aToB[0], bToA[1]);
+    RadioLink a;
+    RadioLink b;
+    open = open && a.begin(&aBackend) && b.begin(&bBackend);
+    memset(frame, 'x', RADIO_MAX_FRAME);
+    uint32_t polls = 0;
+    while (a.getStats().txBusyPolls == 0 && polls < SIM_POLL_LIMIT) {
+        if (!a.txBusy()) {
+            a.send(frame, RADIO_MAX_FRAME);
+        }
+        a.poll(SIM_MAX_FRAGMENTS);
+        polls++;
+    }
+    char what[96];
+    snprintf(what, sizeof(what), "full pipe: poll() returns busy (%u fragments buffered)", a.getStats().fragmentsSent);
+    check(open && a.getStats().txBusyPolls > 0, what);
+
+    //The peer drains until the stalled frame is out, then a new one goes through intact
+    for (uint32_t i = 0; i < SIM_POLL_LIMIT && a.txBusy(); i++) {
+        b.poll(SIM_MAX_FRAGMENTS);
+        b.read(received, sizeof(received));
+        a.poll(SIM_MAX_FRAGMENTS);
+    }
+    b.poll(SIM_MAX_FRAGMENTS);
+    b.read(received, sizeof(received));
+    fillFrame(frame, 300, 7);
+    a.send(frame, 300);
+    uint16_t len = 0;
+    for (uint32_t i = 0; i < 100 && len == 0; i++) {
+        a.poll(SIM_MAX_FRAGMENTS);
+        b.poll(SIM_MAX_FRAGMENTS);
+        len = b.read(received, sizeof(received));
+    }
+    check(!a.txBusy() && len == 300 && memcmp(frame, received, len) == 0, "link resumes once the peer drains");
+    close(aToB[0]);
+    close(aToB[1]);
+    close(bToA[0]);
+    close(bToA[1]);
+}
+
+static void receiveErrors() {
+    printf("\nreceive errors\n");
+    int rxFd;
+    int txFd;
+    FdRadioBackend::openLoopback(rxFd, txFd);
+    FdRadioBackend backend(rxFd, txFd);
+    FdRadioBackend raw(rxFd, txFd);
+    RadioLink link;
+    link.begin(&backend);
+    uint8_t payload[RADIO_MAX_PAYLOAD];
+    uint8_t received[RADIO_MAX_FRAME];
+    memset(payload, 0x55, sizeof(payload));
+
+    //index >= count
+    payload[0] = 1; payload[1] = 2; payload[2] = 2; payload[3] = 10;
+    raw.transmit(payload, RADIO_FRAG_HEADER + 10);
+    link.poll(SIM_MAX_FRAGMENTS);
+    check(link.getStats().fragmentsMalformed == 1 && !link.available(), "bad fragment header rejected");
+
+    //Two of three fragments of seq 2, then seq 3 whole: 2 is dropped, 3 delivered
+    for (uint8_t i = 0; i < 2; i++) {
+        payload[0] = 2; payload[1] = i; payload[2] = 3; payload[3] = RADIO_FRAG_DATA;
+        raw.transmit(payload, RADIO_MAX_PAYLOAD);
+    }
+    payload[0] = 3; payload[1] = 0; payload[2] = 1; payload[3] = 20;
+    raw.transmit(payload, RADIO_FRAG_HEADER + 20);
+    link.poll(SIM_MAX_FRAGMENTS);
+    uint16_t len = link.read(received, sizeof(received));
+    check(link.getStats().framesIncomplete == 1 && len == 20 && link.lastRxSequence() == 3,
+          "frame cut short by the next sequence dropped, next kept");
+
+    //First of two fragments, the second never comes
+    payload[0] = 4; payload[1] = 0; payload[2] = 2; payload[3] = RADIO_FRAG_DATA;
+    raw.transmit(payload, RADIO_MAX_PAYLOAD);
+    link.poll(SIM_MAX_FRAGMENTS);
+    usleep((RADIO_REASSEMBLY_TIMEOUT_MS + 100) * 1000);
+    link.poll(SIM_MAX_FRAGMENTS);
+    char what[96];
+    snprintf(what, sizeof(what), "partial frame dropped after %u ms", RADIO_REASSEMBLY_TIMEOUT_MS);
+    check(link.getStats().framesIncomplete == 2 && !link.available(), what);
+    close(rxFd);
+    close(txFd);
+}
+
+int main() {
+    printf("radio link check\n");
+    loopback();
+    pipelined();
+    txPolicy();
+    receiveErrors();
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
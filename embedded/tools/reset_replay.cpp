@@ -0,0 +1,345 @@
+//Host replay of resets at arbitrary points of a flight: warm restart, resume time and the rest of the flight.
+//
+//  g++ -O2 -std=c++11 -DALLOC_TRACKING -DGPS_USE_UBX -I"../lolin esp8266" -o reset_replay reset_replay.cpp "../lolin esp8266/"*.cpp "../lolin esp8266/sensors/"*.cpp
+//  ./reset_replay [-v]
+//
+//The flight modules run on LinuxSimHal through flight_sim.h, the GPS in UBX
+//mode so a cold boot pays for the receiver configuration like on the board.
+//The flight_sim.h drop is flown once without a reset for reference, then
+//again with a reset every SIM_RESET_STEP_MS of flight time, once as a
+//watchdog reset (RTC memory kept) and once as a power cycle (EEPROM copy
+//only). For every run:
+//1. The board boots warm exactly when the reset hit IDLE..LANDING, into the
+//   same state (the first reset is halfway through BOOT); warm boots resume within SIM_RESUME_MAX_MS of simulated time
+//   (the driver begin() calls, no ground calibration, no UBX configuration).
+//2. The flight goes on through the same states to FINAL_REPORT, no state is
+//   entered twice or skipped, no SAFE_MODE.
+//3. ASCENT never before the drone is at the liftoff height (a warm boot
+//   restarts the IIR on the current altitude, after a reset while lifting
+//   it sees the climb sooner than the reference). DESCENT_FREE never before
+//   the true release (a fresh predictor fit
+//   after the reset used to call a false descent; it may come earlier than
+//   in the reference, the fit has less history to unlearn). The other
+//   transitions no earlier than in the reference minus one baro output
+//   period of the profile before them plus one loop (the filters restart on
+//   a different noise sample). None later than that plus the predictor's
+//   two forgetting windows, which a warm boot has to refill.
+//4. The release servo (ServoActuator on ActuatorMockTimer): in the reference
+//   ARM comes ahead of LANDING (predicted landing) and FIRE within one servo
+//   frame of the LANDING transition. Every run that reaches LANDING drives a
+//   FIRE edge, also when the reset hit LANDING itself (the release is
+//   re-issued on the warm boot).
+//A reset in IDLE after the drone lifted off but before ASCENT was seen (the
+//pad IIR lag and output period, ~3 m) resumes IDLE on the checkpointed
+//ground baseline, frozen: a cold boot could not converge one while climbing.
+//Those runs are counted and must end in FINAL_REPORT.
+//Power-on after an unfinished flight: the board is switched off in
+//DESCENT_STABLE or LANDING and on again later. Off for a short outage it
+//resumes from the EEPROM copy; off for longer than
+//CHECKPOINT_EEPROM_MAX_AGE_S (on the ground, recovered), or with the RTC
+//time lost, it boots cold into IDLE and the servo never fires again.
+//Last, SAFE_MODE once the servo is pre-armed in DESCENT_STABLE: the abort
+//drops the release, no FIRE, the servo goes SAFE.
+//-v lists every run.
+
+#include "flight_sim.h"
+#include "sampling_profiles.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_FLIGHT_END_MS    200000
+#define SIM_RESET_STEP_MS    1300
+#define SIM_RESUME_MAX_MS    100
+#define SIM_PREDICTOR_READY_MS 2000     //40 samples at 20 Hz (two windows, lambda 0.95)
+#define SIM_LIFTOFF_AGL_M    10.0       //FSM LIFTOFF_DETECT_ALT
+#define SIM_OUTAGE_MS        2000       //brownout / loose battery contact
+#define SIM_RECOVERY_MS      ((CHECKPOINT_EEPROM_MAX_AGE_S + 60) * 1000UL)   //switched off, carried back
+#define SIM_AFTER_ON_MS      40000      //past BOOT_TIMEOUT
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static bool resumable(MissionState state) {
+    return state >= MissionState::IDLE && state <= MissionState::LANDING;
+}
+
+static bool finished(const FlightSim& sim) {
+    return sim.state() == MissionState::FINAL_REPORT || sim.state() == MissionState::SAFE_MODE;
+}
+
+//Transition log without the repeated IDLE of a cold boot
+static std::vector<SimTransition> collapse(const std::vector<SimTransition>& log) {
+    std::vector<SimTransition> out;
+    for (size_t i = 0; i < log.size(); i++) {
+        if (out.empty() || out.back().state != log[i].state) {
+            out.push_back(log[i]);
+        }
+    }
+    return out;
+}
+
+struct ResetRun {
+    uint32_t reset_ms;
+    MissionState before;
+    bool warm;
+    bool sameState;
+    double resume_ms;
+    bool complete;
+    bool early;
+    bool late;
+    uint32_t late_ms;
+    bool lifting;               //IDLE reset above the pad
+    bool landing;               //LANDING entered before or after the reset
+    bool fired;                 //FIRE executed (output edge)
+    MissionState end;
+};
+
+static bool reaches(const std::vector<SimTransition>& log, MissionState state) {
+    for (size_t i = 0; i < log.size(); i++) {
+        if (log[i].state == state) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//Drone at the FSM liftoff height (LIFTOFF_DETECT_ALT)
+static uint32_t liftoffMs() {
+    const SimFlightProfile& p = SIM_DEFAULT_FLIGHT;
+    return (uint32_t)((p.padSeconds + SIM_LIFTOFF_AGL_M / p.climb_mps) * 1000.0);
+}
+
+static uint32_t releaseMs() {
+    const SimFlightProfile& p = SIM_DEFAULT_FLIGHT;
+    return (uint32_t)((p.padSeconds + p.releaseAGL_m / p.climb_mps) * 1000.0);
+}
+
+static ResetRun fly(const std::vector<SimTransition>& reference, uint32_t reset_ms, bool powerCycle) {
+    ResetRun run;
+    memset(&run, 0, sizeof(run));
+    run.reset_ms = reset_ms;
+
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(reset_ms, [&] { return finished(sim); });
+    run.before = sim.state();
+    run.lifting = run.before == MissionState::IDLE && sim.trueAltitudeAGL() > 0.0;
+
+    if (powerCycle) {
+        SimEsp::powerCycle();
+    }
+    run.warm = sim.boot();
+    //micros() restarted at 0 in boot(), what it reads now is the time begin() took
+    run.resume_ms = micros() / 1000.0;
+    run.sameState = sim.state() == run.before;
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] { return finished(sim); });
+    run.end = sim.state();
+
+    std::vector<SimTransition> log = collapse(sim.transitions());
+    run.landing = reaches(log, MissionState::LANDING);
+    run.fired = sim.countActuations(ActuatorCommand::FIRE) > 0;
+    run.complete = log.size() == reference.size();
+    for (size_t i = 0; run.complete && i < log.size(); i++) {
+        run.complete = log[i].state == reference[i].state;
+        MissionState previous = i == 0 ? MissionState::BOOT : reference[i - 1].state;
+        uint32_t tolerance_ms = getSamplingProfile(previous).baroPeriod_ms + SIM_LOOP_MS;
+        if (log[i].state == MissionState::ASCENT ? log[i].flight_ms < liftoffMs()
+            : log[i].state == MissionState::DESCENT_FREE ? log[i].flight_ms < releaseMs()
+            : log[i].flight_ms + tolerance_ms < reference[i].flight_ms) {
+            run.early = true;
+        }
+        if (log[i].flight_ms > reference[i].flight_ms) {
+            uint32_t late_ms = log[i].flight_ms - reference[i].flight_ms;
+            run.late_ms = late_ms > run.late_ms ? late_ms : run.late_ms;
+            run.late = run.late || late_ms > tolerance_ms + SIM_PREDICTOR_READY_MS;
+        }
+    }
+    return run;
+}
+
+static const char* stateName(MissionState state) {
+    switch (state) {
+        case MissionState::BOOT:            return "BOOT";
+        case MissionState::IDLE:            return "IDLE";
+        case MissionState::ASCENT:          return "ASCENT";
+        case MissionState::DESCENT_FREE:    return "DESCENT_FREE";
+        case MissionState::DESCENT_STABLE:  return "DESCENT_STABLE";
+        case MissionState::LANDING:         return "LANDING";
+        case MissionState::FINAL_REPORT:    return "FINAL_REPORT";
+        case MissionState::SAFE_MODE:       return "SAFE_MODE";
+        default:                            return "?";
+    }
+}
+
+static void sweep(const char* name, const std::vector<SimTransition>& reference, bool powerCycle, bool verbose) {
+    printf("\n%s every %u ms\n", name, SIM_RESET_STEP_MS);
+    uint32_t end_ms = reference.back().flight_ms;
+    uint32_t runs = 0, wrongBoot = 0, incomplete = 0, early = 0, late = 0, warmRuns = 0, lifting = 0, landed = 0;
+    uint32_t landings = 0, unfired = 0;
+    uint32_t maxLate_ms = 0;
+    double maxWarm_ms = 0.0, maxCold_ms = 0.0;
+    //First reset halfway through BOOT, before the IDLE checkpoint exists
+    for (uint32_t t = reference[0].flight_ms / 2; t < end_ms; t += SIM_RESET_STEP_MS) {
+        ResetRun r = fly(reference, t, powerCycle);
+        runs++;
+        if (r.warm != resumable(r.before) || (r.warm && !r.sameState)) {
+            wrongBoot++;
+        }
+        if (r.warm) {
+            warmRuns++;
+            maxWarm_ms = r.resume_ms > maxWarm_ms ? r.resume_ms : maxWarm_ms;
+        } else {
+            maxCold_ms = r.resume_ms > maxCold_ms ? r.resume_ms : maxCold_ms;
+        }
+        if (r.landing) {
+            landings++;
+            unfired += r.fired ? 0 : 1;
+        }
+        if (r.lifting) {
+            lifting++;
+            landed += r.end == MissionState::FINAL_REPORT ? 1 : 0;
+        }
+        incomplete += r.complete ? 0 : 1;
+        early += r.early ? 1 : 0;
+        late += r.late ? 1 : 0;
+        maxLate_ms = r.late_ms > maxLate_ms ? r.late_ms : maxLate_ms;
+        if (verbose) {
+            printf("  %6u ms  %-15s %s  resume %6.1f ms  late %5u ms  ends in %s%s%s%s%s\n", t,
+                   stateName(r.before), r.warm ? "warm" : "cold", r.resume_ms, r.late_ms, stateName(r.end),
+                   r.lifting ? "  (lifting)" : "", r.early ? "  EARLY" : "", r.late ? "  LATE" : "",
+                   r.fired ? "  fired" : "");
+        }
+    }
+
+    char what[80];
+    snprintf(what, sizeof(what), "%u resets, %u warm, boot kind and state right (%u wrong)", runs, warmRuns,
+             wrongBoot);
+    check(wrongBoot == 0, what);
+    snprintf(what, sizeof(what), "warm resume within %u ms (max %.1f, cold boot %.1f)", SIM_RESUME_MAX_MS,
+             maxWarm_ms, maxCold_ms);
+    check(warmRuns > 0 && maxWarm_ms <= SIM_RESUME_MAX_MS, what);
+    snprintf(what, sizeof(what), "every flight ends in the reference sequence (%u not)", incomplete);
+    check(incomplete == 0, what);
+    snprintf(what, sizeof(what), "no transition early (%u runs)", early);
+    check(early == 0, what);
+    snprintf(what, sizeof(what), "late by %u ms at most (%u runs over the bound)", maxLate_ms, late);
+    check(late == 0, what);
+    snprintf(what, sizeof(what), "%u IDLE resets while lifting, all end in FINAL_REPORT (%u)", lifting, landed);
+    check(lifting > 0 && landed == lifting, what);
+    snprintf(what, sizeof(what), "release fired in every run through LANDING (%u of %u not)", unfired, landings);
+    check(landings > 0 && unfired == 0, what);
+}
+
+//Switched off in state, on again after off_ms
+static void powerOn(const char* name, MissionState offIn, uint32_t off_ms, bool rtcLost) {
+    printf("\npower-on after %u s off in %s%s\n", off_ms / 1000, name, rtcLost ? ", RTC time lost" : "");
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] { return sim.state() == offIn || finished(sim); });
+    check(sim.state() == offIn, "reached the state");
+    uint32_t fired = sim.countActuations(ActuatorCommand::FIRE);
+    if (rtcLost) {
+        sim.rtc.setPowerLost(true);
+    }
+    sim.powerCycle(off_ms);
+    bool resume = off_ms <= CHECKPOINT_EEPROM_MAX_AGE_S * 1000UL && !rtcLost;
+    char what[80];
+    snprintf(what, sizeof(what), "boots %s", resume ? "warm into the same state" : "cold");
+    check(resume ? sim.isWarm() && sim.state() == offIn : !sim.isWarm(), what);
+
+    uint32_t on_ms = sim.flightMs();
+    sim.runUntil(on_ms + SIM_AFTER_ON_MS, [&] { return finished(sim); });
+    if (resume) {
+        check(sim.state() == MissionState::FINAL_REPORT, "flight ends in FINAL_REPORT");
+    } else {
+        snprintf(what, sizeof(what), "waits in IDLE on the ground (%s)", stateName(sim.state()));
+        check(sim.onGround() ? sim.state() == MissionState::IDLE : sim.state() != MissionState::LANDING, what);
+        check(sim.countActuations(ActuatorCommand::FIRE) == fired, "no release after the power-on");
+    }
+}
+
+//SAFE_MODE between the pre-arm and LANDING
+static void safeModeAbort() {
+    printf("\nSAFE_MODE after the pre-arm\n");
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] { return sim.countActuations(ActuatorCommand::ARM) > 0 || finished(sim); });
+    check(sim.state() == MissionState::DESCENT_STABLE && sim.countActuations(ActuatorCommand::ARM) == 1,
+          "servo pre-armed in DESCENT_STABLE");
+    sim.fsm().enterSafeMode();
+    sim.runUntil(SIM_FLIGHT_END_MS);
+    check(sim.state() == MissionState::SAFE_MODE, "stays in SAFE_MODE to touchdown");
+    check(sim.countActuations(ActuatorCommand::FIRE) == 0, "no FIRE");
+    check(sim.countActuations(ActuatorCommand::SAFE) == 1, "servo back to SAFE");
+}
+
+//Pre-arm ahead of LANDING, FIRE edge within one servo frame of the transition
+static void referenceRelease(const FlightSim& sim, const std::vector<SimTransition>& reference) {
+    uint32_t landing_ms = 0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        if (reference[i].state == MissionState::LANDING) {
+            landing_ms = reference[i].flight_ms;
+        }
+    }
+    bool armedAhead = false;
+    bool fired = false;
+    uint32_t fire_ms = 0;
+    const std::vector<SimActuation>& log = sim.actuations();
+    for (size_t i = 0; i < log.size(); i++) {
+        if (log[i].outcome != ActuatorOutcome::DONE) {
+            continue;
+        }
+        if (log[i].command == ActuatorCommand::ARM && log[i].flight_ms < landing_ms) {
+            armedAhead = true;
+        }
+        if (log[i].command == ActuatorCommand::FIRE && !fired) {
+            fired = true;
+            fire_ms = log[i].flight_ms;
+        }
+    }
+    check(armedAhead, "reference: release servo armed ahead of LANDING");
+    char what[80];
+    snprintf(what, sizeof(what), "reference: FIRE edge %d ms after LANDING (frame %u ms)",
+             fired ? (int)(fire_ms - landing_ms) : -1, ACTUATOR_FRAME_US / 1000);
+    check(fired && fire_ms >= landing_ms && fire_ms - landing_ms <= ACTUATOR_FRAME_US / 1000, what);
+}
+
+int main(int argc, char** argv) {
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+#ifdef FIXED_POINT_PIPELINE
+    printf("reset replay, fixed-point build\n");
+#else
+    printf("reset replay, float build\n");
+#endif
+    SimPrint::setEnabled(false);
+
+    FlightSim sim;
+    sim.boot();
+    sim.runUntil(SIM_FLIGHT_END_MS, [&] { return finished(sim); });
+    std::vector<SimTransition> reference = collapse(sim.transitions());
+    printf("\nreference flight:");
+    for (size_t i = 0; i < reference.size(); i++) {
+        printf(" %s %u", stateName(reference[i].state), reference[i].flight_ms);
+    }
+    printf("\n");
+    check(sim.state() == MissionState::FINAL_REPORT, "reference flight ends in FINAL_REPORT");
+    referenceRelease(sim, reference);
+
+    sweep("watchdog reset", reference, false, verbose);
+    sweep("power cycle", reference, true, verbose);
+    powerOn("DESCENT_STABLE", MissionState::DESCENT_STABLE, SIM_OUTAGE_MS, false);
+    powerOn("DESCENT_STABLE", MissionState::DESCENT_STABLE, SIM_RECOVERY_MS, false);
+    powerOn("LANDING", MissionState::LANDING, SIM_RECOVERY_MS, false);
+    powerOn("DESCENT_STABLE", MissionState::DESCENT_STABLE, SIM_OUTAGE_MS, true);
+    safeModeAbort();
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+//Host benchmark and robustness check of the UBX parser on NEO-6M NAV streams.
+//
+//  g++ -O2 -std=c++11 -I"../lolin esp8266/sensors" -o ubx_bench ubx_bench.cpp "../lolin esp8266/sensors/ubx.cpp"
+//  ./ubx_bench [capture.ubx]
+//
+//The stream is what GPS_Driver::beginUBX() configures: NAV-POSLLH, NAV-VELNED
+//and NAV-SOL every 200 ms, plus a NAV-STATUS the parser has to skip. Every
+//value is a function of iTOW, so any frame the parser accepts can be checked.
+//1. Clean stream: every NAV frame decoded, the solution matches.
+//2. Corrupted length: one header claims 0xFF1C bytes. Only that frame may be
+//   lost (before UBX_MAX_FRAME_PAYLOAD it swallowed the next 65 kB,
+//   17 s of a saturated 38400 baud line, 80 s of this stream).
+//3. Random bit flips (1 per SIM_FLIP_BYTES): no corrupted frame is ever
+//   accepted, and the frames lost per flip are counted.
+//4. Throughput, host ns per byte, and the same for a capture file if given
+//   (a raw receiver dump, checksum errors are reported, not checked).
+//The ns figures are host ones, the LX106 runs the same loop per byte.
+
+#include "ubx.h"
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_EPOCHS           3000       //10 minutes at 5 Hz
+#define SIM_EPOCH_MS         200
+#define SIM_BAUD_BYTES_S     3840       //38400 baud, 10 bits per byte
+#define SIM_CORRUPT_EPOCH    100
+#define SIM_FLIP_BYTES       1000
+#define SIM_BENCH_PASSES     50
+#define UBX_NAV_STATUS       0x03
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+//Deterministic solution for a time of week, a slow drift around 47.5 N 19 E
+static UBX_NavPosllh posllhAt(uint32_t iTOW) {
+    UBX_NavPosllh p;
+    memset(&p, 0, sizeof(p));
+    p.iTOW = iTOW;
+    p.lat = 475000000 + (int32_t)(iTOW / 10);
+    p.lon = 190000000 - (int32_t)(iTOW / 20);
+    p.height = 530000 + (int32_t)(iTOW % 997);
+    p.hMSL = 488000 + (int32_t)(iTOW % 997);
+    p.hAcc = 2500;
+    p.vAcc = 4000;
+    return p;
+}
+
+static UBX_NavVelned velnedAt(uint32_t iTOW) {
+    UBX_NavVelned v;
+    memset(&v, 0, sizeof(v));
+    v.iTOW = iTOW;
+    v.velN = (int32_t)(iTOW % 300) - 150;
+    v.velE = 120;
+    v.velD = 500;
+    v.speed = 530;
+    v.gSpeed = 190;
+    v.heading = 4500000;
+    v.sAcc = 40;
+    v.cAcc = 100000;
+    return v;
+}
+
+static UBX_NavSol solAt(uint32_t iTOW) {
+    UBX_NavSol s;
+    memset(&s, 0, sizeof(s));
+    s.iTOW = iTOW;
+    s.week = 2440;
+    s.gpsFix = 3;
+    s.flags = 0x0D;
+    s.pAcc = 300;
+    s.pDOP = 150;
+    s.numSV = (uint8_t)(7 + iTOW % 5);
+    return s;
+}
+
+static void appendFrame(std::vector<uint8_t>& stream, uint8_t msgClass, uint8_t msgId, const void* payload,
+                        uint16_t len) {
+    uint8_t frame[UBX_MAX_PAYLOAD + 8];
+    uint16_t n = UBX_Parser::buildFrame(msgClass, msgId, (const uint8_t*)payload, len, frame, sizeof(frame));
+    stream.insert(stream.end(), frame, frame + n);
+}
+
+//One epoch: POSLLH, VELNED, SOL and a NAV-STATUS to skip; returns the POSLLH header offset
+static size_t appendEpoch(std::vector<uint8_t>& stream, uint32_t iTOW) {
+    size_t posllh = stream.size();
+    UBX_NavPosllh p = posllhAt(iTOW);
+    UBX_NavVelned v = velnedAt(iTOW);
+    UBX_NavSol s = solAt(iTOW);
+    uint8_t status[16] = { 0 };
+    memcpy(status, &iTOW, sizeof(iTOW));
+    status[4] = 3;
+    appendFrame(stream, UBX_CLASS_NAV, UBX_NAV_POSLLH, &p, sizeof(p));
+    appendFrame(stream, UBX_CLASS_NAV, UBX_NAV_VELNED, &v, sizeof(v));
+    appendFrame(stream, UBX_CLASS_NAV, UBX_NAV_SOL, &s, sizeof(s));
+    appendFrame(stream, UBX_CLASS_NAV, UBX_NAV_STATUS, status, sizeof(status));
+    return posllh;
+}
+
+//Feed the stream, count accepted NAV frames and the ones that do not match their iTOW
+struct ParseResult {
+    uint32_t accepted;
+    uint32_t wrong;
+};
+
+static ParseResult feed(UBX_Parser& parser, const std::vector<uint8_t>& stream) {
+    ParseResult r = { 0, 0 };
+    const UBX_Solution& solution = parser.getSolution();
+    uint32_t posllhSeen = solution.posllhCount;
+    for (size_t i = 0; i < stream.size(); i++) {
+        if (!parser.parse(stream[i])) {
+            continue;
+        }
+        r.accepted++;
+        //Which message completed: POSLLH bumps its counter, otherwise compare all three
+        bool ok;
+        if (solution.posllhCount != posllhSeen) {
+            posllhSeen = solution.posllhCount;
+            UBX_NavPosllh p = posllhAt(solution.posllh.iTOW);
+            ok = memcmp(&p, &solution.posllh, sizeof(p)) == 0;
+        } else {
+            UBX_NavVelned v = velnedAt(solution.velned.iTOW);
+            UBX_NavSol s = solAt(solution.sol.iTOW);
+            ok = (!solution.haveVelned || memcmp(&v, &solution.velned, sizeof(v)) == 0) &&
+                 (!solution.haveSol || memcmp(&s, &solution.sol, sizeof(s)) == 0);
+        }
+        if (!ok) {
+            r.wrong++;
+        }
+    }
+    return r;
+}
+
+static double nsPerByte(const std::vector<uint8_t>& stream) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    volatile uint32_t sink = 0;
+    for (uint32_t pass = 0; pass < SIM_BENCH_PASSES; pass++) {
+        UBX_Parser parser;
+        for (size_t i = 0; i < stream.size(); i++) {
+            sink += parser.parse(stream[i]);
+        }
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return s * 1e9 / ((double)stream.size() * SIM_BENCH_PASSES);
+}
+
+int main(int argc, char** argv) {
+    printf("UBX parser bench, %u epochs at %u ms\n", SIM_EPOCHS, SIM_EPOCH_MS);
+
+    std::vector<uint8_t> clean;
+    std::vector<size_t> posllhOffsets;
+    for (uint32_t e = 0; e < SIM_EPOCHS; e++) {
+        posllhOffsets.push_back(appendEpoch(clean, 345600000 + e * SIM_EPOCH_MS));
+    }
+    const uint32_t navFrames = 3 * SIM_EPOCHS;
+
+    printf("\nclean stream, %zu bytes (%.0f B/s of %u)\n", clean.size(),
+           clean.size() * 1000.0 / (SIM_EPOCHS * SIM_EPOCH_MS), SIM_BAUD_BYTES_S);
+    {
+        UBX_Parser parser;
+        ParseResult r = feed(parser, clean);
+        char what[80];
+        snprintf(what, sizeof(what), "every NAV frame decoded (%u / %u)", r.accepted, navFrames);
+        check(r.accepted == navFrames && parser.getMessagesOk() >= navFrames, what);
+        check(r.wrong == 0, "decoded values match the generator");
+        check(parser.getChecksumErrors() == 0 && parser.getLengthErrors() == 0, "no checksum or length errors");
+        const UBX_Solution& s = parser.getSolution();
+        check(s.havePosllh && s.haveVelned && s.haveSol && s.posllhCount == SIM_EPOCHS, "solution has all three");
+    }
+
+    printf("\ncorrupted length at epoch %u\n", SIM_CORRUPT_EPOCH);
+    {
+        std::vector<uint8_t> stream = clean;
+        stream[posllhOffsets[SIM_CORRUPT_EPOCH] + 5] = 0xFF;    //length high byte: 28 -> 65308
+        UBX_Parser parser;
+        ParseResult r = feed(parser, stream);
+        char what[80];
+        snprintf(what, sizeof(what), "one frame lost (%u)", navFrames - r.accepted);
+        check(r.accepted == navFrames - 1 && r.wrong == 0, what);
+        snprintf(what, sizeof(what), "counted as a length error (%u)", parser.getLengthErrors());
+        check(parser.getLengthErrors() == 1, what);
+        printf("  unbounded, it would have skipped 65308 bytes: %.1f s at 38400 baud, %.0f s of this stream\n",
+               0xFF1C / (double)SIM_BAUD_BYTES_S, 0xFF1C * (SIM_EPOCHS * SIM_EPOCH_MS / 1000.0) / clean.size());
+    }
+
+    printf("\nrandom bit flips, 1 per %u bytes\n", SIM_FLIP_BYTES);
+    {
+        std::vector<uint8_t> stream = clean;
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<size_t> offset(0, SIM_FLIP_BYTES - 1);
+        std::uniform_int_distribution<int> bit(0, 7);
+        uint32_t flips = 0;
+        for (size_t base = 0; base + SIM_FLIP_BYTES <= stream.size(); base += SIM_FLIP_BYTES) {
+            stream[base + offset(rng)] ^= (uint8_t)(1 << bit(rng));
+            flips++;
+        }
+        UBX_Parser parser;
+        ParseResult r = feed(parser, stream);
+        uint32_t lost = navFrames - r.accepted;
+        char what[80];
+        snprintf(what, sizeof(what), "no corrupted frame accepted (%u accepted)", r.accepted);
+        check(r.wrong == 0, what);
+        snprintf(what, sizeof(what), "%u flips cost %u frames (%.2f each)", flips, lost, (double)lost / flips);
+        check(lost >= flips / 2 && (double)lost / flips < 2.0, what);
+        printf("  checksum errors %u, length errors %u\n", parser.getChecksumErrors(), parser.getLengthErrors());
+    }
+
+    printf("\nthroughput (host)\n");
+    double ns = nsPerByte(clean);
+    printf("  %.2f ns per byte, %.2f us per 5 Hz epoch, %.4f%% of a core at %u B/s\n", ns,
+           ns * clean.size() / SIM_EPOCHS / 1000.0, ns * SIM_BAUD_BYTES_S / 1e7, SIM_BAUD_BYTES_S);
+
+    if (argc > 1) {
+        FILE* f = fopen(argv[1], "rb");
+        if (!f) {
+            perror(argv[1]);
+            return 1;
+        }
+        std::vector<uint8_t> capture;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            capture.insert(capture.end(), buffer, buffer + n);
+        }
+        fclose(f);
+        UBX_Parser parser;
+        uint16_t nav = 0;
+        uint32_t total = 0;
+        for (size_t i = 0; i < capture.size(); i += 65535) {
+            size_t len = capture.size() - i < 65535 ? capture.size() - i : 65535;
+            nav = parser.parse(capture.data() + i, len);
+            total += nav;
+        }
+        printf("\ncapture %s, %zu bytes\n", argv[1], capture.size());
+        printf("  %u NAV frames, %u messages ok, %u checksum errors, %u length errors, %u ACK, %u NAK\n", total,
+               parser.getMessagesOk(), parser.getChecksumErrors(), parser.getLengthErrors(), parser.getAcks(),
+               parser.getNaks());
+        printf("  %.2f ns per byte (host)\n", nsPerByte(capture));
+    }
+
+    printf("\n%s (%d failed)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
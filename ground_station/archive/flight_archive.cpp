@@ -0,0 +1,267 @@
+//Build and query the columnar flight archive.
+//
+//  g++ -O2 -std=c++11 -o flight_archive flight_archive.cpp
+//  ./flight_archive append campaign.fca capture1.bin [capture2.bin ...]   (one flight per capture)
+//  ./flight_archive info campaign.fca
+//  ./flight_archive query campaign.fca [--from ms] [--to ms] [--state id[,id...]]
+//                   [--flight n] [--columns name[,name...]] [--csv out.csv]
+//
+//Without --csv the query only prints how many blocks/rows it touched.
+
+#include "flight_archive.h"
+
+#include <stdlib.h>
+#include <string>
+
+
+static bool decodeCapture(const char* path, TelemetryColumns& columns) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    TelemetryDecoder decoder;
+    decoder.decode((const uint8_t*)map, (size_t)st.st_size, columns);
+    munmap(map, (size_t)st.st_size);
+
+    const TelemetryDecodeStats& stats = decoder.getStats();
+    printf("%s: %llu frames, %llu crc errors, %llu sequence gaps\n", path,
+           (unsigned long long)stats.frames, (unsigned long long)stats.crcErrors,
+           (unsigned long long)stats.sequenceGaps);
+    return true;
+}
+
+static int cmdAppend(const char* archive, int count, char** captures) {
+    FlightArchiveWriter writer;
+    if (!writer.open(archive)) {
+        return 1;
+    }
+    TelemetryColumns columns;
+    for (int i = 0; i < count; i++) {
+        columns.clear();
+        if (!decodeCapture(captures[i], columns)) {
+            return 1;
+        }
+        uint32_t flight = writer.beginFlight();
+        if (!writer.append(columns)) {
+            fprintf(stderr, "%s: write failed\n", archive);
+            return 1;
+        }
+        printf("  -> flight %u, %zu rows\n", flight, columns.size());
+    }
+    if (!writer.close()) {
+        fprintf(stderr, "%s: write failed\n", archive);
+        return 1;
+    }
+    printf("%llu blocks written\n", (unsigned long long)writer.getBlocksWritten());
+    return 0;
+}
+
+static int cmdInfo(const char* archive) {
+    FlightArchiveReader reader;
+    if (!reader.open(archive)) {
+        return 1;
+    }
+    printf("blocks: %zu\nrows:   %llu\n", reader.getBlockCount(),
+           (unsigned long long)reader.getRowCount());
+    if (reader.getSkippedBlockCount() > 0) {
+        printf("skipped: %zu blocks with a chunk outside the body\n", reader.getSkippedBlockCount());
+    }
+
+    //Stored size and encoding mix per column
+    printf("%-18s %12s %8s  raw/const/delta/xor\n", "column", "bytes", "ratio");
+    for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++) {
+        uint64_t bytes = 0;
+        uint64_t used[4] = { 0, 0, 0, 0 };
+        for (size_t b = 0; b < reader.getBlockCount(); b++) {
+            const ArchiveChunkInfo& info = reader.getChunk(b, (ArchiveColumnId)c);
+            bytes += info.size;
+            if (info.encoding < 4) {
+                used[info.encoding]++;
+            }
+        }
+        size_t width = c == ARCHIVE_COL_sequence ? sizeof(uint16_t) : 0;
+#define ARCHIVE_COLUMN_WIDTH(T, name) \
+        if (c == ARCHIVE_COL_##name) { width = sizeof(TelemetryColumnType<T>::type); }
+        SENSOR_DATA_FIELDS(ARCHIVE_COLUMN_WIDTH)
+#undef ARCHIVE_COLUMN_WIDTH
+        double plain = (double)reader.getRowCount() * width;
+        printf("%-18s %12llu %7.1f%%  %llu/%llu/%llu/%llu\n", ARCHIVE_COLUMN_NAMES[c],
+               (unsigned long long)bytes, plain > 0 ? 100.0 * bytes / plain : 0.0,
+               (unsigned long long)used[0], (unsigned long long)used[1],
+               (unsigned long long)used[2], (unsigned long long)used[3]);
+    }
+    return 0;
+}
+
+static inline void printValue(FILE* f, double v)   { fprintf(f, "%.7f", v); }
+static inline void printValue(FILE* f, float v)    { fprintf(f, "%.3f", v); }
+static inline void printValue(FILE* f, uint32_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int32_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint16_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int16_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint8_t v)  { fprintf(f, "%u", v); }
+
+static bool writeCsv(const char* path, const TelemetryColumns& columns, uint64_t mask, size_t rows) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    const char* sep = "";
+    for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++) {
+        if (mask & archiveColumnBit((ArchiveColumnId)c)) {
+            fprintf(f, "%s%s", sep, ARCHIVE_COLUMN_NAMES[c]);
+            sep = ",";
+        }
+    }
+    fprintf(f, "\n");
+
+    for (size_t row = 0; row < rows; row++) {
+        sep = "";
+        if (mask & archiveColumnBit(ARCHIVE_COL_sequence)) {
+            printValue(f, columns.sequence[row]);
+            sep = ",";
+        }
+#define CSV_VALUE(type, name)                                  \
+        if (mask & archiveColumnBit(ARCHIVE_COL_##name)) {     \
+            fputs(sep, f);                                     \
+            printValue(f, columns.name[row]);                  \
+            sep = ",";                                         \
+        }
+        SENSOR_DATA_FIELDS(CSV_VALUE)
+#undef CSV_VALUE
+        fputc('\n', f);
+    }
+    fclose(f);
+    return true;
+}
+
+//Comma-separated column names into a mask, 0 on an unknown name
+static uint64_t parseColumns(const char* list) {
+    uint64_t mask = 0;
+    std::string s = list;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) {
+            end = s.size();
+        }
+        std::string name = s.substr(start, end - start);
+        int id = archiveColumnByName(name.c_str());
+        if (id < 0) {
+            fprintf(stderr, "unknown column: %s\n", name.c_str());
+            return 0;
+        }
+        mask |= archiveColumnBit((ArchiveColumnId)id);
+        start = end + 1;
+    }
+    return mask;
+}
+
+static uint32_t parseStates(const char* list) {
+    uint32_t mask = 0;
+    const char* p = list;
+    while (*p) {
+        char* end;
+        unsigned long id = strtoul(p, &end, 10);
+        if (end != p && id < 32) {
+            mask |= 1u << id;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return mask;
+}
+
+static int cmdQuery(const char* archive, int argc, char** argv) {
+    ArchiveQuery q;
+    const char* csvPath = nullptr;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--from" && hasValue) {
+            q.fromMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--to" && hasValue) {
+            q.toMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--state" && hasValue) {
+            q.stateMask = parseStates(argv[++i]);
+        } else if (arg == "--flight" && hasValue) {
+            q.flight = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--columns" && hasValue) {
+            q.columns = parseColumns(argv[++i]);
+            if (q.columns == 0) {
+                return 1;
+            }
+        } else if (arg == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        } else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FlightArchiveReader reader;
+    if (!reader.open(archive)) {
+        return 1;
+    }
+    TelemetryColumns columns;
+    ArchiveQueryStats stats;
+    size_t rows = reader.query(q, columns, &stats);
+
+    printf("blocks read:   %llu / %llu\n", (unsigned long long)stats.blocksRead,
+           (unsigned long long)stats.blocksTotal);
+    printf("rows scanned:  %llu\n", (unsigned long long)stats.rowsScanned);
+    printf("rows returned: %llu\n", (unsigned long long)stats.rowsReturned);
+    printf("bytes decoded: %llu\n", (unsigned long long)stats.bytesTouched);
+
+    if (csvPath && !writeCsv(csvPath, columns, q.columns, rows)) {
+        return 1;
+    }
+    return 0;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s append archive.fca capture.bin [...]\n"
+            "       %s info archive.fca\n"
+            "       %s query archive.fca [--from ms] [--to ms] [--state id,...] [--flight n]\n"
+            "                [--columns name,...] [--csv out.csv]\n",
+            argv0, argv0, argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string cmd = argv[1];
+    if (cmd == "append" && argc >= 4) {
+        return cmdAppend(argv[2], argc - 3, argv + 3);
+    }
+    if (cmd == "info") {
+        return cmdInfo(argv[2]);
+    }
+    if (cmd == "query") {
+        return cmdQuery(argv[2], argc - 3, argv + 3);
+    }
+    usage(argv[0]);
+    return 1;
+}
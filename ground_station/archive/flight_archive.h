@@ -0,0 +1,813 @@
+#ifndef FLIGHT_ARCHIVE_H
+#define FLIGHT_ARCHIVE_H
+
+//Append-only columnar archive of decoded telemetry, one file for a whole campaign.
+//
+//  [FileHeader][Block][Block]...
+//  Block = [BlockHeader][ChunkInfo x ARCHIVE_COLUMN_COUNT][chunk data, 8-byte aligned]
+//
+//Columns are sequence + every SENSOR_DATA_FIELDS entry (bool stored as uint8), so the
+//schema follows the flight code like the decoder does. Every chunk carries a min/max
+//zone map; queries on time, mission state and flight skip whole blocks from the
+//headers alone and only decode the columns they ask for. The reader maps the file,
+//RAW chunks are returned as pointers into the mapping.
+//
+//Chunk encodings (the writer keeps the smallest):
+//  RAW       little-endian array
+//  CONSTANT  one value, every row equal (flags, state id, zeros)
+//  DELTA     integers: zigzag varint of the difference to the previous row
+//  XOR       float/double: varint of the bits XOR the previous row's bits,
+//            slowly changing values share sign/exponent/high mantissa bits
+//
+//A block torn by a crash while appending is dropped on the next open.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../decoder/telemetry_decoder.h"
+
+#define ARCHIVE_MAGIC            "CSATARC1"
+#define ARCHIVE_FORMAT_VERSION   1
+#define ARCHIVE_BLOCK_MAGIC      0x4B4C4246u   //"FBLK"
+#define ARCHIVE_BLOCK_ROWS       4096
+
+
+//Column ids in file order
+enum ArchiveColumnId {
+    ARCHIVE_COL_sequence,
+#define ARCHIVE_COLUMN_ID(type, name) ARCHIVE_COL_##name,
+    SENSOR_DATA_FIELDS(ARCHIVE_COLUMN_ID)
+#undef ARCHIVE_COLUMN_ID
+    ARCHIVE_COLUMN_COUNT
+};
+
+static_assert(ARCHIVE_COLUMN_COUNT <= 64, "column masks are 64 bit");
+
+static inline uint64_t archiveColumnBit(ArchiveColumnId id) {
+    return 1ULL << id;
+}
+
+#define ARCHIVE_ALL_COLUMNS (~0ULL >> (64 - ARCHIVE_COLUMN_COUNT))
+
+static const char* const ARCHIVE_COLUMN_NAMES[ARCHIVE_COLUMN_COUNT] = {
+    "sequence",
+#define ARCHIVE_COLUMN_NAME(type, name) #name,
+    SENSOR_DATA_FIELDS(ARCHIVE_COLUMN_NAME)
+#undef ARCHIVE_COLUMN_NAME
+};
+
+//-1 if unknown
+static inline int archiveColumnByName(const char* name) {
+    for (int i = 0; i < ARCHIVE_COLUMN_COUNT; i++) {
+        if (strcmp(ARCHIVE_COLUMN_NAMES[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+enum ArchiveEncoding : uint8_t {
+    ARCHIVE_RAW,
+    ARCHIVE_CONSTANT,
+    ARCHIVE_DELTA,
+    ARCHIVE_XOR
+};
+
+#pragma pack(push, 1)
+
+struct ArchiveFileHeader {
+    char magic[8];
+    uint16_t formatVersion;
+    uint16_t telemetryVersion;
+    uint16_t columnCount;
+    uint16_t schemaCrc;          //CRC of "name:size," for every column, catches layout changes
+    uint8_t reserved[16];
+};
+
+struct ArchiveBlockHeader {
+    uint32_t magic;
+    uint32_t rows;
+    uint32_t flight;             //writer increments it per beginFlight()
+    uint32_t bodySize;           //bytes after the chunk table
+};
+
+//Zone map + location of one column in a block
+struct ArchiveChunkInfo {
+    uint32_t offset;             //from the start of the block body
+    uint32_t size;
+    uint8_t encoding;
+    uint8_t reserved[7];
+    double min;                  //NaN ignored; min > max if every value was NaN
+    double max;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(ArchiveFileHeader) % 8 == 0, "keeps blocks aligned");
+static_assert(sizeof(ArchiveBlockHeader) % 8 == 0, "keeps chunks aligned");
+static_assert(sizeof(ArchiveChunkInfo) % 8 == 0, "keeps chunks aligned");
+
+
+static inline uint16_t archiveSchemaCrc() {
+    uint16_t crc = 0xFFFF;
+    char entry[64];
+    int n = snprintf(entry, sizeof(entry), "sequence:%u,", (unsigned)sizeof(uint16_t));
+    crc = telemetryCrc16((const uint8_t*)entry, (size_t)n, crc);
+#define ARCHIVE_SCHEMA_ENTRY(T, name)                                                         \
+    n = snprintf(entry, sizeof(entry), #name ":%u,", (unsigned)sizeof(TelemetryColumnType<T>::type)); \
+    crc = telemetryCrc16((const uint8_t*)entry, (size_t)n, crc);
+    SENSOR_DATA_FIELDS(ARCHIVE_SCHEMA_ENTRY)
+#undef ARCHIVE_SCHEMA_ENTRY
+    return crc;
+}
+
+
+//Bit patterns and encoding choice per element type
+template <typename T> struct ArchiveTraits {
+    typedef T Bits;
+    static const bool isFloat = false;
+};
+template <> struct ArchiveTraits<float> {
+    typedef uint32_t Bits;
+    static const bool isFloat = true;
+};
+template <> struct ArchiveTraits<double> {
+    typedef uint64_t Bits;
+    static const bool isFloat = true;
+};
+
+static inline void archivePutVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+//false on a truncated / overlong varint
+static inline bool archiveGetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+static inline typename ArchiveTraits<T>::Bits archiveToBits(T value) {
+    typename ArchiveTraits<T>::Bits bits;
+    memcpy(&bits, &value, sizeof(T));
+    return bits;
+}
+
+template <typename T>
+static inline T archiveFromBits(typename ArchiveTraits<T>::Bits bits) {
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+}
+
+//DELTA for integers, XOR for floating point
+template <typename T>
+static void archiveEncodeVarint(const T* values, size_t n, std::vector<uint8_t>& out) {
+    typedef typename ArchiveTraits<T>::Bits Bits;
+    Bits prev = 0;
+    for (size_t i = 0; i < n; i++) {
+        Bits bits = archiveToBits(values[i]);
+        if (ArchiveTraits<T>::isFloat) {
+            archivePutVarint(out, (uint64_t)(bits ^ prev));
+        } else {
+            int64_t delta = (int64_t)bits - (int64_t)prev;
+            archivePutVarint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        }
+        prev = bits;
+    }
+}
+
+template <typename T>
+static bool archiveDecodeVarint(const uint8_t* p, const uint8_t* end, size_t n, T* out) {
+    typedef typename ArchiveTraits<T>::Bits Bits;
+    Bits prev = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v;
+        if (!archiveGetVarint(p, end, v)) {
+            return false;
+        }
+        Bits bits;
+        if (ArchiveTraits<T>::isFloat) {
+            bits = (Bits)(prev ^ v);
+        } else {
+            int64_t delta = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            bits = (Bits)((int64_t)prev + delta);
+        }
+        out[i] = archiveFromBits<T>(bits);
+        prev = bits;
+    }
+    return true;
+}
+
+
+/**
+ Appends blocks to an archive file
+ Rows are buffered until ARCHIVE_BLOCK_ROWS (or flush / beginFlight / close),
+ so a block never spans two flights.
+ */
+class FlightArchiveWriter {
+public:
+    FlightArchiveWriter() : file(nullptr), flight(0), blockRows(ARCHIVE_BLOCK_ROWS), blocks(0) {
+    }
+
+    ~FlightArchiveWriter() {
+        close();
+    }
+
+    /**
+     Create the file or append to an existing archive with the same schema
+     A torn trailing block is truncated away, flight numbering continues
+     */
+    bool open(const char* path, uint32_t rowsPerBlock = ARCHIVE_BLOCK_ROWS) {
+        close();
+        blockRows = rowsPerBlock ? rowsPerBlock : ARCHIVE_BLOCK_ROWS;
+
+        int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            perror(path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            perror(path);
+            ::close(fd);
+            return false;
+        }
+
+        ArchiveFileHeader header;
+        makeHeader(header);
+        off_t end = 0;
+        if (st.st_size == 0) {
+            if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+                perror(path);
+                ::close(fd);
+                return false;
+            }
+            end = sizeof(header);
+            flight = 0;
+        } else if (!scanExisting(fd, (off_t)st.st_size, header, end)) {
+            fprintf(stderr, "%s: not an archive with this telemetry schema\n", path);
+            ::close(fd);
+            return false;
+        }
+        if (end < st.st_size && ftruncate(fd, end) != 0) {
+            perror(path);
+            ::close(fd);
+            return false;
+        }
+
+        file = fdopen(fd, "ab");
+        if (!file) {
+            perror(path);
+            ::close(fd);
+            return false;
+        }
+        pending.clear();
+        return true;
+    }
+
+    //Following rows belong to a new flight (one capture file, one power cycle)
+    uint32_t beginFlight() {
+        flush();
+        return ++flight;
+    }
+
+    uint32_t getFlight() const {
+        return flight;
+    }
+
+    //Append decoded rows (every column of rows must have the same length)
+    bool append(const TelemetryColumns& rows) {
+        for (size_t start = 0; start < rows.size();) {
+            size_t take = rows.size() - start;
+            if (take > blockRows - pending.size()) {
+                take = blockRows - pending.size();
+            }
+            appendRange(pending.sequence, rows.sequence, start, take);
+#define ARCHIVE_APPEND_RANGE(type, name) appendRange(pending.name, rows.name, start, take);
+            SENSOR_DATA_FIELDS(ARCHIVE_APPEND_RANGE)
+#undef ARCHIVE_APPEND_RANGE
+            start += take;
+            if (pending.size() >= blockRows && !flush()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //Write buffered rows as a (possibly short) block
+    bool flush() {
+        if (!file || pending.size() == 0) {
+            return true;
+        }
+        bool ok = writeBlock();
+        pending.clear();
+        return ok;
+    }
+
+    bool close() {
+        if (!file) {
+            return true;
+        }
+        bool ok = flush();
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+    uint64_t getBlocksWritten() const {
+        return blocks;
+    }
+
+private:
+    FILE* file;
+    uint32_t flight;
+    uint32_t blockRows;
+    uint64_t blocks;
+    TelemetryColumns pending;
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> scratch;
+
+    static void makeHeader(ArchiveFileHeader& header) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+        header.formatVersion = ARCHIVE_FORMAT_VERSION;
+        header.telemetryVersion = TELEMETRY_VERSION;
+        header.columnCount = ARCHIVE_COLUMN_COUNT;
+        header.schemaCrc = archiveSchemaCrc();
+    }
+
+    //Walk the block headers: last complete block end and highest flight number
+    bool scanExisting(int fd, off_t size, const ArchiveFileHeader& expected, off_t& end) {
+        ArchiveFileHeader header;
+        if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            memcmp(&header, &expected, sizeof(header)) != 0) {
+            return false;
+        }
+        end = sizeof(header);
+        flight = 0;
+        const off_t tableSize = sizeof(ArchiveChunkInfo) * ARCHIVE_COLUMN_COUNT;
+        ArchiveBlockHeader block;
+        while (end + (off_t)sizeof(block) <= size &&
+               pread(fd, &block, sizeof(block), end) == (ssize_t)sizeof(block) &&
+               block.magic == ARCHIVE_BLOCK_MAGIC) {
+            off_t next = end + (off_t)sizeof(block) + tableSize + block.bodySize;
+            if (next > size) {
+                break;
+            }
+            if (block.flight > flight) {
+                flight = block.flight;
+            }
+            end = next;
+        }
+        return true;
+    }
+
+    template <typename T>
+    static void appendRange(std::vector<T>& to, const std::vector<T>& from, size_t start, size_t n) {
+        to.insert(to.end(), from.begin() + start, from.begin() + start + n);
+    }
+
+    template <typename T>
+    void encodeChunk(const std::vector<T>& values, ArchiveChunkInfo& info) {
+        size_t n = values.size();
+        while (body.size() % 8) {
+            body.push_back(0);
+        }
+        memset(&info, 0, sizeof(info));
+        info.offset = (uint32_t)body.size();
+
+        //Zone map, NaN does not widen it
+        double lo = INFINITY;
+        double hi = -INFINITY;
+        bool constant = true;
+        for (size_t i = 0; i < n; i++) {
+            double v = (double)values[i];
+            if (v < lo) {
+                lo = v;
+            }
+            if (v > hi) {
+                hi = v;
+            }
+            constant = constant && memcmp(&values[i], &values[0], sizeof(T)) == 0;
+        }
+        info.min = lo;
+        info.max = hi;
+
+        const uint8_t* raw = (const uint8_t*)values.data();
+        if (constant) {
+            info.encoding = ARCHIVE_CONSTANT;
+            body.insert(body.end(), raw, raw + sizeof(T));
+        } else {
+            scratch.clear();
+            archiveEncodeVarint(values.data(), n, scratch);
+            if (scratch.size() < n * sizeof(T)) {
+                info.encoding = ArchiveTraits<T>::isFloat ? ARCHIVE_XOR : ARCHIVE_DELTA;
+                body.insert(body.end(), scratch.begin(), scratch.end());
+            } else {
+                info.encoding = ARCHIVE_RAW;
+                body.insert(body.end(), raw, raw + n * sizeof(T));
+            }
+        }
+        info.size = (uint32_t)(body.size() - info.offset);
+    }
+
+    bool writeBlock() {
+        ArchiveChunkInfo table[ARCHIVE_COLUMN_COUNT];
+        body.clear();
+        encodeChunk(pending.sequence, table[ARCHIVE_COL_sequence]);
+#define ARCHIVE_ENCODE_CHUNK(type, name) encodeChunk(pending.name, table[ARCHIVE_COL_##name]);
+        SENSOR_DATA_FIELDS(ARCHIVE_ENCODE_CHUNK)
+#undef ARCHIVE_ENCODE_CHUNK
+        while (body.size() % 8) {
+            body.push_back(0);
+        }
+
+        ArchiveBlockHeader header;
+        header.magic = ARCHIVE_BLOCK_MAGIC;
+        header.rows = (uint32_t)pending.size();
+        header.flight = flight;
+        header.bodySize = (uint32_t)body.size();
+
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(table, sizeof(table), 1, file) == 1 &&
+                  fwrite(body.data(), 1, body.size(), file) == body.size();
+        blocks++;
+        return ok;
+    }
+};
+
+
+//Block selection: every condition must hold, zero / empty means "any"
+struct ArchiveQuery {
+    uint32_t fromMs;             //timestamp_ms range, inclusive
+    uint32_t toMs;
+    uint32_t stateMask;          //bit per mission_state_id, 0 = any state
+    uint32_t flight;             //0 = every flight
+    uint64_t columns;            //archiveColumnBit() mask of columns to return
+
+    ArchiveQuery() : fromMs(0), toMs(UINT32_MAX), stateMask(0), flight(0), columns(ARCHIVE_ALL_COLUMNS) {
+    }
+};
+
+struct ArchiveQueryStats {
+    uint64_t blocksTotal;
+    uint64_t blocksRead;         //passed the zone maps
+    uint64_t rowsScanned;        //rows of the blocks read
+    uint64_t rowsReturned;
+    uint64_t bytesTouched;       //chunk bytes decoded
+};
+
+
+/**
+ Read side: the file is mapped once, open() indexes the block headers,
+ query() decodes only the chunks of blocks whose zone maps can match
+ */
+class FlightArchiveReader {
+public:
+    FlightArchiveReader() : map(nullptr), mapSize(0), rows(0), skippedBlocks(0) {
+    }
+
+    ~FlightArchiveReader() {
+        close();
+    }
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            perror(path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArchiveFileHeader)) {
+            fprintf(stderr, "%s: not an archive\n", path);
+            ::close(fd);
+            return false;
+        }
+        void* m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (m == MAP_FAILED) {
+            perror(path);
+            return false;
+        }
+        map = (const uint8_t*)m;
+        mapSize = (size_t)st.st_size;
+
+        ArchiveFileHeader expected;
+        memset(&expected, 0, sizeof(expected));
+        memcpy(expected.magic, ARCHIVE_MAGIC, sizeof(expected.magic));
+        expected.formatVersion = ARCHIVE_FORMAT_VERSION;
+        expected.telemetryVersion = TELEMETRY_VERSION;
+        expected.columnCount = ARCHIVE_COLUMN_COUNT;
+        expected.schemaCrc = archiveSchemaCrc();
+        if (memcmp(map, &expected, sizeof(expected)) != 0) {
+            fprintf(stderr, "%s: not an archive with this telemetry schema\n", path);
+            close();
+            return false;
+        }
+        indexBlocks();
+        return true;
+    }
+
+    void close() {
+        if (map) {
+            munmap((void*)map, mapSize);
+        }
+        map = nullptr;
+        mapSize = 0;
+        blocks.clear();
+        rows = 0;
+        skippedBlocks = 0;
+    }
+
+    size_t getBlockCount() const {
+        return blocks.size();
+    }
+
+    uint64_t getRowCount() const {
+        return rows;
+    }
+
+    //Framed blocks left out of the index because a chunk points outside the body
+    size_t getSkippedBlockCount() const {
+        return skippedBlocks;
+    }
+
+    const ArchiveBlockHeader& getBlockHeader(size_t block) const {
+        return *(const ArchiveBlockHeader*)(map + blocks[block]);
+    }
+
+    const ArchiveChunkInfo& getChunk(size_t block, ArchiveColumnId column) const {
+        return chunkTable(block)[column];
+    }
+
+    /**
+     Zero-copy access: pointer into the mapping if the chunk is stored RAW,
+     nullptr otherwise (use readColumn)
+     */
+    template <typename T>
+    const T* rawColumn(size_t block, ArchiveColumnId column) const {
+        const ArchiveChunkInfo& info = getChunk(block, column);
+        if (info.encoding != ARCHIVE_RAW || info.size != getBlockHeader(block).rows * sizeof(T)) {
+            return nullptr;
+        }
+        return (const T*)(blockBody(block) + info.offset);
+    }
+
+    //Decode one chunk into out (resized to the block's row count)
+    template <typename T>
+    bool readColumn(size_t block, ArchiveColumnId column, std::vector<T>& out) const {
+        out.resize(getBlockHeader(block).rows);
+        return readColumn(block, column, out.data());
+    }
+
+    //Same into a caller buffer of at least the block's row count
+    template <typename T>
+    bool readColumn(size_t block, ArchiveColumnId column, T* out) const {
+        const ArchiveChunkInfo& info = getChunk(block, column);
+        size_t n = getBlockHeader(block).rows;
+        const uint8_t* data = blockBody(block) + info.offset;
+        switch (info.encoding) {
+            case ARCHIVE_RAW:
+                if (info.size != n * sizeof(T)) {
+                    return false;
+                }
+                memcpy(out, data, n * sizeof(T));
+                return true;
+            case ARCHIVE_CONSTANT: {
+                if (info.size != sizeof(T)) {
+                    return false;
+                }
+                T value;
+                memcpy(&value, data, sizeof(T));
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = value;
+                }
+                return true;
+            }
+            case ARCHIVE_DELTA:
+            case ARCHIVE_XOR:
+                return archiveDecodeVarint(data, data + info.size, n, out);
+        }
+        return false;
+    }
+
+    //Zone maps only: can any row of this block satisfy the query?
+    bool blockMayMatch(size_t block, const ArchiveQuery& q) const {
+        if (q.flight != 0 && getBlockHeader(block).flight != q.flight) {
+            return false;
+        }
+        const ArchiveChunkInfo& t = getChunk(block, ARCHIVE_COL_timestamp_ms);
+        if (t.max < (double)q.fromMs || t.min > (double)q.toMs) {
+            return false;
+        }
+        if (q.stateMask != 0) {
+            const ArchiveChunkInfo& s = getChunk(block, ARCHIVE_COL_mission_state_id);
+            uint32_t lo = s.min < 0.0 ? 0 : (uint32_t)s.min;
+            uint32_t hi = s.max > 31.0 ? 31 : (uint32_t)s.max;
+            uint32_t span = hi >= lo ? (uint32_t)(((2ULL << hi) - 1) & ~((1ULL << lo) - 1)) : 0;
+            if ((q.stateMask & span) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     Append matching rows to out. Only columns in q.columns are filled, the
+     others keep their size (so out.size() follows the sequence column only
+     if it is requested). return number of rows appended
+     */
+    size_t query(const ArchiveQuery& q, TelemetryColumns& out, ArchiveQueryStats* stats = nullptr) {
+        ArchiveQueryStats local;
+        memset(&local, 0, sizeof(local));
+        local.blocksTotal = blocks.size();
+
+        size_t appended = 0;
+        for (size_t b = 0; b < blocks.size(); b++) {
+            if (!blockMayMatch(b, q)) {
+                continue;
+            }
+            local.blocksRead++;
+            local.rowsScanned += getBlockHeader(b).rows;
+            if (!selectRows(b, q, local)) {
+                continue;
+            }
+            if (selected.empty()) {
+                continue;
+            }
+
+            appendSelected(b, ARCHIVE_COL_sequence, q.columns, out.sequence, local);
+#define ARCHIVE_QUERY_COLUMN(type, name) appendSelected(b, ARCHIVE_COL_##name, q.columns, out.name, local);
+            SENSOR_DATA_FIELDS(ARCHIVE_QUERY_COLUMN)
+#undef ARCHIVE_QUERY_COLUMN
+            appended += selected.size();
+        }
+        local.rowsReturned = appended;
+        if (stats) {
+            *stats = local;
+        }
+        return appended;
+    }
+
+private:
+    const uint8_t* map;
+    size_t mapSize;
+    std::vector<size_t> blocks;  //file offsets of the block headers
+    uint64_t rows;
+    size_t skippedBlocks;
+
+    //Per-query scratch
+    std::vector<uint32_t> timestamps;
+    std::vector<uint8_t> states;
+    std::vector<uint32_t> selected;
+    std::vector<uint64_t> decoded;   //any column type, 8-byte aligned
+
+    const ArchiveChunkInfo* chunkTable(size_t block) const {
+        return (const ArchiveChunkInfo*)(map + blocks[block] + sizeof(ArchiveBlockHeader));
+    }
+
+    const uint8_t* blockBody(size_t block) const {
+        return (const uint8_t*)(chunkTable(block) + ARCHIVE_COLUMN_COUNT);
+    }
+
+    /**
+     Every chunk inside the block body with a known encoding, checked once here
+     so rawColumn / readColumn can trust offset and size. Offsets are 8-aligned
+     by the writer, which the zero-copy pointer of rawColumn relies on
+     */
+    static bool chunksInBody(const ArchiveBlockHeader& header, const ArchiveChunkInfo* table) {
+        for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++) {
+            const ArchiveChunkInfo& info = table[c];
+            if (info.offset > header.bodySize || info.size > header.bodySize - info.offset ||
+                info.offset % 8 != 0 || info.encoding > ARCHIVE_XOR) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void indexBlocks() {
+        const size_t tableSize = sizeof(ArchiveChunkInfo) * ARCHIVE_COLUMN_COUNT;
+        size_t offset = sizeof(ArchiveFileHeader);
+        while (offset + sizeof(ArchiveBlockHeader) + tableSize <= mapSize) {
+            const ArchiveBlockHeader* header = (const ArchiveBlockHeader*)(map + offset);
+            if (header->magic != ARCHIVE_BLOCK_MAGIC) {
+                break;
+            }
+            size_t next = offset + sizeof(ArchiveBlockHeader) + tableSize + header->bodySize;
+            if (next > mapSize) {
+                break;  //torn block
+            }
+            if (chunksInBody(*header, (const ArchiveChunkInfo*)(header + 1))) {
+                blocks.push_back(offset);
+                rows += header->rows;
+            } else {
+                skippedBlocks++;  //framing still holds, the next block is readable
+            }
+            offset = next;
+        }
+        madvise((void*)map, mapSize, MADV_RANDOM);
+    }
+
+    //Row filter of one block into selected, decodes the time / state chunks only if needed
+    bool selectRows(size_t b, const ArchiveQuery& q, ArchiveQueryStats& stats) {
+        size_t n = getBlockHeader(b).rows;
+        const ArchiveChunkInfo& t = getChunk(b, ARCHIVE_COL_timestamp_ms);
+        const ArchiveChunkInfo& s = getChunk(b, ARCHIVE_COL_mission_state_id);
+        bool timeAll = t.min >= (double)q.fromMs && t.max <= (double)q.toMs;
+        bool stateAll = q.stateMask == 0 ||
+                        (s.min == s.max && s.min >= 0.0 && s.min < 32.0 && (q.stateMask >> (uint32_t)s.min) & 1);
+
+        selected.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            selected[i] = (uint32_t)i;
+        }
+        if (timeAll && stateAll) {
+            return true;
+        }
+
+        if (!timeAll) {
+            if (!readColumn(b, ARCHIVE_COL_timestamp_ms, timestamps)) {
+                return false;
+            }
+            stats.bytesTouched += t.size;
+        }
+        if (!stateAll) {
+            if (!readColumn(b, ARCHIVE_COL_mission_state_id, states)) {
+                return false;
+            }
+            stats.bytesTouched += s.size;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < n; i++) {
+            bool ok = (timeAll || (timestamps[i] >= q.fromMs && timestamps[i] <= q.toMs)) &&
+                      (stateAll || (states[i] < 32 && ((q.stateMask >> states[i]) & 1)));
+            if (ok) {
+                selected[kept++] = (uint32_t)i;
+            }
+        }
+        selected.resize(kept);
+        return true;
+    }
+
+    template <typename T>
+    void appendSelected(size_t b, ArchiveColumnId column, uint64_t mask, std::vector<T>& out,
+                        ArchiveQueryStats& stats) {
+        if (!(mask & archiveColumnBit(column))) {
+            return;
+        }
+        const ArchiveChunkInfo& info = getChunk(b, column);
+        stats.bytesTouched += info.size;
+        size_t n = getBlockHeader(b).rows;
+        size_t base = out.size();
+
+        //Whole RAW chunk: straight from the mapping
+        const T* raw = rawColumn<T>(b, column);
+        if (raw && selected.size() == n) {
+            out.insert(out.end(), raw, raw + n);
+            return;
+        }
+
+        out.resize(base + selected.size());
+        if (raw) {
+            for (size_t i = 0; i < selected.size(); i++) {
+                out[base + i] = raw[selected[i]];
+            }
+            return;
+        }
+        decoded.resize((n * sizeof(T) + 7) / 8);
+        const T* values = (const T*)decoded.data();
+        if (!readColumn(b, column, (T*)decoded.data())) {
+            //Corrupt chunk: keep the row count consistent with the other columns
+            memset(&out[base], 0, selected.size() * sizeof(T));
+            return;
+        }
+        for (size_t i = 0; i < selected.size(); i++) {
+            out[base + i] = values[selected[i]];
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,309 @@
+//Archive vs CSV on a synthetic campaign.
+//
+//  g++ -O2 -std=c++11 -o flight_archive_bench flight_archive_bench.cpp
+//  ./flight_archive_bench [rows] [work_dir]
+//
+//Writes the same rows as CSV (telemetry_decode --csv format) and as an archive,
+//then times three analysis queries on both:
+//  full     max altitude_AGL over everything
+//  window   max altitude_AGL for timestamp_ms in one minute of every flight
+//  state    mean accel_z_g over DESCENT_STABLE rows
+//The CSV side is a hand-rolled mmap scanner that only converts the fields it needs,
+//the best case for CSV. 20M rows (default) is ~4 GB of CSV. Page cache is warm
+//for both, run with drop_caches in between for the cold numbers.
+
+#include "flight_archive.h"
+
+#ifdef FIXED_POINT_PIPELINE
+#error "the synthetic flight uses the float field layout, build without FIXED_POINT_PIPELINE"
+#endif
+
+#include <chrono>
+#include <stdlib.h>
+#include <string>
+
+static const uint32_t FLIGHT_ROWS = 36000;     //30 min at 20 Hz
+static const uint32_t ROW_PERIOD_MS = 50;
+static const uint32_t WINDOW_FROM_MS = 600000;
+static const uint32_t WINDOW_TO_MS = 660000;
+static const uint8_t STATE_DESCENT_STABLE = 4;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static float noise(uint32_t& state, float amplitude) {
+    return amplitude * ((float)(nextRandom(state) & 0xFFFF) / 32768.0f - 1.0f);
+}
+
+//One flight profile: pad, climb to 100 m, free fall, canopy, landing, report
+static void synthesize(size_t firstRow, size_t rows, uint32_t& rng, TelemetryColumns& out) {
+    out.clear();
+    for (size_t r = firstRow; r < firstRow + rows; r++) {
+        uint32_t i = (uint32_t)(r % FLIGHT_ROWS);
+        uint32_t t = i * ROW_PERIOD_MS;
+        float s = t / 1000.0f;
+        uint8_t state;
+        float alt;
+        if (s < 300) {
+            state = 1;
+            alt = 0.0f;
+        } else if (s < 500) {
+            state = 2;
+            alt = (s - 300) * 0.5f;
+        } else if (s < 501) {
+            state = 3;
+            alt = 100.0f - 20.0f * (s - 500);
+        } else if (s < 515) {
+            state = 4;
+            alt = 80.0f - 5.0f * (s - 501);
+        } else if (s < 517) {
+            state = 5;
+            alt = 10.0f - 5.0f * (s - 515);
+        } else {
+            state = 6;
+            alt = 0.0f;
+        }
+        alt += noise(rng, 0.3f);
+
+        out.sequence.push_back((uint16_t)r);
+        out.timestamp_ms.push_back(t);
+        out.gps_time.push_back(120000 + (uint32_t)s);
+        out.timestamp_us.push_back(t * 1000u + 120);
+        out.bmp_time_us.push_back(t * 1000u - 14000);
+        out.imu_time_us.push_back(t * 1000u - 3000);
+        out.gps_fix_time_us.push_back((t - t % 200) * 1000u);
+        out.pressure_hPa.push_back(1013.25f - alt * 0.12f);
+        out.temperature_C.push_back(21.5f + noise(rng, 0.05f));
+        out.altitude_MSL.push_back(2240.0f + alt);
+        out.altitude_AGL.push_back(alt);
+        out.bmp_valid.push_back(1);
+        out.pitch_deg.push_back(noise(rng, 5.0f));
+        out.roll_deg.push_back(noise(rng, 5.0f));
+        out.accel_x_g.push_back(noise(rng, 0.05f));
+        out.accel_y_g.push_back(noise(rng, 0.05f));
+        out.accel_z_g.push_back((state == 3 ? 0.0f : 1.0f) + noise(rng, 0.05f));
+        out.imu_valid.push_back(1);
+        out.swing_freq_hz.push_back(state == 4 ? 0.8f : 0.0f);
+        out.swing_rms_dps.push_back(state == 4 ? 12.0f + noise(rng, 2.0f) : 0.0f);
+        out.vib_freq_hz.push_back(state == 4 ? 35.0f : 0.0f);
+        out.vib_low_mg.push_back(state == 4 ? 20 : 0);
+        out.vib_mid_mg.push_back(state == 4 ? 8 : 0);
+        out.vib_high_mg.push_back(state == 4 ? 30 : 0);
+        out.latitude.push_back(19.4326 + i * 1e-7);
+        out.longitude.push_back(-99.1332 + i * 1e-7);
+        out.gps_altitude_m.push_back(2240.0f + alt + noise(rng, 2.0f));
+        out.gps_speed_mps.push_back(state == 2 ? 0.5f : 0.0f);
+        out.satellites.push_back(9);
+        out.gps_fix.push_back(1);
+        out.wind_east_mps.push_back(state == 4 ? 3.0f + noise(rng, 0.3f) : 0.0f);
+        out.wind_north_mps.push_back(state == 4 ? 1.0f + noise(rng, 0.3f) : 0.0f);
+        out.landing_lat.push_back(state == 4 ? 19.4327 : 0.0);
+        out.landing_lon.push_back(state == 4 ? -99.1331 : 0.0);
+        out.landing_eta_ds.push_back(state == 4 ? (uint16_t)((515.0f - s) * 10.0f) : 0);
+        out.landing_valid.push_back(state == 4);
+        out.battery_voltage.push_back(4.1f - s * 0.0002f);
+        out.mission_state_id.push_back(state);
+        out.error_flags.push_back(0);
+    }
+}
+
+static inline void printValue(FILE* f, double v)   { fprintf(f, "%.7f", v); }
+static inline void printValue(FILE* f, float v)    { fprintf(f, "%.3f", v); }
+static inline void printValue(FILE* f, uint32_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int32_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint16_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int16_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint8_t v)  { fprintf(f, "%u", v); }
+
+static void appendCsv(FILE* f, const TelemetryColumns& columns) {
+    for (size_t row = 0; row < columns.size(); row++) {
+        printValue(f, columns.sequence[row]);
+#define CSV_VALUE(type, name) fputc(',', f); printValue(f, columns.name[row]);
+        SENSOR_DATA_FIELDS(CSV_VALUE)
+#undef CSV_VALUE
+        fputc('\n', f);
+    }
+}
+
+struct QueryResult {
+    double maxAltitude;
+    double windowMaxAltitude;
+    double stableAccelSum;
+    uint64_t stableRows;
+};
+
+//Field index of a column in the CSV (column order = archive column order)
+static const int CSV_TIME = ARCHIVE_COL_timestamp_ms;
+static const int CSV_ALT = ARCHIVE_COL_altitude_AGL;
+static const int CSV_ACCEL_Z = ARCHIVE_COL_accel_z_g;
+static const int CSV_STATE = ARCHIVE_COL_mission_state_id;
+
+//Parse only the fields a query needs, skip the rest of each line
+static double scanCsv(const char* path, int query, QueryResult& result) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    const char* map = (const char*)mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    madvise((void*)map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    const char* end = map + st.st_size;
+
+    auto start = std::chrono::steady_clock::now();
+    const char* p = (const char*)memchr(map, '\n', (size_t)st.st_size) + 1;   //header
+    while (p < end) {
+        uint32_t t = 0;
+        double alt = 0.0;
+        double accel = 0.0;
+        unsigned state = 0;
+        int field = 0;
+        while (p < end && *p != '\n') {
+            if (field == CSV_TIME) {
+                t = (uint32_t)strtoul(p, (char**)&p, 10);
+            } else if (field == CSV_ALT) {
+                alt = strtod(p, (char**)&p);
+            } else if (field == CSV_ACCEL_Z && query == 2) {
+                accel = strtod(p, (char**)&p);
+            } else if (field == CSV_STATE) {
+                state = (unsigned)strtoul(p, (char**)&p, 10);
+            }
+            while (p < end && *p != ',' && *p != '\n') {
+                p++;
+            }
+            if (p < end && *p == ',') {
+                p++;
+                field++;
+            }
+        }
+        p++;
+
+        if (query == 0) {
+            if (alt > result.maxAltitude) {
+                result.maxAltitude = alt;
+            }
+        } else if (query == 1) {
+            if (t >= WINDOW_FROM_MS && t <= WINDOW_TO_MS && alt > result.windowMaxAltitude) {
+                result.windowMaxAltitude = alt;
+            }
+        } else if (state == STATE_DESCENT_STABLE) {
+            result.stableAccelSum += accel;
+            result.stableRows++;
+        }
+    }
+    double seconds = secondsSince(start);
+    munmap((void*)map, (size_t)st.st_size);
+    return seconds;
+}
+
+static double queryArchive(const char* path, int query, QueryResult& result, ArchiveQueryStats& stats) {
+    auto start = std::chrono::steady_clock::now();
+    FlightArchiveReader reader;
+    reader.open(path);
+    TelemetryColumns columns;
+    ArchiveQuery q;
+
+    if (query == 0) {
+        q.columns = archiveColumnBit(ARCHIVE_COL_altitude_AGL);
+    } else if (query == 1) {
+        q.fromMs = WINDOW_FROM_MS;
+        q.toMs = WINDOW_TO_MS;
+        q.columns = archiveColumnBit(ARCHIVE_COL_altitude_AGL);
+    } else {
+        q.stateMask = 1u << STATE_DESCENT_STABLE;
+        q.columns = archiveColumnBit(ARCHIVE_COL_accel_z_g);
+    }
+    reader.query(q, columns, &stats);
+    for (size_t i = 0; i < columns.altitude_AGL.size(); i++) {
+        double alt = columns.altitude_AGL[i];
+        double& best = query == 0 ? result.maxAltitude : result.windowMaxAltitude;
+        if (alt > best) {
+            best = alt;
+        }
+    }
+    for (size_t i = 0; i < columns.accel_z_g.size(); i++) {
+        result.stableAccelSum += columns.accel_z_g[i];
+    }
+    result.stableRows += columns.accel_z_g.size();
+    return secondsSince(start);
+}
+
+static uint64_t fileSize(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    std::string csvPath = dir + "/flight_archive_bench.csv";
+    std::string archivePath = dir + "/flight_archive_bench.fca";
+    unlink(archivePath.c_str());
+
+    //Build both files from the same rows, one flight per FLIGHT_ROWS
+    FILE* csv = fopen(csvPath.c_str(), "w");
+    FlightArchiveWriter writer;
+    if (!csv || !writer.open(archivePath.c_str())) {
+        perror(dir.c_str());
+        return 1;
+    }
+    fprintf(csv, "sequence");
+#define CSV_HEADER(type, name) fprintf(csv, "," #name);
+    SENSOR_DATA_FIELDS(CSV_HEADER)
+#undef CSV_HEADER
+    fprintf(csv, "\n");
+
+    TelemetryColumns chunk;
+    uint32_t rng = 1;
+    double csvWrite = 0.0;
+    double archiveWrite = 0.0;
+    for (size_t row = 0; row < rows;) {
+        size_t n = FLIGHT_ROWS - row % FLIGHT_ROWS;
+        if (n > rows - row) {
+            n = rows - row;
+        }
+        synthesize(row, n, rng, chunk);
+        if (row % FLIGHT_ROWS == 0) {
+            writer.beginFlight();
+        }
+        auto start = std::chrono::steady_clock::now();
+        appendCsv(csv, chunk);
+        csvWrite += secondsSince(start);
+        start = std::chrono::steady_clock::now();
+        writer.append(chunk);
+        archiveWrite += secondsSince(start);
+        row += n;
+    }
+    fclose(csv);
+    writer.close();
+
+    printf("rows: %zu, flights: %zu\n", rows, (rows + FLIGHT_ROWS - 1) / FLIGHT_ROWS);
+    printf("csv:     %8.1f MB, written in %.2f s\n", fileSize(csvPath.c_str()) / 1e6, csvWrite);
+    printf("archive: %8.1f MB, written in %.2f s\n", fileSize(archivePath.c_str()) / 1e6, archiveWrite);
+
+    static const char* const NAMES[] = { "full", "window", "state" };
+    for (int query = 0; query < 3; query++) {
+        QueryResult a;
+        QueryResult b;
+        memset(&a, 0, sizeof(a));
+        memset(&b, 0, sizeof(b));
+        ArchiveQueryStats stats;
+        double csvSeconds = scanCsv(csvPath.c_str(), query, a);
+        double archiveSeconds = queryArchive(archivePath.c_str(), query, b, stats);
+        //CSV keeps 3 decimals
+        bool same = fabs(a.maxAltitude - b.maxAltitude) < 1e-3 &&
+                    fabs(a.windowMaxAltitude - b.windowMaxAltitude) < 1e-3 &&
+                    a.stableRows == b.stableRows;
+        printf("%-7s csv %8.3f s   archive %8.3f s  (%6.1fx)  blocks %llu/%llu  %s\n",
+               NAMES[query], csvSeconds, archiveSeconds, csvSeconds / archiveSeconds,
+               (unsigned long long)stats.blocksRead, (unsigned long long)stats.blocksTotal,
+               same ? "results match" : "RESULTS DIFFER");
+    }
+    return 0;
+}
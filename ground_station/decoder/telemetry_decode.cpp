@@ -0,0 +1,161 @@
+//Batch-decode raw telemetry captures into columnar files.
+//
+//  g++ -O2 -std=c++11 -o telemetry_decode telemetry_decode.cpp
+//  ./telemetry_decode [-o out_dir] [--csv out.csv] capture1.bin [capture2.bin ...]
+//
+//out_dir gets one <field>.bin per SensorData field (raw little-endian array,
+//load with numpy.fromfile(path, dtype)), plus sequence.bin.
+
+#include "telemetry_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static bool decodeFile(const char* path, TelemetryDecoder& decoder, TelemetryColumns& columns) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    //Whole file mapped, decoder reads frames in place
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    decoder.reset();
+    decoder.decode((const uint8_t*)map, (size_t)st.st_size, columns);
+
+    munmap(map, (size_t)st.st_size);
+    return true;
+}
+
+template <typename T>
+static bool writeColumn(const std::string& dir, const char* name, const std::vector<T>& column) {
+    std::string path = dir + "/" + name + ".bin";
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+    size_t written = column.empty() ? 0 : fwrite(column.data(), sizeof(T), column.size(), f);
+    fclose(f);
+    return written == column.size();
+}
+
+static bool writeColumns(const std::string& dir, const TelemetryColumns& columns) {
+    mkdir(dir.c_str(), 0755);
+    bool ok = writeColumn(dir, "sequence", columns.sequence);
+#define WRITE_COLUMN(type, name) ok = writeColumn(dir, #name, columns.name) && ok;
+    SENSOR_DATA_FIELDS(WRITE_COLUMN)
+#undef WRITE_COLUMN
+    return ok;
+}
+
+static inline void printValue(FILE* f, double v)   { fprintf(f, "%.7f", v); }
+static inline void printValue(FILE* f, float v)    { fprintf(f, "%.3f", v); }
+static inline void printValue(FILE* f, uint32_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int32_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint16_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int16_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint8_t v)  { fprintf(f, "%u", v); }
+
+static bool writeCsv(const char* path, const TelemetryColumns& columns) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    fprintf(f, "sequence");
+#define CSV_HEADER(type, name) fprintf(f, "," #name);
+    SENSOR_DATA_FIELDS(CSV_HEADER)
+#undef CSV_HEADER
+    fprintf(f, "\n");
+
+    for (size_t row = 0; row < columns.size(); row++) {
+        printValue(f, columns.sequence[row]);
+#define CSV_VALUE(type, name) fputc(',', f); printValue(f, columns.name[row]);
+        SENSOR_DATA_FIELDS(CSV_VALUE)
+#undef CSV_VALUE
+        fputc('\n', f);
+    }
+
+    fclose(f);
+    return true;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [-o out_dir] [--csv out.csv] capture.bin [...]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* outDir = nullptr;
+    const char* csvPath = nullptr;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TelemetryDecoder decoder;
+    TelemetryColumns columns;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!decodeFile(inputs[i], decoder, columns)) {
+            return 1;
+        }
+    }
+
+    const TelemetryDecodeStats& stats = decoder.getStats();
+    printf("bytes:           %llu\n", (unsigned long long)stats.bytes);
+    printf("frames:          %llu\n", (unsigned long long)stats.frames);
+    printf("crc errors:      %llu\n", (unsigned long long)stats.crcErrors);
+    printf("header errors:   %llu\n", (unsigned long long)stats.headerErrors);
+    printf("bytes skipped:   %llu\n", (unsigned long long)stats.bytesSkipped);
+    printf("sequence gaps:   %llu\n", (unsigned long long)stats.sequenceGaps);
+    printf("sequence resets: %llu\n", (unsigned long long)stats.sequenceResets);
+
+    if (outDir && !writeColumns(outDir, columns)) {
+        return 1;
+    }
+    if (csvPath && !writeCsv(csvPath, columns)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+//Decoder throughput on a synthetic capture.
+//
+//  g++ -O2 -std=c++11 -o telemetry_decode_bench telemetry_decode_bench.cpp
+//  ./telemetry_decode_bench [frames] [corrupt_per_million]
+//
+//Builds frames the same way the flight code does, flips bytes in a fraction
+//of them, then times one-shot (mmap-style) and chunked (serial-style) decoding.
+
+#include "telemetry_decoder.h"
+
+#ifdef FIXED_POINT_PIPELINE
+#error "the synthetic flight uses the float field layout, build without FIXED_POINT_PIPELINE"
+#endif
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void buildFrame(uint16_t sequence, uint32_t t, uint8_t* out) {
+    TelemetryHeader header;
+    header.sync[0] = TELEMETRY_SYNC_0;
+    header.sync[1] = TELEMETRY_SYNC_1;
+    header.version = TELEMETRY_VERSION;
+    header.payload_len = TELEMETRY_PAYLOAD_SIZE;
+    header.sequence = sequence;
+
+    TelemetryPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.timestamp_ms = t;
+    payload.pressure_hPa = 1013.25f - t * 0.0001f;
+    payload.temperature_C = 21.5f;
+    payload.altitude_AGL = (float)(t % 100000) * 0.001f;
+    payload.latitude = 19.4326 + t * 1e-9;
+    payload.longitude = -99.1332;
+    payload.bmp_valid = true;
+    payload.mission_state_id = (uint8_t)((t / 60000) % 8);
+
+    memcpy(out, &header, TELEMETRY_HEADER_SIZE);
+    memcpy(out + TELEMETRY_HEADER_SIZE, &payload, TELEMETRY_PAYLOAD_SIZE);
+    size_t crcOffset = TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE;
+    uint16_t crc = telemetryCrc16(out + 2, crcOffset - 2);
+    out[crcOffset] = (uint8_t)(crc & 0xFF);
+    out[crcOffset + 1] = (uint8_t)(crc >> 8);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double seconds, const TelemetryDecoder& decoder) {
+    const TelemetryDecodeStats& s = decoder.getStats();
+    printf("%-10s %8.3f s  %7.2f Mframes/s  %8.1f MB/s  frames=%llu crc=%llu gaps=%llu\n",
+           name, seconds, s.frames / seconds / 1e6, s.bytes / seconds / 1e6,
+           (unsigned long long)s.frames, (unsigned long long)s.crcErrors,
+           (unsigned long long)s.sequenceGaps);
+}
+
+int main(int argc, char** argv) {
+    size_t frames = argc > 1 ? strtoull(argv[1], nullptr, 10) : 5000000;
+    unsigned corruptPpm = argc > 2 ? (unsigned)strtoul(argv[2], nullptr, 10) : 100;
+
+    std::vector<uint8_t> capture(frames * TELEMETRY_FRAME_SIZE);
+    srand(1);
+    for (size_t i = 0; i < frames; i++) {
+        uint8_t* frame = capture.data() + i * TELEMETRY_FRAME_SIZE;
+        buildFrame((uint16_t)i, (uint32_t)(i * 50), frame);
+        if ((unsigned)(rand() % 1000000) < corruptPpm) {
+            frame[TELEMETRY_HEADER_SIZE + rand() % TELEMETRY_PAYLOAD_SIZE] ^= 0x5A;
+        }
+    }
+    {
+        TelemetryDecoder check;
+        const uint8_t* frame = capture.data();
+        size_t crcLen = TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE - 2;
+        if (check.crc16(frame + 2, crcLen) != telemetryCrc16(frame + 2, crcLen)) {
+            fprintf(stderr, "ground CRC does not match flight CRC\n");
+            return 1;
+        }
+    }
+
+    printf("capture: %zu frames, %zu bytes/frame, %.1f MB\n",
+           frames, (size_t)TELEMETRY_FRAME_SIZE, capture.size() / 1e6);
+
+    {
+        TelemetryDecoder decoder;
+        TelemetryColumns columns;
+        auto start = std::chrono::steady_clock::now();
+        decoder.decode(capture.data(), capture.size(), columns);
+        report("one-shot", secondsSince(start), decoder);
+    }
+
+    {
+        TelemetryDecoder decoder;
+        TelemetryColumns columns;
+        const size_t chunk = 4093;  //odd size so frames straddle chunks
+        auto start = std::chrono::steady_clock::now();
+        for (size_t off = 0; off < capture.size(); off += chunk) {
+            size_t n = capture.size() - off < chunk ? capture.size() - off : chunk;
+            decoder.decode(capture.data() + off, n, columns);
+        }
+        report("chunked", secondsSince(start), decoder);
+    }
+    return 0;
+}
@@ -0,0 +1,244 @@
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+//Header-only ground-side decoder for the on-board telemetry frames.
+//Frame layout and field list come straight from the flight code
+//(telemetry_packet.h / sensor_fields.h), so the two can never drift.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "../../embedded/lolin esp8266/telemetry_packet.h"
+
+
+//Column element type for a SensorData field (std::vector<bool> is a bitset, keep bytes)
+template <typename T> struct TelemetryColumnType { typedef T type; };
+template <> struct TelemetryColumnType<bool> { typedef uint8_t type; };
+
+
+//Struct-of-arrays: one vector per SensorData field, plus the frame sequence number
+struct TelemetryColumns {
+    std::vector<uint16_t> sequence;
+#define TELEMETRY_COLUMN_DECLARE(T, name) std::vector<TelemetryColumnType<T>::type> name;
+    SENSOR_DATA_FIELDS(TELEMETRY_COLUMN_DECLARE)
+#undef TELEMETRY_COLUMN_DECLARE
+
+    size_t size() const {
+        return sequence.size();
+    }
+
+    void reserve(size_t rows) {
+        sequence.reserve(rows);
+#define TELEMETRY_COLUMN_RESERVE(type, name) name.reserve(rows);
+        SENSOR_DATA_FIELDS(TELEMETRY_COLUMN_RESERVE)
+#undef TELEMETRY_COLUMN_RESERVE
+    }
+
+    void clear() {
+        sequence.clear();
+#define TELEMETRY_COLUMN_CLEAR(type, name) name.clear();
+        SENSOR_DATA_FIELDS(TELEMETRY_COLUMN_CLEAR)
+#undef TELEMETRY_COLUMN_CLEAR
+    }
+};
+
+
+struct TelemetryDecodeStats {
+    uint64_t bytes;              //bytes fed to the decoder
+    uint64_t frames;             //frames with good CRC
+    uint64_t crcErrors;          //sync + header ok, CRC mismatch
+    uint64_t headerErrors;       //sync ok, wrong version or payload length
+    uint64_t bytesSkipped;       //garbage between frames
+    uint64_t sequenceGaps;       //frames missing according to the sequence counter
+    uint64_t sequenceResets;     //sequence went backwards (reboot, reordering, duplicate)
+};
+
+
+//Frame sink that appends to columns (the default output of TelemetryDecoder::decode)
+struct TelemetryColumnSink {
+    TelemetryColumns& out;
+
+    explicit TelemetryColumnSink(TelemetryColumns& columns) : out(columns) {}
+
+    void onFrame(uint16_t sequence, const uint8_t* frame) {
+        out.sequence.push_back(sequence);
+
+        const uint8_t* payload = frame + TELEMETRY_HEADER_SIZE;
+#define TELEMETRY_COLUMN_APPEND(T, name)                                        \
+        {                                                                       \
+            T value;                                                            \
+            memcpy(&value, payload + offsetof(TelemetryPayload, name), sizeof(T)); \
+            out.name.push_back((TelemetryColumnType<T>::type)value);            \
+        }
+        SENSOR_DATA_FIELDS(TELEMETRY_COLUMN_APPEND)
+#undef TELEMETRY_COLUMN_APPEND
+    }
+};
+
+
+/**
+ Streaming decoder: feed any chunking of the capture, frames that straddle two
+ chunks are completed on the next call. For a whole file in memory (mmap) one
+ call decodes everything without copying.
+ decode() appends columns; decodeFrames() hands every good frame to a sink
+ (sink.onFrame(sequence, frame), frame valid during the call) for consumers
+ that keep rows, such as the ingest daemon.
+ */
+class TelemetryDecoder {
+public:
+    TelemetryDecoder() : haveSequence(false), lastSequence(0) {
+        memset(&stats, 0, sizeof(stats));
+        buildCrcTable();
+    }
+
+    //Decode data and append rows to out, return number of frames appended
+    size_t decode(const uint8_t* data, size_t len, TelemetryColumns& out) {
+        //Grow geometrically: exact reserves on every small chunk would be quadratic
+        size_t needed = out.size() + len / TELEMETRY_FRAME_SIZE + 1;
+        if (needed > out.sequence.capacity()) {
+            out.reserve(needed > 2 * out.sequence.capacity() ? needed : 2 * out.sequence.capacity());
+        }
+        TelemetryColumnSink sink(out);
+        return decodeFrames(data, len, sink);
+    }
+
+    //Decode data into sink, return number of frames delivered
+    template <typename Sink>
+    size_t decodeFrames(const uint8_t* data, size_t len, Sink& out) {
+        uint64_t before = stats.frames;
+        stats.bytes += len;
+
+        size_t resume = 0;
+        if (!pending.empty()) {
+            //Only the start positions inside the carried tail are scanned here,
+            //FRAME-1 extra bytes are enough to complete any frame that starts there
+            size_t carried = pending.size();
+            size_t take = len < TELEMETRY_FRAME_SIZE - 1 ? len : TELEMETRY_FRAME_SIZE - 1;
+            pending.insert(pending.end(), data, data + take);
+
+            size_t stop = scan(pending.data(), pending.size(), carried, out);
+            if (stop < carried) {
+                //Still not enough bytes to decide (tiny chunk), keep waiting
+                pending.erase(pending.begin(), pending.begin() + stop);
+                return (size_t)(stats.frames - before);
+            }
+            resume = stop - carried;
+            pending.clear();
+        }
+
+        size_t stop = resume + scan(data + resume, len - resume, len - resume, out);
+        pending.assign(data + stop, data + len);
+        return (size_t)(stats.frames - before);
+    }
+
+    //Forget carried bytes and sequence history (new capture file)
+    void reset() {
+        pending.clear();
+        haveSequence = false;
+    }
+
+    const TelemetryDecodeStats& getStats() const {
+        return stats;
+    }
+
+    //Same CRC as telemetryCrc16() on board, slice-by-8 tables for ground throughput
+    uint16_t crc16(const uint8_t* data, size_t len) const {
+        uint16_t crc = 0xFFFF;
+        while (len >= 8) {
+            crc = (uint16_t)(crcTable[7][(crc >> 8) ^ data[0]] ^ crcTable[6][(crc & 0xFF) ^ data[1]] ^
+                             crcTable[5][data[2]] ^ crcTable[4][data[3]] ^
+                             crcTable[3][data[4]] ^ crcTable[2][data[5]] ^
+                             crcTable[1][data[6]] ^ crcTable[0][data[7]]);
+            data += 8;
+            len -= 8;
+        }
+        while (len--) {
+            crc = (uint16_t)((crc << 8) ^ crcTable[0][((crc >> 8) ^ *data++) & 0xFF]);
+        }
+        return crc;
+    }
+
+private:
+    std::vector<uint8_t> pending;
+    uint16_t crcTable[8][256];   //[k][x]: byte x followed by k zero bytes
+    bool haveSequence;
+    uint16_t lastSequence;
+    TelemetryDecodeStats stats;
+
+    void buildCrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+            crcTable[0][i] = crc;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint16_t prev = crcTable[k - 1][i];
+                crcTable[k][i] = (uint16_t)((prev << 8) ^ crcTable[0][prev >> 8]);
+            }
+        }
+    }
+
+    /**
+     Try every start position < maxStart that has a full frame inside buf[0, n)
+     return first start position that was not tried
+     */
+    template <typename Sink>
+    size_t scan(const uint8_t* buf, size_t n, size_t maxStart, Sink& out) {
+        size_t i = 0;
+        while (i < maxStart && i + TELEMETRY_FRAME_SIZE <= n) {
+            if (buf[i] != TELEMETRY_SYNC_0 || buf[i + 1] != TELEMETRY_SYNC_1) {
+                //Jump to the next possible sync byte
+                const void* next = memchr(buf + i + 1, TELEMETRY_SYNC_0, maxStart - i - 1);
+                size_t to = next ? (size_t)((const uint8_t*)next - buf) : maxStart;
+                stats.bytesSkipped += to - i;
+                i = to;
+                continue;
+            }
+
+            const uint8_t* frame = buf + i;
+            if (frame[2] != TELEMETRY_VERSION || frame[3] != TELEMETRY_PAYLOAD_SIZE) {
+                stats.headerErrors++;
+                stats.bytesSkipped++;
+                i++;
+                continue;
+            }
+
+            const size_t crcOffset = TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE;
+            uint16_t expected = (uint16_t)(frame[crcOffset] | (frame[crcOffset + 1] << 8));
+            if (crc16(frame + 2, crcOffset - 2) != expected) {
+                stats.crcErrors++;
+                stats.bytesSkipped++;
+                i++;
+                continue;
+            }
+
+            emit(frame, out);
+            i += TELEMETRY_FRAME_SIZE;
+        }
+        return i;
+    }
+
+    template <typename Sink>
+    void emit(const uint8_t* frame, Sink& out) {
+        uint16_t sequence = (uint16_t)(frame[4] | (frame[5] << 8));
+        if (haveSequence) {
+            uint16_t gap = (uint16_t)(sequence - lastSequence - 1);
+            if (gap < 0x8000) {
+                stats.sequenceGaps += gap;
+            } else {
+                stats.sequenceResets++;
+            }
+        }
+        haveSequence = true;
+        lastSequence = sequence;
+        stats.frames++;
+        out.onFrame(sequence, frame);
+    }
+};
+
+#endif
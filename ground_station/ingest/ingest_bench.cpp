@@ -0,0 +1,386 @@
+//Throughput and latency of the ingest path with several concurrent readers.
+//
+//  g++ -O2 -std=c++11 -pthread -o ingest_bench ingest_bench.cpp -lrt
+//  ./ingest_bench [--readers n] [--frames n] [--rate fps] [--slots n] [--slow-us us]
+//
+//Readers are separate processes attached to the ring by name, like the real
+//consumers. Phases:
+//  ring    writer builds and publishes frames as fast as it can (no serial)
+//  pty     a sender thread floods a pseudo-terminal, SerialIngest (the daemon's
+//          loop) decodes the slave side into the ring
+//  paced   same at --rate frames/s: latency without queueing in the pty
+//Latency is end-to-end (sender clock in payload.timestamp_us to reader) and the
+//ring hop alone (receive_ns to reader). --slow-us makes the last reader spend
+//that long per frame: it loses frames, the others must not notice.
+
+#include "serial_ingest.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+
+#define BENCH_MAX_READERS    16
+#define BENCH_PACED_SECONDS  5
+
+struct BenchConfig {
+    uint32_t readers;
+    uint32_t frames;
+    uint32_t rate;
+    uint32_t slots;
+    uint32_t slow_us;
+    char shmName[64];
+};
+
+struct LatencySummary {
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+};
+
+struct ReaderResult {
+    uint32_t reader;
+    uint64_t frames;
+    uint64_t lost;
+    LatencySummary endToEnd;
+    LatencySummary ring;
+};
+
+static inline uint32_t nowMicros() {
+    return (uint32_t)(ringNow_ns() / 1000);
+}
+
+static void buildFrame(uint16_t sequence, uint32_t t_us, uint8_t* out) {
+    TelemetryHeader header;
+    header.sync[0] = TELEMETRY_SYNC_0;
+    header.sync[1] = TELEMETRY_SYNC_1;
+    header.version = TELEMETRY_VERSION;
+    header.payload_len = TELEMETRY_PAYLOAD_SIZE;
+    header.sequence = sequence;
+
+    TelemetryPayload payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.timestamp_ms = t_us / 1000;
+    payload.timestamp_us = t_us;
+
+    memcpy(out, &header, TELEMETRY_HEADER_SIZE);
+    memcpy(out + TELEMETRY_HEADER_SIZE, &payload, TELEMETRY_PAYLOAD_SIZE);
+    size_t crcOffset = TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_SIZE;
+    uint16_t crc = telemetryCrc16(out + 2, crcOffset - 2);
+    out[crcOffset] = (uint8_t)(crc & 0xFF);
+    out[crcOffset + 1] = (uint8_t)(crc >> 8);
+}
+
+static LatencySummary summarize(std::vector<uint32_t>& samples) {
+    LatencySummary s = {0, 0, 0};
+    if (samples.empty()) {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    s.p50_us = samples[samples.size() / 2];
+    s.p99_us = samples[samples.size() * 99 / 100];
+    s.max_us = samples.back();
+    return s;
+}
+
+static bool writeAll(int fd, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+//Child process: attach, signal ready, read until the writer closes, report through resultFd
+static void runReader(const BenchConfig& cfg, uint32_t index, int readyFd, int resultFd) {
+    TelemetryRingReader reader;
+    ReaderResult result;
+    memset(&result, 0, sizeof(result));
+    result.reader = index;
+    bool slow = cfg.slow_us > 0 && index == cfg.readers - 1;
+    bool attached = reader.attach(cfg.shmName);
+    char ready = attached ? 1 : 0;
+    writeAll(readyFd, &ready, 1);
+    if (!attached) {
+        perror("reader attach");
+        _exit(1);
+    }
+
+    std::vector<uint32_t> endToEnd;
+    std::vector<uint32_t> ringHop;
+    endToEnd.reserve(cfg.frames);
+    ringHop.reserve(cfg.frames);
+
+    uint32_t sent_us = 0;
+    uint64_t receive_ns = 0;
+    while (true) {
+        RingRead r = reader.read([&](const TelemetryRingSlot& slot) {
+            sent_us = slot.payload().timestamp_us;
+            receive_ns = slot.receive_ns;
+        });
+        if (r == RingRead::OK) {
+            uint64_t now = ringNow_ns();
+            endToEnd.push_back((uint32_t)(now / 1000) - sent_us);
+            ringHop.push_back((uint32_t)((now - receive_ns) / 1000));
+            if (slow) {
+                while (ringNow_ns() - now < (uint64_t)cfg.slow_us * 1000) {
+                }
+            }
+            continue;
+        }
+        if (r == RingRead::LAPPED) {
+            continue;
+        }
+        if (reader.isClosed()) {
+            break;
+        }
+        reader.wait(100);
+    }
+
+    result.frames = endToEnd.size();
+    result.lost = reader.getLost();
+    result.endToEnd = summarize(endToEnd);
+    result.ring = summarize(ringHop);
+    writeAll(resultFd, &result, sizeof(result));
+    _exit(0);
+}
+
+//Fork the readers against a fresh ring and wait until all of them are attached
+static bool startReaders(const BenchConfig& cfg, std::vector<pid_t>& pids, int& resultFd) {
+    int ready[2];
+    int results[2];
+    if (pipe(ready) != 0 || pipe(results) != 0) {
+        perror("pipe");
+        return false;
+    }
+    fflush(stdout);
+    for (uint32_t i = 0; i < cfg.readers; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return false;
+        }
+        if (pid == 0) {
+            close(ready[0]);
+            close(results[0]);
+            runReader(cfg, i, ready[1], results[1]);
+        }
+        pids.push_back(pid);
+    }
+    close(ready[1]);
+    close(results[1]);
+
+    bool ok = true;
+    for (uint32_t i = 0; i < cfg.readers; i++) {
+        char c = 0;
+        if (read(ready[0], &c, 1) != 1 || c != 1) {
+            ok = false;
+        }
+    }
+    close(ready[0]);
+    resultFd = results[0];
+    return ok;
+}
+
+static void collectReaders(const char* phase, const BenchConfig& cfg, double seconds, uint64_t published,
+                           std::vector<pid_t>& pids, int resultFd) {
+    printf("%-6s %9llu frames %7.3f s %9.0f frames/s\n", phase, (unsigned long long)published, seconds,
+           published / seconds);
+    //Results arrive in the order the readers finish
+    std::vector<ReaderResult> results(cfg.readers);
+    std::vector<bool> received(cfg.readers, false);
+    for (uint32_t i = 0; i < cfg.readers; i++) {
+        ReaderResult r;
+        if (read(resultFd, &r, sizeof(r)) == (ssize_t)sizeof(r) && r.reader < cfg.readers) {
+            results[r.reader] = r;
+            received[r.reader] = true;
+        }
+    }
+    for (uint32_t i = 0; i < cfg.readers; i++) {
+        if (!received[i]) {
+            printf("  reader %2u: no result\n", i);
+            continue;
+        }
+        const ReaderResult& r = results[i];
+        printf("  reader %2u: %9llu read %8llu lost  e2e p50 %6u p99 %6u max %7u us  ring p50 %5u p99 %6u max %7u us%s\n",
+               i, (unsigned long long)r.frames, (unsigned long long)r.lost,
+               r.endToEnd.p50_us, r.endToEnd.p99_us, r.endToEnd.max_us,
+               r.ring.p50_us, r.ring.p99_us, r.ring.max_us,
+               cfg.slow_us > 0 && i == cfg.readers - 1 ? "  (slow)" : "");
+    }
+    close(resultFd);
+    for (size_t i = 0; i < pids.size(); i++) {
+        waitpid(pids[i], nullptr, 0);
+    }
+    pids.clear();
+}
+
+//Writer only: the ceiling the ring itself puts on fan-out
+static void benchRing(const BenchConfig& cfg) {
+    TelemetryRingWriter ring;
+    if (!ring.create(cfg.shmName, cfg.slots)) {
+        perror(cfg.shmName);
+        return;
+    }
+    std::vector<pid_t> pids;
+    int resultFd = -1;
+    if (!startReaders(cfg, pids, resultFd)) {
+        return;
+    }
+
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    uint64_t start = ringNow_ns();
+    for (uint32_t i = 0; i < cfg.frames; i++) {
+        uint64_t now = ringNow_ns();
+        buildFrame((uint16_t)i, (uint32_t)(now / 1000), frame);
+        ring.publish(frame, now);
+        if ((i & 63) == 63) {
+            ring.notify();
+        }
+    }
+    ring.notify();
+    double seconds = (ringNow_ns() - start) / 1e9;
+    uint64_t published = ring.getWriteIndex();
+    ring.close();
+    collectReaders("ring", cfg, seconds, published, pids, resultFd);
+}
+
+//Sender -> pty -> SerialIngest -> ring -> readers; rate 0 = as fast as the pty takes it
+static void benchPty(const char* phase, const BenchConfig& cfg, uint32_t frames, uint32_t rate) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return;
+    }
+    int slave = openSerial(ptsname(master), 115200);
+    if (slave < 0) {
+        close(master);
+        return;
+    }
+
+    TelemetryRingWriter ring;
+    if (!ring.create(cfg.shmName, cfg.slots)) {
+        perror(cfg.shmName);
+        return;
+    }
+    std::vector<pid_t> pids;
+    int resultFd = -1;
+    if (!startReaders(cfg, pids, resultFd)) {
+        return;
+    }
+
+    std::atomic<bool> stop(false);
+    SerialIngest ingest(slave, ring);
+    std::thread ingestThread([&]() {
+        ingest.run(stop);
+    });
+
+    uint64_t start = ringNow_ns();
+    std::thread sender([&]() {
+        uint8_t frame[TELEMETRY_FRAME_SIZE];
+        for (uint32_t i = 0; i < frames; i++) {
+            if (rate > 0) {
+                uint64_t due = start + (uint64_t)i * 1000000000ull / rate;
+                struct timespec ts;
+                ts.tv_sec = (time_t)(due / 1000000000ull);
+                ts.tv_nsec = (long)(due % 1000000000ull);
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+            }
+            buildFrame((uint16_t)i, nowMicros(), frame);
+            if (!writeAll(master, frame, TELEMETRY_FRAME_SIZE)) {
+                perror("pty write");
+                return;
+            }
+        }
+    });
+    sender.join();
+
+    //Let the ingest drain the pty (give up after a second of no progress)
+    uint64_t lastCount = 0;
+    uint64_t lastProgress = ringNow_ns();
+    while (ring.getHeader()->writeIndex.load() < frames && ringNow_ns() - lastProgress < 1000000000ull) {
+        uint64_t count = ring.getHeader()->writeIndex.load();
+        if (count != lastCount) {
+            lastCount = count;
+            lastProgress = ringNow_ns();
+        }
+        struct timespec tick = {0, 1000000L};
+        nanosleep(&tick, nullptr);
+    }
+    double seconds = (ringNow_ns() - start) / 1e9;
+    stop.store(true);
+    ingestThread.join();
+
+    uint64_t published = ring.getHeader()->writeIndex.load();
+    const TelemetryDecodeStats& s = ingest.getStats();
+    ring.close();
+    collectReaders(phase, cfg, seconds, published, pids, resultFd);
+    if (s.crcErrors > 0 || s.bytesSkipped > 0) {
+        printf("  decoder: %llu crc errors, %llu bytes skipped\n", (unsigned long long)s.crcErrors,
+               (unsigned long long)s.bytesSkipped);
+    }
+    close(slave);
+    close(master);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--readers n] [--frames n] [--rate fps] [--slots n] [--slow-us us]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    cfg.readers = 4;
+    cfg.frames = 1000000;
+    cfg.rate = 2000;
+    cfg.slots = TELEMETRY_RING_DEFAULT_SLOTS;
+    cfg.slow_us = 0;
+    snprintf(cfg.shmName, sizeof(cfg.shmName), "/cubesat_ingest_bench_%d", (int)getpid());
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--readers" && i + 1 < argc) {
+            cfg.readers = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            cfg.frames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            cfg.rate = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--slots" && i + 1 < argc) {
+            cfg.slots = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--slow-us" && i + 1 < argc) {
+            cfg.slow_us = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (cfg.readers == 0 || cfg.readers > BENCH_MAX_READERS) {
+        fprintf(stderr, "--readers must be 1..%d\n", BENCH_MAX_READERS);
+        return 1;
+    }
+
+    printf("%u readers, %u slots of %u bytes, frame %u bytes, telemetry v%u\n", cfg.readers, cfg.slots,
+           (unsigned)sizeof(TelemetryRingSlot), (unsigned)TELEMETRY_FRAME_SIZE, (unsigned)TELEMETRY_VERSION);
+    benchRing(cfg);
+    benchPty("pty", cfg, cfg.frames, 0);
+    if (cfg.rate > 0) {
+        uint32_t paced = cfg.rate * BENCH_PACED_SECONDS;
+        benchPty("paced", cfg, paced < cfg.frames ? paced : cfg.frames, cfg.rate);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+//Ground-station ingest daemon: decode the serial link once, fan frames out to
+//every local consumer through a shared-memory ring.
+//
+//  g++ -O2 -std=c++11 -pthread -o ingest_daemon ingest_daemon.cpp -lrt
+//  ./ingest_daemon [--baud 115200] [--shm /cubesat_telemetry] [--slots 4096] [--stats s] /dev/ttyUSB0
+//
+//Consumers (dashboard, recorder, ML scripts) attach with TelemetryRingReader
+//(see ring_tail.cpp) or map /dev/shm/<name> directly, layout in telemetry_ring.h.
+//With 4096 slots at 10 frames/s a reader can stall for ~7 minutes without losing data.
+
+#include "serial_ingest.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) {
+    stopRequested.store(true);
+}
+
+//From the counters the read loop publishes in the ring header (safe from any thread)
+static void printStats(const TelemetryRingHeader& h) {
+    fprintf(stderr, "[INGEST] %llu frames, %llu bytes, %llu crc errors, %llu skipped, %llu gaps\n",
+            (unsigned long long)h.writeIndex.load(), (unsigned long long)h.bytes.load(),
+            (unsigned long long)h.crcErrors.load(), (unsigned long long)h.bytesSkipped.load(),
+            (unsigned long long)h.sequenceGaps.load());
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--baud rate] [--shm name] [--slots n] [--stats seconds] device\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* device = nullptr;
+    const char* shmName = TELEMETRY_RING_DEFAULT_NAME;
+    uint32_t baud = 115200;
+    uint32_t slots = TELEMETRY_RING_DEFAULT_SLOTS;
+    uint32_t statsInterval_s = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--baud" && i + 1 < argc) {
+            baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--shm" && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (arg == "--slots" && i + 1 < argc) {
+            slots = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statsInterval_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            device = argv[i];
+        }
+    }
+    if (device == nullptr) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int fd = openSerial(device, baud);
+    if (fd < 0) {
+        return 1;
+    }
+    TelemetryRingWriter ring;
+    if (!ring.create(shmName, slots)) {
+        perror(shmName);
+        fprintf(stderr, "(--slots must be a power of two)\n");
+        close(fd);
+        return 1;
+    }
+    fprintf(stderr, "[INGEST] %s @ %u -> %s, %u slots of %u bytes, telemetry v%u\n", device, baud, shmName,
+            slots, (unsigned)sizeof(TelemetryRingSlot), (unsigned)TELEMETRY_VERSION);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    //Stats from a side thread: the read loop stays free of formatting and stdio locks
+    std::thread reporter([&]() {
+        uint64_t last = ringNow_ns();
+        while (!stopRequested.load()) {
+            struct timespec tick = {0, 200 * 1000000L};
+            nanosleep(&tick, nullptr);
+            uint64_t now = ringNow_ns();
+            if (statsInterval_s > 0 && now - last >= (uint64_t)statsInterval_s * 1000000000ull) {
+                last = now;
+                printStats(*ring.getHeader());
+            }
+        }
+    });
+
+    SerialIngest ingest(fd, ring);
+    bool ok = ingest.run(stopRequested);
+    stopRequested.store(true);
+    reporter.join();
+
+    printStats(*ring.getHeader());
+    ring.close();
+    close(fd);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+//Follow the ingest daemon's shared-memory ring, the minimal reader.
+//
+//  g++ -O2 -std=c++11 -o ring_tail ring_tail.cpp -lrt
+//  ./ring_tail [--shm name] [--from-oldest] > live.csv           (CSV, like telemetry_decode --csv)
+//  ./ring_tail [--shm name] --raw >> flight.bin                   (recorder: raw frames)
+//
+//--raw writes the frames byte for byte as they came off the link, so the output
+//is a normal capture for telemetry_decode / flight_archive. Frames lost to a
+//slow reader are reported on stderr and at exit.
+
+#include "telemetry_ring.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define RING_TAIL_WAIT_MS        500
+#define RING_TAIL_STALE_NS       3000000000ull   //writer heartbeat older than this: daemon gone
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+static inline void printValue(FILE* f, double v)   { fprintf(f, "%.7f", v); }
+static inline void printValue(FILE* f, float v)    { fprintf(f, "%.3f", v); }
+static inline void printValue(FILE* f, uint32_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int32_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint16_t v) { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, int16_t v)  { fprintf(f, "%d", v); }
+static inline void printValue(FILE* f, uint8_t v)  { fprintf(f, "%u", v); }
+static inline void printValue(FILE* f, bool v)     { fprintf(f, "%u", v ? 1u : 0u); }
+
+//Copy out of the slot first: the row is printed only if the slot was not overwritten meanwhile
+struct RingRow {
+    uint16_t sequence;
+    uint64_t receive_ns;
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+};
+
+static void printCsvHeader(FILE* f) {
+    fprintf(f, "receive_ns,sequence");
+#define CSV_HEADER(type, name) fprintf(f, "," #name);
+    SENSOR_DATA_FIELDS(CSV_HEADER)
+#undef CSV_HEADER
+    fprintf(f, "\n");
+}
+
+static void printCsvRow(FILE* f, const RingRow& row) {
+    TelemetryPayload p;
+    memcpy(&p, row.frame + TELEMETRY_HEADER_SIZE, sizeof(p));
+    fprintf(f, "%llu,%u", (unsigned long long)row.receive_ns, row.sequence);
+#define CSV_VALUE(type, name) { type v = p.name; fputc(',', f); printValue(f, v); }
+    SENSOR_DATA_FIELDS(CSV_VALUE)
+#undef CSV_VALUE
+    fputc('\n', f);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--shm name] [--from-oldest] [--raw]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* shmName = TELEMETRY_RING_DEFAULT_NAME;
+    bool fromOldest = false;
+    bool raw = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (arg == "--from-oldest") {
+            fromOldest = true;
+        } else if (arg == "--raw") {
+            raw = true;
+        } else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    TelemetryRingReader reader;
+    if (!reader.attach(shmName, fromOldest)) {
+        perror(shmName);
+        return 1;
+    }
+    if (!raw) {
+        printCsvHeader(stdout);
+    }
+
+    uint64_t frames = 0;
+    uint64_t reportedLost = 0;
+    RingRow row;
+    while (!stopRequested) {
+        RingRead r = reader.read([&](const TelemetryRingSlot& slot) {
+            row.sequence = slot.sequence();
+            row.receive_ns = slot.receive_ns;
+            memcpy(row.frame, slot.frame, TELEMETRY_FRAME_SIZE);
+        });
+
+        if (r == RingRead::OK) {
+            frames++;
+            if (raw) {
+                fwrite(row.frame, 1, TELEMETRY_FRAME_SIZE, stdout);
+            } else {
+                printCsvRow(stdout, row);
+            }
+            continue;
+        }
+        if (r == RingRead::LAPPED) {
+            continue;
+        }
+
+        //Caught up: flush what we have, then sleep until the writer publishes
+        fflush(stdout);
+        if (reader.getLost() != reportedLost) {
+            fprintf(stderr, "[TAIL] %llu frames lost (reader too slow)\n",
+                    (unsigned long long)(reader.getLost() - reportedLost));
+            reportedLost = reader.getLost();
+        }
+        if (reader.isClosed()) {
+            break;
+        }
+        if (!reader.wait(RING_TAIL_WAIT_MS) && reader.isStale(ringNow_ns(), RING_TAIL_STALE_NS)) {
+            fprintf(stderr, "[TAIL] ingest daemon stopped updating the ring\n");
+            break;
+        }
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "[TAIL] %llu frames, %llu lost\n", (unsigned long long)frames,
+            (unsigned long long)reader.getLost());
+    return 0;
+}
@@ -0,0 +1,160 @@
+#ifndef SERIAL_INGEST_H
+#define SERIAL_INGEST_H
+
+//Serial port -> TelemetryDecoder -> TelemetryRing, the core of ingest_daemon.
+//Kept in a header so ingest_bench runs the exact same loop in a thread.
+
+#include "telemetry_ring.h"
+#include "../decoder/telemetry_decoder.h"
+
+#include <stdio.h>
+#include <atomic>
+
+#include <poll.h>
+#include <termios.h>
+
+#define SERIAL_INGEST_CHUNK       4096
+#define SERIAL_INGEST_POLL_MS     100       //also the heartbeat period when the link is silent
+
+
+//Decoder sink: every good frame goes straight into the next ring slot
+struct TelemetryRingSink {
+    TelemetryRingWriter& ring;
+    uint64_t receive_ns;                    //one timestamp per read() batch
+
+    explicit TelemetryRingSink(TelemetryRingWriter& writer) : ring(writer), receive_ns(0) {}
+
+    void onFrame(uint16_t sequence, const uint8_t* frame) {
+        (void)sequence;
+        ring.publish(frame, receive_ns);
+    }
+};
+
+
+static speed_t serialSpeed(uint32_t baud) {
+    switch (baud) {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        default:      return 0;
+    }
+}
+
+//Open a serial device (or pty) raw, non-blocking; -1 on error (message printed)
+static int openSerial(const char* device, uint32_t baud) {
+    int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        perror(device);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        perror(device);
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    speed_t speed = serialSpeed(baud);
+    if (speed == 0) {
+        fprintf(stderr, "Unsupported baud rate %u\n", baud);
+        close(fd);
+        return -1;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        perror(device);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/**
+ Read loop: one read() of up to SERIAL_INGEST_CHUNK bytes is decoded and
+ published as a batch, readers are woken once per batch. Returns when stop is
+ set or the device fails (unplugged: false).
+ */
+class SerialIngest {
+public:
+    SerialIngest(int serialFd, TelemetryRingWriter& writer) : fd(serialFd), ring(writer), sink(writer) {}
+
+    bool run(const std::atomic<bool>& stop) {
+        uint8_t buf[SERIAL_INGEST_CHUNK];
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            int ready = poll(&pfd, 1, SERIAL_INGEST_POLL_MS);
+            uint64_t now = ringNow_ns();
+            ring.heartbeat(now);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("poll");
+                return false;
+            }
+            if (ready == 0) {
+                continue;
+            }
+            if (pfd.revents & (POLLERR | POLLNVAL)) {
+                fprintf(stderr, "Serial device error\n");
+                return false;
+            }
+
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    continue;
+                }
+                perror("read");
+                return false;
+            }
+            if (n == 0) {
+                //pty with no writer left, or device gone: wait instead of spinning
+                if (pfd.revents & POLLHUP) {
+                    struct timespec idle = {0, SERIAL_INGEST_POLL_MS * 1000000L};
+                    nanosleep(&idle, nullptr);
+                }
+                continue;
+            }
+
+            sink.receive_ns = now;
+            if (decoder.decodeFrames(buf, (size_t)n, sink) > 0) {
+                ring.notify();
+            }
+            publishStats();
+        }
+        return true;
+    }
+
+    const TelemetryDecodeStats& getStats() const {
+        return decoder.getStats();
+    }
+
+private:
+    int fd;
+    TelemetryRingWriter& ring;
+    TelemetryRingSink sink;
+    TelemetryDecoder decoder;
+
+    void publishStats() {
+        const TelemetryDecodeStats& s = decoder.getStats();
+        TelemetryRingHeader* h = ring.getHeader();
+        h->bytes.store(s.bytes, std::memory_order_relaxed);
+        h->crcErrors.store(s.crcErrors, std::memory_order_relaxed);
+        h->bytesSkipped.store(s.bytesSkipped, std::memory_order_relaxed);
+        h->sequenceGaps.store(s.sequenceGaps, std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+//Shared-memory ring of decoded telemetry frames: one writer (ingest_daemon),
+//any number of readers in other processes (dashboard, recorder, ML scripts).
+//
+//  /dev/shm/<name>:  [TelemetryRingHeader][slot 0][slot 1]...[slot N-1]
+//
+//Every slot holds one CRC-checked frame exactly as received, so the payload is
+//read in place as a packed TelemetryPayload (no copy, no re-parse). The writer
+//never waits for a reader: a reader that falls more than N frames behind loses
+//the oldest ones and is told how many.
+//
+//Each slot is a seqlock: seq = 2 i + 1 while frame i is written into it,
+//2 i + 2 once it is complete. A reader checks seq before and after looking at
+//the slot, so a slot overwritten under its feet is detected, not returned.
+//Idle readers sleep on a futex instead of polling.
+//
+//Non-C++ readers (numpy over mmap) use the fixed offsets: header is
+//TELEMETRY_RING_HEADER_SIZE bytes, slot i at header + i * slotSize, inside a
+//slot seq at 0 (u64), receive_ns at 8 (u64), frame at 16.
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../../embedded/lolin esp8266/telemetry_packet.h"
+
+#define TELEMETRY_RING_MAGIC          0x47524C54u    //"TLRG"
+#define TELEMETRY_RING_LAYOUT         1
+#define TELEMETRY_RING_DEFAULT_NAME   "/cubesat_telemetry"
+#define TELEMETRY_RING_DEFAULT_SLOTS  4096
+#define TELEMETRY_RING_HEADER_SIZE    256
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ring counters must be lock-free to live in shared memory");
+
+
+static inline uint64_t ringNow_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline long ringFutex(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+
+struct TelemetryRingHeader {
+    std::atomic<uint32_t> magic;          //written last by the writer: ring is ready
+    uint16_t layout;                      //TELEMETRY_RING_LAYOUT
+    uint8_t telemetryVersion;             //TELEMETRY_VERSION of the frames
+    uint8_t frameSize;                    //TELEMETRY_FRAME_SIZE
+    uint32_t slotCount;                   //power of two
+    uint32_t slotSize;
+    int32_t writerPid;
+
+    alignas(64) std::atomic<uint64_t> writeIndex;   //frames published so far
+    std::atomic<uint32_t> wakeup;         //futex word, bumped on publish when someone sleeps
+    std::atomic<uint32_t> sleepers;
+    std::atomic<uint64_t> heartbeat_ns;   //CLOCK_MONOTONIC of the writer's last poll
+    std::atomic<uint32_t> closed;         //writer exited cleanly
+
+    //Decoder counters, for any reader to display (relaxed)
+    alignas(64) std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> crcErrors;
+    std::atomic<uint64_t> bytesSkipped;
+    std::atomic<uint64_t> sequenceGaps;
+};
+
+static_assert(sizeof(TelemetryRingHeader) <= TELEMETRY_RING_HEADER_SIZE, "header outgrew its fixed size");
+
+struct alignas(64) TelemetryRingSlot {
+    std::atomic<uint64_t> seq;
+    uint64_t receive_ns;                  //CLOCK_MONOTONIC when the daemon decoded the frame
+    uint8_t frame[TELEMETRY_FRAME_SIZE];  //raw frame, header + payload + CRC
+
+    uint16_t sequence() const {
+        return (uint16_t)(frame[4] | (frame[5] << 8));
+    }
+
+    //Packed, alignment 1: fields can be read in place
+    const TelemetryPayload& payload() const {
+        return *reinterpret_cast<const TelemetryPayload*>(frame + TELEMETRY_HEADER_SIZE);
+    }
+};
+
+static inline size_t telemetryRingBytes(uint32_t slotCount) {
+    return TELEMETRY_RING_HEADER_SIZE + (size_t)slotCount * sizeof(TelemetryRingSlot);
+}
+
+
+/**
+ Writer side, owned by the ingest daemon
+ create() replaces any ring left by a crashed daemon; readers still mapping
+ the old one see its heartbeat stop and attach again.
+ */
+class TelemetryRingWriter {
+public:
+    TelemetryRingWriter() : header(nullptr), slots(nullptr), mapBytes(0), index(0) {
+        name[0] = '\0';
+    }
+
+    ~TelemetryRingWriter() {
+        close();
+    }
+
+    bool create(const char* shmName, uint32_t slotCount) {
+        if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0) {
+            errno = EINVAL;
+            return false;
+        }
+        strncpy(name, shmName, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+
+        shm_unlink(name);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        mapBytes = telemetryRingBytes(slotCount);
+        if (ftruncate(fd, (off_t)mapBytes) != 0) {
+            ::close(fd);
+            shm_unlink(name);
+            return false;
+        }
+        void* map = mmap(nullptr, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            shm_unlink(name);
+            return false;
+        }
+
+        //ftruncate gave zeroed pages: every counter and slot seq starts at 0
+        header = static_cast<TelemetryRingHeader*>(map);
+        slots = reinterpret_cast<TelemetryRingSlot*>(static_cast<uint8_t*>(map) + TELEMETRY_RING_HEADER_SIZE);
+        header->layout = TELEMETRY_RING_LAYOUT;
+        header->telemetryVersion = TELEMETRY_VERSION;
+        header->frameSize = (uint8_t)TELEMETRY_FRAME_SIZE;
+        header->slotCount = slotCount;
+        header->slotSize = (uint32_t)sizeof(TelemetryRingSlot);
+        header->writerPid = (int32_t)getpid();
+        header->heartbeat_ns.store(ringNow_ns(), std::memory_order_relaxed);
+        header->magic.store(TELEMETRY_RING_MAGIC, std::memory_order_release);
+        index = 0;
+        return true;
+    }
+
+    //Copy one good frame into the next slot (wake readers separately, once per batch)
+    void publish(const uint8_t* frame, uint64_t receive_ns) {
+        TelemetryRingSlot& slot = slots[index & (header->slotCount - 1)];
+        slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.receive_ns = receive_ns;
+        memcpy(slot.frame, frame, TELEMETRY_FRAME_SIZE);
+        slot.seq.store(2 * index + 2, std::memory_order_release);
+        index++;
+        header->writeIndex.store(index, std::memory_order_release);
+    }
+
+    //Wake sleeping readers; a fence and a single load when nobody sleeps.
+    //The fence orders the writeIndex stores before the sleepers load: a reader
+    //increments sleepers and then checks writeIndex, so without it both sides
+    //could miss each other and the reader sleeps until its timeout
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header->sleepers.load(std::memory_order_seq_cst) > 0) {
+            header->wakeup.fetch_add(1, std::memory_order_seq_cst);
+            ringFutex(&header->wakeup, FUTEX_WAKE, INT32_MAX, nullptr);
+        }
+    }
+
+    void heartbeat(uint64_t now_ns) {
+        header->heartbeat_ns.store(now_ns, std::memory_order_relaxed);
+    }
+
+    TelemetryRingHeader* getHeader() {
+        return header;
+    }
+
+    uint64_t getWriteIndex() const {
+        return index;
+    }
+
+    //Mark closed, wake everyone and remove the name (mapped readers keep the memory)
+    void close() {
+        if (header == nullptr) {
+            return;
+        }
+        header->closed.store(1, std::memory_order_release);
+        header->wakeup.fetch_add(1, std::memory_order_seq_cst);
+        ringFutex(&header->wakeup, FUTEX_WAKE, INT32_MAX, nullptr);
+        munmap(header, mapBytes);
+        shm_unlink(name);
+        header = nullptr;
+        slots = nullptr;
+    }
+
+private:
+    char name[64];
+    TelemetryRingHeader* header;
+    TelemetryRingSlot* slots;
+    size_t mapBytes;
+    uint64_t index;                       //next frame index (only the writer writes it)
+};
+
+
+enum class RingRead {
+    OK,             //visit() saw a consistent frame
+    EMPTY,          //nothing new
+    LAPPED          //the writer overwrote the slot (reader too slow), frame skipped
+};
+
+/**
+ Reader side: attach by name, then read() in a loop
+ A new reader starts at the live edge (or at the oldest frame still in the
+ ring with fromOldest). read(visit) calls visit(const TelemetryRingSlot&) on
+ the slot in shared memory: take what you need inside visit, and only use it
+ if read() returns OK (the slot may be overwritten while visit runs).
+ */
+class TelemetryRingReader {
+public:
+    TelemetryRingReader() : header(nullptr), slots(nullptr), mapBytes(0), next(0), lost(0) {}
+
+    ~TelemetryRingReader() {
+        detach();
+    }
+
+    bool attach(const char* shmName, bool fromOldest = false) {
+        detach();
+        int fd = shm_open(shmName, O_RDWR, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < TELEMETRY_RING_HEADER_SIZE) {
+            ::close(fd);
+            errno = EAGAIN;
+            return false;
+        }
+        //Read-write: sleeping on the futex registers in the header, slots are only read
+        void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+        header = static_cast<TelemetryRingHeader*>(map);
+        mapBytes = (size_t)st.st_size;
+        if (header->magic.load(std::memory_order_acquire) != TELEMETRY_RING_MAGIC ||
+            header->layout != TELEMETRY_RING_LAYOUT ||
+            header->telemetryVersion != TELEMETRY_VERSION ||
+            header->frameSize != TELEMETRY_FRAME_SIZE ||
+            header->slotSize != sizeof(TelemetryRingSlot) ||
+            telemetryRingBytes(header->slotCount) > mapBytes) {
+            detach();
+            errno = EPROTO;
+            return false;
+        }
+        slots = reinterpret_cast<const TelemetryRingSlot*>(static_cast<uint8_t*>(map) + TELEMETRY_RING_HEADER_SIZE);
+        uint64_t w = header->writeIndex.load(std::memory_order_acquire);
+        next = fromOldest && w > header->slotCount ? w - header->slotCount : (fromOldest ? 0 : w);
+        lost = 0;
+        return true;
+    }
+
+    void detach() {
+        if (header != nullptr) {
+            munmap(header, mapBytes);
+        }
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    template <typename Visit>
+    RingRead read(Visit visit) {
+        uint64_t w = header->writeIndex.load(std::memory_order_acquire);
+        if (next == w) {
+            return RingRead::EMPTY;
+        }
+        if (w - next > header->slotCount) {
+            lost += w - next - header->slotCount;
+            next = w - header->slotCount;
+        }
+        const TelemetryRingSlot& slot = slots[next & (header->slotCount - 1)];
+        uint64_t expected = 2 * next + 2;
+        if (slot.seq.load(std::memory_order_acquire) != expected) {
+            lost++;
+            next++;
+            return RingRead::LAPPED;
+        }
+        visit(slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != expected) {
+            lost++;
+            next++;
+            return RingRead::LAPPED;
+        }
+        next++;
+        return RingRead::OK;
+    }
+
+    /**
+     Sleep until the writer publishes past our position, closes, or timeout_ms
+     passes. Returns false on timeout.
+     */
+    bool wait(uint32_t timeout_ms) {
+        uint32_t word = header->wakeup.load(std::memory_order_seq_cst);
+        header->sleepers.fetch_add(1, std::memory_order_seq_cst);
+        bool ready = header->writeIndex.load(std::memory_order_seq_cst) != next || isClosed();
+        if (!ready) {
+            struct timespec timeout;
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+            ringFutex(&header->wakeup, FUTEX_WAIT, word, &timeout);
+            ready = header->writeIndex.load(std::memory_order_acquire) != next || isClosed();
+        }
+        header->sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        return ready;
+    }
+
+    bool isClosed() const {
+        return header->closed.load(std::memory_order_acquire) != 0;
+    }
+
+    //Writer stopped polling for longer than timeout_ns (crashed or hung)
+    bool isStale(uint64_t now_ns, uint64_t timeout_ns) const {
+        return now_ns - header->heartbeat_ns.load(std::memory_order_relaxed) > timeout_ns;
+    }
+
+    const TelemetryRingHeader& getHeader() const {
+        return *header;
+    }
+
+    uint64_t getLost() const {
+        return lost;
+    }
+
+    //Frames published but not read yet
+    uint64_t getBacklog() const {
+        return header->writeIndex.load(std::memory_order_acquire) - next;
+    }
+
+private:
+    TelemetryRingHeader* header;
+    const TelemetryRingSlot* slots;
+    size_t mapBytes;
+    uint64_t next;                        //index of the next frame to read
+    uint64_t lost;
+};
+
+#endif
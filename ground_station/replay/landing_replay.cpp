@@ -0,0 +1,292 @@
+//Score landing-point predictions against the real touchdown of recorded flights.
+//
+//  g++ -O2 -std=c++11 -o landing_replay landing_replay.cpp "../../embedded/lolin esp8266/landing_predictor.cpp"
+//  ./landing_replay capture.bin [...]     (one flight per capture)
+//  ./landing_replay --synthetic [seed]    (simulated descent, known wind)
+//
+//Two tables per flight:
+//  onboard  the landing_* fields the payload sent in every frame
+//  replay   the same LandingPredictor re-run on the recorded GPS track,
+//           rebuild after changing LANDING_* to compare tunings
+//Errors are bucketed by how long before touchdown the prediction was made.
+
+#include "../decoder/telemetry_decoder.h"
+#include "../../embedded/lolin esp8266/landing_predictor.h"
+
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//MissionState ids (fsm.h)
+#define STATE_DESCENT_FREE   3
+#define STATE_DESCENT_STABLE 4
+#define STATE_LANDING        5
+#define STATE_FINAL_REPORT   6
+
+
+//The fields the scorer needs, independent of the float / fixed-point layout
+struct ReplayRow {
+    uint32_t time_ms;
+    uint8_t state;
+    bool fix;
+    int32_t lat_e7;
+    int32_t lon_e7;
+    float altitude_m;             //barometric AGL
+    bool landingValid;
+    int32_t landingLat_e7;
+    int32_t landingLon_e7;
+    float eta_s;
+};
+
+static inline int32_t toE7(double degrees) {
+    return (int32_t)lround(degrees * 1e7);
+}
+
+static ReplayRow rowAt(const TelemetryColumns& c, size_t i) {
+    ReplayRow r;
+    r.time_ms = c.timestamp_ms[i];
+    r.state = c.mission_state_id[i];
+    r.fix = c.gps_fix[i] != 0;
+    r.landingValid = c.landing_valid[i] != 0;
+    r.eta_s = c.landing_eta_ds[i] * 0.1f;
+#ifdef FIXED_POINT_PIPELINE
+    r.lat_e7 = c.latitude_e7[i];
+    r.lon_e7 = c.longitude_e7[i];
+    r.altitude_m = c.altitude_AGL_cm[i] * 0.01f;
+    r.landingLat_e7 = c.landing_lat_e7[i];
+    r.landingLon_e7 = c.landing_lon_e7[i];
+#else
+    r.lat_e7 = toE7(c.latitude[i]);
+    r.lon_e7 = toE7(c.longitude[i]);
+    r.altitude_m = c.altitude_AGL[i];
+    r.landingLat_e7 = toE7(c.landing_lat[i]);
+    r.landingLon_e7 = toE7(c.landing_lon[i]);
+#endif
+    return r;
+}
+
+static bool decodeCapture(const char* path, TelemetryColumns& columns) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    TelemetryDecoder decoder;
+    decoder.decode((const uint8_t*)map, (size_t)st.st_size, columns);
+    munmap(map, (size_t)st.st_size);
+    return true;
+}
+
+
+//Prediction error by lead time before touchdown
+#define BUCKET_COUNT 5
+static const float BUCKET_LIMIT_S[BUCKET_COUNT] = { 5, 10, 20, 40, 1e9 };
+static const char* const BUCKET_NAMES[BUCKET_COUNT] = { "0-5 s", "5-10 s", "10-20 s", "20-40 s", ">40 s" };
+
+struct ErrorTable {
+    uint32_t count[BUCKET_COUNT];
+    double sumDistance[BUCKET_COUNT];
+    double maxDistance[BUCKET_COUNT];
+    double sumEtaError[BUCKET_COUNT];       //|predicted - actual touchdown time|
+
+    ErrorTable() {
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            count[b] = 0;
+            sumDistance[b] = 0.0;
+            maxDistance[b] = 0.0;
+            sumEtaError[b] = 0.0;
+        }
+    }
+
+    void add(float lead_s, double distance_m, double etaError_s) {
+        int b = 0;
+        while (lead_s >= BUCKET_LIMIT_S[b]) {
+            b++;
+        }
+        count[b]++;
+        sumDistance[b] += distance_m;
+        if (distance_m > maxDistance[b]) {
+            maxDistance[b] = distance_m;
+        }
+        sumEtaError[b] += fabs(etaError_s);
+    }
+
+    void print(const char* title) const {
+        printf("  %-8s lead      preds   mean_m    max_m   eta_err_s\n", title);
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            if (count[b] == 0) {
+                continue;
+            }
+            printf("           %-8s %6u %8.1f %8.1f %11.2f\n", BUCKET_NAMES[b], count[b],
+                   sumDistance[b] / count[b], maxDistance[b], sumEtaError[b] / count[b]);
+        }
+    }
+};
+
+struct Touchdown {
+    uint32_t time_ms;
+    int32_t lat_e7;
+    int32_t lon_e7;
+};
+
+//First FINAL_REPORT row (or the last fix), position from the last fix up to there
+static bool findTouchdown(const std::vector<ReplayRow>& rows, Touchdown& td) {
+    bool found = false;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i].fix) {
+            td.time_ms = rows[i].time_ms;
+            td.lat_e7 = rows[i].lat_e7;
+            td.lon_e7 = rows[i].lon_e7;
+            found = true;
+        }
+        if (found && rows[i].state == STATE_FINAL_REPORT) {
+            td.time_ms = rows[i].time_ms;
+            break;
+        }
+    }
+    return found;
+}
+
+static void score(ErrorTable& table, const LandingPredictor& frame, const Touchdown& td,
+                  uint32_t time_ms, int32_t lat_e7, int32_t lon_e7, float eta_s) {
+    if (time_ms > td.time_ms) {
+        return;
+    }
+    float east, north;
+    frame.toLocal(lat_e7, lon_e7, east, north);
+    float lead_s = (td.time_ms - time_ms) / 1000.0f;
+    table.add(lead_s, hypot(east, north), eta_s - lead_s);
+}
+
+static void replayFlight(const char* name, const std::vector<ReplayRow>& rows) {
+    Touchdown td = { 0, 0, 0 };
+    if (!findTouchdown(rows, td)) {
+        printf("%s: no GPS fix, nothing to score\n", name);
+        return;
+    }
+
+    //Frame centred on the real touchdown: local coordinates are the error vector
+    LandingPredictor frame;
+    frame.setOrigin(td.lat_e7, td.lon_e7);
+
+    ErrorTable onboard;
+    ErrorTable replay;
+    LandingPredictor predictor;
+    int32_t lastLat = 0;
+    int32_t lastLon = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const ReplayRow& r = rows[i];
+        if (r.state < STATE_DESCENT_FREE || r.state > STATE_LANDING) {
+            continue;
+        }
+        if (r.landingValid) {
+            score(onboard, frame, td, r.time_ms, r.landingLat_e7, r.landingLon_e7, r.eta_s);
+        }
+        //Telemetry repeats the last fix between GPS updates, feed positions that moved
+        if (!r.fix || (predictor.getFixCount() > 0 && r.lat_e7 == lastLat && r.lon_e7 == lastLon)) {
+            continue;
+        }
+        lastLat = r.lat_e7;
+        lastLon = r.lon_e7;
+        predictor.addFix(r.lat_e7, r.lon_e7, r.altitude_m, r.time_ms);
+        const LandingEstimate& est = predictor.getEstimate();
+        if (est.valid) {
+            score(replay, frame, td, r.time_ms, est.landingLat_e7, est.landingLon_e7, est.timeToLanding_s);
+        }
+    }
+
+    printf("%s: touchdown at %u ms, %.7f %.7f\n", name, td.time_ms, td.lat_e7 * 1e-7, td.lon_e7 * 1e-7);
+    onboard.print("onboard");
+    replay.print("replay");
+}
+
+/**
+ Parachute descent from 300 m at ~5 m/s, wind 3 m/s E / 1 m/s N with a slow
+ gust, GPS at 5 Hz with 2 m noise, barometer with 0.3 m noise
+ */
+static void buildSynthetic(uint32_t seed, std::vector<ReplayRow>& rows) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const int32_t lat0 = 194326000;
+    const int32_t lon0 = -991332000;
+    LandingPredictor frame;
+    frame.setOrigin(lat0, lon0);
+
+    double east = 0.0, north = 0.0, altitude = 300.0;
+    for (uint32_t t = 0; ; t += 200) {
+        double windEast = 3.0 + 0.5 * sin(t / 5000.0);
+        double windNorth = 1.0;
+        double descent = 5.0 + 0.2 * sin(t / 7000.0);
+        ReplayRow r;
+        r.time_ms = t;
+        r.state = altitude > 10.0 ? STATE_DESCENT_STABLE : STATE_LANDING;
+        r.fix = true;
+        frame.toGlobal((float)(east + 2.0 * noise(rng)), (float)(north + 2.0 * noise(rng)), r.lat_e7, r.lon_e7);
+        r.altitude_m = (float)(altitude + 0.3 * noise(rng));
+        r.landingValid = false;
+        if (altitude <= 0.0) {
+            frame.toGlobal((float)east, (float)north, r.lat_e7, r.lon_e7);
+            r.state = STATE_FINAL_REPORT;
+            rows.push_back(r);
+            return;
+        }
+        rows.push_back(r);
+        east += windEast * 0.2;
+        north += windNorth * 0.2;
+        altitude -= descent * 0.2;
+    }
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s capture.bin [...]\n       %s --synthetic [seed]\n", argv0, argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (std::string(argv[1]) == "--synthetic") {
+        std::vector<ReplayRow> rows;
+        buildSynthetic(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 1, rows);
+        replayFlight("synthetic", rows);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        TelemetryColumns columns;
+        if (!decodeCapture(argv[i], columns)) {
+            return 1;
+        }
+        std::vector<ReplayRow> rows;
+        rows.reserve(columns.size());
+        for (size_t row = 0; row < columns.size(); row++) {
+            rows.push_back(rowAt(columns, row));
+        }
+        replayFlight(argv[i], rows);
+    }
+    return 0;
+}
@@ -0,0 +1,337 @@
+//Align the per-sensor streams of recorded flights onto one time grid.
+//
+//  g++ -O2 -std=c++11 -o resample_replay resample_replay.cpp "../../embedded/lolin esp8266/resampler.cpp"
+//  ./resample_replay [--period ms] [--latency ms] capture.bin > aligned.csv
+//  ./resample_replay --synthetic [seed]    (streams with known offsets, error report)
+//
+//Capture mode: every sensor value is pushed at its own *_time_us, not at the
+//readAll time of the frame that carried it, and the grid is written as CSV with
+//the age of each value (0 = interpolated). The skew between readAll and each
+//sensor is summarised on stderr.
+//Synthetic mode: known signals sampled at different rates and phases, the
+//resampled values are compared with the truth at the grid times, next to the
+//naive "latest value at readAll" pairing the payload used before.
+
+#include "../decoder/telemetry_decoder.h"
+#include "../../embedded/lolin esp8266/resampler.h"
+
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum StreamId {
+    STREAM_ALTITUDE,
+    STREAM_ACCEL_Z,
+    STREAM_GPS_ALTITUDE,
+    STREAM_GPS_SPEED,
+    STREAM_COUNT
+};
+
+static const char* const STREAM_NAMES[STREAM_COUNT] = { "altitude_m", "accel_z_g", "gps_altitude_m", "gps_speed_mps" };
+
+
+//One telemetry row in SI units, independent of the float / fixed-point layout
+struct StreamRow {
+    uint32_t time_ms;
+    uint32_t time_us;
+    uint32_t sampleTime_us[STREAM_COUNT];
+    float value[STREAM_COUNT];
+    bool valid[STREAM_COUNT];
+};
+
+static StreamRow rowAt(const TelemetryColumns& c, size_t i) {
+    StreamRow r;
+    r.time_ms = c.timestamp_ms[i];
+    r.time_us = c.timestamp_us[i];
+    r.sampleTime_us[STREAM_ALTITUDE] = c.bmp_time_us[i];
+    r.sampleTime_us[STREAM_ACCEL_Z] = c.imu_time_us[i];
+    r.sampleTime_us[STREAM_GPS_ALTITUDE] = c.gps_fix_time_us[i];
+    r.sampleTime_us[STREAM_GPS_SPEED] = c.gps_fix_time_us[i];
+    r.valid[STREAM_ALTITUDE] = c.bmp_valid[i] != 0;
+    r.valid[STREAM_ACCEL_Z] = c.imu_valid[i] != 0;
+    r.valid[STREAM_GPS_ALTITUDE] = c.gps_fix[i] != 0;
+    r.valid[STREAM_GPS_SPEED] = c.gps_fix[i] != 0;
+#ifdef FIXED_POINT_PIPELINE
+    r.value[STREAM_ALTITUDE] = c.altitude_AGL_cm[i] * 0.01f;
+    r.value[STREAM_ACCEL_Z] = c.accel_z_mg[i] * 0.001f;
+    r.value[STREAM_GPS_ALTITUDE] = c.gps_altitude_cm[i] * 0.01f;
+    r.value[STREAM_GPS_SPEED] = c.gps_speed_cmps[i] * 0.01f;
+#else
+    r.value[STREAM_ALTITUDE] = c.altitude_AGL[i];
+    r.value[STREAM_ACCEL_Z] = c.accel_z_g[i];
+    r.value[STREAM_GPS_ALTITUDE] = c.gps_altitude_m[i];
+    r.value[STREAM_GPS_SPEED] = c.gps_speed_mps[i];
+#endif
+    return r;
+}
+
+static bool decodeCapture(const char* path, TelemetryColumns& columns) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    TelemetryDecoder decoder;
+    decoder.decode((const uint8_t*)map, (size_t)st.st_size, columns);
+    munmap(map, (size_t)st.st_size);
+    return true;
+}
+
+//Barometer and IMU are interpolated, GPS values are held from fix to fix
+static void addStreams(Resampler& resampler, uint32_t period_us) {
+    resampler.addStream(ResampleMode::INTERPOLATE, 4 * period_us, 2 * period_us);
+    resampler.addStream(ResampleMode::INTERPOLATE, 4 * period_us, 2 * period_us);
+    resampler.addStream(ResampleMode::HOLD, 0, 1500000);
+    resampler.addStream(ResampleMode::HOLD, 0, 1500000);
+}
+
+
+//Skew between readAll and the sample each frame carried (negative: clock mismatch)
+struct SkewStats {
+    uint32_t count;
+    double sum_us;
+    int32_t max_us;
+
+    SkewStats() : count(0), sum_us(0.0), max_us(INT32_MIN) {}
+
+    void add(int32_t skew_us) {
+        count++;
+        sum_us += skew_us;
+        if (skew_us > max_us) {
+            max_us = skew_us;
+        }
+    }
+};
+
+static void resampleCapture(const std::vector<StreamRow>& rows, uint32_t period_us, uint32_t latency_us) {
+    Resampler resampler;
+    addStreams(resampler, period_us);
+    resampler.begin(period_us, latency_us);
+
+    SkewStats skew[STREAM_COUNT];
+    printf("time_ms");
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        printf(",%s,%s_age_ms", STREAM_NAMES[s], STREAM_NAMES[s]);
+    }
+    printf(",stale_mask\n");
+
+    ResampledFrame frame;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const StreamRow& r = rows[i];
+        for (int s = 0; s < STREAM_COUNT; s++) {
+            if (r.valid[s] && r.sampleTime_us[s] != 0 && resampler.push((uint8_t)s, r.sampleTime_us[s], r.value[s])) {
+                skew[s].add((int32_t)(r.time_us - r.sampleTime_us[s]));
+            }
+        }
+        //Grid times map to the millis() axis through the row they come out at
+        while (resampler.next(r.time_us, frame)) {
+            printf("%.1f", r.time_ms - (int32_t)(r.time_us - frame.time_us) / 1000.0);
+            for (int s = 0; s < STREAM_COUNT; s++) {
+                if (frame.validMask & (1 << s)) {
+                    printf(",%.4f,%.1f", frame.value[s], frame.age_us[s] / 1000.0);
+                } else {
+                    printf(",,");
+                }
+            }
+            printf(",%u\n", frame.staleMask);
+        }
+    }
+
+    fprintf(stderr, "%-16s %8s %12s %12s\n", "stream", "samples", "mean_skew_ms", "max_skew_ms");
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        if (skew[s].count > 0) {
+            fprintf(stderr, "%-16s %8u %12.1f %12.1f\n", STREAM_NAMES[s], skew[s].count,
+                    skew[s].sum_us / skew[s].count / 1000.0, skew[s].max_us / 1000.0);
+        }
+    }
+    if (resampler.getSkipped() > 0) {
+        fprintf(stderr, "%u grid points skipped (gaps in the capture)\n", resampler.getSkipped());
+    }
+}
+
+
+/**
+ Synthetic streams with known offsets: readAll every 50 ms, barometer every
+ 80 ms (phase 13 ms), IMU every 20 ms (phase 7 ms), GPS at 5 Hz with the fix
+ 150 ms old when it arrives. Truth is a descent with a pendulum swing in
+ accel_z; the clock starts 10 s before the micros() rollover.
+ */
+static double truth(int stream, double t_s) {
+    switch (stream) {
+    case STREAM_ALTITUDE:
+    case STREAM_GPS_ALTITUDE:
+        return 300.0 - 5.0 * t_s;
+    case STREAM_ACCEL_Z:
+        return 1.0 + 0.3 * sin(2.0 * M_PI * 0.8 * t_s);
+    default:
+        return 3.0 + 0.5 * sin(t_s / 5.0);
+    }
+}
+
+struct ErrorStats {
+    uint32_t count;
+    double sumSq;
+    double maxAbs;
+    uint32_t maxAge_us;
+    uint32_t stale;
+
+    ErrorStats() : count(0), sumSq(0.0), maxAbs(0.0), maxAge_us(0), stale(0) {}
+
+    void add(double error) {
+        count++;
+        sumSq += error * error;
+        if (fabs(error) > maxAbs) {
+            maxAbs = fabs(error);
+        }
+    }
+};
+
+static void runSynthetic(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> jitter(0, 2000);    //loop jitter in the readAll time
+
+    const uint32_t start_us = 0xFFFFFFFFu - 10000000u;
+    const uint32_t readPeriod_us = 50000;
+    const uint32_t period_us[STREAM_COUNT] = { 80000, 20000, 200000, 200000 };
+    const uint32_t phase_us[STREAM_COUNT] = { 13000, 7000, 0, 0 };
+    const uint32_t gpsLatency_us = 150000;
+    const uint32_t gridPeriod_us = 50000;
+    const uint32_t latency_us = 100000;
+
+    Resampler resampler;
+    addStreams(resampler, gridPeriod_us);
+    resampler.begin(gridPeriod_us, latency_us);
+
+    ErrorStats resampled[STREAM_COUNT];
+    ErrorStats naive[STREAM_COUNT];
+    double latest[STREAM_COUNT];
+    bool haveLatest = false;
+
+    ResampledFrame frame;
+    for (uint32_t elapsed = 0; elapsed < 60000000u; elapsed += readPeriod_us) {
+        uint32_t read_us = elapsed + jitter(rng);
+        //Newest sample of each stream that has completed (GPS: arrived) by read_us
+        for (int s = 0; s < STREAM_COUNT; s++) {
+            uint32_t arrival = s >= STREAM_GPS_ALTITUDE ? gpsLatency_us : 0;
+            if (read_us < phase_us[s] + arrival) {
+                continue;
+            }
+            uint32_t n = (read_us - phase_us[s] - arrival) / period_us[s];
+            uint32_t sample_us = phase_us[s] + n * period_us[s];
+            double value = truth(s, sample_us / 1e6);
+            latest[s] = value;
+            resampler.push((uint8_t)s, start_us + sample_us, (float)value);
+        }
+        haveLatest = elapsed >= 200000 + gpsLatency_us;
+
+        //Naive pairing: every stream's latest value taken as the value at read_us
+        if (haveLatest) {
+            for (int s = 0; s < STREAM_COUNT; s++) {
+                naive[s].add(latest[s] - truth(s, read_us / 1e6));
+            }
+        }
+        while (resampler.next(start_us + read_us, frame)) {
+            double t_s = (uint32_t)(frame.time_us - start_us) / 1e6;
+            for (int s = 0; s < STREAM_COUNT; s++) {
+                if (!(frame.validMask & (1 << s))) {
+                    continue;
+                }
+                //Held GPS values are compared with the truth at their fix time
+                double reference = frame.age_us[s] > 0 && s >= STREAM_GPS_ALTITUDE
+                                       ? truth(s, t_s - frame.age_us[s] / 1e6)
+                                       : truth(s, t_s);
+                resampled[s].add(frame.value[s] - reference);
+                if (frame.age_us[s] > resampled[s].maxAge_us) {
+                    resampled[s].maxAge_us = frame.age_us[s];
+                }
+                if (frame.staleMask & (1 << s)) {
+                    resampled[s].stale++;
+                }
+            }
+        }
+    }
+
+    printf("synthetic (seed %u): grid %u ms, latency %u ms, micros() wraps after 10 s\n",
+           seed, gridPeriod_us / 1000, latency_us / 1000);
+    printf("  %-16s %7s %10s %10s %10s %10s %6s\n", "stream", "points", "rms", "max", "naive_rms", "max_age_ms", "stale");
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        const ErrorStats& e = resampled[s];
+        printf("  %-16s %7u %10.4f %10.4f %10.4f %10.1f %6u\n", STREAM_NAMES[s], e.count,
+               sqrt(e.sumSq / e.count), e.maxAbs, sqrt(naive[s].sumSq / naive[s].count),
+               e.maxAge_us / 1000.0, e.stale);
+    }
+    if (resampler.getSkipped() > 0) {
+        printf("  %u grid points skipped\n", resampler.getSkipped());
+    }
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--period ms] [--latency ms] capture.bin\n       %s --synthetic [seed]\n",
+            argv0, argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (std::string(argv[1]) == "--synthetic") {
+        runSynthetic(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 1);
+        return 0;
+    }
+
+    uint32_t period_ms = 50;
+    uint32_t latency_ms = 200;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--period" || arg == "--latency") && i + 1 < argc) {
+            uint32_t v = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            (arg == "--period" ? period_ms : latency_ms) = v;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!path || period_ms == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TelemetryColumns columns;
+    if (!decodeCapture(path, columns)) {
+        return 1;
+    }
+    std::vector<StreamRow> rows;
+    rows.reserve(columns.size());
+    for (size_t row = 0; row < columns.size(); row++) {
+        rows.push_back(rowAt(columns, row));
+    }
+    resampleCapture(rows, period_ms * 1000, latency_ms * 1000);
+    return 0;
+}